@@ -7,6 +7,7 @@
 #include "IComposite.h"
 #include "LookupTableFactory.h"
 #include "MultiLag.h"
+#include "MultiPoly.h"
 #include "ObjectCache.h"
 #include "poly.h"
 #include "SinOscillator.h"
@@ -45,6 +46,10 @@ public:
  *
  * Performance measure for 1.0 = 42.44
  * reduced polynomial order to what we actually use (10), perf = 39.5
+ * MultiPoly (clenshaw) and calcVolumes only on change: mono 30% faster than that.
+ *
+ * Polyphonic: the CV and external audio inputs may carry up to 16 channels.
+ * The harmonic controls (knobs and CV) are shared by all the channels.
  */
 template <class TBase>
 class CHB : public TBase
@@ -151,23 +156,38 @@ public:
         knobToFilterL = makeLPFDirectFilterLookup<float>(this->engineGetSampleTime());
     }
 
+    /**
+     * frequency of channel 0, for unit tests
+     */
     float _freq = 0;
 
+    static const int maxChannels = 16;
+
 private:
     int cycleCount = 1;
     int clipCount = 0;
     int signalCount = 0;
     const int clipDuration = 4000;
-    float finalGain = 0;
+    float finalGain[maxChannels] = {0};
     bool isExternalAudio = false;
+    int numChannels = 1;
+
+    /**
+     * largest input of all the channels, before clipping.
+     * drives the clip LED.
+     */
+    float maxInput = 0;
 
     static const int polyOrder = 10;
 
     /**
      * The waveshaper that is the heart of this module.
-     * Let's use doubles.
+     * All the channels run at once.
      */
-    Poly<double, polyOrder> poly;
+    MultiPoly<maxChannels> poly;
+
+    float polyInput[maxChannels] = {0};
+    float polyOutput[maxChannels] = {0};
 
     MultiLag<12> lag;
 
@@ -183,10 +203,18 @@ private:
     float _volume[12] = {0};
 
     /**
-     * Internal sine wave oscillator to drive the waveshaper
+     * All the inputs to calcVolumes, as of the last time it ran.
+     * Lets us skip calcVolumes when nothing has changed.
      */
-    SinOscillatorParams<float> sinParams;
-    SinOscillatorState<float> sinState;
+    static const int numVolumeInputs = 4 * 10 + 9;
+    float lastVolumeInputs[numVolumeInputs];
+    bool volumeInputsChanged();
+
+    /**
+     * Internal sine wave oscillators to drive the waveshaper
+     */
+    SinOscillatorParams<float> sinParams[maxChannels];
+    SinOscillatorState<float> sinState[maxChannels];
 
     // just maps 0..1 to 0..1
     std::shared_ptr<LookupTableParams<float>> audioTaper = {ObjectCache<float>::getAudioTaper()};
@@ -212,7 +240,7 @@ private:
      * Do all the processing to get the input waveform
      * that will be fed to the polynomials
      */
-    float getInput();
+    float getInput(int channel);
 
     void calcVolumes(float *);
 
@@ -236,6 +264,10 @@ private:
 template <class TBase>
 inline void  CHB<TBase>::init()
 {
+    for (int i = 0; i < numVolumeInputs; ++i) {
+        // something no input can be, so we will calc the first time
+        lastVolumeInputs[i] = -1000;
+    }
     for (int i = 0; i < polyOrder; ++i) {
         _octave[i] = std::log2(float(i + 1));
     }
@@ -276,7 +308,7 @@ inline void CHB<TBase>::updateLagTC()
 }
 
 template <class TBase>
-inline float CHB<TBase>::getInput()
+inline float CHB<TBase>::getInput(int channel)
 {
     assert(TBase::engineGetSampleTime() > 0);
 
@@ -284,32 +316,34 @@ inline float CHB<TBase>::getInput()
     float pitch = 1.0f + roundf(TBase::params[PARAM_OCTAVE].value) +
         TBase::params[PARAM_SEMIS].value / 12.0f +
         TBase::params[PARAM_TUNE].value / 12.0f;
-    pitch += TBase::inputs[CV_INPUT].getVoltage(0);
-    pitch += .25f * TBase::inputs[PITCH_MOD_INPUT].getVoltage(0) *
+    pitch += TBase::inputs[CV_INPUT].getPolyVoltage(channel);
+    pitch += .25f * TBase::inputs[PITCH_MOD_INPUT].getPolyVoltage(channel) *
         taper(TBase::params[PARAM_PITCH_MOD_TRIM].value);
 
     const float q = float(log2(261.626));       // move up to pitch range of EvenVCO
     pitch += q;
-    _freq = expLookup(pitch);
+    float freq = expLookup(pitch);
 
-    if (_freq < .01f) {
-        _freq = .01f;
+    if (freq < .01f) {
+        freq = .01f;
     }
 
     // Multiply in the Linear FM contribution
-    _freq *= 1.0f + TBase::inputs[LINEAR_FM_INPUT].getVoltage(0) * taper(TBase::params[PARAM_LINEAR_FM_TRIM].value);
-    float time = std::clamp(_freq * TBase::engineGetSampleTime(), -.5f, 0.5f);
+    freq *= 1.0f + TBase::inputs[LINEAR_FM_INPUT].getPolyVoltage(channel) * taper(TBase::params[PARAM_LINEAR_FM_TRIM].value);
+    float time = std::clamp(freq * TBase::engineGetSampleTime(), -.5f, 0.5f);
+    if (channel == 0) {
+        _freq = freq;
+    }
 
-    Osc::setFrequency(sinParams, time);
+    Osc::setFrequency(sinParams[channel], time);
 
     if (cycleCount == 0) {
         // Get the gain from the envelope generator in
         // eGain = {0 .. 10.0f }
-        float eGain = TBase::inputs[ENV_INPUT].isConnected() ? TBase::inputs[ENV_INPUT].getVoltage(0) : 10.f;
-        isExternalAudio = TBase::inputs[AUDIO_INPUT].isConnected();
+        float eGain = TBase::inputs[ENV_INPUT].isConnected() ? TBase::inputs[ENV_INPUT].getPolyVoltage(channel) : 10.f;
 
         const float gainKnobValue = TBase::params[PARAM_EXTGAIN].value;
-        const float gainCVValue = TBase::inputs[GAIN_INPUT].getVoltage(0);
+        const float gainCVValue = TBase::inputs[GAIN_INPUT].getPolyVoltage(channel);
         const float gainTrimValue = TBase::params[PARAM_EXTGAIN_TRIM].value;
         const float combinedGain = gainCombiner(gainCVValue, gainKnobValue, gainTrimValue);
 
@@ -317,14 +351,15 @@ inline float CHB<TBase>::getInput()
         const float taperedGain = .5f * taper(combinedGain);
 
         // final gain 0..5
-        finalGain = taperedGain * eGain;
+        finalGain[channel] = taperedGain * eGain;
+        poly.setInputGain(channel, std::min(finalGain[channel], 1.f));
     }
 
-    float input = finalGain * (isExternalAudio ?
-        TBase::inputs[AUDIO_INPUT].getVoltage(0) :
-        Osc::run(sinState, sinParams));
+    float input = finalGain[channel] * (isExternalAudio ?
+        TBase::inputs[AUDIO_INPUT].getPolyVoltage(channel) :
+        Osc::run(sinState[channel], sinParams[channel]));
 
-    checkClipping(input);
+    maxInput = std::max(maxInput, input);
 
     // Now clip or fold to keep in -1...+1
     if (TBase::params[PARAM_FOLD].value > .5) {
@@ -370,6 +405,38 @@ inline void CHB<TBase>::checkClipping(float input)
     }
 }
 
+template <class TBase>
+inline bool CHB<TBase>::volumeInputsChanged()
+{
+    float inputs[numVolumeInputs];
+    int index = 0;
+    for (int i = 0; i < numHarmonics; ++i) {
+        inputs[index++] = TBase::params[i + PARAM_H0].value;
+        inputs[index++] = TBase::inputs[i + H0_INPUT].isConnected() ? 1.f : 0.f;
+        inputs[index++] = TBase::inputs[i + H0_INPUT].getVoltage(0);
+        inputs[index++] = 0;
+    }
+    inputs[index++] = TBase::inputs[EVEN_INPUT].getVoltage(0);
+    inputs[index++] = TBase::params[PARAM_MAG_EVEN].value;
+    inputs[index++] = TBase::params[PARAM_EVEN_TRIM].value;
+    inputs[index++] = TBase::inputs[ODD_INPUT].getVoltage(0);
+    inputs[index++] = TBase::params[PARAM_MAG_ODD].value;
+    inputs[index++] = TBase::params[PARAM_ODD_TRIM].value;
+    inputs[index++] = TBase::inputs[SLOPE_INPUT].getVoltage(0);
+    inputs[index++] = TBase::params[PARAM_SLOPE].value;
+    inputs[index++] = TBase::params[PARAM_SLOPE_TRIM].value;
+    assert(index == numVolumeInputs);
+
+    bool changed = false;
+    for (int i = 0; i < numVolumeInputs; ++i) {
+        if (inputs[i] != lastVolumeInputs[i]) {
+            lastVolumeInputs[i] = inputs[i];
+            changed = true;
+        }
+    }
+    return changed;
+}
+
 template <class TBase>
 inline void CHB<TBase>::calcVolumes(float * volumes)
 {
@@ -428,24 +495,41 @@ inline void CHB<TBase>::step()
         cycleCount = 3;
     }
 
+    if (cycleCount == 0) {
+        numChannels = std::max<int>(1, std::max<int>(
+            TBase::inputs[CV_INPUT].channels,
+            TBase::inputs[AUDIO_INPUT].channels));
+        isExternalAudio = TBase::inputs[AUDIO_INPUT].isConnected();
+        TBase::outputs[MIX_OUTPUT].setChannels(numChannels);
+    }
+
     // do all the processing to get the carrier signal
     // Does the pitch every cycle, vol every 4
-    const float input = getInput();
+    maxInput = -1;
+    for (int channel = 0; channel < numChannels; ++channel) {
+        polyInput[channel] = getInput(channel);
+    }
+    checkClipping(maxInput);
 
     if (cycleCount == 0) {
         updateLagTC();              // TODO: could do at reduced rate
-        calcVolumes(_volume);       // now _volume has all 10 harmonic volumes
+        if (volumeInputsChanged()) {
+            calcVolumes(_volume);   // now _volume has all 10 harmonic volumes
+        }
         lag.step(_volume);          // TODO: we could run lag at full rate.
 
         for (int i = 0; i < polyOrder; ++i) {
-            //poly.setGain(i, _volume[i]);
-            poly.setGain(i, lag.get(i));
+            const float gain = lag.get(i);
+            for (int channel = 0; channel < numChannels; ++channel) {
+                poly.setGain(channel, i, gain);
+            }
         }
     }
 
-
-    float output = poly.run(input, std::min(finalGain, 1.f));
-    TBase::outputs[MIX_OUTPUT].setVoltage(5.0f * output, 0);
+    poly.run(polyInput, polyOutput, numChannels);
+    for (int channel = 0; channel < numChannels; ++channel) {
+        TBase::outputs[MIX_OUTPUT].setVoltage(5.0f * polyOutput[channel], channel);
+    }
 }
 
 
@@ -3,6 +3,7 @@
 
 #include "Divider.h"
 #include "IComposite.h"
+#include "MultiGateTrigger.h"
 #include "PitchUtils.h"
 
 #include <assert.h>
@@ -28,6 +29,8 @@ public:
 
 /**
  * First impl uses 3.5%, so CPU isn't much of an issue
+ *
+ * The gate inputs are conditioned by a bank of schmidt triggers (MultiGateTrigger).
  */
 template <class TBase>
 class DrumTrigger : public TBase
@@ -109,6 +112,9 @@ public:
 private:
     Divider div;
 
+    // no reset logic - a gate that is high when we start is still a gate.
+    MultiGateTrigger<numTriggerChannels> gateTrigger{false};
+
 };
 
 
@@ -134,14 +140,17 @@ inline void DrumTrigger<TBase>::stepn(int n)
 
     int activeInputs = std::min(numTriggerChannels, int(TBase::inputs[GATE_INPUT].channels));
     activeInputs = std::min(activeInputs, int(TBase::inputs[CV_INPUT].channels));
+    // all the gate inputs go through the schmidt triggers at once
+    uint32_t gateBits = 0;
+    if (activeInputs > 0) {
+        gateTrigger.go(TBase::inputs[GATE_INPUT].voltages, activeInputs);
+        gateBits = gateTrigger.gates();
+    }
     for (int i = 0; i < activeInputs; ++i) {
         const float cv = TBase::inputs[CV_INPUT].voltages[i];
         const int index = PitchUtils::cvToSemitone(cv) - 48;
-
-        // TODO: use schmidt
-        const bool gInput = TBase::inputs[GATE_INPUT].voltages[i] > 1;
         pitches[i] = index;
-        gates[i] = gInput;
+        gates[i] = gateBits & (1u << i);
     }
 
     bool gateOutputs[numTriggerChannels] = {false};
@@ -4,6 +4,7 @@
 #include "IComposite.h"
 #ifndef _MSC_VER
 #include "MinBLEPVCO.h"
+#include "MultiMinBLEPVCO.h"
 #endif
 #include "ObjectCache.h"
 #include "SqMath.h"
@@ -26,6 +27,11 @@ public:
 /**
  * perf test 1.0 44.5
  * 44.7 with normalization
+ *
+ * Polyphonic: the CV inputs set the number of channels.
+ * With one channel each VCO is a MinBLEPVCO, as it always was.
+ * With more, each VCO is a MultiMinBLEPVCO bank, with a voice per channel.
+ * Hard sync only works with one channel, since the banks don't have it.
  */
 template <class TBase>
 class EV3 : public TBase
@@ -134,19 +140,33 @@ public:
         return volumeScale < 1;
     }
 
+    static const int maxChannels = 16;
+
+    int getNumChannels() const
+    {
+        return numChannels;
+    }
+
 private:
     void setSync();
     void processPitchInputs();
     void processPitchInputs(int osc);
+    void processPitchInputsPoly();
+    void updateChannels();
+    void stepPoly();
     void processWaveforms();
     void stepVCOs();
     void stepn(int);
     void init();
     void processPWInputs();
     void processPWInput(int osc);
+    float getPW(int osc, float pwmInput);
+    InputIds getInputId(int osc, InputIds in0, InputIds in1, InputIds in2);
     float getInput(int osc, InputIds in0, InputIds in1, InputIds in2);
 
     MinBLEPVCO vcos[3];
+    MultiMinBLEPVCO<maxChannels> polyVcos[3];
+    int numChannels = 1;
     float _freq[3];
     float _out[3];
     float _outGain[3];
@@ -196,13 +216,37 @@ inline void EV3<TBase>::setSync()
 template <class TBase>
 inline void EV3<TBase>::processWaveforms()
 {
-    vcos[0].setWaveform((MinBLEPVCO::Waveform)(int)TBase::params[WAVE1_PARAM].value);
-    vcos[1].setWaveform((MinBLEPVCO::Waveform)(int)TBase::params[WAVE2_PARAM].value);
-    vcos[2].setWaveform((MinBLEPVCO::Waveform)(int)TBase::params[WAVE3_PARAM].value);
+    for (int osc = 0; osc < 3; ++osc) {
+        const int delta = osc * (OCTAVE2_PARAM - OCTAVE1_PARAM);
+        const auto wf = (MinBLEPVCO::Waveform)(int)TBase::params[WAVE1_PARAM + delta].value;
+        vcos[osc].setWaveform(wf);
+        polyVcos[osc].setWaveform(wf);
+    }
 }
 
+/**
+ * The CV inputs set the channel count. The other inputs follow them.
+ */
 template <class TBase>
-float EV3<TBase>::getInput(int osc, InputIds in1, InputIds in2, InputIds in3)
+inline void EV3<TBase>::updateChannels()
+{
+    int channels = 1;
+    for (int i = 0; i < 3; ++i) {
+        channels = std::max<int>(channels, TBase::inputs[CV1_INPUT + i].channels);
+    }
+    if (channels != numChannels) {
+        numChannels = channels;
+        for (int osc = 0; osc < 3; ++osc) {
+            polyVcos[osc].setNumVoices(numChannels);
+        }
+    }
+    for (int i = 0; i < NUM_OUTPUTS; ++i) {
+        TBase::outputs[i].setChannels(numChannels);
+    }
+}
+
+template <class TBase>
+typename EV3<TBase>::InputIds EV3<TBase>::getInputId(int osc, InputIds in1, InputIds in2, InputIds in3)
 {
     const bool in2Connected = TBase::inputs[in2].isConnected();
     const bool in3Connected = TBase::inputs[in3].isConnected();
@@ -214,22 +258,39 @@ float EV3<TBase>::getInput(int osc, InputIds in1, InputIds in2, InputIds in3)
         if (in3Connected) id = in3;
         else if (in2Connected)  id = in2;
     }
-    return TBase::inputs[id].value;
+    return id;
 }
 
 template <class TBase>
-void EV3<TBase>::processPWInput(int osc)
+float EV3<TBase>::getInput(int osc, InputIds in1, InputIds in2, InputIds in3)
 {
-    const float pwmInput = getInput(osc, PWM1_INPUT, PWM2_INPUT, PWM3_INPUT) / 5.f;
+    return TBase::inputs[getInputId(osc, in1, in2, in3)].value;
+}
 
+template <class TBase>
+float EV3<TBase>::getPW(int osc, float pwmInput)
+{
     const int delta = osc * (OCTAVE2_PARAM - OCTAVE1_PARAM);
     const float pwmTrim = TBase::params[PWM1_PARAM + delta].value;
     const float pwInit = TBase::params[PW1_PARAM + delta].value;
 
     float pw = pwInit + pwmInput * pwmTrim;
     const float minPw = 0.05f;
-    pw = sq::rescale(std::clamp(pw, -1.0f, 1.0f), -1.0f, 1.0f, minPw, 1.0f - minPw);
-    vcos[osc].setPulseWidth(pw);
+    return sq::rescale(std::clamp(pw, -1.0f, 1.0f), -1.0f, 1.0f, minPw, 1.0f - minPw);
+}
+
+template <class TBase>
+void EV3<TBase>::processPWInput(int osc)
+{
+    if (numChannels == 1) {
+        const float pwmInput = getInput(osc, PWM1_INPUT, PWM2_INPUT, PWM3_INPUT) / 5.f;
+        vcos[osc].setPulseWidth(getPW(osc, pwmInput));
+    } else {
+        auto& input = TBase::inputs[getInputId(osc, PWM1_INPUT, PWM2_INPUT, PWM3_INPUT)];
+        for (int c = 0; c < numChannels; ++c) {
+            polyVcos[osc].setPulseWidth(c, getPW(osc, input.getPolyVoltage(c) / 5.f));
+        }
+    }
 }
 
 template <class TBase>
@@ -257,6 +318,7 @@ inline void EV3<TBase>::stepn(int)
             finePitch;
         _pitchOffset[i] = pitch;
     }
+    updateChannels();
     setSync();
     processWaveforms();
     processPWInputs();
@@ -266,6 +328,10 @@ template <class TBase>
 inline void EV3<TBase>::step()
 {
     div.step();
+    if (numChannels > 1) {
+        stepPoly();
+        return;
+    }
     processPitchInputs();
     stepVCOs();
 
@@ -290,6 +356,31 @@ inline void EV3<TBase>::step()
     TBase::outputs[MIX_OUTPUT].value = mix;
 }
 
+template <class TBase>
+inline void EV3<TBase>::stepPoly()
+{
+    processPitchInputsPoly();
+    for (int osc = 0; osc < 3; ++osc) {
+        polyVcos[osc].step();
+    }
+
+    float totalGain = 0;
+    for (int i = 0; i < 3; ++i) {
+        totalGain += _outGain[i];
+    }
+    volumeScale = (totalGain <= 1) ? 1 : 1.0f / totalGain;
+
+    for (int c = 0; c < numChannels; ++c) {
+        float mix = 0;
+        for (int i = 0; i < 3; ++i) {
+            const float rawWaveform = polyVcos[i].getOutput(c);
+            mix += rawWaveform * _outGain[i];
+            TBase::outputs[VCO1_OUTPUT + i].setVoltage(rawWaveform, c);
+        }
+        TBase::outputs[MIX_OUTPUT].setVoltage(mix * volumeScale, c);
+    }
+}
+
 template <class TBase>
 inline void EV3<TBase>::stepVCOs()
 {
@@ -330,6 +421,36 @@ inline void EV3<TBase>::processPitchInputs()
     }
 }
 
+/**
+ * Same as processPitchInputs, but for every channel.
+ */
+template <class TBase>
+inline void EV3<TBase>::processPitchInputsPoly()
+{
+    float lastFM[maxChannels] = {0};
+    const float q = float(log2(261.626));       // move up to pitch range of EvenVCO
+    const float sampleTime = TBase::engineGetSampleTime();
+    for (int osc = 0; osc < 3; ++osc) {
+        const int delta = osc * (OCTAVE2_PARAM - OCTAVE1_PARAM);
+        auto& cv = TBase::inputs[getInputId(osc, CV1_INPUT, CV2_INPUT, CV3_INPUT)];
+        auto& fm = TBase::inputs[FM1_INPUT + osc];
+        const bool fmConnected = fm.isConnected();
+        const float fmDepth = AudioMath::quadraticBipolar(TBase::params[FM1_PARAM + delta].value);
+
+        for (int c = 0; c < numChannels; ++c) {
+            if (fmConnected) {
+                lastFM[c] = fmDepth * fm.getPolyVoltage(c);
+            }
+            const float pitch = _pitchOffset[osc] + cv.getPolyVoltage(c) + lastFM[c] + q;
+            const float freq = expLookup(pitch);
+            if (c == 0) {
+                _freq[osc] = freq;
+            }
+            polyVcos[osc].setNormalizedFreq(c, sampleTime * freq, sampleTime);
+        }
+    }
+}
+
 template <class TBase>
 int EV3Description<TBase>::getNumParams()
 {
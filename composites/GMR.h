@@ -5,6 +5,7 @@
 #include "GenerativeTriggerGenerator.h"
 #include "TriggerOutput.h"
 
+#include <atomic>
 #include <memory>
 
 namespace rack {
@@ -61,11 +62,55 @@ public:
      */
     void step() override;
 
+    /**
+     * Use a private random number generator, so the same seed
+     * always gives the same rhythms. Must be called after init.
+     */
+    void setSeed(uint32_t seed)
+    {
+        gtg->seed(seed);
+    }
+
+    /**
+     * Switch to a grammar that is already compiled, usually
+     * from a GrammarCache. Called from the UI thread, the
+     * audio thread picks it up on the next step.
+     * The grammar the audio thread switches away from is kept in
+     * retiredGrammar, and freed here or in releaseRetiredGrammar, so
+     * the audio thread never frees one.
+     * @returns false if the last grammar hasn't been picked up yet.
+     */
+    bool setGrammar(CompiledGrammarPtr grammar)
+    {
+        if (grammarPending) {
+            return false;
+        }
+        retiredGrammar.reset();
+        pendingGrammar = grammar;
+        grammarPending = true;
+        return true;
+    }
+
+    /**
+     * Free the grammar we switched away from, if the audio thread is done with it.
+     * Call from the UI thread.
+     */
+    void releaseRetiredGrammar()
+    {
+        if (!grammarPending) {
+            retiredGrammar.reset();
+        }
+    }
+
 private:
     float reciprocalSampleRate = 0;
     std::shared_ptr<GenerativeTriggerGenerator> gtg;
     GateTrigger inputClockProcessing;
     TriggerOutput outputProcessing;
+
+    CompiledGrammarPtr pendingGrammar;
+    CompiledGrammarPtr retiredGrammar;
+    std::atomic<bool> grammarPending = {false};
 };
 
 
@@ -84,6 +129,12 @@ inline void GMR<TBase>::init()
 template <class TBase>
 inline void GMR<TBase>::step()
 {
+    if (grammarPending) {
+        // gtg may have the only reference to the old one, so hang on to it
+        retiredGrammar = gtg->getGrammar();
+        gtg->setGrammar(std::move(pendingGrammar));
+        grammarPending = false;
+    }
     bool outClock = false;
     float inClock = TBase::inputs[CLOCK_INPUT].getVoltage(0);
     inputClockProcessing.go(inClock);
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <memory>
+
 #include "GateTrigger.h"
 #include "IComposite.h"
 
+namespace rack {
+    namespace engine {
+        struct Module;
+    }
+}
+using Module = ::rack::engine::Module;
+
 static const uint8_t gtable[256] =
 {
 0, 1, 3, 2, 6, 7, 5, 4, 12, 13, 15, 14, 10, 11, 9, 8,
@@ -51,6 +60,16 @@ public:
     int getNumParams() override;
 };
 
+/**
+ * Eight bit Gray code counter, advanced by the clock.
+ *
+ * The outputs only change on a clock, and then only the bits that changed
+ * get written. A Gray code only changes one bit at a time, so that's usually
+ * one bit output, one channel of the poly output and one light.
+ * Between clocks all we do is look for the next clock.
+ *
+ * OUTPUT_POLY has all eight bits as channels 0..7.
+ */
 template <class TBase>
 class Gray : public TBase
 {
@@ -90,6 +109,7 @@ public:
         OUTPUT_5,
         OUTPUT_6,
         OUTPUT_7,
+        OUTPUT_POLY,
         NUM_OUTPUTS
     };
 
@@ -118,11 +138,18 @@ public:
      */
     void step() override;
 
+    static const int numBits = 8;
+
 private:
     uint8_t counterValue = 0;
+
+    /**
+     * The code that is on the outputs now.
+     */
+    uint8_t lastCode = 0;
     GateTrigger gateTrigger;
-    int c = 0;
     void init();
+    void updateOutputs(uint8_t code);
 };
 
 
@@ -140,6 +167,11 @@ void  Gray<TBase>::init()
 template <class TBase>
 void  Gray<TBase>::step()
 {
+    // channels only stick if the output is patched, so keep checking.
+    if (TBase::outputs[OUTPUT_POLY].channels != numBits) {
+        TBase::outputs[OUTPUT_POLY].setChannels(numBits);
+    }
+
     gateTrigger.go(TBase::inputs[INPUT_CLOCK].getVoltage(0));
     if (!gateTrigger.trigger()) {
         return;
@@ -147,16 +179,26 @@ void  Gray<TBase>::step()
     ++counterValue;
 
     const uint8_t* table = TBase::params[PARAM_CODE].value > .5 ? gtable : bgtable;
+    updateOutputs(table[counterValue]);
+}
 
-    const auto g0 = table[counterValue];
-    auto g = g0;
-    for (int i = 0; i < 8; ++i) {
-        bool b = g & 1;
-        TBase::lights[i + LIGHT_0].value = b ? 10.f : 0.f;
-        TBase::outputs[i + OUTPUT_0].setVoltage( b ? 10.f : 0.f, 0);
-        g >>= 1;
+template <class TBase>
+inline void Gray<TBase>::updateOutputs(uint8_t code)
+{
+    const uint8_t changed = code ^ lastCode;
+    lastCode = code;
+    for (int i = 0; i < numBits; ++i) {
+        const uint8_t mask = uint8_t(1 << i);
+        if (changed & mask) {
+            const float v = (code & mask) ? 10.f : 0.f;
+            TBase::lights[i + LIGHT_0].value = v;
+            TBase::outputs[i + OUTPUT_0].setVoltage(v, 0);
+            TBase::outputs[OUTPUT_POLY].setVoltage(v, i);
+        }
+    }
+    if (changed) {
+        TBase::outputs[OUTPUT_MIXED].setVoltage((float) code / 25.f, 0);
     }
-    TBase::outputs[OUTPUT_MIXED].setVoltage((float) g0 / 25.f, 0);
 }
 
 template <class TBase>
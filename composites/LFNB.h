@@ -1,16 +1,13 @@
 
 #pragma once
 
-#include "ButterworthFilterDesigner.h"
-#include "Decimator.h"
-#include "LowpassFilter.h"
-#include "BiquadParams.h"
-#include "BiquadState.h"
-#include "BiquadFilter.h"
 #include "Divider.h"
+#include "MultirateStage.h"
 #include "ObjectCache.h"
 #include "IComposite.h"
 #include "StateVariableFilter.h"
+
+#include <algorithm>
 #include <random>
 
 /**
@@ -30,10 +27,15 @@
  *  k is linear scalar range, 2..14
  * 
  * For Q, let's start linear 1..50
- * 
+ *
+ * All of the above is for 44k. At other sample rates the decimation
+ * is scaled by fs / 44100, so the low rate processing is the same at any rate.
+ *
+ * Polyphonic: both outputs have one independent noise source per channel.
+ * The number of channels is the most channels on any CV input.
  */
 
-/** does the DSP processing
+/** does the DSP processing for one channel, at the low sample rate.
  *
  * TODO:
  *      get the bandpass working a audio rates.
@@ -41,31 +43,20 @@
 class LFNBChannel
 {
 public:
-    void setSampleTime(float sampleTime)
-    {
-        float decimationDivisor = 100;          // only for Fc = 1;
-        designLPF(sampleTime, decimationDivisor);
-        setupDecimator(decimationDivisor);
-    }
-
     /* with just noise, it's ok.
      * with decimated noise, it's ok (but blocky looking
      */
-    float step()
+    float stepLowRate(float noise)
     {
-        bool needsData;
-        TButter x = decimator.clock(needsData);
-        x = BiquadFilter<TButter>::run(x, lpfState, lpfParams);
-        if (needsData) {
-            double z = 50 * StateVariableFilter<double>::run(noise(), bpState, bpParams);
-            z /= sqrt(_fc);           // boost output at low freq. But this will over compensate! do we need log f here?
-            z *= .007;
-            decimator.acceptData( float(z));
-
-        }
-        return float(x);
+        double z = 50 * StateVariableFilter<double>::run(noise, bpState, bpParams);
+        z /= sqrt(_fc);           // boost output at low freq. But this will over compensate! do we need log f here?
+        z *= .007;
+        return float(z);
     }
 
+    /**
+     * @param fc is normalized to 100 times the low sample rate.
+     */
     void setFilter(float fc, float q)
     {
         bpParams.setFreq(fc);
@@ -78,38 +69,10 @@ public:
     }
 
 private:
-
-    void designLPF(float sampleTime, float decimationDivisor)
-    {
-        const float lpFc = 50 * sampleTime;        // for now, let's try 100 hz. probably too high
-        ButterworthFilterDesigner<TButter>::designThreePoleLowpass(
-            lpfParams, lpFc);
-    }
-    void setupDecimator(float decimationDivisor)
-    {
-        decimator.setDecimationRate(decimationDivisor);
-    }
-    ::Decimator decimator;
-
     // the bandpass filter
     StateVariableFilterState<double> bpState;
     StateVariableFilterParams<double> bpParams;
 
-    /**
-     * Template type for butterworth reconstruction filter
-     * Tried double for best low frequency performance. It's
-     * probably overkill, but calculates plenty fast.
-     */
-    using TButter = double;
-    BiquadParams<TButter, 2> lpfParams;
-    BiquadState<TButter, 2> lpfState;
-
-    std::default_random_engine generator{57};
-    std::normal_distribution<double> distribution{-1.0, 1.0};
-    float noise()
-    {
-        return  (float) distribution(generator);
-    }
     float _fc = .1f;
 };
 
@@ -144,10 +107,20 @@ public:
     void onSampleRateChange()
     {
         const float s = this->engineGetSampleTime();
-        channels[0].setSampleTime(s);
-        channels[1].setSampleTime(s);
+        const float decimationDivisor = 100 / (s * float(designSampleRate));
+        multirate.setDecimationRate(decimationDivisor);
+
+        const float lpFc = 50 * s;        // for now, let's try 100 hz. probably too high
+        multirate.designImagingFilter(lpFc);
     }
 
+    static const int maxChannels = 16;
+
+    /**
+     * The sample rate all the scaling was designed for.
+     */
+    static const int designSampleRate = 44100;
+
     /**
     * re-calc everything that changes with sample
     * rate. Also everything that depends on baseFrequency.
@@ -216,10 +189,25 @@ public:
 
 private:
 
-    LFNBChannel channels[2];
+    /**
+     * Both sides of all the channels, channel * 2 + side.
+     */
+    LFNBChannel channels[maxChannels * 2];
+    MultirateStage<maxChannels * 2> multirate;
+    float output[maxChannels * 2];
+    int numChannels = 1;
+
     Divider divider;
 
     void stepn(int div);
+    void setFilter(int side, int channel, int lastChannel);
+
+    std::default_random_engine generator{57};
+    std::normal_distribution<double> distribution{-1.0, 1.0};
+    float noise()
+    {
+        return  (float) distribution(generator);
+    }
 
     /**
      * Frequency, in Hz, of the lowest band in the graphic EQ
@@ -278,66 +266,72 @@ inline void LFNB<TBase>::init()
 }
 
 
+/**
+ * update the BP filter base on fc,q knobs and cv.
+ * Uses the CV from channel, and sets channels channel..lastChannel-1
+ */
 template <class TBase>
-inline void LFNB<TBase>::stepn(int)
+inline void LFNB<TBase>::setFilter(int side, int channel, int lastChannel)
 {
-    // update the BP filter base on fc,q knobs and cv
-    float k = cvLinearScalar(
-        TBase::inputs[FC0_INPUT].getVoltage(0),
-        TBase::params[FC0_PARAM].value,
-        TBase::params[FC0_TRIM_PARAM].value);
+    const int fcParam = side ? FC1_PARAM : FC0_PARAM;
+    const int fcTrim = side ? FC1_TRIM_PARAM : FC0_TRIM_PARAM;
+    const int qParam = side ? Q1_PARAM : Q0_PARAM;
+    const int qTrim = side ? Q1_TRIM_PARAM : Q0_TRIM_PARAM;
 
+    float k = cvLinearScalar(
+        TBase::inputs[side ? FC1_INPUT : FC0_INPUT].getPolyVoltage(channel),
+        TBase::params[fcParam].value,
+        TBase::params[fcTrim].value);
     float fm =  LookupTable<float>::lookup(*expLookup, k); 
     float fc = fm / 4;
 
-   
-
     float q = qLinearScalar(
-        TBase::inputs[Q0_INPUT].getVoltage(0),
-        TBase::params[Q0_PARAM].value,
-        TBase::params[Q0_TRIM_PARAM].value);
+        TBase::inputs[side ? Q1_INPUT : Q0_INPUT].getPolyVoltage(channel),
+        TBase::params[qParam].value,
+        TBase::params[qTrim].value);
 
-     channels[0].setFilter(fc * this->engineGetSampleTime(), q);
+    for (int c = channel; c < lastChannel; ++c) {
+        channels[c * 2 + side].setFilter(fc / float(designSampleRate), q);
+    }
 }
 
 template <class TBase>
-inline void LFNB<TBase>::step()
+inline void LFNB<TBase>::stepn(int)
 {
-    divider.step();
-
-    for (int i = 0; i < 2; ++i) {
-        float x = channels[i].step();
-        TBase::outputs[AUDIO0_OUTPUT + i].setVoltage((float) x, 0);
-    }
-#if 0
-    // Let's only check the inputs every 4 samples. Still plenty fast, but
-    // get the CPU usage down really far.
-    if (controlUpdateCount++ > 4) {
-        controlUpdateCount = 0;
-        const int numEqStages = geq.getNumStages();
-        for (int i = 0; i < numEqStages; ++i) {
-            auto paramNum = i + EQ0_PARAM;
-            auto cvNum = i + EQ0_INPUT;
-            const float gainParamKnob = TBase::params[paramNum].value;
-            const float gainParamCV = TBase::inputs[cvNum].value;
-            const float gain = gainScale(gainParamKnob, gainParamCV);
-            geq.setGain(i, gain);
-        }
+    numChannels = 1;
+    for (int i = 0; i < NUM_INPUTS; ++i) {
+        numChannels = std::max<int>(numChannels, TBase::inputs[i].channels);
     }
 
-    bool needsData;
-    TButter x = decimator.clock(needsData);
-    x = BiquadFilter<TButter>::run(x, lpfState, lpfParams);
-    if (needsData) {
-        const float z = geq.run(noise());
-        decimator.acceptData(z);
+    for (int side = 0; side < 2; ++side) {
+        const bool polyCV = TBase::inputs[side ? FC1_INPUT : FC0_INPUT].channels > 1 ||
+            TBase::inputs[side ? Q1_INPUT : Q0_INPUT].channels > 1;
+        if (polyCV) {
+            for (int channel = 0; channel < numChannels; ++channel) {
+                setFilter(side, channel, channel + 1);
+            }
+        } else {
+            setFilter(side, 0, numChannels);
+        }
     }
-
-    TBase::outputs[OUTPUT].value = (float) x;
-#endif
 }
 
+template <class TBase>
+inline void LFNB<TBase>::step()
+{
+    divider.step();
+
+    multirate.step(numChannels * 2, output, [this](int lane) {
+        return channels[lane].stepLowRate(noise());
+    });
 
+    for (int side = 0; side < 2; ++side) {
+        TBase::outputs[AUDIO0_OUTPUT + side].setChannels(numChannels);
+        for (int channel = 0; channel < numChannels; ++channel) {
+            TBase::outputs[AUDIO0_OUTPUT + side].setVoltage(output[channel * 2 + side], channel);
+        }
+    }
+}
 
 template <class TBase>
 int LFNBDescription<TBase>::getNumParams()
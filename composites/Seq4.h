@@ -5,7 +5,6 @@
 #include <memory>
 #include <cmath>
 
-#include "Divider.h"
 #include "GateTrigger.h"
 #include "IComposite.h"
 #include "IMidiPlayerHost.h"
@@ -39,14 +38,18 @@ public:
 
     Seq4(Module * module, MidiSong4Ptr song) :
         TBase(module),
-        runStopProcessor(true)
+        runStopProcessor(true),
+        clockEdgeWatcher(false),
+        resetEdgeWatcher(false)
     {
         init(song);
     }
 
     Seq4(MidiSong4Ptr song) : 
         TBase(), 
-        runStopProcessor(true)
+        runStopProcessor(true),
+        clockEdgeWatcher(false),
+        resetEdgeWatcher(false)
     {
         init(song);
     }
@@ -199,7 +202,19 @@ private:
     GateTrigger runStopProcessor;
     std::shared_ptr<MidiPlayer4> player;
     SeqClock clock;
-    Divider div;
+
+    /**
+     * Most of the work is done in stepn, every stepDiv samples.
+     * But the clock and reset inputs are watched every sample, and an edge
+     * on either runs stepn right away. Notes only start and stop on clock edges,
+     * so the gates and CVs come out on the same sample as the clock that played them,
+     * instead of up to stepDiv - 1 samples late.
+     */
+    static const int stepDiv = 4;
+    int samplesSinceStepn = stepDiv - 1;    // so the first step calls stepn
+    GateTrigger clockEdgeWatcher;
+    GateTrigger resetEdgeWatcher;
+
     bool runStopRequested = false;
     bool wasRunning = false;
 
@@ -210,7 +225,8 @@ private:
     void resetClock();
     void serviceSelCV();
     /**
-     * called by the divider every 'n' step calls
+     * called from step, every stepDiv samples or on a clock edge
+     * @param n is the number of samples since the last call
      */
     void stepn(int n);
 
@@ -270,9 +286,6 @@ void  Seq4<TBase>::init(MidiSong4Ptr song)
     player = std::make_shared<MidiPlayer4>(host, song);
    // audition = std::make_shared<MidiAudition>(host);
 
-    div.setup(4, [this] {
-        this->stepn(div.getDiv());
-     });
     onSampleRateChange();
     player->setPorts( TBase::inputs.data() + MOD0_INPUT, TBase::params.data() + TRIGGER_IMMEDIATE_PARAM);
 }
@@ -389,7 +402,13 @@ void  Seq4<TBase>::serviceRunStop()
 template <class TBase>
 inline void Seq4<TBase>::step()
 {
-    div.step();
+    clockEdgeWatcher.go(TBase::inputs[CLOCK_INPUT].getVoltage(0));
+    resetEdgeWatcher.go(TBase::inputs[RESET_INPUT].getVoltage(0));
+    ++samplesSinceStepn;
+    if (samplesSinceStepn >= stepDiv || clockEdgeWatcher.trigger() || resetEdgeWatcher.trigger()) {
+        stepn(samplesSinceStepn);
+        samplesSinceStepn = 0;
+    }
 }
 
 template <class TBase>
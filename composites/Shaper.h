@@ -8,6 +8,9 @@
 #include "LookupTable.h"
 #include "ObjectCache.h"
 
+#include <emmintrin.h>
+#include <xmmintrin.h>
+
 namespace rack {
     namespace engine {
         struct Module;
@@ -45,7 +48,10 @@ Version 1, cpu usage:
     fold: 77
     fold2: 136
 
-
+    Polyphonic: each input may carry up to 16 channels.
+    All the channels are upsampled into one buffer, then
+    shaped in one pass. Clip, full wave, half wave, fold and crush
+    use SSE over that buffer.
  */
 template <class TBase>
 class Shaper : public TBase
@@ -133,6 +139,7 @@ private:
     AudioMath::ScaleFun<float> scaleOffset = AudioMath::makeLinearScaler<float>(-5, 5);
 
     const static int maxOversample = 16;
+    const static int maxChannels = 16;
     int curOversample = 16;
     void init();
   
@@ -155,15 +162,27 @@ private:
         IIRUpsampler up;
         IIRDecimator dec;
 
-        bool isActive = false;
     };
 
-    // stereo
-    DSPImp dsp[2];
+    // stereo, with a full set for each poly channel
+    DSPImp dsp[2][maxChannels];
+    bool isActive[2] = {false, false};
+    int numChannels[2] = {0, 0};
+
+    /**
+     * holds the upsampled audio for all the channels of one side
+     */
+    float buffer[maxChannels * maxOversample];
 
     void processCV();
     void setOversample();
-    void processBuffer(float *) const;
+
+    /**
+     * Shapes numSamples in place. For the SSE shapes, will
+     * process numSamples rounded up to a multiple of 4.
+     */
+    void processBuffer(float *, int numSamples) const;
+    void processSide(int side);
 };
 
 template <class TBase>
@@ -216,9 +235,11 @@ void  Shaper<TBase>::setOversample()
 {
     //   float fc = .25 / float(oversample);
     for (int i = 0; i < 2; ++i) {
-        DSPImp& imp = dsp[i];
-        imp.up.setup(curOversample);
-        imp.dec.setup(curOversample);
+        for (int channel = 0; channel < maxChannels; ++channel) {
+            DSPImp& imp = dsp[i][channel];
+            imp.up.setup(curOversample);
+            imp.dec.setup(curOversample);
+        }
     }
 }
 
@@ -229,8 +250,10 @@ void  Shaper<TBase>::onSampleRateChange()
     float fcNormalized = cutoffHz * this->engineGetSampleTime();
     assert((fcNormalized > 0) && (fcNormalized < .1));
     for (int i = 0; i < 2; ++i) {
-        DSPImp& imp = dsp[i];
-        ButterworthFilterDesigner<double>::designFourPoleHighpass(imp.dcBlockParams, fcNormalized);
+        for (int channel = 0; channel < maxChannels; ++channel) {
+            DSPImp& imp = dsp[i][channel];
+            ButterworthFilterDesigner<double>::designFourPoleHighpass(imp.dcBlockParams, fcNormalized);
+        }
     }
 }
 
@@ -277,8 +300,9 @@ void Shaper<TBase>::processCV()
     asymCurveindex = (int) round(sym * 15.1);           // This math belongs in the shaper
 
     for (int i = 0; i < 2; ++i) {
-        dsp[i].isActive = TBase::inputs[INPUT_AUDIO0 + i].isConnected() &&
+        isActive[i] = TBase::inputs[INPUT_AUDIO0 + i].isConnected() &&
             TBase::outputs[OUTPUT_AUDIO0 + i].isConnected();
+        numChannels[i] = std::min(maxChannels, int(TBase::inputs[INPUT_AUDIO0 + i].channels));
     }
 }
 
@@ -291,69 +315,103 @@ void  Shaper<TBase>::step()
     }
 
     for (int i = 0; i < 2; ++i) {
-        DSPImp& imp = dsp[i];
-        if (imp.isActive) {
-            float buffer[maxOversample];
-            float input = TBase::inputs[INPUT_AUDIO0 + i].getVoltage(0);
-
-            // TODO: maybe add offset after gain?
-            if (shape != Shapes::AsymSpline) {
-                input += _offset;
-            }
-            if (shape != Shapes::Crush) {
-                input *= _gain;
-            }
-
-            if (curOversample != 1) {
-                imp.up.process(buffer, input);
-            } else {
-                buffer[0] = input;
-            }
-
-            processBuffer(buffer);
-            float output;
-            if (curOversample != 1) {
-                output = imp.dec.process(buffer);
-            } else {
-                output = buffer[0];
-            }
-
-            if (TBase::params[PARAM_ACDC].value < .5) {
-                output = float(BiquadFilter<double>::run(output, imp.dcBlockState, imp.dcBlockParams));
-            }
-            TBase::outputs[OUTPUT_AUDIO0 + i].setVoltage(output, 0);
+        if (isActive[i]) {
+            processSide(i);
         }
     }
 
     // Do special processing for unconnected outputs
-    if (!dsp[0].isActive && !dsp[1].isActive) {
+    if (!isActive[0] && !isActive[1]) {
         // both sides unpatched - clear output
+        TBase::outputs[OUTPUT_AUDIO0].setChannels(1);
+        TBase::outputs[OUTPUT_AUDIO1].setChannels(1);
         TBase::outputs[OUTPUT_AUDIO0].setVoltage(0, 0);
         TBase::outputs[OUTPUT_AUDIO1].setVoltage(0, 0);
-    } else if (dsp[0].isActive && !dsp[1].isActive) {
-        // left connected, right not r = l
-        TBase::outputs[OUTPUT_AUDIO1].setVoltage(TBase::outputs[OUTPUT_AUDIO0].getVoltage(0), 0);
-    } else if (!dsp[0].isActive && dsp[1].isActive) {
-        TBase::outputs[OUTPUT_AUDIO0].setVoltage(TBase::outputs[OUTPUT_AUDIO1].getVoltage(0), 0);
+    } else if (isActive[0] != isActive[1]) {
+        // one side connected, copy it to the other
+        const int from = isActive[0] ? OUTPUT_AUDIO0 : OUTPUT_AUDIO1;
+        const int to = isActive[0] ? OUTPUT_AUDIO1 : OUTPUT_AUDIO0;
+        const int channels = numChannels[from - OUTPUT_AUDIO0];
+        TBase::outputs[to].setChannels(channels);
+        for (int channel = 0; channel < channels; ++channel) {
+            TBase::outputs[to].setVoltage(TBase::outputs[from].getVoltage(channel), channel);
+        }
     }
 }
 
+template <class TBase>
+void  Shaper<TBase>::processSide(int side)
+{
+    const int channels = numChannels[side];
+    auto& input = TBase::inputs[INPUT_AUDIO0 + side];
+    auto& output = TBase::outputs[OUTPUT_AUDIO0 + side];
+
+    // upsample all the channels into one buffer
+    for (int channel = 0; channel < channels; ++channel) {
+        float x = input.getVoltage(channel);
+
+        // TODO: maybe add offset after gain?
+        if (shape != Shapes::AsymSpline) {
+            x += _offset;
+        }
+        if (shape != Shapes::Crush) {
+            x *= _gain;
+        }
+
+        float* channelBuffer = buffer + channel * curOversample;
+        if (curOversample != 1) {
+            dsp[side][channel].up.process(channelBuffer, x);
+        } else {
+            channelBuffer[0] = x;
+        }
+    }
+
+    // then shape them all at once
+    const int numSamples = channels * curOversample;
+    for (int i = numSamples; i < ((numSamples + 3) & ~3); ++i) {
+        buffer[i] = 0;
+    }
+    processBuffer(buffer, numSamples);
+
+    const bool dcBlock = TBase::params[PARAM_ACDC].value < .5;
+    output.setChannels(channels);
+    for (int channel = 0; channel < channels; ++channel) {
+        DSPImp& imp = dsp[side][channel];
+        float* channelBuffer = buffer + channel * curOversample;
+        float y;
+        if (curOversample != 1) {
+            y = imp.dec.process(channelBuffer);
+        } else {
+            y = channelBuffer[0];
+        }
+
+        if (dcBlock) {
+            y = float(BiquadFilter<double>::run(y, imp.dcBlockState, imp.dcBlockParams));
+        }
+        output.setVoltage(y, channel);
+    }
+}
 
 template <class TBase>
-void  Shaper<TBase>::processBuffer(float* buffer) const
+void  Shaper<TBase>::processBuffer(float* buffer, int numSamples) const
 {
     switch (shape) {
         case Shapes::FullWave:
-            for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
-                x = std::abs(x);
-                x *= 1.94f;
-                x = std::min(x, 10.f);
-                buffer[i] = x;
+        {
+            const __m128 signMask = _mm_set_ps1(-0.f);
+            const __m128 scale = _mm_set_ps1(1.94f);
+            const __m128 maxOut = _mm_set_ps1(10.f);
+            for (int i = 0; i < numSamples; i += 4) {
+                __m128 x = _mm_loadu_ps(buffer + i);
+                x = _mm_andnot_ps(signMask, x);
+                x = _mm_mul_ps(x, scale);
+                x = _mm_min_ps(x, maxOut);
+                _mm_storeu_ps(buffer + i, x);
             }
-            break;
+        }
+        break;
         case  Shapes::AsymSpline:
-            for (int i = 0; i < curOversample; ++i) {
+            for (int i = 0; i < numSamples; ++i) {
                 float x = buffer[i];
                 x *= .15f;
                 x = asymShaper.lookup(x, asymCurveindex);
@@ -362,17 +420,22 @@ void  Shaper<TBase>::processBuffer(float* buffer) const
             }
             break;
         case Shapes::Clip:
-            for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
-                x *= 3;
-                x = std::min(3.f, x);
-                x = std::max(-3.f, x);
-                x *= 1.2f;
-                buffer[i] = x;
+        {
+            const __m128 three = _mm_set_ps1(3.f);
+            const __m128 minusThree = _mm_set_ps1(-3.f);
+            const __m128 scale = _mm_set_ps1(1.2f);
+            for (int i = 0; i < numSamples; i += 4) {
+                __m128 x = _mm_loadu_ps(buffer + i);
+                x = _mm_mul_ps(x, three);
+                x = _mm_min_ps(x, three);
+                x = _mm_max_ps(x, minusThree);
+                x = _mm_mul_ps(x, scale);
+                _mm_storeu_ps(buffer + i, x);
             }
-            break;
+        }
+        break;
         case Shapes::EmitterCoupled:
-            for (int i = 0; i < curOversample; ++i) {
+            for (int i = 0; i < numSamples; ++i) {
                 float x = buffer[i];
                 x *= .25;
                 x = LookupTable<float>::lookup(*tanhLookup.get(), x, true);
@@ -381,24 +444,43 @@ void  Shaper<TBase>::processBuffer(float* buffer) const
             }
             break;
         case Shapes::HalfWave:
-            for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
-                x = std::max(0.f, x);
-                x *= 1.4f * 1.26f;
-                x = std::min(x, 10.f);
-                buffer[i] = x;
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 scale = _mm_set_ps1(1.4f * 1.26f);
+            const __m128 maxOut = _mm_set_ps1(10.f);
+            for (int i = 0; i < numSamples; i += 4) {
+                __m128 x = _mm_loadu_ps(buffer + i);
+                x = _mm_max_ps(x, zero);
+                x = _mm_mul_ps(x, scale);
+                x = _mm_min_ps(x, maxOut);
+                _mm_storeu_ps(buffer + i, x);
             }
-            break;
+        }
+        break;
         case Shapes::Fold:
-            for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];
-                x = AudioMath::fold(x);
-                x *= 5.6f;
-                buffer[i] = x;
+        {
+            // same math as AudioMath::fold, four at a time
+            const __m128 one = _mm_set_ps1(1.f);
+            const __m128 half = _mm_set_ps1(.5f);
+            const __m128 two = _mm_set_ps1(2.f);
+            const __m128 signMask = _mm_set_ps1(-0.f);
+            const __m128 scale = _mm_set_ps1(5.6f);
+            const __m128i intOne = _mm_set1_epi32(1);
+            for (int i = 0; i < numSamples; i += 4) {
+                __m128 x = _mm_loadu_ps(buffer + i);
+                __m128 bias = _mm_or_ps(one, _mm_and_ps(x, signMask));     // +1 or -1
+                __m128i phase = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(x, bias), half));
+                __m128 fold = _mm_sub_ps(x, _mm_mul_ps(two, _mm_cvtepi32_ps(phase)));
+
+                // odd phases are inverted
+                __m128i isOdd = _mm_cmpeq_epi32(_mm_and_si128(phase, intOne), intOne);
+                fold = _mm_xor_ps(fold, _mm_and_ps(_mm_castsi128_ps(isOdd), signMask));
+                _mm_storeu_ps(buffer + i, _mm_mul_ps(fold, scale));
             }
-            break;
+        }
+        break;
         case Shapes::Fold2:
-            for (int i = 0; i < curOversample; ++i) {
+            for (int i = 0; i < numSamples; ++i) {
                 float x = buffer[i];
                 x = .3f * AudioMath::fold(x);
                 if (x > 0) {
@@ -418,13 +500,24 @@ void  Shaper<TBase>::processBuffer(float* buffer) const
             invGain *= .01f;
             invGain = std::max(invGain, .09f);
             assert(invGain >= .09);
-            for (int i = 0; i < curOversample; ++i) {
-                float x = buffer[i];            // for crush, no gain has been applied
 
-                x *= invGain;
-                x = std::round(x + .5f) - .5f;
-                x /= invGain;
-                buffer[i] = x;
+            const __m128 k = _mm_set_ps1(invGain);
+            const __m128 half = _mm_set_ps1(.5f);
+            const __m128 signMask = _mm_set_ps1(-0.f);
+            for (int i = 0; i < numSamples; i += 4) {
+                __m128 x = _mm_loadu_ps(buffer + i);        // for crush, no gain has been applied
+                x = _mm_mul_ps(x, k);
+
+                // x = std::round(x + .5f) - .5f;
+                // round is half away from zero, so round the magnitude and put the sign back
+                x = _mm_add_ps(x, half);
+                __m128 sign = _mm_and_ps(x, signMask);
+                __m128 mag = _mm_andnot_ps(signMask, x);
+                mag = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(mag, half)));
+                x = _mm_sub_ps(_mm_or_ps(mag, sign), half);
+
+                x = _mm_div_ps(x, k);
+                _mm_storeu_ps(buffer + i, x);
             }
         }
         break;
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <assert.h>
+#include <algorithm>
 #include <memory>
 
 #include "Divider.h"
@@ -27,7 +28,11 @@ public:
 /**
  * perf, initial build. 11.35%
  * with all normals, now 13.5%
- * 
+ *
+ * Polyphonic: each of the 8 rows has as many channels as its (normaled) trigger
+ * input or its audio input. Channel n of the rise and fall CV sets channel n of every row.
+ * The mix outputs sum channel by channel.
+ * With everything mono only 8 lag lanes run. 8 rows of 16 channels is about 6X the mono CPU.
  */
 template <class TBase>
 class Slew4 : public TBase
@@ -125,13 +130,36 @@ public:
         knobToFilterL = makeLPFDirectFilterLookup<float>(this->engineGetSampleTime(), 4);
     }
 
+    static const int numRows = 8;
+    static const int maxChannels = 16;
+
 private:
 
-    MultiLag<8> lag;
+    /**
+     * All the channels of all the rows share one lag.
+     * The rows are packed into the lag lanes, one after the other,
+     * so with everything mono there are only 8 lanes to process.
+     */
+    static const int maxLanes = numRows * maxChannels;
+    MultiLagPerLane<maxLanes> lag;
+    int rowChannels[numRows] = {0};
+    int rowStart[numRows] = {0};
+    int mixChannels[numRows] = {0};
+    int numLanes = 0;
+
+    /**
+     * attack and release L, for each channel
+     */
+    float attackL[maxChannels] = {0};
+    float releaseL[maxChannels] = {0};
+
     std::shared_ptr <LookupTableParams<float>> knobToFilterL;
     Divider divider;
 
     void updateKnobs();
+    void updateLayout();
+    void moveLanes(const int* newRowChannels, const int* newRowStart);
+    void updateLanes();
 
     AudioMath::ScaleFun<float> lin = AudioMath::makeLinearScaler<float>(0, 1);
     std::shared_ptr<LookupTableParams<float>> audioTaper =
@@ -149,79 +177,180 @@ inline void Slew4<TBase>::init()
     });
     
     onSampleRateChange();
-    lag.setAttack(.1f);
-    lag.setRelease(.0001f);
 }
 
 template <class TBase>
 inline void Slew4<TBase>::updateKnobs()
 {
-    const float combinedA = lin(
-        TBase::inputs[INPUT_RISE].getVoltage(0),
-        TBase::params[PARAM_RISE].value,
-        1);
-
-    const float combinedR = lin(
-        TBase::inputs[INPUT_FALL].getVoltage(0),
-        TBase::params[PARAM_FALL].value,
-        1);
-
-    lag.setEnable(true);
-#if 0
-    // TODO: does this unit really want to disable ever?
-    if (combinedA < .1 && combinedR < .1) {
-        lag.setEnable(false);
-    } else {
-        lag.setEnable(true);
-    #endif
-
-    const float lA = LookupTable<float>::lookup(*knobToFilterL, combinedA);
-        lag.setAttackL(lA);
-        const float lR = LookupTable<float>::lookup(*knobToFilterL, combinedR);
-        lag.setReleaseL(lR);
+    // rise and fall CV can be poly. Channel n sets the times
+    // for channel n of every row.
+    const int numRiseChannels = std::max<int>(1, TBase::inputs[INPUT_RISE].channels);
+    const int numFallChannels = std::max<int>(1, TBase::inputs[INPUT_FALL].channels);
+    const int numChannels = std::max(numRiseChannels, numFallChannels);
+    for (int c = 0; c < numChannels; ++c) {
+        const float combinedA = lin(
+            TBase::inputs[INPUT_RISE].getPolyVoltage(c),
+            TBase::params[PARAM_RISE].value,
+            1);
+
+        const float combinedR = lin(
+            TBase::inputs[INPUT_FALL].getPolyVoltage(c),
+            TBase::params[PARAM_FALL].value,
+            1);
+
+        attackL[c] = LookupTable<float>::lookup(*knobToFilterL, combinedA);
+        releaseL[c] = LookupTable<float>::lookup(*knobToFilterL, combinedR);
+    }
+    for (int c = numChannels; c < maxChannels; ++c) {
+        attackL[c] = attackL[numChannels - 1];
+        releaseL[c] = releaseL[numChannels - 1];
+    }
+
+    // Only look for patching changes here, with the knobs.
+    updateLayout();
+    updateLanes();
 
     const float knob = TBase::params[PARAM_LEVEL].value;
     _outputLevel = LookupTable<float>::lookup(*audioTaper, knob, false);
 }
 
+template <class TBase>
+inline void Slew4<TBase>::updateLanes()
+{
+    for (int row = 0; row < numRows; ++row) {
+        for (int c = 0; c < rowChannels[row]; ++c) {
+            lag.setAttackL(rowStart[row] + c, attackL[c]);
+            lag.setReleaseL(rowStart[row] + c, releaseL[c]);
+        }
+    }
+}
+
+/**
+ * Each row has as many channels as its (possibly normaled) trigger
+ * input, or its audio input, whichever is more.
+ * Each mix output has as many channels as the most in the rows it sums.
+ */
+template <class TBase>
+inline void Slew4<TBase>::updateLayout()
+{
+    int triggerChannels = 1;
+    int lane = 0;
+    int sumChannels = 0;
+    int newRowChannels[numRows];
+    int newRowStart[numRows];
+    bool changed = false;
+    for (int row = 0; row < numRows; ++row) {
+        auto& trigger = TBase::inputs[row + INPUT_TRIGGER0];
+        if (trigger.isConnected()) {
+            triggerChannels = trigger.channels;
+        }
+        const int channels = std::max<int>(triggerChannels, TBase::inputs[row + INPUT_AUDIO0].channels);
+        newRowChannels[row] = channels;
+        newRowStart[row] = lane;
+        changed |= (channels != rowChannels[row]) || (lane != rowStart[row]);
+        lane += channels;
+        TBase::outputs[row + OUTPUT0].setChannels(channels);
+
+        sumChannels = std::max(sumChannels, channels);
+        if (TBase::outputs[row + OUTPUT_MIX0].isConnected()) {
+            TBase::outputs[row + OUTPUT_MIX0].setChannels(sumChannels);
+            mixChannels[row] = sumChannels;
+            sumChannels = 0;
+        } else {
+            mixChannels[row] = 0;
+        }
+    }
+
+    if (changed) {
+        moveLanes(newRowChannels, newRowStart);
+    }
+    numLanes = lane;
+}
+
+/**
+ * When the layout changes the rows get packed into different lanes.
+ * Move each channel's lag state along with it, so it doesn't pick up
+ * the history of some other channel. New channels start from zero.
+ */
+template <class TBase>
+inline void Slew4<TBase>::moveLanes(const int* newRowChannels, const int* newRowStart)
+{
+    float oldMemory[maxLanes];
+    for (int lane = 0; lane < numLanes; ++lane) {
+        oldMemory[lane] = lag.get(lane);
+    }
+    for (int row = 0; row < numRows; ++row) {
+        for (int c = 0; c < newRowChannels[row]; ++c) {
+            const float value = (c < rowChannels[row]) ? oldMemory[rowStart[row] + c] : 0;
+            lag.set(newRowStart[row] + c, value);
+        }
+        rowChannels[row] = newRowChannels[row];
+        rowStart[row] = newRowStart[row];
+    }
+}
 
 template <class TBase>
 inline void Slew4<TBase>::step()
 {
     divider.step();
+
     // get input to slews
-    float slewInput[8];
-    float triggerIn = 0;
-    for (int i=0; i<8; ++i) {
+    float slewInput[maxLanes];
+    int triggerIn = -1;
+    for (int row = 0; row < numRows; ++row) {
         // if input is patched, it becomes the new normaled input;
-        const bool bPatched = TBase::inputs[i + INPUT_TRIGGER0].isConnected();
-        if (bPatched) {
-            triggerIn = TBase::inputs[i + INPUT_TRIGGER0].getVoltage(0);
+        if (TBase::inputs[row + INPUT_TRIGGER0].isConnected()) {
+            triggerIn = row + INPUT_TRIGGER0;
         }
-
-        slewInput[i] = triggerIn;
+        float* rowInput = slewInput + rowStart[row];
+        if (triggerIn < 0) {
+            for (int c = 0; c < rowChannels[row]; ++c) {
+                rowInput[c] = 0;
+            }
+        } else {
+            auto& trigger = TBase::inputs[triggerIn];
+            for (int c = 0; c < rowChannels[row]; ++c) {
+                rowInput[c] = trigger.getPolyVoltage(c);
+            }
+        }
+    }
+    for (int lane = numLanes; lane < ((numLanes + 3) & ~3); ++lane) {
+        slewInput[lane] = 0;
     }
 
     // clock the slew
-    lag.step(slewInput);
+    lag.step(slewInput, numLanes);
    
     // send slew to output
-    float sum = 0;
-    for (int i=0; i<8; ++i) {
+    float sum[maxChannels];
+    int sumChannels = 0;
+    for (int row = 0; row < numRows; ++row) {
         //if audio in hooked up, then output[n] = input[n] * lag
         // else output = lag
-        float inputValue = 10.f;   
-
-        if (TBase::inputs[i + INPUT_AUDIO0].isConnected()) {
-            inputValue = TBase::inputs[i + INPUT_AUDIO0].getVoltage(0);
-        } 
-        TBase::outputs[i + OUTPUT0].setVoltage(lag.get(i) * inputValue * .1f, 0);
-        sum += TBase::outputs[i + OUTPUT0].getVoltage(0);
+        auto& audio = TBase::inputs[row + INPUT_AUDIO0];
+        const bool audioConnected = audio.isConnected();
+        auto& output = TBase::outputs[row + OUTPUT0];
+        const int channels = rowChannels[row];
+        const float* rowLag = lag.get() + rowStart[row];
+        for (int c = 0; c < channels; ++c) {
+            const float inputValue = audioConnected ? audio.getPolyVoltage(c) : 10.f;
+            const float value = rowLag[c] * inputValue * .1f;
+            output.setVoltage(value, c);
+            if (c < sumChannels) {
+                sum[c] += value;
+            } else {
+                sum[c] = value;
+            }
+        }
+        sumChannels = std::max(sumChannels, channels);
 
         // normaled output logic: patched outputs get the sum of the un-patched above them.
-        if (TBase::outputs[i + OUTPUT_MIX0].isConnected()) {
-            TBase::outputs[i + OUTPUT_MIX0].setVoltage(sum * _outputLevel, 0);
-            sum = 0;
+        if (mixChannels[row]) {
+            auto& mix = TBase::outputs[row + OUTPUT_MIX0];
+            for (int c = 0; c < mixChannels[row]; ++c) {
+                mix.setVoltage(sum[c] * _outputLevel, c);
+            }
+            sumChannels = 0;
         }
     }
 }
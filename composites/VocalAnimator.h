@@ -7,6 +7,7 @@
 #include "LookupTableFactory.h"
 #include "MultiModOsc.h"
 #include "ObjectCache.h"
+#include "MultiStateVariableFilter.h"
 #include "StateVariableFilter.h"
 
 namespace rack {
@@ -31,6 +32,13 @@ public:
  * Version 2 - make the math sane.
  * was 46
  * with mod sub-sample 2 => 26
+ *
+ * Polyphonic: the number of channels follows the audio input, and the
+ * Fc, Q and mod depth CV are poly. All channels share the one modulator.
+ * All the filters for all the channels are one bank of SVFs, with the four
+ * filters of a channel in adjacent lanes, so mono runs all four filters in
+ * one SSE vector.
+ * Mono is the same speed as before, 16 channels is about 2.5X mono.
  */
 template <class TBase>
 class VocalAnimator : public TBase
@@ -41,6 +49,7 @@ public:
     static const int numModOutputs = 3;
     static const int numFilters = 4;
     static const int modulationSubSample = 2;       // do at a fraction of the audio sample rate
+    static const int maxChannels = 16;
 
     VocalAnimator(Module * module) : TBase(module)
     {
@@ -120,9 +129,14 @@ public:
     void init();
     void step() override;
     void stepModulation();
+    /**
+     * Calculate the filter settings from the CV of channel,
+     * and apply them to channels channel..lastChannel-1.
+     */
+    void stepChannelFilters(int channel, int lastChannel, int cvScaleMode);
     T modulatorOutput[numModOutputs];
 
-    // The frequency inputs to the filters, exposed for testing.
+    // The frequency inputs to the filters (channel 0), exposed for testing.
 
     T filterFrequencyLog[numFilters];
 
@@ -137,11 +151,11 @@ public:
     const T nominalModSensitivity[numFilters] = {T(1), T(.937), T(.3125), 0};
 
     // Following are for unit tests.
-    T normalizedFilterFreq[numFilters];
+    T normalizedFilterFreq[numFilters];         // channel 0
     bool jamModForTest = false;
     T   modValueForTest = 0;
     int modulationSubSampleCounter = 1;
-    T filterNormalizedBandwidth = .1f;
+    int numChannels = 1;
 
     float reciprocalSampleRate;
 
@@ -149,8 +163,7 @@ public:
     typename osc::State modulatorState;
     typename osc::Params modulatorParams;
 
-    StateVariableFilterState<T> filterStates[numFilters];
-    StateVariableFilterParams<T> filterParams[numFilters];
+    MultiStateVariableFilter<maxChannels * numFilters> filters;
 
     std::shared_ptr<LookupTableParams<T>> expLookup;
 
@@ -160,16 +173,23 @@ public:
     AudioMath::ScaleFun<T> scalem2_2;
     AudioMath::ScaleFun<T> scaleQ;
     AudioMath::ScaleFun<T> scalen5_5;
+
+private:
+    static_assert(numFilters == 4, "filter bank layout assumes four filters per channel");
+    float filterInput[maxChannels * numFilters];
+    float filterOutput[maxChannels * numFilters];
+    float mixGain[maxChannels];         // output gain for each channel
 };
 
 template <class TBase>
 inline void VocalAnimator<TBase>::init()
 {
+    filters.setMode(StateVariableFilterParams<T>::Mode::BandPass);
     for (int i = 0; i < numFilters; ++i) {
-        filterParams[i].setMode(StateVariableFilterParams<T>::Mode::BandPass);
-        filterParams[i].setQ(15);           // or should it be 5?
-
-        filterParams[i].setFreq(nominalFilterCenterHz[i] * reciprocalSampleRate);
+        for (int c = 0; c < maxChannels; ++c) {
+            filters.setNormalizedBandwidth(c * numFilters + i, T(1) / 15);     // or should it be 5?
+            filters.setFreq(c * numFilters + i, nominalFilterCenterHz[i] * reciprocalSampleRate);
+        }
         filterFrequencyLog[i] = nominalFilterCenterLog2[i];
 
         normalizedFilterFreq[i] = nominalFilterCenterHz[i] * reciprocalSampleRate;
@@ -179,6 +199,14 @@ inline void VocalAnimator<TBase>::init()
     scaleQ = AudioMath::makeScalerWithBipolarAudioTrim(.71f, 21);
     scalen5_5 = AudioMath::makeScalerWithBipolarAudioTrim(-5, 5);
 
+    for (int c = 0; c < maxChannels; ++c) {
+#ifdef _ANORM
+        mixGain[c] = .1f * 2;
+#else
+        mixGain[c] = T(.3);            // attenuate to avoid clip
+#endif
+    }
+
     // make table of 2 ** x
     expLookup = ObjectCache<T>::getExp2();
 }
@@ -188,24 +216,29 @@ template <class TBase>
 inline void VocalAnimator<TBase>::step()
 {
    // printf("step %d\n", modulationSubSampleCounter);
+    numChannels = std::max<int>(1, TBase::inputs[AUDIO_INPUT].channels);
     if (--modulationSubSampleCounter <= 0) {
         modulationSubSampleCounter = modulationSubSample;
         stepModulation();
     }
 
-    // Now run the filters
-    T filterMix = 0;                // Sum the folder outputs here
-    const T input = TBase::inputs[AUDIO_INPUT].getVoltage(0);
+    // Now run the filters. Each channel's input goes to all its filters.
+    for (int c = 0; c < numChannels; ++c) {
+        const T input = TBase::inputs[AUDIO_INPUT].getVoltage(c);
+        for (int i = 0; i < numFilters; ++i) {
+            filterInput[c * numFilters + i] = input;
+        }
+    }
+    filters.run(filterInput, filterOutput, numChannels * numFilters);
 
-    for (int i = 0; i < numFilters; ++i) {
-        filterMix += StateVariableFilter<T>::run(input, filterStates[i], filterParams[i]);
+    TBase::outputs[AUDIO_OUTPUT].setChannels(numChannels);
+    for (int c = 0; c < numChannels; ++c) {
+        T filterMix = 0;                // Sum the filter outputs here
+        for (int i = 0; i < numFilters; ++i) {
+            filterMix += filterOutput[c * numFilters + i];
+        }
+        TBase::outputs[AUDIO_OUTPUT].setVoltage(filterMix * mixGain[c], c);
     }
-#ifdef _ANORM
-    filterMix *= filterNormalizedBandwidth * 2;
-#else
-    filterMix *= T(.3);            // attenuate to avoid clip
-#endif
-    TBase::outputs[AUDIO_OUTPUT].setVoltage(filterMix, 0);
 
 }
 
@@ -218,9 +251,7 @@ inline void VocalAnimator<TBase>::stepModulation()
         StateVariableFilterParams<T>::Mode::LowPass :
         StateVariableFilterParams<T>::Mode::BandPass;
 
-    for (int i = 0; i < numFilters + 1 - 1; ++i) {
-        filterParams[i].setMode(mode);
-    }
+    filters.setMode(mode);
 
     // Run the modulators, hold onto their output.
     // Raw Modulator outputs put in modulatorOutputs[].
@@ -238,14 +269,71 @@ inline void VocalAnimator<TBase>::stepModulation()
         TBase::outputs[LEDOutputs[i]].setVoltage(modulatorOutput[i], 0);
     }
 
+    // tracking:
+    //  0 = all 1v/octave, mod scaled, no on top
+    //  1 = mod and cv scaled
+    //  2 = 1, + top filter gets some mod
+    int cvScaleMode = 0;
+    const float cvScaleParam = TBase::params[TRACK_EXP_PARAM].value;
+    if (cvScaleParam < .5) {
+        cvScaleMode = 0;
+    } else if (cvScaleParam < 1.5) {
+        cvScaleMode = 1;
+    } else {
+        cvScaleMode = 2;
+        assert(cvScaleParam < 2.5);
+    }
+
+    // When all the CV is mono, every channel gets the same settings, so only calculate them once.
+    const bool polyCV =
+        TBase::inputs[FILTER_Q_CV_INPUT].channels > 1 ||
+        TBase::inputs[FILTER_FC_CV_INPUT].channels > 1 ||
+        TBase::inputs[FILTER_MOD_DEPTH_CV_INPUT].channels > 1;
+    if (polyCV) {
+        for (int channel = 0; channel < numChannels; ++channel) {
+            stepChannelFilters(channel, channel + 1, cvScaleMode);
+        }
+    } else {
+        stepChannelFilters(0, numChannels, cvScaleMode);
+    }
+
+    int matrixMode;
+    float mmParam = TBase::params[LFO_MIX_PARAM].value;
+    if (mmParam < .5) {
+        matrixMode = 0;
+    } else if (mmParam < 1.5) {
+        matrixMode = 1;
+    } else {
+        matrixMode = 2;
+        assert(mmParam < 2.5);
+    }
+
+    const T spread = T(1.0);
+
+    // scale by sub-sample rate to lfo rate sounds right.
+    const float modRate = modulationSubSample * scalem2_2(
+        TBase::inputs[LFO_RATE_CV_INPUT].getVoltage(0),
+        TBase::params[LFO_RATE_PARAM].value,
+        TBase::params[LFO_RATE_TRIM_PARAM].value);
+    modulatorParams.setRateAndSpread(
+        modRate,
+        spread,
+        matrixMode,
+        reciprocalSampleRate);
+}
+
+
+template <class TBase>
+inline void VocalAnimator<TBase>::stepChannelFilters(int channel, int lastChannel, int cvScaleMode)
+{
     // Normalize all the parameters out here
     const T qFinal = scaleQ(
-        TBase::inputs[FILTER_Q_CV_INPUT].getVoltage(0),
+        TBase::inputs[FILTER_Q_CV_INPUT].getPolyVoltage(channel),
         TBase::params[FILTER_Q_PARAM].value,
         TBase::params[FILTER_Q_TRIM_PARAM].value);
 
     const T fc = scalen5_5(
-        TBase::inputs[FILTER_FC_CV_INPUT].getVoltage(0),
+        TBase::inputs[FILTER_FC_CV_INPUT].getPolyVoltage(channel),
         TBase::params[FILTER_FC_PARAM].value,
         TBase::params[FILTER_FC_TRIM_PARAM].value);
 
@@ -254,27 +342,17 @@ inline void VocalAnimator<TBase>::stepModulation()
 
     // cv, knob, trim
     const T baseModDepth = scale0_1(
-        TBase::inputs[FILTER_MOD_DEPTH_CV_INPUT].getVoltage(0),
+        TBase::inputs[FILTER_MOD_DEPTH_CV_INPUT].getPolyVoltage(channel),
         TBase::params[FILTER_MOD_DEPTH_PARAM].value,
         TBase::params[FILTER_MOD_DEPTH_TRIM_PARAM].value);
 
-    // tracking:
-    //  0 = all 1v/octave, mod scaled, no on top
-    //  1 = mod and cv scaled
-    //  2 = 1, + top filter gets some mod
-    int cvScaleMode = 0;
-    const float cvScaleParam = TBase::params[TRACK_EXP_PARAM].value;
-    if (cvScaleParam < .5) {
-        cvScaleMode = 0;
-    } else if (cvScaleParam < 1.5) {
-        cvScaleMode = 1;
-    } else {
-        cvScaleMode = 2;
-        assert(cvScaleParam < 2.5);
-    }
-
     // Just do the Q division once, in the outer loop
-    filterNormalizedBandwidth = T(1) / qFinal;
+    const T filterNormalizedBandwidth = T(1) / qFinal;
+#ifdef _ANORM
+    for (int c = channel; c < lastChannel; ++c) {
+        mixGain[c] = filterNormalizedBandwidth * 2;
+    }
+#endif
     for (int i = 0; i < numFilters; ++i) {
         T logFreq = nominalFilterCenterLog2[i];
 
@@ -316,41 +394,19 @@ inline void VocalAnimator<TBase>::stepModulation()
             baseModDepth *
             nominalModSensitivity[i];
 
-        filterFrequencyLog[i] = logFreq;
-
         // tell lookup not to assert - we know we can go slightly out of range.
         T normFreq = LookupTable<T>::lookup(*expLookup, logFreq, true) * reciprocalSampleRate;
         normFreq = std::min(normFreq, T(.2));
 
-        normalizedFilterFreq[i] = normFreq;
-        filterParams[i].setFreq(normFreq);
-
-        filterParams[i].setNormalizedBandwidth(filterNormalizedBandwidth);
-    }
-
-    int matrixMode;
-    float mmParam = TBase::params[LFO_MIX_PARAM].value;
-    if (mmParam < .5) {
-        matrixMode = 0;
-    } else if (mmParam < 1.5) {
-        matrixMode = 1;
-    } else {
-        matrixMode = 2;
-        assert(mmParam < 2.5);
+        if (channel == 0) {
+            filterFrequencyLog[i] = logFreq;
+            normalizedFilterFreq[i] = normFreq;
+        }
+        for (int c = channel; c < lastChannel; ++c) {
+            filters.setFreq(c * numFilters + i, normFreq);
+            filters.setNormalizedBandwidth(c * numFilters + i, filterNormalizedBandwidth);
+        }
     }
-
-    const T spread = T(1.0);
-
-    // scale by sub-sample rate to lfo rate sounds right.
-    const float modRate = modulationSubSample * scalem2_2(
-        TBase::inputs[LFO_RATE_CV_INPUT].getVoltage(0),
-        TBase::params[LFO_RATE_PARAM].value,
-        TBase::params[LFO_RATE_TRIM_PARAM].value);
-    modulatorParams.setRateAndSpread(
-        modRate,
-        spread,
-        matrixMode,
-        reciprocalSampleRate);
 }
 
 
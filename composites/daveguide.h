@@ -10,11 +10,17 @@ class Daveguide : public TBase
 public:
     Daveguide(Module * module) : TBase(module), delay(44100)
     {
-       // init();
+        init();
     }
     Daveguide() : TBase(), delay(44100)
     {
-       // init();
+        init();
+    }
+
+    void init()
+    {
+        // allpass is flat, so the loop decays the same at all pitches.
+        delay.setInterpolation(FractionalDelay::Interpolation::Allpass);
     }
 
     enum ParamIds
@@ -8,6 +8,17 @@
 #include "BiquadFilter.h"
 #include <memory>
 
+/**
+ * The odd order lowpass designs come out of DspFilters with a gain of -1,
+ * so flip the sign of one stage.
+ */
+template <typename T, int N>
+static void invertGain(BiquadParams<T, N>& params)
+{
+    params.B0(0) = -params.B0(0);
+    params.B1(0) = -params.B1(0);
+    params.B2(0) = -params.B2(0);
+}
 
 template <typename T>
 void ButterworthFilterDesigner<T>::designEightPoleLowpass(BiquadParams<T, 4>& outParams, T frequency)
@@ -37,6 +48,7 @@ void ButterworthFilterDesigner<T>::designFivePoleLowpass(BiquadParams<T, 3>& out
     lp5->SetupAs(frequency);
     assert(lp5->GetStageCount() == 3);
     BiquadFilter<T>::fillFromStages(outParams, lp5->Stages(), lp5->GetStageCount());
+    invertGain(outParams);
 }
 
 template <typename T>
@@ -47,6 +59,7 @@ void ButterworthFilterDesigner<T>::designThreePoleLowpass(BiquadParams<T, 2>& ou
     lp3->SetupAs(frequency);
     assert(lp3->GetStageCount() == 2);
     BiquadFilter<T>::fillFromStages(outParams, lp3->Stages(), lp3->GetStageCount());
+    invertGain(outParams);
 }
 
 template <typename T>
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "BiquadParams.h"
+
+#include <assert.h>
+#include <xmmintrin.h>
+#include <mmintrin.h>
+
+/**
+ * Runs the same cascade of biquads on N channels at once.
+ * N must be a multiple of four - each group of four channels is
+ * one SSE vector.
+ *
+ * Same topology and coefficient conventions as BiquadFilter, so
+ * the params can come from any of our designers.
+ *
+ * S is the number of stages.
+ */
+template <int N, int S>
+class MultiBiquad
+{
+public:
+    MultiBiquad();
+
+    /**
+     * Copy in the filter coefficients. All channels use the same.
+     */
+    void setParams(const BiquadParams<float, S>&);
+
+    /**
+     * Filter numChannels (rounded up to a multiple of four) of input.
+     * input and output may be the same buffer.
+     */
+    void run(const float* input, float* output, int numChannels);
+
+    void clear();
+
+private:
+    static_assert((N % 4) == 0, "channels must be multiple of 4");
+    static const int numVectors = N / 4;
+
+    __m128 a1[S];
+    __m128 a2[S];
+    __m128 b0[S];
+    __m128 b1[S];
+    __m128 b2[S];
+
+    __m128 z0[S][numVectors];
+    __m128 z1[S][numVectors];
+};
+
+template <int N, int S>
+inline MultiBiquad<N, S>::MultiBiquad()
+{
+    for (int stage = 0; stage < S; ++stage) {
+        a1[stage] = a2[stage] = b0[stage] = b1[stage] = b2[stage] = _mm_setzero_ps();
+    }
+    clear();
+}
+
+template <int N, int S>
+inline void MultiBiquad<N, S>::clear()
+{
+    for (int stage = 0; stage < S; ++stage) {
+        for (int i = 0; i < numVectors; ++i) {
+            z0[stage][i] = _mm_setzero_ps();
+            z1[stage][i] = _mm_setzero_ps();
+        }
+    }
+}
+
+template <int N, int S>
+inline void MultiBiquad<N, S>::setParams(const BiquadParams<float, S>& params)
+{
+    for (int stage = 0; stage < S; ++stage) {
+        a1[stage] = _mm_set_ps1(params.A1(stage));
+        a2[stage] = _mm_set_ps1(params.A2(stage));
+        b0[stage] = _mm_set_ps1(params.B0(stage));
+        b1[stage] = _mm_set_ps1(params.B1(stage));
+        b2[stage] = _mm_set_ps1(params.B2(stage));
+    }
+}
+
+template <int N, int S>
+inline void MultiBiquad<N, S>::run(const float* input, float* output, int numChannels)
+{
+    assert(numChannels <= N);
+    for (int i = 0; (i * 4) < numChannels; ++i) {
+        __m128 x = _mm_loadu_ps(input + i * 4);
+        for (int stage = 0; stage < S; ++stage) {
+            __m128 node = _mm_add_ps(x, _mm_add_ps(
+                _mm_mul_ps(a1[stage], z0[stage][i]),
+                _mm_mul_ps(a2[stage], z1[stage][i])));
+
+            x = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(b0[stage], node),
+                _mm_mul_ps(b1[stage], z0[stage][i])),
+                _mm_mul_ps(b2[stage], z1[stage][i]));
+            z1[stage][i] = z0[stage][i];
+            z0[stage][i] = node;
+        }
+        _mm_storeu_ps(output + i * 4, x);
+    }
+}
@@ -180,6 +180,121 @@ inline void MultiLag<N>::step(const float * input)
 
 /******************************************************************************************************/
 
+/**
+ * Like MultiLag, but every lane has its own attack and release,
+ * and only the lanes in use are processed.
+ *
+ * Intended for polyphonic use, where each lane is a channel.
+ */
+template <int N>
+class MultiLagPerLane
+{
+public:
+    MultiLagPerLane();
+
+    /**
+     * attack and release, using direct filter L values
+     */
+    void setAttackL(int lane, float l)
+    {
+        assert(lane >= 0 && lane < N);
+        lAttack[lane] = l;
+    }
+    void setReleaseL(int lane, float l)
+    {
+        assert(lane >= 0 && lane < N);
+        lRelease[lane] = l;
+    }
+
+    /**
+     * Process one sample of numLanes (rounded up to a multiple of four)
+     */
+    void step(const float * input, int numLanes);
+
+    /**
+     * Process numSamples of numLanes (must be a multiple of four).
+     * input and output are interleaved, numLanes floats per sample.
+     */
+    void step(const float * input, float * output, int numLanes, int numSamples);
+
+    float get(int index) const
+    {
+        assert(index < N);
+        return memory[index];
+    }
+    const float* get() const
+    {
+        return memory;
+    }
+
+    /**
+     * Overwrite the state of a lane, for moving channels
+     * to different lanes.
+     */
+    void set(int index, float value)
+    {
+        assert(index >= 0 && index < N);
+        memory[index] = value;
+    }
+
+private:
+    static_assert((N % 4) == 0, "lanes must be multiple of 4");
+
+    float memory[N] = {0};
+    float lAttack[N];
+    float lRelease[N];
+};
+
+template <int N>
+inline MultiLagPerLane<N>::MultiLagPerLane()
+{
+    for (int i = 0; i < N; ++i) {
+        lAttack[i] = 0;
+        lRelease[i] = 0;
+    }
+}
+
+/**
+ * z = _z * _l + _k * x;
+ */
+template <int N>
+inline void MultiLagPerLane<N>::step(const float * input, int numLanes)
+{
+    assert(numLanes <= N);
+    const __m128 one = _mm_set_ps1(1.f);
+    for (int i = 0; i < numLanes; i += 4) {
+        __m128 input4 = _mm_loadu_ps(input + i);
+        __m128 memory4 = _mm_loadu_ps(memory + i);
+        __m128 cmp = _mm_cmpge_ps(input4, memory4);     //cmp has 11111 where >=, 0000 others
+
+        __m128 la = _mm_and_ps(cmp, _mm_loadu_ps(lAttack + i));
+        __m128 lr = _mm_andnot_ps(cmp, _mm_loadu_ps(lRelease + i));
+        __m128 l = _mm_or_ps(la, lr);
+        __m128 k = _mm_sub_ps(one, l);
+
+        __m128 temp = _mm_mul_ps(input4, k);
+        memory4 = _mm_mul_ps(memory4, l);
+        memory4 = _mm_add_ps(memory4, temp);
+        _mm_storeu_ps(memory + i, memory4);
+    }
+}
+
+template <int N>
+inline void MultiLagPerLane<N>::step(const float * input, float * output, int numLanes, int numSamples)
+{
+    assert((numLanes % 4) == 0);
+    for (int sample = 0; sample < numSamples; ++sample) {
+        step(input, numLanes);
+        for (int i = 0; i < numLanes; i += 4) {
+            _mm_storeu_ps(output + i, _mm_loadu_ps(memory + i));
+        }
+        input += numLanes;
+        output += numLanes;
+    }
+}
+
+/******************************************************************************************************/
+
 /**
  * initial CPU = 2.3, 28.1 change freq every sample
  *                  , 6.1 with non-uniform look
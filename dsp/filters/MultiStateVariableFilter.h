@@ -0,0 +1,164 @@
+#pragma once
+
+#include "StateVariableFilter.h"
+
+#include <assert.h>
+#include <xmmintrin.h>
+#include <mmintrin.h>
+
+/**
+ * A bank of N state variable filters, four filters per SSE vector.
+ *
+ * Same math as StateVariableFilter<float> (including the clip on the band output),
+ * but each filter (lane) has its own Fc and bandwidth. All the lanes share the same mode.
+ *
+ * Intended use is one lane per polyphonic channel.
+ */
+template <int N>
+class MultiStateVariableFilter
+{
+public:
+    using Mode = typename StateVariableFilterParams<float>::Mode;
+
+    MultiStateVariableFilter();
+
+    /**
+     * Set the center frequency.
+     * units are 1 == sample rate
+     */
+    void setFreq(int lane, float f)
+    {
+        assert(lane >= 0 && lane < N);
+        fcGain[lane] = float(AudioMath::Pi) * 2.f * f;
+    }
+
+    /**
+     * Normalized bandwidth is bw / fc
+     * Also is 1 / Q
+     */
+    void setNormalizedBandwidth(int lane, float bw)
+    {
+        assert(lane >= 0 && lane < N);
+        qGain[lane] = bw;
+    }
+
+    void setMode(Mode m)
+    {
+        mode = m;
+    }
+
+    /**
+     * Filter numLanes (rounded up to a multiple of four) of input.
+     */
+    void run(const float* input, float* output, int numLanes);
+
+    /**
+     * Filter the same input through numLanes (rounded up to a multiple of four).
+     */
+    void run(float input, float* output, int numLanes);
+
+    /**
+     * Filter numLanes (rounded up to a multiple of four) of input,
+     * and add the output times gain into mix.
+     */
+    void runAndMix(const float* input, float* mix, const float* gain, int numLanes);
+
+    void clear();
+
+private:
+    static_assert((N % 4) == 0, "lanes must be multiple of 4");
+
+    float fcGain[N];
+    float qGain[N];
+    float z1[N];
+    float z2[N];
+    Mode mode = Mode::BandPass;
+
+    __m128 step(__m128 input, int lane);
+};
+
+template <int N>
+inline MultiStateVariableFilter<N>::MultiStateVariableFilter()
+{
+    // same defaults as StateVariableFilterParams
+    for (int i = 0; i < N; ++i) {
+        qGain[i] = 1;
+        fcGain[i] = .001f;
+    }
+    clear();
+}
+
+template <int N>
+inline void MultiStateVariableFilter<N>::clear()
+{
+    for (int i = 0; i < N; ++i) {
+        z1[i] = 0;
+        z2[i] = 0;
+    }
+}
+
+template <int N>
+inline __m128 MultiStateVariableFilter<N>::step(__m128 input, int lane)
+{
+    const __m128 fc = _mm_loadu_ps(fcGain + lane);
+    const __m128 q = _mm_loadu_ps(qGain + lane);
+    const __m128 s1 = _mm_loadu_ps(z1 + lane);
+    const __m128 s2 = _mm_loadu_ps(z2 + lane);
+
+    const __m128 dLow = _mm_add_ps(s2, _mm_mul_ps(fc, s1));
+    const __m128 dHi = _mm_sub_ps(input, _mm_add_ps(_mm_mul_ps(s1, q), dLow));
+    __m128 dBand = _mm_add_ps(_mm_mul_ps(dHi, fc), s1);
+
+    // same clip as StateVariableFilter
+    const __m128 tooHigh = _mm_cmpge_ps(dBand, _mm_set_ps1(1000.f));
+    dBand = _mm_or_ps(_mm_and_ps(tooHigh, _mm_set_ps1(999.f)), _mm_andnot_ps(tooHigh, dBand));
+    const __m128 tooLow = _mm_cmplt_ps(dBand, _mm_set_ps1(-1000.f));
+    dBand = _mm_or_ps(_mm_and_ps(tooLow, _mm_set_ps1(-999.f)), _mm_andnot_ps(tooLow, dBand));
+
+    _mm_storeu_ps(z1 + lane, dBand);
+    _mm_storeu_ps(z2 + lane, dLow);
+
+    switch (mode) {
+        case Mode::LowPass:
+            return dLow;
+        case Mode::HiPass:
+            return dHi;
+        case Mode::BandPass:
+            return dBand;
+        case Mode::Notch:
+            return _mm_add_ps(dLow, dHi);
+        default:
+            assert(false);
+    }
+    return _mm_setzero_ps();
+}
+
+template <int N>
+inline void MultiStateVariableFilter<N>::run(const float* input, float* output, int numLanes)
+{
+    assert(numLanes <= N);
+    for (int lane = 0; lane < numLanes; lane += 4) {
+        _mm_storeu_ps(output + lane, step(_mm_loadu_ps(input + lane), lane));
+    }
+}
+
+template <int N>
+inline void MultiStateVariableFilter<N>::run(float input, float* output, int numLanes)
+{
+    assert(numLanes <= N);
+    const __m128 x = _mm_set_ps1(input);
+    for (int lane = 0; lane < numLanes; lane += 4) {
+        _mm_storeu_ps(output + lane, step(x, lane));
+    }
+}
+
+template <int N>
+inline void MultiStateVariableFilter<N>::runAndMix(const float* input, float* mix, const float* gain, int numLanes)
+{
+    assert(numLanes <= N);
+    for (int lane = 0; lane < numLanes; lane += 4) {
+        const __m128 x = step(_mm_loadu_ps(input + lane), lane);
+        const __m128 sum = _mm_add_ps(_mm_loadu_ps(mix + lane), _mm_mul_ps(x, _mm_loadu_ps(gain + lane)));
+        _mm_storeu_ps(mix + lane, sum);
+    }
+}
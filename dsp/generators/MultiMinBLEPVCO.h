@@ -0,0 +1,424 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <xmmintrin.h>
+#include <mmintrin.h>
+
+#include "MinBLEPVCO.h"
+
+/**
+ * Polyphonic version of MinBLEPVCO.
+ *
+ * Runs N voices (N a multiple of four) in lock-step, four at a time in SSE lanes.
+ * Phase accumulation, edge detection and the naive waveforms are all vectorized.
+ * Only the minBLEP insertion itself is scalar, and that only happens on the
+ * (rare) samples where a voice has a discontinuity.
+ *
+ * The minBLEP residuals for all the voices share one ring buffer, laid out
+ * one row per sample with a column per voice, so draining the residual
+ * is a vector add per four voices.
+ *
+ * All voices share the same waveform, as they would in a polyphonic module.
+ * Unlike MinBLEPVCO there is no hard sync.
+ *
+ * perf test, saw: four MinBLEPVCO .17, MultiMinBLEPVCO<4> .036
+ */
+template <int N>
+class MultiMinBLEPVCO
+{
+public:
+    using Waveform = MinBLEPVCO::Waveform;
+
+    MultiMinBLEPVCO();
+
+    void setWaveform(Waveform);
+    void setNormalizedFreq(int voice, float f, float st);
+    void setPulseWidth(int voice, float);
+
+    /**
+     * Only the first numVoices (rounded up to a multiple of four) are run.
+     * Defaults to all N.
+     */
+    void setNumVoices(int numVoices);
+
+    /**
+     * generate one sample for all the running voices
+     */
+    void step();
+
+    /**
+     * generate numFrames samples for all the running voices.
+     * output is frame major: output[frame * N + voice]
+     */
+    void process(float* output, int numFrames);
+
+    float getOutput(int voice) const
+    {
+        assert(voice < N);
+        return output[voice];
+    }
+
+    const float* getOutputs() const
+    {
+        return output;
+    }
+
+private:
+    static const int Z = 16;            // zero crossings, same as MinBLEPVCO
+    static const int O = 32;            // oversample
+    static const int residualSize = 2 * Z;
+    static_assert((N % 4) == 0, "voices must be multiple of 4");
+    static_assert((residualSize & (residualSize - 1)) == 0, "ring buffer must be power of two");
+
+    Waveform waveform = Waveform::Saw;
+    int numLanes = N;
+
+    float phase[N] = {0};
+    float normalizedFreq[N] = {0};
+    float pulseWidth[N];
+    float tri[N] = {0};
+    float lastSq[N] = {0};          // all ones where square was high
+    float output[N] = {0};
+    float sampleTime = 0;
+
+    /**
+     * residual[i][voice] is the pending minBLEP correction
+     * for voice, i samples in the future (relative to residualPos).
+     */
+    float residual[residualSize][N] = {{0}};
+    int residualPos = 0;
+
+    float impulse[2 * Z * O + 1];
+
+    std::shared_ptr<LookupTableParams<float>> sinLookup = {ObjectCache<float>::getSinLookup()};
+
+    void insertDiscontinuity(int voice, float crossing, float jump);
+
+    void step_saw();
+    void step_sq();
+    void step_sin();
+    void step_tri();
+    void step_even();
+
+    /**
+     * add the pending residual to 'wave', scale to +-5V and
+     * store in output. Advances the residual ring buffer.
+     */
+    void finishOutput(const float* wave);
+
+    /**
+     * advance all the phases by one sample.
+     * returns a bitmask of the voices that wrapped.
+     */
+    int advancePhase();
+
+    float sineLook(float input) const;
+};
+
+template <int N>
+inline MultiMinBLEPVCO<N>::MultiMinBLEPVCO()
+{
+    ::rack::dsp::minBlepImpulse(Z, O, impulse);
+    impulse[2 * Z * O] = 1.f;
+    for (int i = 0; i < N; ++i) {
+        pulseWidth[i] = .5f;
+    }
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::setWaveform(Waveform wf)
+{
+    waveform = wf;
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::setNormalizedFreq(int voice, float f, float st)
+{
+    assert(voice < N);
+    normalizedFreq[voice] = std::clamp(f, 1e-6f, 0.5f);
+    sampleTime = st;
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::setPulseWidth(int voice, float pw)
+{
+    assert(voice < N);
+    pulseWidth[voice] = pw;
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::setNumVoices(int numVoices)
+{
+    assert(numVoices > 0 && numVoices <= N);
+    const int lanes = (numVoices + 3) & ~3;
+
+    // voices that start running again shouldn't get left over minBLEPs
+    for (int voice = numLanes; voice < lanes; ++voice) {
+        for (int i = 0; i < residualSize; ++i) {
+            residual[i][voice] = 0;
+        }
+    }
+    numLanes = lanes;
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::insertDiscontinuity(int voice, float p, float x)
+{
+    // same as rack::dsp::MinBlepGenerator::insertDiscontinuity
+    if (!(-1 < p && p <= 0)) {
+        return;
+    }
+    for (int j = 0; j < residualSize; ++j) {
+        const float minBlepIndex = ((float) j - p) * O;
+        const int index = (residualPos + j) & (residualSize - 1);
+        residual[index][voice] += x * (-1.f + sq::interpolateLinear(impulse, minBlepIndex));
+    }
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::finishOutput(const float* wave)
+{
+    const __m128 five = _mm_set_ps1(5.f);
+    const __m128 zero = _mm_setzero_ps();
+    float* res = residual[residualPos];
+    for (int i = 0; i < numLanes; i += 4) {
+        __m128 x = _mm_loadu_ps(wave + i);
+        x = _mm_add_ps(x, _mm_loadu_ps(res + i));
+        _mm_storeu_ps(output + i, _mm_mul_ps(x, five));
+        _mm_storeu_ps(res + i, zero);
+    }
+    residualPos = (residualPos + 1) & (residualSize - 1);
+}
+
+template <int N>
+inline int MultiMinBLEPVCO<N>::advancePhase()
+{
+    int wrapped = 0;
+    const __m128 one = _mm_set_ps1(1.f);
+    for (int i = 0; i < numLanes; i += 4) {
+        __m128 ph = _mm_add_ps(_mm_loadu_ps(phase + i), _mm_loadu_ps(normalizedFreq + i));
+        __m128 overflow = _mm_cmpge_ps(ph, one);
+        ph = _mm_sub_ps(ph, _mm_and_ps(overflow, one));
+        _mm_storeu_ps(phase + i, ph);
+        wrapped |= _mm_movemask_ps(overflow) << i;
+    }
+    return wrapped;
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::step()
+{
+    switch (waveform) {
+        case Waveform::Saw:
+            step_saw();
+            break;
+        case Waveform::Square:
+            step_sq();
+            break;
+        case Waveform::Sin:
+            step_sin();
+            break;
+        case Waveform::Tri:
+            step_tri();
+            break;
+        case Waveform::Even:
+            step_even();
+            break;
+        case Waveform::END:
+            for (int i = 0; i < numLanes; ++i) {
+                output[i] = 0;
+            }
+            break;
+        default:
+            assert(false);
+    }
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::process(float* out, int numFrames)
+{
+    for (int frame = 0; frame < numFrames; ++frame) {
+        step();
+        for (int i = 0; i < numLanes; i += 4) {
+            _mm_storeu_ps(out + i, _mm_loadu_ps(output + i));
+        }
+        out += N;
+    }
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::step_saw()
+{
+    int wrapped = advancePhase();
+    for (int voice = 0; wrapped; ++voice, wrapped >>= 1) {
+        if (wrapped & 1) {
+            const float crossing = -phase[voice] / normalizedFreq[voice];
+            insertDiscontinuity(voice, crossing, -2);
+        }
+    }
+
+    float wave[N];
+    const __m128 one = _mm_set_ps1(1.f);
+    const __m128 two = _mm_set_ps1(2.f);
+    for (int i = 0; i < numLanes; i += 4) {
+        __m128 saw = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(phase + i), two), one);
+        _mm_storeu_ps(wave + i, saw);
+    }
+    finishOutput(wave);
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::step_sq()
+{
+    const int wrapped = advancePhase();
+
+    float wave[N];
+    const __m128 one = _mm_set_ps1(1.f);
+    const __m128 minusOne = _mm_set_ps1(-1.f);
+    int changed = 0;
+    for (int i = 0; i < numLanes; i += 4) {
+        __m128 high = _mm_cmpge_ps(_mm_loadu_ps(phase + i), _mm_loadu_ps(pulseWidth + i));
+        __m128 last = _mm_loadu_ps(lastSq + i);
+        changed |= _mm_movemask_ps(_mm_xor_ps(high, last)) << i;
+        _mm_storeu_ps(lastSq + i, high);
+
+        __m128 square = _mm_or_ps(_mm_and_ps(high, one), _mm_andnot_ps(high, minusOne));
+        _mm_storeu_ps(wave + i, square);
+    }
+
+    for (int voice = 0; changed; ++voice, changed >>= 1) {
+        if (changed & 1) {
+            const float jump = (wave[voice] > 0) ? 2.f : -2.f;
+            const float crossing = (wrapped & (1 << voice)) ?
+                -phase[voice] / normalizedFreq[voice] :
+                -(phase[voice] - pulseWidth[voice]) / normalizedFreq[voice];
+            insertDiscontinuity(voice, crossing, jump);
+        }
+    }
+    finishOutput(wave);
+}
+
+template <int N>
+inline float MultiMinBLEPVCO<N>::sineLook(float input) const
+{
+    // want cosine, but only have sine lookup
+    float adjPhase = input + .25f;
+    if (adjPhase >= 1) {
+        adjPhase -= 1;
+    }
+    return -LookupTable<float>::lookup(*sinLookup, adjPhase, true);
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::step_sin()
+{
+    advancePhase();
+    float wave[N];
+    for (int voice = 0; voice < numLanes; ++voice) {
+        wave[voice] = sineLook(phase[voice]);
+    }
+    finishOutput(wave);
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::step_tri()
+{
+    const __m128 half = _mm_set_ps1(.5f);
+    int crossedHalf = 0;
+    for (int i = 0; i < numLanes; i += 4) {
+        __m128 oldPhase = _mm_loadu_ps(phase + i);
+        __m128 newPhase = _mm_add_ps(oldPhase, _mm_loadu_ps(normalizedFreq + i));
+        __m128 crossed = _mm_and_ps(_mm_cmplt_ps(oldPhase, half), _mm_cmpge_ps(newPhase, half));
+        crossedHalf |= _mm_movemask_ps(crossed) << i;
+    }
+    const int wrapped = advancePhase();
+
+    for (int voice = 0; voice < numLanes; ++voice) {
+        const int mask = 1 << voice;
+        if (crossedHalf & mask) {
+            // we may have wrapped on the same sample, so unwrap
+            const float unwrapped = phase[voice] + ((wrapped & mask) ? 1.f : 0.f);
+            const float crossing = -(unwrapped - 0.5f) / normalizedFreq[voice];
+            insertDiscontinuity(voice, crossing, 2.f);
+        }
+        if (wrapped & mask) {
+            const float crossing = -phase[voice] / normalizedFreq[voice];
+            insertDiscontinuity(voice, crossing, -2.f);
+        }
+    }
+
+    float square[N];
+    const __m128 one = _mm_set_ps1(1.f);
+    const __m128 minusOne = _mm_set_ps1(-1.f);
+    const float* res = residual[residualPos];
+    for (int i = 0; i < numLanes; i += 4) {
+        __m128 low = _mm_cmplt_ps(_mm_loadu_ps(phase + i), half);
+        __m128 sq = _mm_or_ps(_mm_and_ps(low, minusOne), _mm_andnot_ps(low, one));
+        sq = _mm_add_ps(sq, _mm_loadu_ps(res + i));
+        _mm_storeu_ps(square + i, sq);
+    }
+
+    // Integrate square for triangle. The minBLEP goes into the square, not the tri,
+    // so do our own version of finishOutput.
+    const __m128 four = _mm_set_ps1(4.f);
+    const __m128 five = _mm_set_ps1(5.f);
+    const __m128 leak = _mm_set_ps1(1.f - 40.f * sampleTime);
+    const __m128 zero = _mm_setzero_ps();
+    float* resw = residual[residualPos];
+    for (int i = 0; i < numLanes; i += 4) {
+        __m128 t = _mm_loadu_ps(tri + i);
+        __m128 inc = _mm_mul_ps(_mm_mul_ps(four, _mm_loadu_ps(square + i)), _mm_loadu_ps(normalizedFreq + i));
+        t = _mm_mul_ps(_mm_add_ps(t, inc), leak);
+        _mm_storeu_ps(tri + i, t);
+        _mm_storeu_ps(output + i, _mm_mul_ps(t, five));
+        _mm_storeu_ps(resw + i, zero);
+    }
+    residualPos = (residualPos + 1) & (residualSize - 1);
+}
+
+template <int N>
+inline void MultiMinBLEPVCO<N>::step_even()
+{
+    const __m128 half = _mm_set_ps1(.5f);
+    int crossedHalf = 0;
+    for (int i = 0; i < numLanes; i += 4) {
+        __m128 oldPhase = _mm_loadu_ps(phase + i);
+        __m128 newPhase = _mm_add_ps(oldPhase, _mm_loadu_ps(normalizedFreq + i));
+        __m128 crossed = _mm_and_ps(_mm_cmplt_ps(oldPhase, half), _mm_cmpge_ps(newPhase, half));
+        crossedHalf |= _mm_movemask_ps(crossed) << i;
+    }
+    const int wrapped = advancePhase();
+
+    // The double saw drops by two at each discontinuity.
+    // Since the residual is added to the final "even" output, pre-scale it.
+    const float jump = -2.f * .55f;
+    for (int voice = 0; voice < numLanes; ++voice) {
+        const int mask = 1 << voice;
+        if (wrapped & mask) {
+            const float crossing = -phase[voice] / normalizedFreq[voice];
+            insertDiscontinuity(voice, crossing, jump);
+        } else if (crossedHalf & mask) {
+            const float crossing = -(phase[voice] - 0.5f) / normalizedFreq[voice];
+            insertDiscontinuity(voice, crossing, jump);
+        }
+    }
+
+    float wave[N];
+    for (int voice = 0; voice < numLanes; ++voice) {
+        wave[voice] = 1.27f * sineLook(phase[voice]);
+    }
+
+    const __m128 one = _mm_set_ps1(1.f);
+    const __m128 four = _mm_set_ps1(4.f);
+    const __m128 k = _mm_set_ps1(.55f);
+    for (int i = 0; i < numLanes; i += 4) {
+        __m128 ph = _mm_loadu_ps(phase + i);
+        __m128 upper = _mm_cmpge_ps(ph, half);
+        ph = _mm_sub_ps(ph, _mm_and_ps(upper, half));
+        __m128 doubleSaw = _mm_sub_ps(_mm_mul_ps(ph, four), one);
+        __m128 even = _mm_mul_ps(k, _mm_add_ps(doubleSaw, _mm_loadu_ps(wave + i)));
+        _mm_storeu_ps(wave + i, even);
+    }
+    finishOutput(wave);
+}
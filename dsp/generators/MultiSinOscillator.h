@@ -0,0 +1,118 @@
+#pragma once
+
+#include <assert.h>
+#include <xmmintrin.h>
+#include <mmintrin.h>
+
+/**
+ * A bank of N sine oscillators, each with its own frequency.
+ * Runs four oscillators per SSE vector.
+ *
+ * Works like SinOscillator<float, true>: the phase is a saw from 0..1,
+ * frequency may be negative, and the quadrature output leads by 1/4 cycle.
+ *
+ * Instead of the sin lookup table, uses a polynomial that is
+ * good to about 1e-6, since a table lookup can't be vectorized.
+ */
+template <int N>
+class MultiSinOscillator
+{
+public:
+    MultiSinOscillator();
+
+    /**
+     * @param freq is normalized -.5 .. .5
+     */
+    void setFrequency(int channel, float freq)
+    {
+        assert(channel >= 0 && channel < N);
+        assert(freq >= -.5 && freq <= .5);
+        phaseIncrement[channel] = freq;
+    }
+
+    /**
+     * Generates one sample of sin and cos for numChannels (rounded up to
+     * a multiple of four) channels.
+     */
+    void runQuadrature(float* sinOut, float* cosOut, int numChannels);
+
+    /**
+     * sin(2 * pi * x), for 0 <= x < 1
+     */
+    static __m128 sin2pi(__m128 x);
+
+private:
+    static_assert((N % 4) == 0, "channels must be multiple of 4");
+    float phase[N];
+    float phaseIncrement[N];
+
+    static __m128 wrap(__m128 x);
+};
+
+template <int N>
+inline MultiSinOscillator<N>::MultiSinOscillator()
+{
+    for (int i = 0; i < N; ++i) {
+        phase[i] = 0;
+        phaseIncrement[i] = 0;
+    }
+}
+
+/**
+ * put x back in 0..1, assuming it is no more than one cycle out
+ */
+template <int N>
+inline __m128 MultiSinOscillator<N>::wrap(__m128 x)
+{
+    const __m128 one = _mm_set_ps1(1.f);
+    const __m128 zero = _mm_setzero_ps();
+    x = _mm_sub_ps(x, _mm_and_ps(_mm_cmpge_ps(x, one), one));
+    x = _mm_add_ps(x, _mm_and_ps(_mm_cmplt_ps(x, zero), one));
+    return x;
+}
+
+template <int N>
+inline __m128 MultiSinOscillator<N>::sin2pi(__m128 x)
+{
+    const __m128 half = _mm_set_ps1(.5f);
+    const __m128 quarter = _mm_set_ps1(.25f);
+    const __m128 signMask = _mm_set_ps1(-0.f);
+
+    // sin(2pi x) = -sin(2pi(x - .5)), now in -.5 .. .5
+    x = _mm_sub_ps(x, half);
+
+    // fold -.5 .. .5 into -.25 .. .25 using sin(pi - t) = sin(t)
+    const __m128 sign = _mm_and_ps(x, signMask);
+    const __m128 mag = _mm_andnot_ps(signMask, x);
+    const __m128 fold = _mm_cmpgt_ps(mag, quarter);
+    const __m128 folded = _mm_or_ps(sign, _mm_sub_ps(half, mag));
+    x = _mm_or_ps(_mm_and_ps(fold, folded), _mm_andnot_ps(fold, x));
+
+    // taylor series for sin(t), t = 2pi x, |t| <= pi/2
+    const __m128 t = _mm_mul_ps(x, _mm_set_ps1(2.f * 3.14159265358979f));
+    const __m128 t2 = _mm_mul_ps(t, t);
+    __m128 poly = _mm_set_ps1(-1.f / 39916800.f);
+    poly = _mm_add_ps(_mm_mul_ps(poly, t2), _mm_set_ps1(1.f / 362880.f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, t2), _mm_set_ps1(-1.f / 5040.f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, t2), _mm_set_ps1(1.f / 120.f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, t2), _mm_set_ps1(-1.f / 6.f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, t2), _mm_set_ps1(1.f));
+    const __m128 sinT = _mm_mul_ps(poly, t);
+
+    // undo the half cycle shift
+    return _mm_xor_ps(sinT, signMask);
+}
+
+template <int N>
+inline void MultiSinOscillator<N>::runQuadrature(float* sinOut, float* cosOut, int numChannels)
+{
+    assert(numChannels <= N);
+    const __m128 quarter = _mm_set_ps1(.25f);
+    for (int i = 0; i < numChannels; i += 4) {
+        // like SawOscillator, output the phase before incrementing
+        const __m128 ph = _mm_loadu_ps(phase + i);
+        _mm_storeu_ps(sinOut + i, sin2pi(ph));
+        _mm_storeu_ps(cosOut + i, sin2pi(wrap(_mm_add_ps(ph, quarter))));
+        _mm_storeu_ps(phase + i, wrap(_mm_add_ps(ph, _mm_loadu_ps(phaseIncrement + i))));
+    }
+}
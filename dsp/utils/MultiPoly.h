@@ -0,0 +1,172 @@
+#pragma once
+
+#include <assert.h>
+#include <xmmintrin.h>
+#include <mmintrin.h>
+
+/**
+ * Polyphonic version of Poly<T, 10>.
+ *
+ * Evaluates the same weighted sum of Chebyshev polynomials (with the same DC compensation),
+ * but for up to N channels at once, four channels per SSE vector.
+ *
+ * Instead of filling in powers of x, the sum is evaluated with the Clenshaw recurrence:
+ *      b[k] = g[k] + 2x * b[k+1] - b[k+2]
+ *      sum = x * b[1] - b[2]
+ * which is only two multiply-adds per harmonic, and is numerically well behaved in float.
+ *
+ * All of the terms that don't depend on x (the constant terms of the even harmonics and
+ * their DC compensation) are folded into one offset per channel. The offset is only
+ * recalculated when a gain actually changes.
+ *
+ * Gains are stored SoA: gains[harmonic][channel].
+ */
+template <int N>
+class MultiPoly
+{
+public:
+    static const int order = 10;
+
+    MultiPoly();
+
+    /**
+     * @param channel is 0..N-1
+     * @param harmonic is 0..order-1. 0 is the fundamental
+     */
+    void setGain(int channel, int harmonic, float value)
+    {
+        assert(channel >= 0 && channel < N);
+        assert(harmonic >= 0 && harmonic < order);
+        if (gains[harmonic][channel] != value) {
+            gains[harmonic][channel] = value;
+            offsetDirty = true;
+        }
+    }
+
+    /**
+     * input gain is only used to calculate the DC offset. It is the
+     * same as the inputGain parameter to Poly::run
+     */
+    void setInputGain(int channel, float value)
+    {
+        assert(channel >= 0 && channel < N);
+        if (inputGain[channel] != value) {
+            inputGain[channel] = value;
+            offsetDirty = true;
+        }
+    }
+
+    /**
+     * Run the wave-shaper on numChannels channels of input.
+     * Will process numChannels rounded up to a multiple of four.
+     * Both input and output must be at least that big.
+     */
+    void run(const float* input, float* output, int numChannels);
+
+    float getGain(int channel, int harmonic) const
+    {
+        return gains[harmonic][channel];
+    }
+
+private:
+    static_assert((N % 4) == 0, "channels must be multiple of 4");
+
+    float gains[order][N];
+    float inputGain[N];
+    float offset[N];
+    bool offsetDirty = true;
+
+    void updateOffset();
+    static float calcOffset(const float* gains, int stride, double inputGain);
+};
+
+template <int N>
+inline MultiPoly<N>::MultiPoly()
+{
+    for (int channel = 0; channel < N; ++channel) {
+        for (int i = 0; i < order; ++i) {
+            gains[i][channel] = 0;
+        }
+        inputGain[channel] = 0;
+        offset[channel] = 0;
+    }
+}
+
+template <int N>
+inline void MultiPoly<N>::run(const float* input, float* output, int numChannels)
+{
+    assert(numChannels <= N);
+    if (offsetDirty) {
+        updateOffset();
+    }
+    for (int channel = 0; channel < numChannels; channel += 4) {
+        const __m128 x = _mm_loadu_ps(input + channel);
+        const __m128 twoX = _mm_add_ps(x, x);
+        __m128 b1 = _mm_setzero_ps();
+        __m128 b2 = _mm_setzero_ps();
+        for (int harmonic = order - 1; harmonic >= 0; --harmonic) {
+            const __m128 g = _mm_loadu_ps(&gains[harmonic][channel]);
+            const __m128 b0 = _mm_sub_ps(_mm_add_ps(g, _mm_mul_ps(twoX, b1)), b2);
+            b2 = b1;
+            b1 = b0;
+        }
+        __m128 sum = _mm_sub_ps(_mm_mul_ps(x, b1), b2);
+        sum = _mm_add_ps(sum, _mm_loadu_ps(offset + channel));
+        _mm_storeu_ps(output + channel, sum);
+    }
+}
+
+template <int N>
+inline void MultiPoly<N>::updateOffset()
+{
+    for (int channel = 0; channel < N; ++channel) {
+        offset[channel] = calcOffset(&gains[0][channel], N, inputGain[channel]);
+    }
+    offsetDirty = false;
+}
+
+/**
+ * Poly<T, 10> does not use T[2n](x) directly for the even harmonics,
+ * it uses T[2n](x) - T[2n](0) - dc, where dc depends on the input gain.
+ * Since clenshaw gives the pure polynomials, calculate the total correction.
+ */
+template <int N>
+inline float MultiPoly<N>::calcOffset(const float* g, int stride, double gain)
+{
+    // same as Poly::calcDC
+    const double W2 = 2.0 / 4.0;
+    const double W4 = W2 * 3.0 / 4.0;
+    const double W6 = W4 * 5.0 / 6.0;
+    const double W8 = W6 * 7.0 / 8.0;
+    const double W10 = W8 * 9.0 / 10.0;
+
+    double sinEnergy2 = gain * gain;
+    double sinEnergy4 = sinEnergy2 * sinEnergy2;
+    double sinEnergy6 = sinEnergy4 * sinEnergy2;
+    double sinEnergy8 = sinEnergy6 * sinEnergy2;
+    double sinEnergy10 = sinEnergy8 * sinEnergy2;
+
+    sinEnergy2 *= W2;
+    sinEnergy4 *= W4;
+    sinEnergy6 *= W6;
+    sinEnergy8 *= W8;
+    sinEnergy10 *= W10;
+
+    const double dc[5] = {
+        2 * sinEnergy2,
+        8 * sinEnergy4 - 8 * sinEnergy2,
+        32 * sinEnergy6 - 48 * sinEnergy4 + 18 * sinEnergy2,
+        128 * sinEnergy8 - 256 * sinEnergy6 + 160 * sinEnergy4 - 32 * sinEnergy2,
+        512 * sinEnergy10 - 1280 * sinEnergy8 + 1120 * sinEnergy6 - 400 * sinEnergy4 + 50 * sinEnergy2
+    };
+
+    // T[2](0) = -1, T[4](0) = 1, T[6](0) = -1 ...
+    double ret = 0;
+    double evenAtZero = -1;
+    for (int i = 0; i < 5; ++i) {
+        const int harmonic = 2 * i + 1;         // index 1 is 2nd harmonic, etc...
+        ret -= g[harmonic * stride] * (evenAtZero + dc[i]);
+        evenAtZero = -evenAtZero;
+    }
+    return float(ret);
+}
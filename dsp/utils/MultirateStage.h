@@ -0,0 +1,132 @@
+#pragma once
+
+#include "BiquadFilter.h"
+#include "BiquadParams.h"
+#include "BiquadState.h"
+#include "ButterworthFilterDesigner.h"
+
+#include <assert.h>
+
+/**
+ * Runs some processing at a low sample rate, for up to N channels,
+ * and brings the results back up to audio rate.
+ *
+ * The low rate processing is supplied as a function that returns
+ * one new low rate sample for a channel. All channels run at the same rate.
+ *
+ * The decimation rate is the number of audio samples per low rate sample.
+ * It may be fractional, but must be at least midRateFactor.
+ *
+ * Going back up to audio rate is done in two stages, so that hardly anything
+ * runs at the audio rate:
+ *
+ *      low rate -> mid rate (fs / midRateFactor):
+ *          A linear interpolator between the last two low rate samples (a two tap
+ *          polyphase interpolator with continuous phase), followed by a
+ *          three pole butterworth to remove the images. The butterworth is in double,
+ *          since fc / fs can be very low.
+ *
+ *      mid rate -> audio rate:
+ *          Another linear interpolator. By now the signal is so far below the
+ *          mid rate that the images from this are way down.
+ */
+template <int N>
+class MultirateStage
+{
+public:
+    using TButter = double;
+    static const int midRateFactor = 8;
+
+    /**
+     * @param rate is audio samples per low rate sample. Must be >= midRateFactor
+     */
+    void setDecimationRate(float rate);
+
+    float getDecimationRate() const
+    {
+        return lowRate * midRateFactor;
+    }
+
+    /**
+     * Calls the butterworth designer, so it may malloc.
+     * @param fc is the imaging filter cutoff, normalized to the audio sample rate.
+     */
+    void designImagingFilter(float fc)
+    {
+        ButterworthFilterDesigner<TButter>::designThreePoleLowpass(imagingParams, fc * midRateFactor);
+    }
+
+    /**
+     * Generate one audio rate sample for each channel.
+     * @param lowRateFunction is called as float f(int channel) when a channel
+     *      needs a new low rate sample.
+     */
+    template <typename F>
+    void step(int numChannels, float* output, F lowRateFunction);
+
+private:
+    /**
+     * mid rate samples per low rate sample
+     */
+    float lowRate = 100.f / midRateFactor;
+    float lowPhase = 0;
+    int midPhase = 0;
+
+    float lowPrevious[N] = {0};
+    float lowCurrent[N] = {0};
+    float midPrevious[N] = {0};
+    float midCurrent[N] = {0};
+
+    BiquadParams<TButter, 2> imagingParams;
+    BiquadState<TButter, 2> imagingState[N];
+
+    template <typename F>
+    void stepMidRate(int numChannels, F lowRateFunction);
+};
+
+template <int N>
+inline void MultirateStage<N>::setDecimationRate(float rate)
+{
+    assert(rate >= midRateFactor);
+    lowRate = rate / midRateFactor;
+    if (lowPhase >= lowRate) {
+        lowPhase = 0;
+    }
+}
+
+template <int N>
+template <typename F>
+inline void MultirateStage<N>::stepMidRate(int numChannels, F lowRateFunction)
+{
+    lowPhase += 1;
+    if (lowPhase >= lowRate) {
+        lowPhase -= lowRate;
+        for (int channel = 0; channel < numChannels; ++channel) {
+            lowPrevious[channel] = lowCurrent[channel];
+            lowCurrent[channel] = lowRateFunction(channel);
+        }
+    }
+
+    const float t = lowPhase / lowRate;
+    for (int channel = 0; channel < numChannels; ++channel) {
+        const TButter x = lowPrevious[channel] + (lowCurrent[channel] - lowPrevious[channel]) * t;
+        midPrevious[channel] = midCurrent[channel];
+        midCurrent[channel] = float(BiquadFilter<TButter>::run(x, imagingState[channel], imagingParams));
+    }
+}
+
+template <int N>
+template <typename F>
+inline void MultirateStage<N>::step(int numChannels, float* output, F lowRateFunction)
+{
+    assert(numChannels <= N);
+    if (++midPhase >= midRateFactor) {
+        midPhase = 0;
+        stepMidRate(numChannels, lowRateFunction);
+    }
+
+    const float t = float(midPhase) * (1.f / midRateFactor);
+    for (int channel = 0; channel < numChannels; ++channel) {
+        output[channel] = midPrevious[channel] + (midCurrent[channel] - midPrevious[channel]) * t;
+    }
+}
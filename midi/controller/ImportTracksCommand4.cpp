@@ -0,0 +1,50 @@
+#include "ImportTracksCommand4.h"
+#include "MidiLock.h"
+#include "MidiSequencer4.h"
+#include "MidiSong4.h"
+
+#include <assert.h>
+
+ImportTracksCommand4::ImportTracksCommand4(const std::vector<MidiTrackPtr>& tracks) :
+    newTracks(tracks)
+{
+    if (int(newTracks.size()) > numTracks) {
+        newTracks.resize(numTracks);
+    }
+    name = "Load MIDI file";
+}
+
+Command4Ptr ImportTracksCommand4::create(MidiSequencer4Ptr, const std::vector<MidiTrackPtr>& tracks)
+{
+    return std::make_shared<ImportTracksCommand4>(tracks);
+}
+
+void ImportTracksCommand4::execute(MidiSequencer4Ptr seq, Sequencer4Widget*)
+{
+    MidiLocker l(seq->song->lock);
+    for (int track = 0; track < numTracks; ++track) {
+        for (int section = 0; section < numSectionsPerTrack; ++section) {
+            oldTracks[track][section] = seq->song->getTrack(track, section);
+            oldOptions[track][section] = seq->song->getOptions(track, section);
+            seq->song->addTrack(track, section, nullptr);
+            seq->song->addOptions(track, section, nullptr);
+        }
+    }
+    for (int track = 0; track < int(newTracks.size()); ++track) {
+        assert(newTracks[track]->lock == seq->song->lock);
+        seq->song->addTrack(track, 0, newTracks[track]);
+    }
+    seq->song->assertValid();
+}
+
+void ImportTracksCommand4::undo(MidiSequencer4Ptr seq, Sequencer4Widget*)
+{
+    MidiLocker l(seq->song->lock);
+    for (int track = 0; track < numTracks; ++track) {
+        for (int section = 0; section < numSectionsPerTrack; ++section) {
+            seq->song->addTrack(track, section, oldTracks[track][section]);
+            seq->song->addOptions(track, section, oldOptions[track][section]);
+        }
+    }
+    seq->song->assertValid();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "MidiSong4.h"
+#include "SqCommand.h"
+
+#include <vector>
+
+/**
+ * Replaces every section of the song with the imported tracks,
+ * one per row in section 0, as when loading a MIDI file.
+ * The tracks must use the song's lock.
+ */
+class ImportTracksCommand4 : public Sq4Command
+{
+public:
+    static Command4Ptr create(MidiSequencer4Ptr, const std::vector<MidiTrackPtr>& tracks);
+    void execute(MidiSequencer4Ptr seq, Sequencer4Widget* widget) override;
+    void undo(MidiSequencer4Ptr seq, Sequencer4Widget*) override;
+
+    ImportTracksCommand4(const std::vector<MidiTrackPtr>& tracks);
+private:
+    static const int numTracks = MidiSong4::numTracks;
+    static const int numSectionsPerTrack = MidiSong4::numSectionsPerTrack;
+
+    std::vector<MidiTrackPtr> newTracks;
+    MidiTrackPtr oldTracks[numTracks][numSectionsPerTrack];
+    MidiTrack4OptionsPtr oldOptions[numTracks][numSectionsPerTrack];
+};
@@ -3,11 +3,15 @@
 #include "MidiFileProxy.h"
 #include "MidiLock.h"
 #include "MidiSong.h"
+#include "MidiSong4.h"
 #include "TimeUtils.h"
 
 //#include <direct.h>
+#include <algorithm>
 #include <iostream>
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
 
 bool MidiFileProxy::save(MidiSongPtr song, const std::string& filePath)
 {
@@ -49,31 +53,81 @@ bool MidiFileProxy::save(MidiSongPtr song, const std::string& filePath)
     return false;
 }
 
-MidiSongPtr MidiFileProxy::load(const std::string& filename)
+static bool readFile(const std::string& filename, std::vector<uint8_t>& data)
 {
-    smf::MidiFile midiFile;
+    FILE* fp = fopen(filename.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    data.clear();
+    uint8_t buffer[64 * 1024];
+    for (bool done = false; !done; ) {
+        const size_t count = fread(buffer, 1, sizeof(buffer), fp);
+        data.insert(data.end(), buffer, buffer + count);
+        done = count < sizeof(buffer);
+    }
+    fclose(fp);
+    return true;
+}
 
-    bool b = midiFile.read(filename);
-    if (!b) {
+std::vector<MidiTrackPtr> MidiFileProxy::loadTracks(const std::string& filename, MidiLockPtr lock)
+{
+    std::vector<MidiTrackPtr> tracks;
+    std::vector<uint8_t> data;
+    if (!readFile(filename, data)) {
         printf("open failed\n");
-        return nullptr;
+        return tracks;
     }
-    midiFile.makeAbsoluteTicks();
-    midiFile.linkNotePairs();
-
-    assert(midiFile.isAbsoluteTicks());
+    std::string err = MidiFileProxy::parse(data, lock, tracks);
+    if (!err.empty()) {
+        printf("bad midi file: %s\n", err.c_str());
+        tracks.clear();
+    }
+    return tracks;
+}
 
+MidiSongPtr MidiFileProxy::load(const std::string& filename)
+{
     MidiSongPtr song = std::make_shared<MidiSong>();
-    MidiTrackPtr track = getFirst(song, midiFile);
-    if (!track) {
-        //printf("get first failed\n");
+    auto tracks = loadTracks(filename, song->lock);
+    if (tracks.empty()) {
         return nullptr;
     }
-    song->addTrack(0, track);
+    MidiLocker l(song->lock);
+    song->addTrack(0, tracks[0]);
+    song->assertValid();
+    return song;
+}
+
+MidiSong4Ptr MidiFileProxy::loadSong4(const std::string& filename)
+{
+    MidiSong4Ptr song = std::make_shared<MidiSong4>();
+    auto tracks = loadTracks(filename, song->lock);
+    if (tracks.empty()) {
+        return nullptr;
+    }
+    if (int(tracks.size()) > MidiSong4::numTracks) {
+        printf("midi file has %d tracks, only loading %d\n", int(tracks.size()), MidiSong4::numTracks);
+        tracks.resize(MidiSong4::numTracks);
+    }
+    MidiLocker l(song->lock);
+    for (int i = 0; i < int(tracks.size()); ++i) {
+        song->addTrack(i, 0, tracks[i]);
+    }
     song->assertValid();
     return song;
 }
 
+// quantize end point to 1/16 note, because that's what we support
+static float quantizeEnd(float start)
+{
+    float startq = (float) TimeUtils::quantize(start, .25f, false);
+    if (startq < start) {
+        startq += .25f;
+    }
+    return startq;
+}
+
 MidiTrackPtr MidiFileProxy::getFirst(MidiSongPtr song, smf::MidiFile& midiFile)
 {
     MidiLocker l(song->lock);
@@ -100,13 +154,7 @@ MidiTrackPtr MidiFileProxy::getFirst(MidiSongPtr song, smf::MidiFile& midiFile)
                 foundNotes = true;
             } else if (evt.isEndOfTrack()) {
                 const float start =  float (double(evt.tick) / ppq);
-
-                // quantize end point to 1/16 note, because that's what we support
-                float startq = (float) TimeUtils::quantize(start, .25f, false);
-                if (startq < start) {
-                    startq += .25f;
-                }
-                newTrack->insertEnd(startq);
+                newTrack->insertEnd(quantizeEnd(start));
             } else if (evt.isTrackName()) {
                // std::string name = evt.getMetaContent();
                // printf("track name is %s\n", name.c_str());
@@ -118,4 +166,242 @@ MidiTrackPtr MidiFileProxy::getFirst(MidiSongPtr song, smf::MidiFile& midiFile)
         }
     }
     return nullptr;
-}
\ No newline at end of file
+}
+/**
+ * Reads standard MIDI file data directly into MidiTracks.
+ * Tempo, time signature, and everything else that isn't a note is skipped.
+ */
+class SmfParser
+{
+public:
+    SmfParser(const std::vector<uint8_t>& data) : p(data.data()), end(data.data() + data.size())
+    {
+    }
+
+    std::string parse(MidiLockPtr lock, std::vector<MidiTrackPtr>& tracks);
+
+private:
+    const uint8_t* p;
+    const uint8_t* end;
+
+    /**
+     * A note that has been started.
+     * duration is zero until the note off comes.
+     */
+    struct Note
+    {
+        uint64_t startTick;
+        uint64_t durationTick;
+        int key;
+    };
+    std::vector<Note> notes;
+
+    /**
+     * For each channel and key, indexes into notes of the note ons
+     * waiting for a note off. Note offs end the oldest first, same as smf::MidiFile.
+     */
+    std::vector<std::vector<int>> pending;
+
+    bool has(size_t count) const
+    {
+        return size_t(end - p) >= count;
+    }
+
+    uint32_t read32()
+    {
+        uint32_t ret = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        p += 4;
+        return ret;
+    }
+
+    uint16_t read16()
+    {
+        uint16_t ret = uint16_t((p[0] << 8) | p[1]);
+        p += 2;
+        return ret;
+    }
+
+    /**
+     * @returns false if the varint is too long, or runs off the end.
+     */
+    static bool readVarint(const uint8_t*& q, const uint8_t* qEnd, uint32_t& value)
+    {
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            if (q == qEnd) {
+                return false;
+            }
+            const uint8_t x = *q++;
+            value = (value << 7) | (x & 0x7f);
+            if (!(x & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string parseTrack(const uint8_t* data, const uint8_t* dataEnd, double ppq, MidiLockPtr lock, MidiTrackPtr& track);
+};
+
+std::string SmfParser::parse(MidiLockPtr lock, std::vector<MidiTrackPtr>& tracks)
+{
+    tracks.clear();
+    if (!has(14) || memcmp(p, "MThd", 4) != 0) {
+        return "not a midi file";
+    }
+    p += 4;
+    const uint32_t headerSize = read32();
+    if (headerSize < 6 || !has(headerSize)) {
+        return "bad header";
+    }
+    const uint8_t* headerEnd = p + headerSize;
+    read16();           // format. 0, 1 and 2 all load the same
+    const int numTracks = read16();
+    const uint16_t division = read16();
+    p = headerEnd;
+    if (division & 0x8000) {
+        return "SMPTE time not supported";
+    }
+    if (division == 0) {
+        return "bad division";
+    }
+    const double ppq = division;
+
+    pending.resize(16 * 128);
+    for (int trackIndex = 0; trackIndex < numTracks && has(8); ) {
+        const bool isTrack = memcmp(p, "MTrk", 4) == 0;
+        p += 4;
+        const uint32_t size = read32();
+        if (!has(size)) {
+            return "track data truncated";
+        }
+        const uint8_t* chunkEnd = p + size;
+        if (isTrack) {
+            MidiTrackPtr track;
+            std::string err = parseTrack(p, chunkEnd, ppq, lock, track);
+            if (!err.empty()) {
+                return err;
+            }
+            if (track) {
+                tracks.push_back(track);
+            }
+            ++trackIndex;
+        }
+        // other chunk types are skipped, as the spec says
+        p = chunkEnd;
+    }
+    return "";
+}
+
+std::string SmfParser::parseTrack(const uint8_t* q, const uint8_t* qEnd, double ppq, MidiLockPtr lock, MidiTrackPtr& track)
+{
+    notes.clear();
+    for (auto& x : pending) {
+        x.clear();
+    }
+
+    uint64_t tick = 0;
+    uint64_t endOfTrackTick = 0;
+    uint8_t runningStatus = 0;
+    while (q < qEnd) {
+        uint32_t delta;
+        if (!readVarint(q, qEnd, delta)) {
+            return "bad delta time";
+        }
+        tick += delta;
+        if (q == qEnd) {
+            return "event truncated";
+        }
+
+        uint8_t status = *q;
+        if (status & 0x80) {
+            ++q;
+        } else if (runningStatus) {
+            status = runningStatus;
+        } else {
+            return "data byte without status";
+        }
+
+        if (status == 0xff) {
+            runningStatus = 0;
+            if (q == qEnd) {
+                return "meta event truncated";
+            }
+            const uint8_t type = *q++;
+            uint32_t length;
+            if (!readVarint(q, qEnd, length) || uint32_t(qEnd - q) < length) {
+                return "meta event truncated";
+            }
+            q += length;
+            if (type == 0x2f) {
+                endOfTrackTick = tick;
+                break;
+            }
+        } else if (status == 0xf0 || status == 0xf7) {
+            runningStatus = 0;
+            uint32_t length;
+            if (!readVarint(q, qEnd, length) || uint32_t(qEnd - q) < length) {
+                return "sysex truncated";
+            }
+            q += length;
+        } else if (status >= 0x80 && status < 0xf0) {
+            runningStatus = status;
+            const int command = status & 0xf0;
+            const int dataSize = (command == 0xc0 || command == 0xd0) ? 1 : 2;
+            if (qEnd - q < dataSize) {
+                return "channel event truncated";
+            }
+            const int channel = status & 0x0f;
+            const int key = q[0] & 0x7f;
+            const int velocity = (dataSize == 2) ? (q[1] & 0x7f) : 0;
+            q += dataSize;
+
+            auto& waiting = pending[channel * 128 + key];
+            if (command == 0x90 && velocity > 0) {
+                waiting.push_back(int(notes.size()));
+                notes.push_back({tick, 0, key});
+            } else if ((command == 0x80 || command == 0x90) && !waiting.empty()) {
+                Note& note = notes[waiting.front()];
+                note.durationTick = tick - note.startTick;
+                waiting.erase(waiting.begin());
+            }
+        } else {
+            return "unsupported status byte";
+        }
+    }
+
+    // notes with no note off, or no length, are dropped
+    uint64_t lastTick = endOfTrackTick;
+    bool foundNotes = false;
+    for (const Note& note : notes) {
+        if (note.durationTick) {
+            foundNotes = true;
+            lastTick = std::max(lastTick, note.startTick + note.durationTick);
+        }
+    }
+    if (!foundNotes) {
+        return "";
+    }
+
+    MidiLocker l(lock);
+    track = std::make_shared<MidiTrack>(lock);
+
+    // the notes are in note on order, which is start time order
+    for (const Note& note : notes) {
+        if (note.durationTick) {
+            MidiNoteEventPtr ev = std::make_shared<MidiNoteEvent>();
+            ev->startTime = float(double(note.startTick) / ppq);
+            ev->duration = float(double(note.durationTick) / ppq);
+            ev->pitchCV = PitchUtils::midiToCV(note.key);
+            track->appendEvent(ev);
+        }
+    }
+    track->insertEnd(quantizeEnd(float(double(lastTick) / ppq)));
+    return "";
+}
+
+std::string MidiFileProxy::parse(const std::vector<uint8_t>& data, MidiLockPtr lock, std::vector<MidiTrackPtr>& tracks)
+{
+    SmfParser parser(data);
+    return parser.parse(lock, tracks);
+}
@@ -1,22 +1,56 @@
 #pragma once
 
+#include <stdint.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace smf {
     class MidiFile;
 };
 
+class MidiLock;
 class MidiSong;
+class MidiSong4;
 class MidiTrack;
 
+using MidiLockPtr = std::shared_ptr<MidiLock>;
 using MidiSongPtr = std::shared_ptr<MidiSong>;
+using MidiSong4Ptr = std::shared_ptr<MidiSong4>;
 using MidiTrackPtr = std::shared_ptr<MidiTrack>;
 class MidiFileProxy
 {
 public:
     MidiFileProxy() = delete;
+
+    /**
+     * Loads the first track that has notes.
+     */
     static MidiSongPtr load(const std::string& filename);
+
+    /**
+     * Loads every track that has notes.
+     * Track n goes in row n, section 0, so the tracks play together.
+     * Any after the fourth are dropped.
+     */
+    static MidiSong4Ptr loadSong4(const std::string& filename);
+
+    /**
+     * Loads every track that has notes, using lock.
+     * @returns no tracks on error.
+     */
+    static std::vector<MidiTrackPtr> loadTracks(const std::string& filename, MidiLockPtr lock);
+
+    /**
+     * Parses standard MIDI file data straight into MidiTracks, one for
+     * each SMF track that has notes. Much faster than going through smf::MidiFile.
+     * @returns error string, empty on success.
+     */
+    static std::string parse(const std::vector<uint8_t>& data, MidiLockPtr lock, std::vector<MidiTrackPtr>& tracks);
+
+    /**
+     * The old way of loading, through smf::MidiFile.
+     */
     static MidiTrackPtr getFirst(MidiSongPtr song, smf::MidiFile&);
     static bool save(MidiSongPtr song, const std::string& filePath);
-};
\ No newline at end of file
+};
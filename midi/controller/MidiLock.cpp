@@ -8,6 +8,7 @@ MidiLock::MidiLock()
     theLock = false;
     editorLockLevel = 0;
     editorDidLock = false;
+    editCount = 0;
 }
 
 MidiLockPtr MidiLock::make()
@@ -26,15 +27,24 @@ void MidiLock::editorLock()
     }
     ++editorLockLevel;
     editorDidLock = true;
+    ++editCount;
 }
 
 void MidiLock::editorUnlock()
 {
+    if (editorLockLevel == 1 && editorUnlockHandler) {
+        editorUnlockHandler();
+    }
     if (--editorLockLevel == 0) {
         theLock = false;
     }
 }
 
+void MidiLock::setEditorUnlockHandler(std::function<void()> handler)
+{
+    editorUnlockHandler = handler;
+}
+
 bool MidiLock::playerTryLock()
 {
     // try once to take lock
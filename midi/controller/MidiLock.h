@@ -1,7 +1,9 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <memory>
+#include <stdint.h>
 
 class MidiLock;
 using MidiLockPtr = std::shared_ptr<MidiLock>;
@@ -26,10 +28,31 @@ public:
      */
     bool dataModelDirty();
 
+    /**
+     * Goes up every time the editor locks.
+     * Unlike dataModelDirty, reading it does not clear anything,
+     * so the UI can use it to tell if cached drawing data is stale
+     * without stealing the flag from the player.
+     */
+    uint32_t getEditCount() const
+    {
+        return editCount;
+    }
+
+    /**
+     * Called on the UI thread when the editor is about to let go of the lock
+     * (the last editorUnlock), while the lock is still held.
+     * Lets the owner of the data rebuild anything the player reads, so
+     * the player never has to.
+     */
+    void setEditorUnlockHandler(std::function<void()>);
+
 private:
     std::atomic<bool> theLock;
     std::atomic<int> editorLockLevel;
     std::atomic<bool> editorDidLock;
+    std::atomic<uint32_t> editCount;
+    std::function<void()> editorUnlockHandler;
 
     bool tryLock();
 };
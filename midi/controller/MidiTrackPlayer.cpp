@@ -2,6 +2,7 @@
 #include "MidiTrackPlayer.h"
 #include "MidiSong4.h"
 #include "MidiTrack4Options.h"
+#include "MidiTrackSchedule.h"
 #include "TimeUtils.h"
 
 #ifdef __PLUGIN
@@ -9,7 +10,9 @@
 #include "engine/Port.hpp"
 #endif
 
+#include <algorithm>
 #include <assert.h>
+#include <limits>
 #include <stdio.h>
 
 // #define _LOGX
@@ -126,6 +129,7 @@ MidiTrackPlayer::MidiTrackPlayer(
 
 void MidiTrackPlayer::setNumVoices(int _numVoices) {
     this->numVoices = _numVoices;
+    earliestNoteOff = 0;        // voices that come back may have notes in them
     voiceAssigner.setNumVoices(numVoices);
 }
 
@@ -287,8 +291,15 @@ bool MidiTrackPlayer::playOnce(double metricTime, float quantizeInterval) {
         return false;
     }
 
+    const MidiTrackSchedule* schedule = getSchedule();
+    if (!schedule) {
+        return false;
+    }
+    const MidiTrackSchedule::Event& event = schedule->events[playback.curEvent];
+    playback.curEventTime = event.startTime;
+
     // push the start time up by loop start, so that event t==loop start happens at start of loop
-    const double eventStartUnQuantized = (playback.currentLoopIterationStart + playback.curEvent->first);
+    const double eventStartUnQuantized = (playback.currentLoopIterationStart + event.startTime);
 
     const double eventStart = TimeUtils::quantize(eventStartUnQuantized, quantizeInterval, true);
 
@@ -296,42 +307,30 @@ bool MidiTrackPlayer::playOnce(double metricTime, float quantizeInterval) {
 
     if (doIt) {
         printf("MidiTrackPlayer::playOnce index=%d eventStart=%.2f mt=%.2f loopStart=%.2f\n",
-            constTrackIndex, eventStart, metricTime, currentLoopIterationStart);
+            constTrackIndex, eventStart, metricTime, playback.currentLoopIterationStart);
         fflush(stdout);
     }
 #endif
     if (eventStart <= metricTime) {
-        MidiEventPtr event = playback.curEvent->second;
-        switch (event->type) {
-            case MidiEvent::Type::Note: {
+        if (!event.isEnd) {
 #ifdef _LOGX
-                {
-                    if (constTrackIndex == 0) {
-                        MidiEventPtr ev = curEvent->second;
-                        MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(ev);
-                        assert(note);
-                        printf("MidiTrackPlayer:playOnce.pitch = %.2f\n", note->pitchCV);
-                    }
-                }
+            if (constTrackIndex == 0) {
+                printf("MidiTrackPlayer:playOnce.pitch = %.2f\n", event.pitchCV);
+            }
 #endif
-                MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(event);
-
-                // find a voice to play
-                MidiVoice* voice = voiceAssigner.getNext(note->pitchCV);
-                assert(voice);
-
-                // play the note
-                const double durationQuantized = TimeUtils::quantize(note->duration, quantizeInterval, false);
-                double quantizedNoteEnd = TimeUtils::quantize(durationQuantized + eventStart, quantizeInterval, false);
-                voice->playNote(note->pitchCV, float(eventStart), float(quantizedNoteEnd));
-                ++playback.curEvent;
-                // printfprintf("just inc curEvent 129\n");
-            } break;
-            case MidiEvent::Type::End:
-                onEndOfTrack();
-                break;
-            default:
-                assert(false);
+            // find a voice to play
+            MidiVoice* voice = voiceAssigner.getNext(event.pitchCV);
+            assert(voice);
+
+            // play the note
+            const double durationQuantized = TimeUtils::quantize(event.duration, quantizeInterval, false);
+            double quantizedNoteEnd = TimeUtils::quantize(durationQuantized + eventStart, quantizeInterval, false);
+            voice->playNote(event.pitchCV, float(eventStart), float(quantizedNoteEnd));
+            earliestNoteOff = std::min(earliestNoteOff, quantizedNoteEnd);
+            ++playback.curEvent;
+            playback.curEventTime = schedule->events[playback.curEvent].startTime;
+        } else {
+            onEndOfTrack(event.startTime);
         }
         didSomething = true;
     }
@@ -393,15 +392,6 @@ bool MidiTrackPlayer::serviceEventQueue()
         // we picked up a new song, but there is a request for next section
         const int next = eventQ.nextSectionIndex;
         eventQ.nextSectionIndex = 0;
-#ifdef _LOGX
-           
-        if (constTrackIndex == 0) {
-            printf("service Q just reset nextSectionIndex\n");
-            printf("serviceQ setting up to play different section %d\n", next);
-            void* cep = curEvent->second.get();
-            printf("before, eventTime = %.2f eventaddr=%p\n",  curEvent->first, cep);
-        }
-#endif
         setupToPlayDifferentSection(next);
         if (constTrackIndex == 0) {
          //   printf("since new section immediate, will reset clock\n");
@@ -410,13 +400,6 @@ bool MidiTrackPlayer::serviceEventQueue()
         // set curTrack, curEvent, loop Counter, and reset clock
         setPlaybackTrackFromSongAndSection();
         resetClock = true;
-
-#ifdef _LOGX
-        if (constTrackIndex == 0) {
-            void* cep = curEvent->second.get();
-            printf("after reset clock, eventTime = %.2f eventaddr=%p\n",  curEvent->first, cep);
-        }
-#endif
     }
 
     eventQ.startupTriggered = false;
@@ -436,7 +419,8 @@ void MidiTrackPlayer::resetFromQueue(bool resetSectionIndex) {
     playback.curTrack = playback.song->getTrack(constTrackIndex, playback.curSectionIndex);
     if (playback.curTrack) {
         // can we really handle not having a track?
-        playback.curEvent = playback.curTrack->begin();
+        playback.curEvent = 0;
+        playback.curEventTime = 0;
         //printf("reset put cur event back\n");
     }
 
@@ -525,20 +509,8 @@ void MidiTrackPlayer::setPlaybackTrackFromSongAndSection()
     playback.curTrack = playback.song->getTrack(constTrackIndex, playback.curSectionIndex);
     if (playback.curTrack) {
         // can we really handle not having a track?
-        playback.curEvent = playback.curTrack->begin();
-#ifdef _LOGX
-        if (constTrackIndex == 0)
-        {
-            
-            MidiEventPtr ev = curEvent->second;
-            MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(ev);
-            if (note) {
-                assert(note);
-                printf("reset put cur event back. pitch = %.2f\n", note->pitchCV);
-            }
-            else printf("first event note note\n");
-        }
-#endif
+        playback.curEvent = 0;
+        playback.curEventTime = 0;
     }
 
 #ifdef _MLOG
@@ -551,7 +523,7 @@ void MidiTrackPlayer::setPlaybackTrackFromSongAndSection()
     playback.currentLoopIterationStart = 0;
 }
 
-void MidiTrackPlayer::onEndOfTrack() {
+void MidiTrackPlayer::onEndOfTrack(float trackLength) {
     assert(playback.inPlayCode);
 #if defined(_MLOG)
     printf("MidiTrackPlayer:playOnce index=%d type = end\n", trackIndex);
@@ -559,7 +531,7 @@ void MidiTrackPlayer::onEndOfTrack() {
     fflush(stdout);
 #endif
     // for now, should loop.
-    playback.currentLoopIterationStart += playback.curEvent->first;
+    playback.currentLoopIterationStart += trackLength;
 
     // If there is a section change queued up, do it.
     if (eventQ.nextSectionIndex > 0) {
@@ -589,7 +561,8 @@ void MidiTrackPlayer::onEndOfTrack() {
             // Then I think all we need to do is reset the pointer, 
             // and update the loop counter for the UI
             assert(playback.curTrack);
-            playback.curEvent = playback.curTrack->begin();
+            playback.curEvent = 0;
+            playback.curEventTime = 0;
             // printf("at end, keep looping set totalRepeatCount to %d\n", totalRepeatCount);
         } else {
             assert(sectionLoopCounter >= 0);
@@ -603,7 +576,8 @@ void MidiTrackPlayer::onEndOfTrack() {
     }
 
     assert(playback.curTrack);
-    playback.curEvent = playback.curTrack->begin();
+    playback.curEvent = 0;
+    playback.curEventTime = 0;
 }
 
 void MidiTrackPlayer::setupToPlayFirstTrackSection() {
@@ -624,7 +598,8 @@ void MidiTrackPlayer::setupToPlayFirstTrackSection() {
 
 void MidiTrackPlayer::dumpCurEvent(const char* msg)
 {
-    printf("dumpCurEvent: %s tkIndex=%d, time=%.2f, evtp=%p\n", msg, constTrackIndex, playback.curEvent->first, playback.curEvent->second.get());
+    printf("dumpCurEvent: %s tkIndex=%d, index=%d, time=%.2f\n", msg, constTrackIndex, playback.curEvent,
+        playback.curEventTime);
 }
 
 void MidiTrackPlayer::setupToPlayDifferentSection(int section) {
@@ -646,7 +621,8 @@ void MidiTrackPlayer::setupToPlayCommon() {
     if (playback.curTrack) {
         // printf("got new track in setupToPlayCommon. here's track\n");
         // curTrack->_dump();
-        playback.curEvent = playback.curTrack->begin();
+        playback.curEvent = 0;
+        playback.curEventTime = 0;
         auto opts = playback.song->getOptions(constTrackIndex, playback.curSectionIndex);
         assert(opts);
         if (opts) {
@@ -676,16 +652,62 @@ void MidiTrackPlayer::setupToPlayNextSection() {
 }
 
 
+const MidiTrackSchedule* MidiTrackPlayer::getSchedule()
+{
+    assert(playback.curTrack);
+    const MidiTrackSchedule* schedule = playback.song->getSchedule(constTrackIndex, playback.curSectionIndex);
+    if (!schedule || !schedule->isPlayable()) {
+        // The UI makes the schedules when it unlocks, so this shouldn't happen
+        return nullptr;
+    }
+    if (schedule->serial == playback.scheduleSerial) {
+        return schedule;
+    }
+
+    if (schedule->track != playback.curTrack.get()) {
+        // The section's track was replaced (paste, cut, edit clip), so follow it.
+        // If it still doesn't match, the editor hasn't unlocked yet.
+        MidiTrackPtr track = playback.song->getTrack(constTrackIndex, playback.curSectionIndex);
+        if (track.get() != schedule->track) {
+            return nullptr;
+        }
+        playback.curTrack = track;
+    }
+
+    // The track was edited or replaced, so pick up where we were.
+    const auto& events = schedule->events;
+    auto it = std::lower_bound(events.begin(), events.end(), playback.curEventTime,
+        [](const MidiTrackSchedule::Event& ev, float t) {
+            return ev.startTime < t;
+        });
+    // if the track got shorter while we were in it, stop at the end.
+    it = std::min(it, events.end() - 1);
+    playback.curEvent = int(it - events.begin());
+    playback.scheduleSerial = schedule->serial;
+    return schedule;
+}
+
 bool MidiTrackPlayer::pollForNoteOff(double metricTime) {
     assert(playback.inPlayCode);
+    if (metricTime < earliestNoteOff) {
+        return false;
+    }
     bool didSomething = false;
+    earliestNoteOff = std::numeric_limits<double>::infinity();
+    // idle voices have no note to turn off
+    const uint32_t busy = voiceAssigner.getBusyVoices() & ((1u << numVoices) - 1);
     for (int i = 0; i < numVoices; ++i) {
+        if (!(busy & (1u << i))) {
+            continue;
+        }
         bool b = voices[i].updateToMetricTime(metricTime);
         if (b) {
             didSomething = true;
-            ;
+        }
+        const double noteOff = voices[i].getNoteOffTime();
+        if (noteOff >= 0) {
+            earliestNoteOff = std::min(earliestNoteOff, noteOff);
         }
     }
     return didSomething;
-}
-
+}
\ No newline at end of file
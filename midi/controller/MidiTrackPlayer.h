@@ -11,6 +11,7 @@
 class IMidiPlayerHost4;
 class MidiSong4;
 class MidiTrack;
+class MidiTrackSchedule;
 
 // #define _MLOG
 
@@ -130,6 +131,12 @@ private:
      */
     bool isPlaying = false;    
 
+    /**
+     * No voice has a note that ends before this time, so pollForNoteOff
+     * doesn't need to look at them until then. It's allowed to be early.
+     */
+    double earliestNoteOff = 0;
+
     bool pollForNoteOff(double metricTime);
     void setupToPlayFirstTrackSection();
 
@@ -145,7 +152,7 @@ private:
      */
     void setupToPlayDifferentSection(int section);
     void setupToPlayCommon();
-    void onEndOfTrack();
+    void onEndOfTrack(float trackLength);
     void pollForCVChange();
 
     /**
@@ -171,6 +178,15 @@ private:
 
     void dumpCurEvent(const char*);
 
+    /**
+     * Returns the song's schedule for the current section, or null if
+     * there isn't a playable one.
+     * If the schedule was replaced since last time, moves curEvent to match,
+     * and picks up the section's new track if that was replaced too.
+     * Never builds anything - the UI does that.
+     */
+    const MidiTrackSchedule* getSchedule();
+
     /**
      * variables only used by playback code.
      * Other code not allowed to touch it.
@@ -206,11 +222,23 @@ private:
         std::shared_ptr<MidiTrack> curTrack;
 
         /**
-         * event iterator that playback uses. Advances each
+         * The serial number of the schedule we last played from,
+         * so we can tell when the UI replaces it.
+         */
+        uint32_t scheduleSerial = 0;
+
+        /**
+         * Start time of the event at curEvent. If the track is edited or
+         * replaced we use it to find our place in the new schedule.
+         */
+        float curEventTime = 0;
+
+        /**
+         * index into the schedule of the next event to play. Advances each
          * time an event is played from the track.
          * We also set it on set song, but maybe that should be queued also?
          */
-        MidiTrack::const_iterator curEvent;
+        int curEvent = 0;
     };
 
     /**
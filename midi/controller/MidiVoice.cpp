@@ -41,9 +41,37 @@ float MidiVoice::pitch() const
     return curPitch;
 }
 
+double MidiVoice::getNoteOffTime() const
+{
+    double ret = noteOffTime;
+    if (curState == State::ReTriggering && (ret < 0 || delayedNoteEndtime < ret)) {
+        ret = delayedNoteEndtime;
+    }
+    return ret;
+}
+
 void MidiVoice::_setState(State s)
+{
+    setState(s);
+}
+
+void MidiVoice::setState(State s)
 {
     curState = s;
+    if (busyMask) {
+        if (s == State::Idle) {
+            *busyMask &= ~busyBit;
+        } else {
+            *busyMask |= busyBit;
+        }
+    }
+}
+
+void MidiVoice::setBusyMask(uint32_t* mask, int bit)
+{
+    busyMask = mask;
+    busyBit = 1u << bit;
+    setState(curState);
 }
 
 void MidiVoice::setSampleCountForRetrigger(int samples)
@@ -60,7 +88,7 @@ void MidiVoice::updateSampleCount(int samples)
         retriggerSampleCounter -= samples;
         if (retriggerSampleCounter <= 0) {
             retriggerSampleCounter = 0;
-            curState = State::Playing;
+            setState(State::Playing);
             setCV(delayedNotePitch);
             noteOffTime = delayedNoteEndtime;
             setGate(true);
@@ -79,7 +107,7 @@ void MidiVoice::playNote(float pitch, double currentTime, float endTime)
 #ifdef _MLOG
         printf(" mv retrigger. interval = %d\n", numSamplesInRetrigger);
 #endif
-        curState = State::ReTriggering;
+        setState(State::ReTriggering);
 
        // printf("gate low in normal gate off logic\n");
         setGate(false);
@@ -96,7 +124,7 @@ void MidiVoice::playNote(float pitch, double currentTime, float endTime)
         this->curPitch = pitch;
         this->noteOffTime = endTime;
 
-        this->curState = State::Playing;
+        this->setState(State::Playing);
         setCV(pitch);
         setGate(true);
     }
@@ -116,7 +144,7 @@ bool MidiVoice::updateToMetricTime(double metricTime)
         lastNoteOffTime = noteOffTime; 
         //lastNoteOffTime = metricTime;
         noteOffTime = -1;
-        curState = State::Idle;
+        setState(State::Idle);
         ret = true;
     }
     return ret;
@@ -131,7 +159,7 @@ void MidiVoice::reset(bool clearGate)
                                 // currently playing note should stop
     curPitch = -100;            // the pitch of the last note played in this voice
     lastNoteOffTime = -1;
-    curState = State::Idle;
+    setState(State::Idle);
     retriggerSampleCounter = 0;
     if (clearGate) {
        // printf("gate off from reset call\n");
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 
 // #define _MLOG
 class IMidiPlayerHost4;
@@ -27,6 +28,12 @@ public:
     void setTrack(int);
     void setSampleCountForRetrigger(int samples);
 
+    /**
+     * The voice will keep bit number "bit" of *mask set whenever
+     * it is not idle. Lets the voice assigner find free voices without polling.
+     */
+    void setBusyMask(uint32_t* mask, int bit);
+
     /**
      * Will always play the note, not matter what state it is in.
      * Clever voice assignment should have been done long before calling this.
@@ -58,6 +65,12 @@ public:
     State state() const;
     float pitch() const;
 
+    /**
+     * The metric time the current note will end, or -1 if there isn't one.
+     * Includes a note that is waiting for a re-trigger to finish.
+     */
+    double getNoteOffTime() const;
+
     // these are only for debugging
     int _getIndex() const;
     void _setState(State);
@@ -86,6 +99,9 @@ private:
 
     State curState = State::Idle;
 
+    uint32_t* busyMask = nullptr;
+    uint32_t busyBit = 0;
+
     /**
      * Index is the voice number was are associated with, 0..15.
      * These can't be const, as we need to have a default ctor.
@@ -96,4 +112,5 @@ private:
 
     void setGate(bool);
     void setCV(float);
+    void setState(State);
 };
\ No newline at end of file
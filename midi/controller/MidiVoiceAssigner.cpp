@@ -1,10 +1,28 @@
-
 #include "MidiVoiceAssigner.h"
 #include "MidiVoice.h"
 
 #include <assert.h>
 #include <stdio.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * @returns the index of the lowest set bit. x must not be zero.
+ */
+static int lowestBit(uint32_t x)
+{
+    assert(x);
+#if defined(_MSC_VER)
+    unsigned long ret;
+    _BitScanForward(&ret, x);
+    return int(ret);
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
 MidiVoiceAssigner::MidiVoiceAssigner(MidiVoice* vx, int maxVoices) :
     voices(vx),
     maxVoices(maxVoices),
@@ -13,6 +31,7 @@ MidiVoiceAssigner::MidiVoiceAssigner(MidiVoice* vx, int maxVoices) :
     assert(maxVoices > 0 && maxVoices <= 16);
     for (int i = 0; i < maxVoices; ++i) {
         assert(voices[i].state() == MidiVoice::State::Idle);
+        voices[i].setBusyMask(&busyVoices, i);
     }
 }
 
@@ -30,16 +49,32 @@ void MidiVoiceAssigner::setNumVoices(int voices)
     }
 }
 
+void MidiVoiceAssigner::setMode(Mode m)
+{
+    mode = m;
+}
+
 MidiVoice* MidiVoiceAssigner::getNext(float pitch)
 {
+    assert(numVoices > 0);
     MidiVoice * nextVoice = nullptr;
     switch (mode) {
         case Mode::ReUse:
             nextVoice = getNextReUse(pitch);
             break;
+        case Mode::Rotate:
+            nextVoice = getNextIdle(idleVoices());
+            break;
+        case Mode::StealOldest:
+            nextVoice = idleVoices() ? getNextReUse(pitch) : voices + stealOldest();
+            break;
+        case Mode::StealLowest:
+            nextVoice = idleVoices() ? getNextReUse(pitch) : voices + stealLowest();
+            break;
         default:
             assert(false);
     }
+    startOrder[nextVoice - voices] = ++noteCounter;
 #if defined(_MLOG)
     printf("MidiVoiceAssigner::getNext(pitch=%.2f), ret voice #%d state=%d\n",
         pitch, nextVoice->_getIndex(), nextVoice->state()); 
@@ -63,12 +98,12 @@ int MidiVoiceAssigner::advance(int vxNum)
 
 MidiVoice* MidiVoiceAssigner::getNextReUse(float pitch)
 {
-    assert(numVoices > 0);
+    const uint32_t idle = idleVoices();
 
     // first, look for a voice already playing this pitch, but idle
-    for (int i = 0; i < numVoices; ++i) {
-        if ((voices[i].pitch() == pitch) &&
-         (voices[i].state() == MidiVoice::State::Idle)) {
+    for (uint32_t candidates = idle; candidates; candidates &= candidates - 1) {
+        const int i = lowestBit(candidates);
+        if (voices[i].pitch() == pitch) {
             // OK, we found an idle voice at the desired pitch
             if (i == nextVoice) {
                 nextVoice = advance(nextVoice);
@@ -76,19 +111,47 @@ MidiVoice* MidiVoiceAssigner::getNextReUse(float pitch)
             return voices + i;
         }
     }
+    return getNextIdle(idle);
+}
 
-    // next, look for any idle voice, starting at next voice
-    for (int i = 0; i < numVoices; ++i) {
-        int candidateVoice = wrapAround(i + nextVoice);
-     
-        if (voices[candidateVoice].state() == MidiVoice::State::Idle) {
-            nextVoice = advance(candidateVoice);
-            return voices + candidateVoice;
-        }
+MidiVoice* MidiVoiceAssigner::getNextIdle(uint32_t idle)
+{
+    if (idle) {
+        // first idle voice at or after nextVoice, else the first one before it
+        const uint32_t fromNext = idle & ~((1u << nextVoice) - 1);
+        const int i = lowestBit(fromNext ? fromNext : idle);
+        nextVoice = advance(i);
+        return voices + i;
     }
 
     // If no idle voices, use the next one
     int i = nextVoice;
     nextVoice = advance(nextVoice);
     return voices + i;            
-}
\ No newline at end of file
+}
+
+int MidiVoiceAssigner::stealOldest() const
+{
+    int ret = 0;
+    uint32_t oldest = 0;
+    for (int i = 0; i < numVoices; ++i) {
+        // subtract so it still works when the counter wraps
+        const uint32_t age = noteCounter - startOrder[i];
+        if (age > oldest) {
+            oldest = age;
+            ret = i;
+        }
+    }
+    return ret;
+}
+
+int MidiVoiceAssigner::stealLowest() const
+{
+    int ret = 0;
+    for (int i = 1; i < numVoices; ++i) {
+        if (voices[i].pitch() < voices[ret].pitch()) {
+            ret = i;
+        }
+    }
+    return ret;
+}
@@ -1,19 +1,44 @@
 #pragma once
 
+#include <stdint.h>
+
 class MidiVoice;
 
+/**
+ * Picks which voice plays the next note.
+ *
+ * The voices report every change between idle and busy into a bitmask
+ * we own (see MidiVoice::setBusyMask), so finding a free voice is a couple of
+ * bit operations instead of polling every voice's state.
+ *
+ * All the modes pick an idle voice if there is one. They differ in
+ * which idle voice, and which busy voice to steal when they are all in use.
+ */
 class MidiVoiceAssigner
 {
 public:
     enum class Mode
     {
-        ReUse,          // default
-        Rotate
+        ReUse,          // default. Prefer an idle voice last used at the same pitch, then round robin.
+                        // When all voices are busy, steal round robin.
+        Rotate,         // Round robin, for idle voices and for stealing.
+        StealOldest,    // Like ReUse, but steal the voice whose note started first.
+        StealLowest     // Like ReUse, but steal the voice playing the lowest pitch.
     };
     MidiVoiceAssigner(MidiVoice* vx, int maxVoices);
     void setNumVoices(int);
+    void setMode(Mode);
     MidiVoice* getNext(float pitch);
     void reset();
+
+    /**
+     * Bit n set means voice n is not idle.
+     */
+    uint32_t getBusyVoices() const
+    {
+        return busyVoices;
+    }
+
 private:
     MidiVoice* const voices;
     const int maxVoices;
@@ -22,7 +47,27 @@ private:
 
     Mode mode = Mode::ReUse;
 
+    /**
+     * Kept up to date by the voices.
+     */
+    uint32_t busyVoices = 0;
+
+    /**
+     * For StealOldest. Each voice gets stamped with noteCounter
+     * when we hand it out.
+     */
+    uint32_t noteCounter = 0;
+    uint32_t startOrder[16] = {0};
+
+    uint32_t idleVoices() const
+    {
+        return ~busyVoices & ((1u << numVoices) - 1);
+    }
+
     MidiVoice* getNextReUse(float pitch);
+    MidiVoice* getNextIdle(uint32_t idle);
+    int stealOldest() const;
+    int stealLowest() const;
     int wrapAround(int vxNum);
     int advance(int vxNum);
-};
\ No newline at end of file
+};
@@ -0,0 +1,231 @@
+#include "NoteXformPipeline.h"
+
+#include "MidiLock.h"
+#include "MidiSequencer.h"
+#include "MidiSong.h"
+#include "MidiTrack.h"
+#include "Scale.h"
+#include "ScaleRelativeNote.h"
+#include "TimeUtils.h"
+#include "Triad.h"
+
+#include <algorithm>
+#include <assert.h>
+
+void NoteXformPipeline::run(Notes& notes) const
+{
+    for (const Stage& stage : stages) {
+        stage(notes);
+    }
+}
+
+ReplaceDataCommandPtr NoteXformPipeline::makeCommand(std::shared_ptr<MidiSequencer> seq) const
+{
+    Notes toRemove;
+    toRemove.reserve(seq->selection->size());
+    for (auto event : *seq->selection) {
+        MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(event);
+        if (note) {
+            toRemove.push_back(*note);
+        }
+    }
+
+    Notes toAdd = toRemove;
+    run(toAdd);
+
+    // a stage may have moved notes past the end
+    auto track = seq->context->getTrack();
+    float endTime = track->getLength();
+    for (const MidiNoteEvent& note : toAdd) {
+        endTime = std::max(endTime, note.startTime + note.duration);
+    }
+    const float newTrackLength = ReplaceDataCommand::calculateDurationRequest(track, endTime);
+
+    ReplaceDataCommandPtr ret = std::make_shared<ReplaceDataCommand>(
+        seq->song,
+        seq->context->getTrackNumber(),
+        toRemove,
+        toAdd,
+        newTrackLength);
+    ret->name = name;
+    return ret;
+}
+
+NoteXformPipeline::Stage NoteXformPipeline::makeFilter(ReplaceDataCommand::FilterFunc lambda)
+{
+    return [lambda](Notes& notes) {
+        // the lambdas want an event pointer, so re-use one for all the notes
+        MidiNoteEventPtr scratch = std::make_shared<MidiNoteEvent>();
+        for (MidiNoteEvent& note : notes) {
+            *scratch = note;
+            lambda(scratch);
+            note = *scratch;
+        }
+    };
+}
+
+NoteXformPipeline::Stage NoteXformPipeline::makeReversePitch()
+{
+    return [](Notes& notes) {
+        const int size = int(notes.size());
+        for (int i = 0; i < size / 2; ++i) {
+            std::swap(notes[i].pitchCV, notes[size - 1 - i].pitchCV);
+        }
+    };
+}
+
+/**************************** CHOP NOTE *************************
+ */
+
+/**
+ * @param semitoneOffset gives the pitch offset of each new note.
+ * @param quantize will snap all the new notes to semitones, not just the offset ones.
+ */
+static void chopNote(
+    const MidiNoteEvent& note,
+    NoteXformPipeline::Notes& out,
+    int numNotes,
+    bool quantize,
+    std::function<int(int)> semitoneOffset)
+{
+    const float dur = note.duration;
+    const float durTotal = TimeUtils::getTimeAsPowerOfTwo16th(dur);
+    if (durTotal <= 0) {
+        // too short to chop
+        out.push_back(note);
+        return;
+    }
+
+    const int origSemitone = PitchUtils::cvToSemitone(note.pitchCV);
+    for (int i = 0; i < numNotes; ++i) {
+        MidiNoteEvent newNote;
+        newNote.startTime = note.startTime + i * durTotal / numNotes;
+        newNote.duration = dur / numNotes;     // keep original articulation
+        newNote.pitchCV = note.pitchCV;
+        const int offset = semitoneOffset(i);
+        if (offset || quantize) {
+            newNote.pitchCV = PitchUtils::semitoneToCV(origSemitone + offset);
+        }
+        out.push_back(newNote);
+    }
+}
+
+NoteXformPipeline::Stage NoteXformPipeline::makeChop(int numNotes, ReplaceDataCommand::Ornament ornament, ScalePtr scale, int steps)
+{
+    return [numNotes, ornament, scale, steps](Notes& notes) {
+        Notes out;
+        out.reserve(notes.size() * numNotes);
+        for (const MidiNoteEvent& note : notes) {
+            const int origSemitone = PitchUtils::cvToSemitone(note.pitchCV);
+            if (ornament == ReplaceDataCommand::Ornament::Trill) {
+                int trillSemis = steps;
+                if (scale) {
+                    trillSemis = scale->transposeInScale(origSemitone, steps) - origSemitone;
+                }
+                chopNote(note, out, numNotes, false, [trillSemis](int i) {
+                    return (i % 2) ? trillSemis : 0;
+                });
+            } else if (ornament == ReplaceDataCommand::Ornament::Arpeggio) {
+                chopNote(note, out, numNotes, true, [origSemitone, scale, steps](int i) {
+                    if (scale) {
+                        return scale->transposeInScale(origSemitone, i * steps) - origSemitone;
+                    }
+                    return i * steps;
+                });
+            } else {
+                chopNote(note, out, numNotes, false, [](int) {
+                    return 0;
+                });
+            }
+        }
+        notes.swap(out);
+    };
+}
+
+/**************************** TRIADS *************************
+ */
+
+static void addTriad(const MidiNoteEvent& note, const Triad& triad, ScalePtr scale, NoteXformPipeline::Notes& out)
+{
+    auto cvs = triad.toCv(scale);
+    for (int i = 0; i < 3; ++i) {
+        MidiNoteEvent chordNote(note);
+        chordNote.pitchCV = cvs[i];
+        out.push_back(chordNote);
+    }
+}
+
+NoteXformPipeline::Stage NoteXformPipeline::makeTriads(ReplaceDataCommand::TriadType type, ScalePtr scale)
+{
+    using TriadType = ReplaceDataCommand::TriadType;
+    if ((type == TriadType::Auto) || (type == TriadType::Auto2)) {
+        const bool searchOctaves = (type == TriadType::Auto2);
+        return [scale, searchOctaves](Notes& notes) {
+            // voice lead from the end, each triad based on the one after it
+            std::vector<TriadPtr> triads(notes.size());
+            TriadPtr triad;
+            for (int i = int(notes.size()) - 1; i >= 0; --i) {
+                const int origSemitone = PitchUtils::cvToSemitone(notes[i].pitchCV);
+                ScaleRelativeNote srn = scale->getScaleRelativeNote(origSemitone);
+
+                // only make triads from scale tones
+                if (!srn.valid) {
+                    triad = nullptr;            // start over on non-scale
+                } else {
+                    if (!triad) {
+                        // if we are the first one (from the end), use root
+                        triad = Triad::make(scale, srn, Triad::Inversion::Root);
+                    } else {
+                        triad = Triad::make(scale, srn, *triad, searchOctaves);
+                    }
+                }
+                triads[i] = triad;
+            }
+
+            // then output in the original order, for the stages after us
+            Notes out;
+            out.reserve(notes.size() * 3);
+            for (size_t i = 0; i < notes.size(); ++i) {
+                if (triads[i]) {
+                    addTriad(notes[i], *triads[i], scale, out);
+                } else {
+                    out.push_back(notes[i]);
+                }
+            }
+            notes.swap(out);
+        };
+    }
+
+    Triad::Inversion inversion = Triad::Inversion::Root;
+    switch (type) {
+        case TriadType::RootPosition:
+            inversion = Triad::Inversion::Root;
+            break;
+        case TriadType::FirstInversion:
+            inversion = Triad::Inversion::First;
+            break;
+        case TriadType::SecondInversion:
+            inversion = Triad::Inversion::Second;
+            break;
+        default:
+            assert(false);
+            printf("bad triad type\n"); fflush(stdout);
+    }
+    return [scale, inversion](Notes& notes) {
+        Notes out;
+        out.reserve(notes.size() * 3);
+        for (const MidiNoteEvent& note : notes) {
+            const int origSemitone = PitchUtils::cvToSemitone(note.pitchCV);
+            ScaleRelativeNote srn = scale->getScaleRelativeNote(origSemitone);
+
+            // only make triads from scale tones
+            if (srn.valid) {
+                TriadPtr triad = Triad::make(scale, srn, inversion);
+                addTriad(note, *triad, scale, out);
+            } else {
+                out.push_back(note);
+            }
+        }
+        notes.swap(out);
+    };
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ReplaceDataCommand.h"
+#include "SqMidiEvent.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class MidiSequencer;
+class Scale;
+using ScalePtr = std::shared_ptr<Scale>;
+
+/**
+ * Applies a chain of transforms to the selected notes, and makes
+ * one ReplaceDataCommand for the whole chain.
+ *
+ * The stages work on plain MidiNoteEvent values, not shared event objects,
+ * so nothing is cloned or allocated per note between stages. The selection
+ * is read once, and the result is one undo record, so the track is only
+ * locked once however many stages there are.
+ *
+ * The command removes all the selected notes and adds the output of the
+ * last stage, so notes that a stage passes through unchanged stay selected.
+ */
+class NoteXformPipeline
+{
+public:
+    using Notes = std::vector<MidiNoteEvent>;
+
+    /**
+     * A stage transforms the notes in place. It may add or remove notes.
+     * Notes come in sorted the way the selection is.
+     */
+    using Stage = std::function<void(Notes&)>;
+
+    NoteXformPipeline(const std::string& name) : name(name)
+    {
+    }
+
+    void add(Stage stage)
+    {
+        stages.push_back(stage);
+    }
+
+    /**
+     * Runs all the stages over the selection, and makes one command
+     * that replaces the selection with the result.
+     */
+    ReplaceDataCommandPtr makeCommand(std::shared_ptr<MidiSequencer>) const;
+
+    /**
+     * Runs all the stages, in order.
+     */
+    void run(Notes&) const;
+
+    /**
+     * A per-note lambda, like the ones Scale makes. Changes notes in place.
+     */
+    static Stage makeFilter(ReplaceDataCommand::FilterFunc);
+
+    /**
+     * Reverses the order of the pitches, leaving the rhythm alone.
+     */
+    static Stage makeReversePitch();
+
+    /**
+     * Breaks each note into numNotes shorter ones.
+     * @param scale is null for chromatic steps.
+     */
+    static Stage makeChop(int numNotes, ReplaceDataCommand::Ornament, ScalePtr scale, int steps);
+
+    /**
+     * Turns each note that's in the scale into a triad.
+     * Other notes are passed through.
+     */
+    static Stage makeTriads(ReplaceDataCommand::TriadType, ScalePtr scale);
+
+private:
+    const std::string name;
+    std::vector<Stage> stages;
+};
@@ -4,6 +4,7 @@
 #include "MidiSequencer.h"
 #include "MidiSong.h"
 #include "MidiTrack.h"
+#include "NoteXformPipeline.h"
 #include "Scale.h"
 #include "ScaleRelativeNote.h"
 #include "SqClipboard.h"
@@ -11,6 +12,7 @@
 #include "TimeUtils.h"
 #include "Triad.h"
 
+#include <algorithm>
 #include <assert.h>
 
 ReplaceDataCommand::ReplaceDataCommand(
@@ -21,7 +23,7 @@ ReplaceDataCommand::ReplaceDataCommand(
     const std::vector<MidiEventPtr>& inRemove,
     const std::vector<MidiEventPtr>& inAdd,
     float trackLength)
-    : trackNumber(trackNumber), removeData(inRemove), addData(inAdd), newTrackLength(trackLength)
+    : trackNumber(trackNumber), removeData(makeRecords(inRemove)), addData(makeRecords(inAdd)), newTrackLength(trackLength)
 {
     assert(song->getTrack(trackNumber));
     song->getTrack(trackNumber)->assertValid();
@@ -34,31 +36,138 @@ ReplaceDataCommand::ReplaceDataCommand(
     int trackNumber,
     const std::vector<MidiEventPtr>& inRemove,
     const std::vector<MidiEventPtr>& inAdd)
-    : trackNumber(trackNumber), removeData(inRemove), addData(inAdd)
+    : trackNumber(trackNumber), removeData(makeRecords(inRemove)), addData(makeRecords(inAdd))
 {
     assert(song->getTrack(trackNumber));
     song->getTrack(trackNumber)->assertValid();
     assertValid();
 }
 
+ReplaceDataCommand::NoteRecord::NoteRecord(const MidiEvent& event)
+{
+    // we only know how to edit notes
+    assert(event.type == MidiEvent::Type::Note);
+    const MidiNoteEvent& note = static_cast<const MidiNoteEvent&>(event);
+    startTime = note.startTime;
+    pitchCV = note.pitchCV;
+    duration = note.duration;
+}
+
+MidiNoteEvent ReplaceDataCommand::NoteRecord::toNote() const
+{
+    MidiNoteEvent note;
+    note.startTime = startTime;
+    note.pitchCV = pitchCV;
+    note.duration = duration;
+    return note;
+}
+
+MidiNoteEventPtr ReplaceDataCommand::NoteRecord::makeNote() const
+{
+    return std::make_shared<MidiNoteEvent>(toNote());
+}
+
+bool ReplaceDataCommand::NoteRecord::operator < (const NoteRecord& other) const
+{
+    if (startTime != other.startTime) {
+        return startTime < other.startTime;
+    }
+    if (pitchCV != other.pitchCV) {
+        return pitchCV < other.pitchCV;
+    }
+    return duration < other.duration;
+}
+
+bool ReplaceDataCommand::NoteRecord::operator == (const NoteRecord& other) const
+{
+    return startTime == other.startTime &&
+        pitchCV == other.pitchCV &&
+        duration == other.duration;
+}
+
+ReplaceDataCommand::NoteRecords ReplaceDataCommand::makeRecords(const std::vector<MidiEventPtr>& events)
+{
+    NoteRecords ret;
+    ret.reserve(events.size());
+    for (auto ev : events) {
+        ret.push_back(NoteRecord(*ev));
+    }
+    return ret;
+}
+
+ReplaceDataCommand::ReplaceDataCommand(
+    MidiSongPtr song,
+    int trackNumber,
+    const std::vector<MidiNoteEvent>& inRemove,
+    const std::vector<MidiNoteEvent>& inAdd,
+    float trackLength)
+    : trackNumber(trackNumber), removeData(makeRecords(inRemove)), addData(makeRecords(inAdd)), newTrackLength(trackLength)
+{
+    assert(song->getTrack(trackNumber));
+    song->getTrack(trackNumber)->assertValid();
+    assertValid();
+    originalTrackLength = song->getTrack(trackNumber)->getLength();
+}
+
+ReplaceDataCommand::NoteRecords ReplaceDataCommand::makeRecords(const std::vector<MidiNoteEvent>& notes)
+{
+    NoteRecords ret;
+    ret.reserve(notes.size());
+    for (const MidiNoteEvent& note : notes) {
+        ret.push_back(NoteRecord(note));
+    }
+    return ret;
+}
+
 void ReplaceDataCommand::assertValid() const
 {
 #ifndef NDEBUG
-    for (auto x : addData) {
-        MidiEventPtr p = x;
-        MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(p);
-        assert(note);
-        note->assertValid();
+    for (const NoteRecord& x : addData) {
+        x.toNote().assertValid();
     }
-    for (auto x : removeData) {
-        MidiEventPtr p = x;
-        MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(p);
-        assert(note);
-        note->assertValid();
+    for (const NoteRecord& x : removeData) {
+        x.toNote().assertValid();
     }
 #endif
 }
 
+bool ReplaceDataCommand::mergeWith(const SqCommand& nextCommand)
+{
+    const ReplaceDataCommand* next = dynamic_cast<const ReplaceDataCommand*>(&nextCommand);
+    if (!next ||
+        (next->name != name) ||
+        (next->trackNumber != trackNumber) ||
+        (next->extendSelection != extendSelection) ||
+        (next->removeData.size() != addData.size())) {
+        return false;
+    }
+
+    // Next must be editing exactly the notes we left behind.
+    // The order isn't important, so compare them sorted.
+    NoteRecords ours = addData;
+    NoteRecords theirs = next->removeData;
+    std::sort(ours.begin(), ours.end());
+    std::sort(theirs.begin(), theirs.end());
+    if (!(ours == theirs)) {
+        return false;
+    }
+
+    // now we go directly from our removeData to next's addData.
+    // originalTrackLength stays as ours, so undo restores it.
+    addData = next->addData;
+    if (next->newTrackLength >= 0) {
+        newTrackLength = next->newTrackLength;
+    }
+    return true;
+}
+
+size_t ReplaceDataCommand::getMemorySize() const
+{
+    return SqCommand::getMemorySize() +
+        sizeof(*this) - sizeof(SqCommand) +
+        (removeData.capacity() + addData.capacity()) * sizeof(NoteRecord);
+}
+
 void ReplaceDataCommand::execute(MidiSequencerPtr seq, SequencerWidget*)
 {
     assert(seq);
@@ -77,37 +186,29 @@ void ReplaceDataCommand::execute(MidiSequencerPtr seq, SequencerWidget*)
         mt->setLength(newTrackLength);
     }
 
-    for (auto it : addData) {
-        mt->insertEvent(it);
-    }
-
-    for (auto it : removeData) {
-        mt->deleteEvent(*it);
-    }
-
-    //  if we need to make track shorter, do it last
-    if (isNewLengthRequested && !isNewLengthLonger) {
-        mt->setLength(newTrackLength);
+    // Remove before adding, so that if a note is removed and added back
+    // unchanged we still select a note that is in the track.
+    for (const NoteRecord& it : removeData) {
+        mt->deleteEvent(it.toNote());
     }
 
-    // clone the selection, clear real selection, add stuff back correctly
-    // at the very least we must clear the selection, as those notes are no
-    // longer in the track.
-
+    // clear the selection, as those notes are no longer in the track,
+    // and select the new ones.
     MidiSelectionModelPtr selection = seq->selection;
     assert(selection);
-
     if (!extendSelection) {
         selection->clear();
     }
 
-    seq->assertValid();
-    
-    for (auto it : addData) {
-        auto foundIter = mt->findEventDeep(*it);      // find an event in the track that matches the one we just inserted
-        assert(foundIter != mt->end());
-        MidiEventPtr evt = foundIter->second;
-        selection->extendSelection(evt);
+    for (const NoteRecord& it : addData) {
+        MidiNoteEventPtr note = it.makeNote();
+        mt->insertEvent(note);
+        selection->extendSelection(note);
+    }
+
+    //  if we need to make track shorter, do it last
+    if (isNewLengthRequested && !isNewLengthLonger) {
+        mt->setLength(newTrackLength);
     }
     seq->assertValid();
 }
@@ -130,26 +231,22 @@ void ReplaceDataCommand::undo(MidiSequencerPtr seq, SequencerWidget*)
     }
 
     // to undo the insertion, delete all of them
-    for (auto it : addData) {
-        mt->deleteEvent(*it);
-    }
-    for (auto it : removeData) {
-        mt->insertEvent(it);
-    }
-
-        // If we need to make track shorter, do it last
-    if (isNewLengthRequested && !isNewLengthLonger) {
-        mt->setLength(originalTrackLength);
+    for (const NoteRecord& it : addData) {
+        mt->deleteEvent(it.toNote());
     }
 
     MidiSelectionModelPtr selection = seq->selection;
     assert(selection);
     selection->clear();
-    for (auto it : removeData) {
-        auto foundIter = mt->findEventDeep(*it);      // find an event in the track that matches the one we just inserted
-        assert(foundIter != mt->end());
-        MidiEventPtr evt = foundIter->second;
-        selection->extendSelection(evt);
+    for (const NoteRecord& it : removeData) {
+        MidiNoteEventPtr note = it.makeNote();
+        mt->insertEvent(note);
+        selection->extendSelection(note);
+    }
+
+    // If we need to make track shorter, do it last
+    if (isNewLengthRequested && !isNewLengthLonger) {
+        mt->setLength(originalTrackLength);
     }
     // TODO: move cursor
 }
@@ -248,15 +345,9 @@ ReplaceDataCommandPtr ReplaceDataCommand::makeFilterNoteCommand(
     FilterFunc lambda)
 {
     seq->assertValid(); 
-    Xform xform = [lambda](MidiEventPtr event, int) {
-        MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(event);
-        if (note) {
-            lambda(note);
-        }
-    };
-    auto ret = makeChangeNoteCommand(Ops::Pitch, seq, xform, false);
-    ret->name = name;
-    return ret;
+    NoteXformPipeline pipeline(name);
+    pipeline.add(NoteXformPipeline::makeFilter(lambda));
+    return pipeline.makeCommand(seq);
 }
 
 ReplaceDataCommandPtr ReplaceDataCommand::makeChangePitchCommand(MidiSequencerPtr seq, int semitones)
@@ -506,138 +597,13 @@ float ReplaceDataCommand::calculateDurationRequest(MidiTrackPtr track, float dur
 }
 
 
-// Algorithm
-
-// clone selection -> clone
-
-// enumerate clone, flip the pitches, using selection is ref
-// to add = clone (as vector)
-// to remove = selection (as vector)
-
 ReplaceDataCommandPtr ReplaceDataCommand::makeReversePitchCommand(std::shared_ptr<MidiSequencer> seq)
 {
-    std::vector<MidiEventPtr> toRemove;
-    std::vector<MidiEventPtr> toAdd;
-
-    // will transform the cloned selection, and add it
-    auto clonedSelection = seq->selection->clone();
-    MidiSelectionModel::const_reverse_iterator itDest = clonedSelection->rbegin();
-
-    for (MidiSelectionModel::const_iterator itSrc = seq->selection->begin(); itSrc != seq->selection->end(); ++itSrc) {
-        MidiEventPtr srcEvent = *itSrc;
-        MidiEventPtr destEvent = *itDest;
-
-        MidiNoteEventPtr destNote = safe_cast<MidiNoteEvent>(destEvent);
-        MidiNoteEventPtr srcNote = safe_cast<MidiNoteEvent>(srcEvent);
-
-        if (srcNote) {
-            assert(destNote);
-            destNote->pitchCV = srcNote->pitchCV;
-        }
-        ++itDest;
-    }
-
-    // we will remove all the events in the selection
-    toRemove = seq->selection->asVector();
-    toAdd = clonedSelection->asVector();
-
-    ReplaceDataCommandPtr ret = std::make_shared<ReplaceDataCommand>(
-        seq->song,
-        seq->selection,
-        seq->context,
-        seq->context->getTrackNumber(),
-        toRemove,
-        toAdd);
-    ret->name = "reverse pitches";
-    return ret;
-}
-
-/**************************** CHOP NOTE *************************
- */
-
-using MidiVector = std::vector<MidiEventPtr>;
-
-static void chopNote(MidiNoteEventPtr note, MidiVector& toAdd, MidiVector& toRemove, int numNotes)
-{
-    const float dur = note->duration;
-    const float durTotal = TimeUtils::getTimeAsPowerOfTwo16th(dur);
-    if (durTotal > 0) {
-        for (int i = 0; i < numNotes; ++i) {
-            MidiNoteEventPtr newNote = std::make_shared<MidiNoteEvent>();
-            newNote->startTime = note->startTime + i * durTotal / numNotes;
-            newNote->duration = dur / numNotes;     // keep original articulation
-            newNote->pitchCV = note->pitchCV;
-            toAdd.push_back(newNote);
-        }
-        toRemove.push_back(note);
-    }
-}
-
-static void trillNote(MidiNoteEventPtr note, MidiVector& toAdd, MidiVector& toRemove, int numNotes, int semitones)
-{
-    const float dur = note->duration;
-    const float durTotal = TimeUtils::getTimeAsPowerOfTwo16th(dur);
-    if (durTotal > 0) {
-        for (int i = 0; i < numNotes; ++i) {
-
-            const int semiPitchOffset = (i % 2) ? semitones : 0;
-            MidiNoteEventPtr newNote = std::make_shared<MidiNoteEvent>();
-            newNote->startTime = note->startTime + i * durTotal / numNotes;
-            newNote->duration = dur / numNotes;     // keep original articulation
-           
-            float pitchCV = note->pitchCV;
-
-            if (semiPitchOffset) {
-                const int origSemitone = PitchUtils::cvToSemitone(note->pitchCV);
-                const int destSemitone = origSemitone + semiPitchOffset;
-                pitchCV = PitchUtils::semitoneToCV(destSemitone);
-            }
-
-            newNote->pitchCV = pitchCV;
-            toAdd.push_back(newNote);
-        }
-        toRemove.push_back(note);
-    }
-}
-
-static void arpeggiateNote(
-    MidiNoteEventPtr note, 
-    MidiVector& toAdd, 
-    MidiVector& toRemove, 
-    int numNotes, 
-    ScalePtr scale,
-    int steps)
-{
-   const float dur = note->duration;
-    const float durTotal = TimeUtils::getTimeAsPowerOfTwo16th(dur);
-    if (durTotal > 0) {
-        for (int i = 0; i < numNotes; ++i) {
-
-            const int origSemitone = PitchUtils::cvToSemitone(note->pitchCV);
-            int semitonePitchOffset = 0;
-            if (scale) {
-                const int stepsToXpose = i * steps;
-                const int xposedSemi = scale->transposeInScale(origSemitone, stepsToXpose);
-                semitonePitchOffset = xposedSemi - origSemitone;
-            } else {
-                semitonePitchOffset = i * steps;
-            }
-
-            MidiNoteEventPtr newNote = std::make_shared<MidiNoteEvent>();
-            newNote->startTime = note->startTime + i * durTotal / numNotes;
-            newNote->duration = dur / numNotes;     // keep original articulation
-            
-            const int destSemitone = origSemitone + semitonePitchOffset;
-            float pitchCV = PitchUtils::semitoneToCV(destSemitone);
-
-            newNote->pitchCV = pitchCV;
-            toAdd.push_back(newNote);
-        }
-        toRemove.push_back(note);
-    }
+    NoteXformPipeline pipeline("reverse pitches");
+    pipeline.add(NoteXformPipeline::makeReversePitch());
+    return pipeline.makeCommand(seq);
 }
 
-
 ReplaceDataCommandPtr ReplaceDataCommand::makeChopNoteCommand(
     std::shared_ptr<MidiSequencer> seq, 
     int numNotes,
@@ -645,197 +611,21 @@ ReplaceDataCommandPtr ReplaceDataCommand::makeChopNoteCommand(
     ScalePtr scale,
     int steps)
 {
-    std::vector<MidiEventPtr> toRemove;
-    std::vector<MidiEventPtr> toAdd;
-
-    // toAdd will get the new notes derived from chopping.
-    for (MidiSelectionModel::const_iterator it = seq->selection->begin(); it != seq->selection->end(); ++it) {
-        MidiEventPtr event = *it;
-        MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(event);
-       
-        if (note) {
-            if (ornament == Ornament::Trill) {
-                int trillSemis = 0;
-                if (scale) {
-                    const int origSemitone = PitchUtils::cvToSemitone(note->pitchCV);
-                    const int xposedSemi = scale->transposeInScale(origSemitone, steps);
-
-                    trillSemis = xposedSemi - origSemitone;
-                } else {
-                    trillSemis = steps;
-                }
-                trillNote(note, toAdd, toRemove, numNotes, trillSemis);
-            } else if (ornament == Ornament::Arpeggio) {
-                arpeggiateNote(note, toAdd, toRemove, numNotes, scale, steps);
-               
-            } else {
-                chopNote(note, toAdd, toRemove, numNotes);
-            }
-
-        }
-    }
-
-    ReplaceDataCommandPtr ret = std::make_shared<ReplaceDataCommand>(
-        seq->song,
-        seq->selection,
-        seq->context,
-        seq->context->getTrackNumber(),
-        toRemove,
-        toAdd);
-    ret->name = "chop notes";
-    return ret;
+    NoteXformPipeline pipeline("chop notes");
+    pipeline.add(NoteXformPipeline::makeChop(numNotes, ornament, scale, steps));
+    return pipeline.makeCommand(seq);
 }
 
-
 ReplaceDataCommandPtr ReplaceDataCommand::makeMakeTriadsCommand(
     std::shared_ptr<MidiSequencer> seq,
     TriadType type,
     ScalePtr scale)
 {
-    ReplaceDataCommandPtr ret = nullptr;
-    switch (type) {
-        case TriadType::RootPosition:
-        case TriadType::FirstInversion:
-        case TriadType::SecondInversion:
- 
-            ret = makeMakeTriadsCommandNorm(seq, type, scale);
-            break;
-        default:
-            assert(false);
-            printf("bad triad type\n"); fflush(stdout);
-            ret = makeMakeTriadsCommandNorm(seq, type, scale);
-            break;
-        case TriadType::Auto2:
-        case TriadType::Auto:
-            ret = makeMakeTriadsCommandAuto(seq, type, scale);
-    }
-    return ret;
-}
-
-
-ReplaceDataCommandPtr ReplaceDataCommand::makeMakeTriadsCommandAuto(
-    std::shared_ptr<MidiSequencer> seq,
-    TriadType type,
-    ScalePtr scale)
-{
-    assert((type == TriadType::Auto) || (type == TriadType::Auto2));
-    const bool searchOctaves = (type == TriadType::Auto2);
-    std::vector<MidiEventPtr> toRemove;
-    std::vector<MidiEventPtr> toAdd;
-
-    TriadPtr triad;     // the last one we made
-    for (MidiSelectionModel::const_reverse_iterator it = seq->selection->rbegin(); it != seq->selection->rend(); ++it) {
-        MidiEventPtr event = *it;
-        MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(event);
-
-        if (note) {
-            const int origSemitone = PitchUtils::cvToSemitone(note->pitchCV);
-            ScaleRelativeNote srn = scale->getScaleRelativeNote(origSemitone);
-
-            // only make triads from scale tones
-            if (!srn.valid) {
-                triad = nullptr;            // start over on non-scale
-            } else {
-                toRemove.push_back(event);                  // when we make a triad, remove the orig
-                if (!triad) {
-                    // if we are the first one (from the end), use root
-                    triad = Triad::make(scale, srn, Triad::Inversion::Root);
-                } else {
-                    triad = Triad::make(scale, srn, *triad, searchOctaves);
-                }
-
-                auto cvs = triad->toCv(scale);
-                MidiNoteEventPtr root = std::make_shared<MidiNoteEvent>(*note);
-                MidiNoteEventPtr third = std::make_shared<MidiNoteEvent>(*note);
-                MidiNoteEventPtr fifth = std::make_shared<MidiNoteEvent>(*note);
-
-                root->pitchCV = cvs[0];
-                third->pitchCV = cvs[1];
-                fifth->pitchCV = cvs[2];
-                toAdd.push_back(root);
-                toAdd.push_back(third);
-                toAdd.push_back(fifth);
-            }
-        }
-    }
-     ReplaceDataCommandPtr ret = std::make_shared<ReplaceDataCommand>(
-        seq->song,
-        seq->selection,
-        seq->context,
-        seq->context->getTrackNumber(),
-        toRemove,
-        toAdd);
-    ret->name = "make triads";
-    return ret;
-
-}
-
-ReplaceDataCommandPtr ReplaceDataCommand::makeMakeTriadsCommandNorm(
-    std::shared_ptr<MidiSequencer> seq,
-    TriadType type,
-    ScalePtr scale)
-{
-    std::vector<MidiEventPtr> toRemove;
-    std::vector<MidiEventPtr> toAdd;
-
-    for (MidiSelectionModel::const_iterator it = seq->selection->begin(); it != seq->selection->end(); ++it) {
-        MidiEventPtr event = *it;
-        MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(event);
-
-        if (note) {
-            const int origSemitone = PitchUtils::cvToSemitone(note->pitchCV);
-            ScaleRelativeNote srn = scale->getScaleRelativeNote(origSemitone);
-
-            // only make triads from scale tones
-            if (srn.valid) {
-                Triad::Inversion inversion = Triad::Inversion::Root;
-                switch (type) {
-                    case TriadType::RootPosition:
-                        inversion = Triad::Inversion::Root;
-                        break;
-                    case TriadType::FirstInversion:
-                        inversion = Triad::Inversion::First;
-                        break;
-                    case TriadType::SecondInversion:
-                        inversion = Triad::Inversion::Second;
-                        break;
-                    default:
-                        assert(false);
-                        printf("bad triad type\n"); fflush(stdout);
-                }
-                // make the triad of the correct inversion
-                TriadPtr triad = Triad::make(scale, srn, inversion);
-                // and convert back to native pitch CV
-                auto cvs = triad->toCv(scale);
-
-                // now convert it back to notes
-                // make three new notes for the three notes in the chord;
-                MidiNoteEventPtr a = std::make_shared<MidiNoteEvent>(*note);
-                a->pitchCV = cvs[0];
-                MidiNoteEventPtr b = std::make_shared<MidiNoteEvent>(*note);
-                b->pitchCV = cvs[1];
-                MidiNoteEventPtr c = std::make_shared<MidiNoteEvent>(*note);
-                c->pitchCV = cvs[2];
-
-                toRemove.push_back(note);
-                toAdd.push_back(a);
-                toAdd.push_back(b);
-                toAdd.push_back(c);
-            }
-        }
-    }
-    ReplaceDataCommandPtr ret = std::make_shared<ReplaceDataCommand>(
-        seq->song,
-        seq->selection,
-        seq->context,
-        seq->context->getTrackNumber(),
-        toRemove,
-        toAdd);
-    ret->name = "make triads";
-    return ret;
+    NoteXformPipeline pipeline("make triads");
+    pipeline.add(NoteXformPipeline::makeTriads(type, scale));
+    return pipeline.makeCommand(seq);
 }
 
-
 #if 0 // second way
 ReplaceDataCommandPtr ReplaceDataCommand::makeMakeTriadsCommand(
     std::shared_ptr<MidiSequencer> seq,
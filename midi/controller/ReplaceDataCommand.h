@@ -4,11 +4,11 @@
 #include <vector>
 
 #include "SqCommand.h"
+#include "SqMidiEvent.h"
 
 class MidiEditorContext;
-class MidiEvent;
-class MidiNoteEvent;
 class MidiSong;
+class MidiTrack;
 class MidiSequencer;
 class MidiSelectionModel;
 class ReplaceDataCommand;
@@ -16,7 +16,6 @@ class Scale;
 
 
 using ReplaceDataCommandPtr = std::shared_ptr<ReplaceDataCommand>;
-using MidiEventPtr = std::shared_ptr<MidiEvent>;
 using ScalePtr = std::shared_ptr<Scale>;
 
 class ReplaceDataCommand : public SqCommand
@@ -25,6 +24,14 @@ public:
     virtual void execute(MidiSequencerPtr, SequencerWidget*) override;
     virtual void undo(MidiSequencerPtr, SequencerWidget*) override;
 
+    /**
+     * Merges repeated edits of the same notes, like nudging the pitch
+     * up many times. Merges if next has the same name, and removes exactly
+     * the notes that this one added.
+     */
+    virtual bool mergeWith(const SqCommand& next) override;
+    virtual size_t getMemorySize() const override;
+
     // TODO: get rid of obsolete arguments.
     ReplaceDataCommand(
         std::shared_ptr<MidiSong> song,
@@ -41,6 +48,17 @@ public:
         const std::vector<MidiEventPtr>& inRemove,
         const std::vector<MidiEventPtr>& inAdd);
 
+    /**
+     * Takes the notes by value, for callers that work on
+     * plain note data, like NoteXformPipeline.
+     */
+    ReplaceDataCommand(
+        std::shared_ptr<MidiSong> song,
+        int trackNumber,
+        const std::vector<MidiNoteEvent>& inRemove,
+        const std::vector<MidiNoteEvent>& inAdd,
+        float trackLength);
+
     /**
      * static factories for replace commands
      */
@@ -67,7 +85,8 @@ public:
     static ReplaceDataCommandPtr makeReversePitchCommand(std::shared_ptr<MidiSequencer> seq);
     /**
      * This one works for any XFORM that does a one to one processing of notes.
-     * Since it uses "Legacy" helper, the lambda must process notes in place.
+     * The lambda must process notes in place.
+     * This, reverse pitch, chop and triads are single stage NoteXformPipelines.
      */
     using FilterFunc = std::function<void(MidiEventPtr)>;
     static ReplaceDataCommandPtr makeFilterNoteCommand(const std::string& name, std::shared_ptr<MidiSequencer> seq, FilterFunc);
@@ -98,9 +117,31 @@ public:
     static float calculateDurationRequest(std::shared_ptr<MidiTrack> track, float duration);
 private:
 
+    /**
+     * The undo data is just the values of the notes, not the note objects.
+     * That's a lot smaller, and doesn't keep the deleted notes alive.
+     * Notes are found in the track by value, like findEventDeep.
+     */
+    class NoteRecord
+    {
+    public:
+        NoteRecord(const MidiEvent&);
+        MidiEvent::time_t startTime = 0;
+        float pitchCV = 0;
+        float duration = 0;
+
+        MidiNoteEvent toNote() const;
+        std::shared_ptr<MidiNoteEvent> makeNote() const;
+        bool operator < (const NoteRecord&) const;
+        bool operator == (const NoteRecord&) const;
+    };
+    using NoteRecords = std::vector<NoteRecord>;
+    static NoteRecords makeRecords(const std::vector<MidiEventPtr>&);
+    static NoteRecords makeRecords(const std::vector<MidiNoteEvent>&);
+
     int trackNumber;
-    std::vector<MidiEventPtr> removeData;
-    std::vector<MidiEventPtr> addData;
+    NoteRecords removeData;
+    NoteRecords addData;
 
     /**
      * Clients who want track length changed should
@@ -132,15 +173,6 @@ private:
         Xform xform,
         bool canChangeLength);
 
-     static ReplaceDataCommandPtr makeMakeTriadsCommandNorm(
-        std::shared_ptr<MidiSequencer>sequencer, 
-        TriadType,
-        ScalePtr);
-     static ReplaceDataCommandPtr makeMakeTriadsCommandAuto(
-        std::shared_ptr<MidiSequencer>sequencer, 
-        TriadType,
-        ScalePtr);
-
     void assertValid() const;
 };
 
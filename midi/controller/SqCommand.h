@@ -16,6 +16,24 @@ public:
     virtual ~SqCommand() {}
     virtual void execute(MidiSequencerPtr seq, SequencerWidget* widget) = 0;
     virtual void undo(MidiSequencerPtr seq, SequencerWidget*) = 0;
+
+    /**
+     * Called with a command that has just been executed after this one.
+     * If this command can absorb it (so that undoing this one undoes both),
+     * it should do so and return true. Then next is not put on the undo stack.
+     */
+    virtual bool mergeWith(const SqCommand& next)
+    {
+        return false;
+    }
+
+    /**
+     * Approximate memory held by this command, for limiting the undo history.
+     */
+    virtual size_t getMemorySize() const
+    {
+        return sizeof(*this) + name.capacity();
+    }
     std::string name = "Seq++";
 };
 
@@ -15,11 +15,46 @@ bool UndoRedoStack::canRedo() const
     return !redoList.empty() || !redo4List.empty();
 }
 
+void UndoRedoStack::setMemoryBudget(size_t bytes)
+{
+    memoryBudget = bytes;
+    enforceBudget();
+}
+
+void UndoRedoStack::clearRedo()
+{
+    for (auto cmd : redoList) {
+        memoryUsed -= cmd->getMemorySize();
+    }
+    redoList.clear();
+}
+
+void UndoRedoStack::enforceBudget()
+{
+    // always keep the most recent one, however big
+    while (memoryUsed > memoryBudget && undoList.size() > 1) {
+        memoryUsed -= undoList.back()->getMemorySize();
+        undoList.pop_back();
+    }
+}
+
 void UndoRedoStack::execute(MidiSequencerPtr seq, std::shared_ptr<SqCommand> cmd)
 {
     cmd->execute(seq, nullptr);     // only used for unit tests, maybe we can get away with this
+    clearRedo();
+
+    if (!undoList.empty()) {
+        auto last = undoList.front();
+        const size_t lastSize = last->getMemorySize();
+        if (last->mergeWith(*cmd)) {
+            memoryUsed = memoryUsed - lastSize + last->getMemorySize();
+            enforceBudget();
+            return;
+        }
+    }
     undoList.push_front(cmd);
-    redoList.clear();   
+    memoryUsed += cmd->getMemorySize();
+    enforceBudget();
 }
 
 void UndoRedoStack::execute4(MidiSequencer4Ptr seq, std::shared_ptr<Sq4Command> cmd)
@@ -17,6 +17,11 @@ using MidiSequencer4Ptr = std::shared_ptr<MidiSequencer4>;
 
 #ifdef __USE_VCV_UNDO
 
+/**
+ * Puts the commands on VCV's undo history.
+ * Commands that can be merged (SqCommand::mergeWith) are merged
+ * into our action if it is at the top of VCV's history.
+ */
 class UndoRedoStack
 {
 public:
@@ -39,12 +44,25 @@ using UndoRedoStackPtr = std::shared_ptr<UndoRedoStack>;
 #include <memory>
 #include <list>
 
+/**
+ * Commands that can be merged (SqCommand::mergeWith) are merged into the
+ * top of the undo stack, so repeated small edits take one entry.
+ *
+ * The history is limited by memory, not by count. When the commands
+ * use more than the budget, the oldest ones are dropped.
+ */
 class UndoRedoStack
 {
 public:
     bool canUndo() const;
     bool canRedo() const;
 
+    void setMemoryBudget(size_t bytes);
+    size_t getMemoryUsed() const
+    {
+        return memoryUsed;
+    }
+
     // It's a bit of a hack to have a version that doesn't require a widget,
     // But since the widget param is rarely used... 
     // execute the command, make undo record
@@ -65,6 +83,11 @@ private:
     std::list<std::shared_ptr<Sq4Command>> undo4List;
     std::list<std::shared_ptr<Sq4Command>> redo4List;
 
+    size_t memoryBudget = 16 * 1024 * 1024;
+    size_t memoryUsed = 0;
+
+    void clearRedo();
+    void enforceBudget();
 };
 
 using UndoRedoStackPtr = std::shared_ptr<UndoRedoStack>;
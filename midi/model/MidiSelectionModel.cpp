@@ -4,7 +4,9 @@
 #include "MidiSelectionModel.h"
 #include "MidiTrack.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <functional>
 extern int _mdb;
 MidiSelectionModel::MidiSelectionModel(IMidiPlayerAuditionHostPtr aud) : auditionHost(aud)
 {
@@ -32,6 +34,42 @@ bool MidiSelectionModel::CompareEventPtrs::operator() (const std::shared_ptr<Mid
     return  le < re;
 }
 
+size_t MidiSelectionModel::HashEventPtr::operator() (const MidiEventPtr& ev) const
+{
+    // must agree with MidiEvent::operator ==
+    // (adding zero turns -0 into 0, so they hash the same)
+    std::hash<float> hashFloat;
+    size_t ret = size_t(ev->type);
+    ret = ret * 31 + hashFloat(ev->startTime + 0.f);
+    MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(ev);
+    if (note) {
+        ret = ret * 31 + hashFloat(note->pitchCV + 0.f);
+        ret = ret * 31 + hashFloat(note->duration + 0.f);
+    }
+    return ret;
+}
+
+bool MidiSelectionModel::EqualEventPtrs::operator() (const MidiEventPtr& lhs, const MidiEventPtr& rhs) const
+{
+    return *lhs == *rhs;
+}
+
+void MidiSelectionModel::changed()
+{
+    ++generation;
+    orderedValid = false;
+}
+
+const MidiSelectionModel::container& MidiSelectionModel::getOrdered() const
+{
+    if (!orderedValid) {
+        ordered.assign(selection.begin(), selection.end());
+        std::sort(ordered.begin(), ordered.end(), CompareEventPtrs());
+        orderedValid = true;
+    }
+    return ordered;
+}
+
 bool MidiSelectionModel::isAuditionSuppressed() const
 {
     return auditionSuppressed;
@@ -67,6 +105,7 @@ void MidiSelectionModel::addToSelection(std::shared_ptr<MidiEvent> event, bool k
 
     if (!keepExisting) {
         selection.clear();
+        changed();
     }
     add(event);
 }
@@ -77,34 +116,36 @@ void MidiSelectionModel::removeFromSelection(std::shared_ptr<MidiEvent> event)
     assert(it != selection.end());
     if (it != selection.end()) {
         selection.erase(it);
+        changed();
     }
 }
 
 MidiSelectionModel::const_iterator MidiSelectionModel::begin() const
 {
-    return selection.begin();
+    return getOrdered().begin();
 }
 
 MidiSelectionModel::const_iterator MidiSelectionModel::end() const
 {
-    return selection.end();
+    return getOrdered().end();
 }
 
 
 MidiSelectionModel::const_reverse_iterator MidiSelectionModel::rbegin() const
 {
-    return selection.rbegin();
+    return getOrdered().rbegin();
 }
 
 MidiSelectionModel::const_reverse_iterator MidiSelectionModel::rend() const
 {
-    return selection.rend();
+    return getOrdered().rend();
 }
 
 void MidiSelectionModel::clear()
 {
     selection.clear();
     allIsSelected = false;
+    changed();
 }
 
 void MidiSelectionModel::add(MidiEventPtr evt)
@@ -120,20 +161,23 @@ void MidiSelectionModel::add(MidiEventPtr evt)
         auditionHost->auditionNote(note->pitchCV);
     }
     selection.insert(evt);
+    changed();
 }
 
 bool MidiSelectionModel::isSelected(MidiEventPtr evt) const
 {
     assert(evt);
-    auto it = std::find(selection.begin(), selection.end(), evt);
-    return it != selection.end();
+    // at most one event with this value can be selected, so find that
+    // one and see if it's the same object.
+    auto it = selection.find(evt);
+    return it != selection.end() && *it == evt;
 }
 
 MidiEventPtr MidiSelectionModel::getLast()
 {
     MidiEventPtr ret;
     float lastTime = 0;
-    for (auto it : selection) {
+    for (auto it : getOrdered()) {
         MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(it);
         if (note) {
             float noteEnd = note->startTime + note->duration;
@@ -166,7 +210,8 @@ MidiSelectionModelPtr MidiSelectionModel::clone() const
     // Clones ones never need to drive audition
     auto nullAudition = std::make_shared<NullAudition>();
     MidiSelectionModelPtr ret = std::make_shared<MidiSelectionModel>(nullAudition);
-    for (auto it : selection) {
+    ret->selection.reserve(selection.size());
+    for (auto it : getOrdered()) {
         MidiEventPtr clonedEvent = it->clone();
         ret->add(clonedEvent);
     }
@@ -175,21 +220,12 @@ MidiSelectionModelPtr MidiSelectionModel::clone() const
 
 bool MidiSelectionModel::isSelectedDeep(MidiEventPtr evt) const
 {
-    auto it = std::find_if(begin(), end(), [evt](MidiEventPtr ev) {
-        return *ev == *evt;
-    });
-
-    return it != end();
+    return selection.find(evt) != selection.end();
 }
 
 std::vector<MidiEventPtr> MidiSelectionModel::asVector() const
 {
-    std::vector<MidiEventPtr> ret;
-    for (auto it : selection) {
-        MidiEventPtr event = it;
-        ret.push_back(event);
-    }
-    return ret;
+    return getOrdered();
 }
 
 IMidiPlayerAuditionHostPtr MidiSelectionModel::_testGetAudition()
@@ -205,7 +241,8 @@ bool MidiSelectionModel::isAllSelected() const
  void MidiSelectionModel::selectAll(MidiTrackPtr track)
  {
     clear();
-    for (auto it : *track) {
+    selection.reserve(track->size());
+    for (const auto& it : *track) {
         MidiEventPtr orig = it.second;
         if (orig->type != MidiEvent::Type::End) {
             extendSelection(orig);
@@ -1,6 +1,7 @@
 #pragma once
 #include <memory>
-#include <set>
+#include <stdint.h>
+#include <unordered_set>
 #include <vector>
 
 class MidiEvent;
@@ -15,6 +16,15 @@ using MidiTrackPtr = std::shared_ptr<MidiTrack>;
 
 /**
  * Central manager for tracking selections in the MidiSong being edited.
+ *
+ * The selection is a hash set, keyed by the value of the events.
+ * So membership tests, both by pointer (isSelected) and by value (isSelectedDeep),
+ * are O(1). Like before, two events that are == can't both be selected.
+ *
+ * Iteration is in event order (MidiEvent::operator <). The sorted list is
+ * only made when someone iterates, and is kept until the selection changes.
+ * So selecting a lot of notes, one at a time, is O(n) rather than O(n log n),
+ * and drawing the selected notes doesn't keep re-sorting.
  */
 class MidiSelectionModel
 {
@@ -48,7 +58,24 @@ public:
         bool operator() (const MidiEventPtr& lhs, const MidiEventPtr& rhs) const;
     };
 
-    using container = std::set<MidiEventPtr, CompareEventPtrs>;
+    /**
+     * Hash and equality on the value of the event, not the pointer.
+     */
+    class HashEventPtr
+    {
+    public:
+        size_t operator() (const MidiEventPtr&) const;
+    };
+    class EqualEventPtrs
+    {
+    public:
+        bool operator() (const MidiEventPtr& lhs, const MidiEventPtr& rhs) const;
+    };
+
+    /**
+     * The sorted selection, which is what the iterators walk.
+     */
+    using container = std::vector<MidiEventPtr>;
     using const_iterator = container::const_iterator;
     using const_reverse_iterator = container::const_reverse_iterator;
 
@@ -84,19 +111,36 @@ public:
 
     /** Returns true is there is an object in selection equivalent
      * to 'event'. i.e.  selection contains entry == *event.
-     * O(n), where n is the number of items in selection
+     * O(1)
      */
     bool isSelectedDeep(MidiEventPtr event) const;
 
     IMidiPlayerAuditionHostPtr _testGetAudition();
 
+    /**
+     * Goes up whenever the selection changes.
+     */
+    uint32_t getGeneration() const
+    {
+        return generation;
+    }
+
 private:
 
     void add(MidiEventPtr);
+    void changed();
+    const container& getOrdered() const;
+
+    std::unordered_set<MidiEventPtr, HashEventPtr, EqualEventPtrs> selection;
 
-    container selection;
+    /**
+     * Made on demand by getOrdered.
+     */
+    mutable container ordered;
+    mutable bool orderedValid = true;
 
     IMidiPlayerAuditionHostPtr auditionHost;
     bool auditionSuppressed = false;
     bool allIsSelected = false;
+    uint32_t generation = 0;
 };
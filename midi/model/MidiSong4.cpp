@@ -2,6 +2,64 @@
 #include "MidiLock.h"
 #include "MidiSong4.h"
 #include "MidiTrack4Options.h"
+#include "MidiTrackSchedule.h"
+
+#include <assert.h>
+
+// shared by all songs, so the player can tell schedules apart when it changes songs
+static std::atomic<uint32_t> nextScheduleSerial(1);
+
+MidiSong4::MidiSong4()
+{
+    for (int track = 0; track < numTracks; ++track) {
+        for (int sect = 0; sect < numSectionsPerTrack; ++sect) {
+            schedules[track][sect] = nullptr;
+        }
+    }
+    lock->setEditorUnlockHandler([this]() {
+        updateSchedules();
+    });
+}
+
+MidiSong4::~MidiSong4()
+{
+    // tracks may outlive us, and they share the lock
+    lock->setEditorUnlockHandler(nullptr);
+    for (int track = 0; track < numTracks; ++track) {
+        for (int sect = 0; sect < numSectionsPerTrack; ++sect) {
+            delete schedules[track][sect].load();
+        }
+    }
+}
+
+const MidiTrackSchedule* MidiSong4::getSchedule(int trackIndex, int sectionIndex) const
+{
+    if (trackIndex < 0 || trackIndex >= numTracks || sectionIndex < 0 || sectionIndex >= numSectionsPerTrack) {
+        assert(false);
+        return nullptr;
+    }
+    return schedules[trackIndex][sectionIndex];
+}
+
+void MidiSong4::updateSchedules()
+{
+    assert(lock->locked());
+    for (int track = 0; track < numTracks; ++track) {
+        for (int sect = 0; sect < numSectionsPerTrack; ++sect) {
+            const MidiTrackPtr tk = tracks[track][sect];
+            const MidiTrackSchedule* old = schedules[track][sect];
+            if (tk == scheduledTracks[track][sect] && (!tk || old->changeCount == tk->getChangeCount())) {
+                continue;
+            }
+            const MidiTrackSchedule* schedule = tk ? new MidiTrackSchedule(*tk, nextScheduleSerial++) : nullptr;
+            schedules[track][sect] = schedule;
+            scheduledTracks[track][sect] = tk;
+
+            // we have the lock, so the player can't be using the old one
+            delete old;
+        }
+    }
+}
 
 void MidiSong4::assertValid()
 {
@@ -91,6 +149,7 @@ void MidiSong4::createTrack(int index, int sectionIndex)
 
 void MidiSong4::_flipTracks()
 {
+    MidiLocker l(lock);
     std::swap(tracks[0], tracks[1]);
     std::swap(options[0], options[1]);
     
@@ -98,6 +157,7 @@ void MidiSong4::_flipTracks()
 
 void MidiSong4::_flipSections()
 {
+    MidiLocker l(lock);
     std::swap(tracks[0][0], tracks[0][1]);
     std::swap(options[0][0], options[0][1]);
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <memory>
 
 #include "MidiLock.h"
@@ -6,6 +7,7 @@
 
 class MidiSong4;
 class MidiTrack4Options;
+class MidiTrackSchedule;
 using MidiSong4Ptr = std::shared_ptr<MidiSong4>;
 using MidiTrack4OptionsPtr = std::shared_ptr<MidiTrack4Options>;
 
@@ -17,6 +19,11 @@ public:
     static const int numTracks = 4;
     static const int numSectionsPerTrack = 4;
 
+    MidiSong4();
+    ~MidiSong4();
+    MidiSong4(const MidiSong4&) = delete;
+    const MidiSong4& operator = (const MidiSong4&) = delete;
+
     void assertValid();
     float getTrackLength(int trackNum) const;
 
@@ -35,6 +42,22 @@ public:
      */
     static MidiSong4Ptr makeTest(MidiTrack::TestContent, int trackIndex, int sectionIndex = 0);
 
+    /**
+     * The schedule the player uses for a section.
+     * May be null, or made from a different track, if the section was changed
+     * while the lock was held.
+     * Playback may only use it while holding the lock, as the UI deletes old ones.
+     */
+    const MidiTrackSchedule* getSchedule(int trackIndex, int sectionIndex) const;
+
+    /**
+     * Re-builds the schedule of any section whose track has changed.
+     * Allocates, so only for the UI thread, with the lock held.
+     * Called from the lock when the editor unlocks, so the player always
+     * sees up to date schedules.
+     */
+    void updateSchedules();
+
     std::shared_ptr<MidiLock> lock = std::make_shared<MidiLock>();
 
     void _flipTracks();
@@ -44,5 +67,17 @@ private:
     
     MidiTrackPtr tracks[numTracks][numSectionsPerTrack] = {{nullptr}};
     MidiTrack4OptionsPtr options[numTracks][numSectionsPerTrack] = {{nullptr}};
+
+    /**
+     * Owned by us. Swapped in atomically, so the player
+     * sees either the old one or the new one.
+     */
+    std::atomic<const MidiTrackSchedule*> schedules[numTracks][numSectionsPerTrack];
+
+    /**
+     * The tracks the schedules were made from. Holding on to them
+     * means a new track can't be at the same address as an old one.
+     */
+    MidiTrackPtr scheduledTracks[numTracks][numSectionsPerTrack] = {{nullptr}};
 };
 
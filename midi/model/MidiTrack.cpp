@@ -70,6 +70,19 @@ void MidiTrack::insertEvent(MidiEventPtr evIn)
     assert(lock);
     assert(lock->locked());
     events.insert(std::pair<MidiEvent::time_t, MidiEventPtr>(evIn->startTime, evIn));
+    noteIndexDirty = true;
+    ++changeCount;
+}
+
+void MidiTrack::appendEvent(MidiEventPtr evIn)
+{
+    assert(lock);
+    assert(lock->locked());
+    // the hint makes this amortized constant time if evIn goes at the end,
+    // and puts it after any other events at the same time, like insert does.
+    events.emplace_hint(events.end(), evIn->startTime, evIn);
+    noteIndexDirty = true;
+    ++changeCount;
 }
 
 float MidiTrack::getLength() const
@@ -96,6 +109,8 @@ void MidiTrack::deleteEvent(const MidiEvent& evIn)
 
         if (*it->second == evIn) {
             events.erase(it);
+            noteIndexDirty = true;
+            ++changeCount;
             return;
         }
     }
@@ -171,6 +186,68 @@ MidiTrack::iterator_pair MidiTrack::timeRange(MidiEvent::time_t start, MidiEvent
     return iterator_pair(events.lower_bound(start), events.upper_bound(end));
 }
 
+void MidiTrack::getNotesOverlapping(MidiEvent::time_t start, MidiEvent::time_t end, std::vector<MidiNoteEventPtr>& notes) const
+{
+    assert(end >= start);
+    notes.clear();
+    if (noteIndexDirty) {
+        buildNoteIndex();
+    }
+    queryNoteIndex(0, int(noteIndex.size()), start, end, notes);
+}
+
+void MidiTrack::buildNoteIndex() const
+{
+    noteIndex.clear();
+    for (const auto& it : events) {
+        MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(it.second);
+        if (note) {
+            noteIndex.push_back(note);
+        }
+    }
+    noteIndexMaxEnd.resize(noteIndex.size());
+    buildNoteIndexMaxEnd(0, int(noteIndex.size()));
+    noteIndexDirty = false;
+}
+
+MidiEvent::time_t MidiTrack::buildNoteIndexMaxEnd(int lo, int hi) const
+{
+    if (lo >= hi) {
+        return 0;
+    }
+    const int mid = (lo + hi) / 2;
+    const MidiNoteEventPtr& note = noteIndex[mid];
+    MidiEvent::time_t maxEnd = note->startTime + note->duration;
+    maxEnd = std::max(maxEnd, buildNoteIndexMaxEnd(lo, mid));
+    maxEnd = std::max(maxEnd, buildNoteIndexMaxEnd(mid + 1, hi));
+    noteIndexMaxEnd[mid] = maxEnd;
+    return maxEnd;
+}
+
+void MidiTrack::queryNoteIndex(int lo, int hi, MidiEvent::time_t start, MidiEvent::time_t end, std::vector<MidiNoteEventPtr>& notes) const
+{
+    if (lo >= hi) {
+        return;
+    }
+    const int mid = (lo + hi) / 2;
+    if (noteIndexMaxEnd[mid] <= start) {
+        // everything under here is over before the range starts
+        return;
+    }
+
+    queryNoteIndex(lo, mid, start, end, notes);
+
+    const MidiNoteEventPtr& note = noteIndex[mid];
+    if (note->startTime >= end) {
+        // this note, and everything after it, starts too late
+        return;
+    }
+    if (note->startTime + note->duration > start) {
+        notes.push_back(note);
+    }
+    queryNoteIndex(mid + 1, hi, start, end, notes);
+}
+
 
 MidiTrack::note_iterator_pair MidiTrack::timeRangeNotes(MidiEvent::time_t start, MidiEvent::time_t end) const
 {
@@ -247,7 +324,7 @@ MidiTrack::const_iterator MidiTrack::findEventPointer(MidiEventPtrC ev)
 
 MidiNoteEventPtr MidiTrack::getFirstNote()
 {
-    for (auto it : events) {
+    for (const auto& it : events) {
         MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(it.second);
         if (note) {
             return note;
@@ -259,7 +336,7 @@ MidiNoteEventPtr MidiTrack::getFirstNote()
 MidiNoteEventPtr MidiTrack::getSecondNote()
 {
     int count = 0;
-    for (auto it : events) {
+    for (const auto& it : events) {
         MidiNoteEventPtr note = safe_cast<MidiNoteEvent>(it.second);
         if (note) {
             if (++count == 2) {
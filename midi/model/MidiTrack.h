@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <vector>
 #include <map>
 #include <memory>
@@ -31,6 +32,12 @@ public:
     void assertValid() const;
 
     void insertEvent(MidiEventPtr ev);
+
+    /**
+     * Same as insertEvent, but much faster when the events
+     * are being added in time order, as they are when loading.
+     */
+    void appendEvent(MidiEventPtr ev);
     void deleteEvent(const MidiEvent&);
     void insertEnd(MidiEvent::time_t time);
 
@@ -77,6 +84,18 @@ public:
      */
     iterator_pair timeRange(MidiEvent::time_t start, MidiEvent::time_t end) const;
 
+    /**
+     * Finds all the notes that are sounding in start <= t < end,
+     * including long notes that started before start.
+     * Clears notes, then fills it in start time order.
+     *
+     * Uses an index of the notes that is rebuilt (O(n)) on the first query
+     * after the track is edited. After that a query is O(log n) plus the
+     * notes found, where timeRange would have to scan back far enough to
+     * find the longest note.
+     */
+    void getNotesOverlapping(MidiEvent::time_t start, MidiEvent::time_t end, std::vector<MidiNoteEventPtr>& notes) const;
+
     iterator begin()
     {
         return events.begin();
@@ -96,6 +115,15 @@ public:
 
     void _dump() const;
 
+    /**
+     * Goes up every time an event is inserted or deleted,
+     * so that copies of the track data can tell they are stale.
+     */
+    uint32_t getChangeCount() const
+    {
+        return changeCount;
+    }
+
     /**
      * factory method to generate test content.
      */
@@ -117,6 +145,21 @@ public:
 private:
     container events;
 
+    /**
+     * The notes, sorted by start time, as an implicit binary tree:
+     * the root of the range [lo, hi) is at (lo + hi) / 2.
+     * noteIndexMaxEnd[i] is the latest end time of any note in the subtree at i,
+     * so whole subtrees that end before a query can be skipped.
+     */
+    mutable std::vector<MidiNoteEventPtr> noteIndex;
+    mutable std::vector<MidiEvent::time_t> noteIndexMaxEnd;
+    mutable bool noteIndexDirty = true;
+    uint32_t changeCount = 0;
+
+    void buildNoteIndex() const;
+    MidiEvent::time_t buildNoteIndexMaxEnd(int lo, int hi) const;
+    void queryNoteIndex(int lo, int hi, MidiEvent::time_t start, MidiEvent::time_t end, std::vector<MidiNoteEventPtr>& notes) const;
+
     static MidiTrackPtr makeTest1(std::shared_ptr<MidiLock>);
     static MidiTrackPtr makeTestCmaj(std::shared_ptr<MidiLock>);
   //  static MidiTrackPtr makeTestEmpty(std::shared_ptr<MidiLock>);
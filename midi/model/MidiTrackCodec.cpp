@@ -0,0 +1,389 @@
+
+#include "MidiLock.h"
+#include "MidiTrack.h"
+#include "MidiTrackCodec.h"
+#include "PitchUtils.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <string.h>
+
+// flags byte
+static const uint8_t typeMask = 0x03;
+static const uint8_t typeNote = 1;
+static const uint8_t typeEnd = 2;
+static const uint8_t rawStart = 0x04;
+static const uint8_t rawPitch = 0x08;
+static const uint8_t rawDuration = 0x10;
+static const uint8_t knownFlags = typeMask | rawStart | rawPitch | rawDuration;
+
+// pitches are stored relative to 0V, so the usual range fits in one byte
+static const int semitoneZero = 48;
+
+// well past any real track length, and small enough to be exact in a double
+static const int64_t maxTicks = int64_t(1) << 40;
+
+/**
+ * Appends to the buffer.
+ */
+class Writer
+{
+public:
+    std::vector<uint8_t> data;
+
+    void writeByte(uint8_t x)
+    {
+        data.push_back(x);
+    }
+
+    void writeVarint(uint64_t x)
+    {
+        while (x >= 0x80) {
+            data.push_back(uint8_t(x | 0x80));
+            x >>= 7;
+        }
+        data.push_back(uint8_t(x));
+    }
+
+    void writeFloat(float x)
+    {
+        uint32_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        for (int i = 0; i < 4; ++i) {
+            data.push_back(uint8_t(bits >> (8 * i)));
+        }
+    }
+};
+
+/**
+ * Reads from the buffer. After any read goes past the end,
+ * ok is false and the values read are zero.
+ */
+class Reader
+{
+public:
+    Reader(const uint8_t* data, size_t size) : p(data), end(data + size)
+    {
+    }
+
+    bool ok = true;
+
+    bool atEnd() const
+    {
+        return p == end;
+    }
+
+    uint8_t readByte()
+    {
+        if (p == end) {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+
+    uint64_t readVarint()
+    {
+        uint64_t ret = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t x = readByte();
+            ret |= uint64_t(x & 0x7f) << shift;
+            if (!(x & 0x80)) {
+                return ret;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+
+    float readFloat()
+    {
+        uint32_t bits = 0;
+        for (int i = 0; i < 4; ++i) {
+            bits |= uint32_t(readByte()) << (8 * i);
+        }
+        float ret;
+        memcpy(&ret, &bits, sizeof(ret));
+        return ret;
+    }
+private:
+    const uint8_t* p;
+    const uint8_t* const end;
+};
+
+static int64_t timeToTicks(float time)
+{
+    return std::llround(double(time) * MidiTrackCodec::ticksPerQuarter);
+}
+
+static float ticksToTime(int64_t ticks)
+{
+    return float(double(ticks) / MidiTrackCodec::ticksPerQuarter);
+}
+
+/**
+ * @returns true if time is exactly on the tick grid, with ticks filled in.
+ */
+static bool isOnGrid(float time, int64_t& ticks)
+{
+    if (!(time >= 0) || time > float(maxTicks / MidiTrackCodec::ticksPerQuarter)) {
+        return false;
+    }
+    ticks = timeToTicks(time);
+    return ticksToTime(ticks) == time;
+}
+
+static uint64_t zigZag(int64_t x)
+{
+    return (uint64_t(x) << 1) ^ uint64_t(x >> 63);
+}
+
+static int64_t unZigZag(uint64_t x)
+{
+    return int64_t(x >> 1) ^ -int64_t(x & 1);
+}
+
+std::vector<uint8_t> MidiTrackCodec::encodeBinary(const MidiTrack& track)
+{
+    Writer w;
+    w.writeByte(version);
+    w.writeVarint(track.size());
+
+    int64_t prevTicks = 0;
+    for (auto it : track) {
+        const MidiEventPtr ev = it.second;
+        const MidiNoteEvent* note = nullptr;
+        uint8_t flags = 0;
+        if (ev->type == MidiEvent::Type::Note) {
+            note = static_cast<const MidiNoteEvent*>(ev.get());
+            flags = typeNote;
+        } else {
+            assert(ev->type == MidiEvent::Type::End);
+            flags = typeEnd;
+        }
+
+        int64_t startTicks = 0;
+        const bool startOnGrid = isOnGrid(ev->startTime, startTicks) && (startTicks >= prevTicks);
+        if (!startOnGrid) {
+            flags |= rawStart;
+        }
+
+        int semitone = 0;
+        int64_t durationTicks = 0;
+        if (note) {
+            semitone = PitchUtils::cvToSemitone(note->pitchCV);
+            if (PitchUtils::semitoneToCV(semitone) != note->pitchCV) {
+                flags |= rawPitch;
+            }
+            if (!isOnGrid(note->duration, durationTicks)) {
+                flags |= rawDuration;
+            }
+        }
+
+        w.writeByte(flags);
+        if (startOnGrid) {
+            w.writeVarint(uint64_t(startTicks - prevTicks));
+        } else {
+            w.writeFloat(ev->startTime);
+        }
+        if (note) {
+            if (flags & rawPitch) {
+                w.writeFloat(note->pitchCV);
+            } else {
+                w.writeVarint(zigZag(semitone - semitoneZero));
+            }
+            if (flags & rawDuration) {
+                w.writeFloat(note->duration);
+            } else {
+                w.writeVarint(uint64_t(durationTicks));
+            }
+        }
+
+        // same as the decoder does, so raw times on the grid still move prevTicks along
+        if (isOnGrid(ev->startTime, startTicks)) {
+            prevTicks = std::max(prevTicks, startTicks);
+        }
+    }
+    return w.data;
+}
+
+std::string MidiTrackCodec::decodeBinary(const uint8_t* data, size_t size, MidiTrackPtr track)
+{
+    assert(track->lock->locked());
+    if (track->size() != 0) {
+        return "track not empty";
+    }
+
+    Reader r(data, size);
+    const uint8_t ver = r.readByte();
+    if (r.ok && ver != version) {
+        return "unknown track version " + std::to_string(ver);
+    }
+    const uint64_t count = r.readVarint();
+    if (!r.ok || count == 0 || count > size) {
+        return "bad event count";
+    }
+
+    int64_t prevTicks = 0;
+    bool sawEnd = false;
+    for (uint64_t i = 0; i < count; ++i) {
+        const uint8_t flags = r.readByte();
+        const uint8_t type = flags & typeMask;
+        if ((flags & ~knownFlags) || (type != typeNote && type != typeEnd)) {
+            return "bad event flags";
+        }
+        if (sawEnd) {
+            return "events after end";
+        }
+
+        float startTime = 0;
+        if (flags & rawStart) {
+            startTime = r.readFloat();
+        } else {
+            const uint64_t delta = r.readVarint();
+            if (delta > uint64_t(maxTicks)) {
+                return "bad start time";
+            }
+            startTime = ticksToTime(prevTicks + int64_t(delta));
+        }
+        if (!std::isfinite(startTime) || startTime < 0) {
+            return "bad start time";
+        }
+        int64_t startTicks = 0;
+        if (isOnGrid(startTime, startTicks)) {
+            prevTicks = std::max(prevTicks, startTicks);
+        }
+
+        MidiEventPtr ev;
+        if (type == typeNote) {
+            auto note = std::make_shared<MidiNoteEvent>();
+            if (flags & rawPitch) {
+                note->pitchCV = r.readFloat();
+            } else {
+                const int64_t semitone = unZigZag(r.readVarint()) + semitoneZero;
+                if (semitone < -1000 || semitone > 1000) {
+                    return "bad pitch";
+                }
+                note->pitchCV = PitchUtils::semitoneToCV(int(semitone));
+            }
+            if (flags & rawDuration) {
+                note->duration = r.readFloat();
+            } else {
+                const uint64_t ticks = r.readVarint();
+                if (ticks > uint64_t(maxTicks)) {
+                    return "bad duration";
+                }
+                note->duration = ticksToTime(int64_t(ticks));
+            }
+            if (!std::isfinite(note->pitchCV) || !(note->duration > 0)) {
+                return "bad note";
+            }
+            ev = note;
+        } else {
+            ev = std::make_shared<MidiEndEvent>();
+            sawEnd = true;
+        }
+        if (!r.ok) {
+            return "track data truncated";
+        }
+        ev->startTime = startTime;
+        track->appendEvent(ev);
+    }
+
+    if (!sawEnd) {
+        return "track has no end";
+    }
+    if (!r.atEnd()) {
+        return "extra data after track";
+    }
+    return "";
+}
+
+std::string MidiTrackCodec::encode(const MidiTrack& track)
+{
+    return toBase64(encodeBinary(track));
+}
+
+std::string MidiTrackCodec::decode(const std::string& data, MidiTrackPtr track)
+{
+    std::vector<uint8_t> binary;
+    if (!fromBase64(data, binary)) {
+        return "track data not base64";
+    }
+    return decodeBinary(binary.data(), binary.size(), track);
+}
+
+static const char* const base64Chars =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string MidiTrackCodec::toBase64(const std::vector<uint8_t>& data)
+{
+    std::string ret;
+    ret.reserve(4 * ((data.size() + 2) / 3));
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        const uint32_t x = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        ret += base64Chars[(x >> 18) & 63];
+        ret += base64Chars[(x >> 12) & 63];
+        ret += base64Chars[(x >> 6) & 63];
+        ret += base64Chars[x & 63];
+    }
+    const size_t left = data.size() - i;
+    if (left) {
+        uint32_t x = data[i] << 16;
+        if (left == 2) {
+            x |= data[i + 1] << 8;
+        }
+        ret += base64Chars[(x >> 18) & 63];
+        ret += base64Chars[(x >> 12) & 63];
+        ret += (left == 2) ? base64Chars[(x >> 6) & 63] : '=';
+        ret += '=';
+    }
+    return ret;
+}
+
+bool MidiTrackCodec::fromBase64(const std::string& str, std::vector<uint8_t>& out)
+{
+    out.clear();
+    if (str.size() % 4) {
+        return false;
+    }
+    out.reserve(3 * (str.size() / 4));
+
+    auto decodeChar = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    };
+
+    for (size_t i = 0; i < str.size(); i += 4) {
+        const bool last = (i + 4 == str.size());
+        int padding = 0;
+        uint32_t x = 0;
+        for (int j = 0; j < 4; ++j) {
+            const char c = str[i + j];
+            int value = 0;
+            if (c == '=' && last && j >= 2) {
+                ++padding;
+            } else {
+                value = decodeChar(c);
+                if (value < 0 || padding) {
+                    return false;
+                }
+            }
+            x = (x << 6) | uint32_t(value);
+        }
+        out.push_back(uint8_t(x >> 16));
+        if (padding < 2) {
+            out.push_back(uint8_t(x >> 8));
+        }
+        if (padding < 1) {
+            out.push_back(uint8_t(x));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,26 @@
+
+#include "MidiTrack.h"
+#include "MidiTrackSchedule.h"
+
+#include <assert.h>
+
+MidiTrackSchedule::MidiTrackSchedule(const MidiTrack& tk, uint32_t ser) :
+    track(&tk),
+    changeCount(tk.getChangeCount()),
+    serial(ser)
+{
+    events.reserve(tk.size());
+    for (const auto& it : tk) {
+        const MidiEvent* ev = it.second.get();
+        Event sch = {it.first, 0, 0, false};
+        if (ev->type == MidiEvent::Type::Note) {
+            const MidiNoteEvent* note = static_cast<const MidiNoteEvent*>(ev);
+            sch.pitchCV = note->pitchCV;
+            sch.duration = note->duration;
+        } else {
+            assert(ev->type == MidiEvent::Type::End);
+            sch.isEnd = true;
+        }
+        events.push_back(sch);
+    }
+}
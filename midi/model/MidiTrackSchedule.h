@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+class MidiTrack;
+
+/**
+ * The events of one 4X4 section, copied out of the MidiTrack
+ * into a flat array, in time order.
+ *
+ * Playback just advances an index through it, rather than walking
+ * the track's multimap and copying shared_ptrs.
+ *
+ * Built on the UI thread by MidiSong4, never by the player.
+ */
+class MidiTrackSchedule
+{
+public:
+    struct Event
+    {
+        float startTime;
+        float pitchCV;
+        float duration;
+        bool isEnd;
+    };
+
+    /**
+     * @param serial is unique for every schedule of a song, so the
+     * player can tell when its schedule has been replaced.
+     */
+    MidiTrackSchedule(const MidiTrack&, uint32_t serial);
+
+    /**
+     * In a valid track the last event is the end.
+     */
+    std::vector<Event> events;
+
+    /**
+     * False if the track isn't finished, so there is nothing to play.
+     */
+    bool isPlayable() const
+    {
+        return !events.empty() && events.back().isEnd;
+    }
+
+    /**
+     * The track, and its change count, that we were made from.
+     */
+    const MidiTrack* const track;
+    const uint32_t changeCount;
+    const uint32_t serial;
+};
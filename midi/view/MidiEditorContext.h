@@ -132,6 +132,13 @@ public:
     iterator_pair getEvents(float preMargin) const;
     iterator_pair getEvents(float timeLow, float timeHigh, float pitchLow, float pitchHigh) const;
 
+    /**
+     * Gets all the notes that are visible in the edit context, in start time order.
+     * Unlike getEvents, this includes notes that start before the
+     * edit context and are still sounding in it, however long they are.
+     */
+    void getVisibleNotes(std::vector<MidiNoteEventPtr>& notes) const;
+
     std::shared_ptr<MidiSong> getSong() const;
 
     void scrollVertically(float pitchCV);
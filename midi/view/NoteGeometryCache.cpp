@@ -0,0 +1,58 @@
+#include "NoteGeometryCache.h"
+
+#include "MidiEditorContext.h"
+#include "MidiLock.h"
+#include "MidiSelectionModel.h"
+#include "NoteScreenScale.h"
+
+bool NoteGeometryCache::Key::operator == (const Key& other) const
+{
+    return track == other.track &&
+        selection == other.selection &&
+        scaler == other.scaler &&
+        editCount == other.editCount &&
+        selectionGeneration == other.selectionGeneration &&
+        startTime == other.startTime &&
+        endTime == other.endTime &&
+        pitchLow == other.pitchLow &&
+        pitchHigh == other.pitchHigh;
+}
+
+bool NoteGeometryCache::update(std::shared_ptr<MidiEditorContext> context, std::shared_ptr<MidiSelectionModel> selection)
+{
+    auto track = context->getTrack();
+    auto scaler = context->getScaler();
+    assert(track);
+    assert(scaler);
+
+    Key newKey;
+    newKey.track = track.get();
+    newKey.selection = selection.get();
+    newKey.scaler = scaler.get();
+    newKey.editCount = track->lock->getEditCount();
+    newKey.selectionGeneration = selection->getGeneration();
+    newKey.startTime = context->startTime();
+    newKey.endTime = context->endTime();
+    newKey.pitchLow = context->pitchLow();
+    newKey.pitchHigh = context->pitchHigh();
+
+    if (valid && (newKey == key)) {
+        return false;
+    }
+
+    key = newKey;
+    valid = true;
+    noteHeight = scaler->noteHeight();
+
+    context->getVisibleNotes(visibleNotes);
+    geometry.resize(visibleNotes.size());
+    for (size_t i = 0; i < visibleNotes.size(); ++i) {
+        const MidiNoteEventPtr& note = visibleNotes[i];
+        NoteGeometry& g = geometry[i];
+        g.x = scaler->midiTimeToX(*note);
+        g.y = scaler->midiPitchToY(*note);
+        g.width = scaler->midiTimeTodX(note->duration);
+        g.selected = selection->isSelected(note);
+    }
+    return true;
+}
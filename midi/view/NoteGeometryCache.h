@@ -0,0 +1,87 @@
+#pragma once
+
+#include "SqMidiEvent.h"
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+class MidiEditorContext;
+class MidiSelectionModel;
+class MidiTrack;
+class NoteScreenScale;
+
+/**
+ * Holds the screen positions of all the visible notes, so the note editor
+ * doesn't have to query the track and map every note through NoteScreenScale
+ * on every frame.
+ *
+ * update() only does the work when something that affects the drawing has changed:
+ *      the track was edited (MidiLock::getEditCount)
+ *      the selection changed (MidiSelectionModel::getGeneration)
+ *      the viewport scrolled or zoomed.
+ * So an idle frame is just a few compares.
+ */
+class NoteGeometryCache
+{
+public:
+    class NoteGeometry
+    {
+    public:
+        float x = 0;
+        float y = 0;
+        float width = 0;
+        bool selected = false;
+    };
+
+    /**
+     * Brings the cache up to date.
+     * @returns true if the notes had to be re-calculated.
+     */
+    bool update(std::shared_ptr<MidiEditorContext>, std::shared_ptr<MidiSelectionModel>);
+
+    /**
+     * Forces the next update to re-calculate.
+     */
+    void invalidate()
+    {
+        valid = false;
+    }
+
+    const std::vector<NoteGeometry>& getNotes() const
+    {
+        return geometry;
+    }
+
+    float getNoteHeight() const
+    {
+        return noteHeight;
+    }
+
+private:
+    /**
+     * Everything that, if it changes, changes the drawing.
+     */
+    class Key
+    {
+    public:
+        const MidiTrack* track = nullptr;
+        const MidiSelectionModel* selection = nullptr;
+        const NoteScreenScale* scaler = nullptr;
+        uint32_t editCount = 0;
+        uint32_t selectionGeneration = 0;
+        float startTime = 0;
+        float endTime = 0;
+        float pitchLow = 0;
+        float pitchHigh = 0;
+
+        bool operator == (const Key&) const;
+    };
+
+    Key key;
+    bool valid = false;
+    float noteHeight = 0;
+
+    std::vector<MidiNoteEventPtr> visibleNotes;
+    std::vector<NoteGeometry> geometry;
+};
@@ -1,9 +1,13 @@
 #ifndef GENERATIVETRIGGERGENERATOR
 #define GENERATIVETRIGGERGENERATOR
 
+#include "CompiledGrammar.h"
 #include "StochasticGrammar.h"
 #include "TriggerSequencer.h"
 
+#include <memory>
+#include <random>
+
 /* Knows how to generate trigger sequence data
  * when evaluating a grammar
  */
@@ -42,19 +46,22 @@ private:
 
 /* wraps up some stochastic gnerative grammar stuff feeding
  * a trigger sequencer
+ *
+ * The grammar is compiled (CompiledGrammar) when it is set, so generating
+ * a new sequence is iterative, has a bounded cost, and doesn't allocate.
  */
 class GenerativeTriggerGenerator
 {
 public:
+    static const int maxEvents = 32;
+
     GenerativeTriggerGenerator(AudioMath::RandomUniformFunc r, const ProductionRule * rules, int numRules, GKEY initialState) :
-        _r(r),
-        _rules(rules),
-        _numRules(numRules),
-        _initKey(initialState)
+        _r(r)
     {
         _data[0].delay = 0;
         _data[0].evt = TriggerSequencer::END;
         _seq = new TriggerSequencer(_data);
+        setGrammar(rules, numRules, initialState);
     }
     ~GenerativeTriggerGenerator()
     {
@@ -62,11 +69,43 @@ public:
     }
 
 
+    /**
+     * Compiles the grammar, so it allocates.
+     */
     void setGrammar(const ProductionRule * rules, int numRules, GKEY initialState)
     {
-        _rules = rules;
-        _numRules = numRules;
-        _initKey = initialState;
+        auto grammar = std::make_shared<CompiledGrammar>();
+        grammar->compile(rules, numRules, initialState);
+        _grammar = grammar;
+    }
+
+    /**
+     * Use a grammar that is already compiled (for example, from a GrammarCache).
+     * Doesn't allocate, but caller must make sure this isn't the last
+     * reference to the old grammar if calling from the audio thread.
+     */
+    void setGrammar(CompiledGrammarPtr grammar)
+    {
+        assert(grammar && grammar->isCompiled());
+        _grammar = grammar;
+    }
+
+    CompiledGrammarPtr getGrammar() const
+    {
+        return _grammar;
+    }
+
+    /**
+     * Switch to a private random number generator with a known seed,
+     * so that the same seed always generates the same rhythms.
+     */
+    void seed(uint32_t s)
+    {
+        _seededGenerator.seed(s);
+        _r = [this]() {
+            // minstd_rand is 1..2147483646
+            return float((_seededGenerator() - 1) * (1.0 / 2147483646.0));
+        };
     }
 
     // returns true if trigger generated
@@ -84,20 +123,26 @@ public:
     }
 private:
     TriggerSequencer * _seq;
-    TriggerSequencer::Event _data[33];
+    TriggerSequencer::Event _data[maxEvents + 1];
+    GKEY _keys[maxEvents];
     AudioMath::RandomUniformFunc _r;
-    const ProductionRule * _rules;
-    int _numRules;
-    GKEY _initKey;
+    CompiledGrammarPtr _grammar;
+    std::minstd_rand _seededGenerator;
     //
     void generate()
     {
-        GTGEvaluator es(_r, _data);
-        es.rules = _rules;
-        es.numRules = _numRules;
-        ProductionRule::evaluate(es, _initKey);
+        const int numKeys = _grammar->generate(_r, _keys, maxEvents);
+
+        // each key is a trigger, after the duration of the one before it
+        int delay = 0;
+        for (int i = 0; i < numKeys; ++i) {
+            _data[i].evt = TriggerSequencer::TRIGGER;
+            _data[i].delay = delay;
+            delay = _grammar->getDuration(_keys[i]);
+        }
+        _data[numKeys].evt = TriggerSequencer::END;
+        _data[numKeys].delay = delay;
 
-        es.writeEnd();
         TriggerSequencer::isValid(_data);
         _seq->reset(_data);
         assert(!_seq->getEnd());
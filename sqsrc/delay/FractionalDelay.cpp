@@ -1,97 +1,208 @@
 #include "FractionalDelay.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <xmmintrin.h>
+#include <mmintrin.h>
 
-
-float FractionalDelay::getOutput()
+static int nextPowerOfTwo(int x)
 {
-#ifdef _LOG
-    printf("\n");
-#endif
-    int delayTimeSamples = (int) delayTime;
-    const double x = delayTime - delayTimeSamples;
-
-    const double y0 = getDelayedOutput(delayTimeSamples - 1);
-    const double y1 = getDelayedOutput(delayTimeSamples);
-    const double y2 = getDelayedOutput(delayTimeSamples + 1);
-    const double y3 = getDelayedOutput(delayTimeSamples + 2);
-#ifdef _LOG
-    printf("dt=%.2f, dts=%d x=%.2f ", delayTime, delayTimeSamples, x);
-    printf("y0=%.2f y1=%.2f y2=%.2f y3=%.2f\n", y0, y1, y2, y3);
-#endif
- 
-    const double x0 = -1.0;
-    const double x1 = 0.0;
-    const double x2 = 1.0;
-    const double x3 = 2.0;
-    assert(x >= x1);
-    assert(x <= x2);
-
-    double dRet = -(1.0 / 6.0)*y0*(x - x1)*(x - x2)*(x - x3);
-    dRet += (1.0 / 2.0)* y1*(x - x0) * (x - x2) * (x - x3);
-    dRet += (-1.0 / 2.0)*y2*(x - x0) * (x - x1) * (x - x3);
-    dRet += (1.0 / 6.0) * y3*(x - x0) * (x - x1) * (x - x2);
-
-#if 0
-    static int ct = 0;
-    if (++ct > 100) {
-        ct = 0;
-        char buf[500];
-        sprintf(buf, "del = %f int=%d, rem=%f ret=%f\n", time, delayTimeSamples, x, dRet);
-        DebugUtil::trace(buf);
-        sprintf(buf, "  y0=%f y1=%f y2=%f y3=%f\n", y0, y1, y2, y3);
-        DebugUtil::trace(buf);
-
-
+    int ret = 1;
+    while (ret < x) {
+        ret *= 2;
     }
-#endif
-
-    return float(dRet);
+    return ret;
+}
 
+// Room for the longest delay, plus the oldest Lagrange tap,
+// plus a block written ahead of the reads.
+FractionalDelay::FractionalDelay(int numSamples) :
+    numSamples(numSamples),
+    size(nextPowerOfTwo(numSamples + maxBlockSize + 4)),
+    mask(size - 1),
+    delayMemory(size + mirrorSize, 0.f)
+{
+    updateKernel();
 }
 
-float FractionalDelay::getDelayedOutput(int delaySamples)
+void FractionalDelay::clear()
 {
-    int index = inputPointerIndex;
+    std::fill(delayMemory.begin(), delayMemory.end(), 0.f);
+    allpassState = 0;
+}
 
-    index -= delaySamples;			// indexes increase as time goes by,
-                                    // to the output (in the past), is at a lower index
-    if (index < 0) {
-        //int n = state.numSamples'
-        index += numSamples;
+void FractionalDelay::setDelay(float samples)
+{
+    assert(samples < numSamples);
+    delayTime = samples;
+    updateKernel();
+}
 
-        assert(index >= 0 && index < numSamples);
-    }
-#ifdef _LOG
-    printf("getting output from area of %d\n", index);
-#endif
+void FractionalDelay::setInterpolation(Interpolation i)
+{
+    interpolation = i;
+    updateKernel();
+}
 
-    return delayMemory[index];
+void FractionalDelay::getLagrange3Coefficients(float x, float* coefficients)
+{
+    // the points are at -1, 0, 1, 2
+    assert(x >= 0);
+    assert(x <= 1);
+    coefficients[0] = -(1.f / 6.f) * x * (x - 1) * (x - 2);
+    coefficients[1] = (1.f / 2.f) * (x + 1) * (x - 1) * (x - 2);
+    coefficients[2] = (-1.f / 2.f) * (x + 1) * x * (x - 2);
+    coefficients[3] = (1.f / 6.f) * (x + 1) * x * (x - 1);
+}
 
+void FractionalDelay::updateKernel()
+{
+    int delayTimeSamples = (int) delayTime;
+    float x = delayTime - delayTimeSamples;
+
+    switch (interpolation) {
+        case Interpolation::Linear:
+            assert(delayTimeSamples >= 1 || delayTime == 0);
+            delayTimeSamples = std::max(delayTimeSamples, 1);
+            oldestTap = delayTimeSamples + 1;
+            minTap = delayTimeSamples;
+            coefficients[0] = x;
+            coefficients[1] = 1 - x;
+            break;
+        case Interpolation::Lagrange3:
+        {
+            assert(delayTimeSamples >= 2 || delayTime == 0);
+            delayTimeSamples = std::max(delayTimeSamples, 2);
+            oldestTap = delayTimeSamples + 2;
+            minTap = delayTimeSamples - 1;
+            float c[4];
+            getLagrange3Coefficients(x, c);
+            // memory goes from oldest to newest
+            for (int i = 0; i < 4; ++i) {
+                coefficients[i] = c[3 - i];
+            }
+        }
+            break;
+        case Interpolation::Allpass:
+            assert(delayTimeSamples >= 1 || delayTime == 0);
+            delayTimeSamples = std::max(delayTimeSamples, 1);
+            // keep the fractional part away from zero, where the pole is
+            // right on the unit circle.
+            if (x < .1f && delayTimeSamples > 1) {
+                --delayTimeSamples;
+                x += 1;
+            }
+            oldestTap = delayTimeSamples + 1;
+            minTap = delayTimeSamples;
+            coefficients[0] = getAllpassCoefficient(x);
+            break;
+    }
 }
 
-void FractionalDelay::setInput(float input)
+void FractionalDelay::getOutput(int writeIndex, float* output, int n)
 {
-    //printf("setting input at %d\n", inputPointerIndex);
-    delayMemory[inputPointerIndex++] = input;
-    if (inputPointerIndex >= numSamples) {
-        inputPointerIndex = 0;
+    assert(n <= maxBlockSize);
+    const float* p = getOldestTap(writeIndex);
+    int i = 0;
+    switch (interpolation) {
+        case Interpolation::Linear:
+        {
+            const __m128 c0 = _mm_set_ps1(coefficients[0]);
+            const __m128 c1 = _mm_set_ps1(coefficients[1]);
+            for (; i <= n - 4; i += 4) {
+                __m128 sum = _mm_mul_ps(c0, _mm_loadu_ps(p + i));
+                sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_loadu_ps(p + i + 1)));
+                _mm_storeu_ps(output + i, sum);
+            }
+            for (; i < n; ++i) {
+                output[i] = coefficients[0] * p[i] + coefficients[1] * p[i + 1];
+            }
+        }
+            break;
+        case Interpolation::Lagrange3:
+        {
+            const __m128 c0 = _mm_set_ps1(coefficients[0]);
+            const __m128 c1 = _mm_set_ps1(coefficients[1]);
+            const __m128 c2 = _mm_set_ps1(coefficients[2]);
+            const __m128 c3 = _mm_set_ps1(coefficients[3]);
+            for (; i <= n - 4; i += 4) {
+                __m128 sum = _mm_mul_ps(c0, _mm_loadu_ps(p + i));
+                sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_loadu_ps(p + i + 1)));
+                sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_loadu_ps(p + i + 2)));
+                sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_loadu_ps(p + i + 3)));
+                _mm_storeu_ps(output + i, sum);
+            }
+            for (; i < n; ++i) {
+                output[i] = coefficients[0] * p[i] + coefficients[1] * p[i + 1] +
+                    coefficients[2] * p[i + 2] + coefficients[3] * p[i + 3];
+            }
+        }
+            break;
+        case Interpolation::Allpass:
+        {
+            // recursive, so no SIMD here
+            const float a = coefficients[0];
+            float y = allpassState;
+            for (; i < n; ++i) {
+                y = a * (p[i + 1] - y) + p[i];
+                output[i] = y;
+            }
+            allpassState = y;
+        }
+            break;
     }
 }
 
+void FractionalDelay::setInput(const float* input, int n)
+{
+    while (n > 0) {
+        // copy up to the end of the memory, then wrap around
+        const int count = std::min(n, size - inputPointerIndex);
+        float* dest = delayMemory.data() + inputPointerIndex;
+        std::copy(input, input + count, dest);
+        if (inputPointerIndex < mirrorSize) {
+            const int mirrorCount = std::min(count, mirrorSize - inputPointerIndex);
+            std::copy(input, input + mirrorCount, dest + size);
+        }
+        inputPointerIndex = (inputPointerIndex + count) & mask;
+        input += count;
+        n -= count;
+    }
+}
 
-/*
-float run(float input)
+void FractionalDelay::run(const float* input, float* output, int n)
 {
-float ret = getOutput();
-setInput(input);
-return ret;
+    while (n > 0) {
+        const int blockSize = std::min(n, int(maxBlockSize));
+
+        // The delay line is long enough that we can write the whole
+        // block before reading it, so no need to look at the delay time.
+        const int writeIndex = getWriteIndex();
+        setInput(input, blockSize);
+        getOutput(writeIndex, output, blockSize);
+
+        input += blockSize;
+        output += blockSize;
+        n -= blockSize;
+    }
 }
-*/
-float RecirculatingFractionalDelay::run(float input)
+
+void RecirculatingFractionalDelay::run(const float* input, float* output, int n)
 {
-    float output = getOutput();
-    input += (output * feedback);
-    setInput(input);
-    return output;
+    float buffer[maxBlockSize];
+    assert(getMaxReadAhead() > 0);
+    while (n > 0) {
+        const int blockSize = std::min(n, std::min(int(maxBlockSize), getMaxReadAhead()));
+        getOutput(getWriteIndex(), buffer, blockSize);
+        for (int i = 0; i < blockSize; ++i) {
+            const float x = buffer[i];
+            buffer[i] = input[i] + x * feedback;
+            output[i] = x;
+        }
+        setInput(buffer, blockSize);
+
+        input += blockSize;
+        output += blockSize;
+        n -= blockSize;
+    }
 }
@@ -1,40 +1,90 @@
 #pragma once
 
 #include <assert.h>
-#include <memory>
+#include <vector>
 
 /**
+ * A delay line with a fractional (interpolated) delay time.
+ *
  * When ignoring wrap, inputIndex > outputIndex.
  * so output "pull up the rear", reading the samples that were written
- * delayTime samples ago.
+ * delayTime samples ago. The output is read before the input is written,
+ * so a delay of 10 means output(n) = input(n - 10).
+ *
+ * The memory is rounded up to a power of two, so wrapping is just a mask.
+ * The first (maxBlockSize + 3) samples are mirrored past the end of the memory,
+ * so reading a block is always contiguous. That lets the block functions
+ * use SSE without worrying about wrap.
+ *
+ * Interpolation kernels:
+ *  Linear:     cheapest. Rolls off the highs at fractional delays (-3 db at fs/4 for delay x.5).
+ *              Minimum delay 1.
+ *  Lagrange3:  four point Lagrange. Much flatter, a little roll off near nyquist.
+ *              This is what FractionalDelay always used. Minimum delay 2.
+ *  Allpass:    first order allpass (Thiran). Flat magnitude response, so it's the one to use
+ *              in a tuned feedback loop like Karplus-Strong. It has state, so it will
+ *              click a little if the delay jumps around a lot. Minimum delay 1.1.
+ *
+ * perf, recirculating, delay 168, -O3, ns per sample:
+ *      old double precision Lagrange:  8.7
+ *                  sample at a time    block of 64
+ *      Linear          3.4                 .7
+ *      Lagrange3       3.6                 1.0
+ *      Allpass         6.0                 4.2     (recursive, so no SIMD)
  */
 class FractionalDelay
 {
 public:
-    FractionalDelay(int numSamples) : numSamples(numSamples), delayMemory( new float[numSamples])
+    enum class Interpolation
     {
-        for (int i = 0; i < numSamples; ++i) {
-            delayMemory[i] = 0;
-        }
-    }
-    ~FractionalDelay()
-    {
-        delete[] delayMemory;
-    }
+        Linear,
+        Lagrange3,
+        Allpass
+    };
+
+    /**
+     * Longest block the block functions will process at once.
+     * Larger blocks are fine, they just get broken up.
+     */
+    static const int maxBlockSize = 64;
+
+    /**
+     * @param numSamples is the longest delay that will be used.
+     */
+    FractionalDelay(int numSamples);
+
+    void setDelay(float samples);
+    void setInterpolation(Interpolation);
+    void clear();
 
-    void setDelay(float samples)
-    {
-        assert(samples < numSamples);
-        delayTime = samples;
-    }
     float run(float input)
     {
         float ret = getOutput();
         setInput(input);
         return ret;
     }
+
+    /**
+     * output[i] is the same as run(input[i]) would give.
+     * In place (input == output) is ok.
+     */
+    void run(const float* input, float* output, int numSamples);
+
+    /**
+     * The coefficients for tap (d - 1), d, (d + 1), (d + 2)
+     * for a delay of d + x.
+     */
+    static void getLagrange3Coefficients(float x, float* coefficients);
+
+    /**
+     * For an allpass delay of x, which should be about .1 to 1.1
+     */
+    static float getAllpassCoefficient(float x)
+    {
+        return (1 - x) / (1 + x);
+    }
+
 protected:
-  
     /**
      * get the fractional delayed output, based in delayTime
      */
@@ -44,21 +94,69 @@ protected:
      * send the next input to the delay line
      */
     void setInput(float);
+
+    /**
+     * Read a block of outputs, as if the write pointer was at writeIndex.
+     * The taps must all be in the past, so numSamples can't be more than
+     * getMaxReadAhead() unless the block has already been written.
+     */
+    void getOutput(int writeIndex, float* output, int numSamples);
+
+    void setInput(const float* input, int numSamples);
+
+    /**
+     * How many outputs can be read before they depend on inputs that
+     * haven't been written yet.
+     */
+    int getMaxReadAhead() const
+    {
+        return minTap;
+    }
+
+    int getWriteIndex() const
+    {
+        return inputPointerIndex;
+    }
+
 private:
     /**
-     * get delay output with integer (non-fractional) delay time
+     * delay to the oldest tap the kernel uses.
+     * the kernel reads (oldestTap + 1 - minTap) contiguous samples.
      */
-    float getDelayedOutput(int delaySamples);
+    int oldestTap = 0;
+    int minTap = 0;
 
-    double delayTime = 0;
+    /**
+     * Lagrange and linear coefficients, from the oldest tap to the newest.
+     * Allpass uses coefficients[0].
+     */
+    float coefficients[4] = {0};
+    float allpassState = 0;
+
+    float delayTime = 0;
+    Interpolation interpolation = Interpolation::Lagrange3;
     int inputPointerIndex = 0;
 
     /**
-     * The size of the delay line, in samples
+     * The largest delay we will be asked for, in samples
      */
     const int numSamples;
 
-    float* delayMemory;
+    /**
+     * size of the delay memory (not counting the mirror). Always a power of two.
+     */
+    const int size;
+    const int mask;
+    std::vector<float> delayMemory;
+
+    static const int mirrorSize = maxBlockSize + 3;
+
+    void updateKernel();
+
+    const float* getOldestTap(int writeIndex) const
+    {
+        return delayMemory.data() + ((writeIndex - oldestTap) & mask);
+    }
 };
 
 class RecirculatingFractionalDelay : public FractionalDelay
@@ -67,22 +165,58 @@ public:
     RecirculatingFractionalDelay(int numSamples) : FractionalDelay(numSamples)
     {
     }
-#if 0
-    void setDelay(float samples)
-    {
-        delay.setDelay(samples);
-    }
-#endif
+
     void setFeedback(float in_feedback)
     {
-        assert(feedback < 1);
-        assert(feedback > -1);
+        assert(in_feedback < 1);
+        assert(in_feedback > -1);
         feedback = in_feedback;
     }
 
     float run(float);
+
+    /**
+     * Block version. The output feeds back, so if the delay is
+     * short the block gets processed in pieces of the delay time.
+     */
+    void run(const float* input, float* output, int numSamples);
 private:
-  //  FractionalDelay delay;
     float feedback = 0;
 };
 
+inline void FractionalDelay::setInput(float input)
+{
+    delayMemory[inputPointerIndex] = input;
+    if (inputPointerIndex < mirrorSize) {
+        delayMemory[inputPointerIndex + size] = input;
+    }
+    inputPointerIndex = (inputPointerIndex + 1) & mask;
+}
+
+inline float FractionalDelay::getOutput()
+{
+    const float* p = getOldestTap(inputPointerIndex);
+    float ret = 0;
+    switch (interpolation) {
+        case Interpolation::Linear:
+            ret = coefficients[0] * p[0] + coefficients[1] * p[1];
+            break;
+        case Interpolation::Lagrange3:
+            ret = coefficients[0] * p[0] + coefficients[1] * p[1] +
+                coefficients[2] * p[2] + coefficients[3] * p[3];
+            break;
+        case Interpolation::Allpass:
+            ret = coefficients[0] * (p[1] - allpassState) + p[0];
+            allpassState = ret;
+            break;
+    }
+    return ret;
+}
+
+inline float RecirculatingFractionalDelay::run(float input)
+{
+    float output = getOutput();
+    input += (output * feedback);
+    setInput(input);
+    return output;
+}
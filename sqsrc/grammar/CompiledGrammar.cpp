@@ -0,0 +1,105 @@
+
+#include "CompiledGrammar.h"
+
+CompiledGrammar::CompiledGrammar()
+{
+    durations[sg_invalid] = 0;
+    for (GKEY key = sg_first; key <= sg_last; ++key) {
+        durations[key] = ProductionRuleKeys::getDuration(key);
+    }
+}
+
+void CompiledGrammar::compile(const ProductionRule * rules, int numRules, GKEY first)
+{
+    assert(numRules == fullRuleTableSize);
+    assert(first >= sg_first && first <= sg_last);
+    for (int i = 0; i < fullRuleTableSize; ++i) {
+        compiledRules[i].numProductions = 0;
+    }
+    firstRule = first;
+    compileRule(rules, first);
+}
+
+void CompiledGrammar::compileRule(const ProductionRule * rules, GKEY key)
+{
+    CompiledRule& rule = compiledRules[key];
+    if (rule.numProductions > 0) {
+        return;         // already done
+    }
+
+    // entries hold cumulative probabilities, up to 1.
+    float probabilities[maxProductions];
+    float last = 0;
+    int n = 0;
+    for (bool done = false; !done; ++n) {
+        assert(n < maxProductions);
+        const ProductionRuleEntry& entry = rules[key].entries[n];
+        probabilities[n] = entry.probability - last;
+        last = entry.probability;
+        done = (entry.probability >= 1) || (n == maxProductions - 1);
+
+        GKEY * keys = rule.keys[n];
+        if (entry.code == sg_invalid) {
+            keys[0] = sg_invalid;
+        } else {
+            ProductionRuleKeys::breakDown(entry.code, keys);
+        }
+    }
+    rule.numProductions = n;
+    makeAliasTable(rule, probabilities);
+
+    // now everything this rule can produce
+    for (int i = 0; i < n; ++i) {
+        for (const GKEY * p = rule.keys[i]; *p != sg_invalid; ++p) {
+            compileRule(rules, *p);
+        }
+    }
+}
+
+/**
+ * Vose's alias method.
+ */
+void CompiledGrammar::makeAliasTable(CompiledRule& rule, const float * probabilities)
+{
+    const int n = rule.numProductions;
+    float scaled[maxProductions];
+    int small[maxProductions];
+    int large[maxProductions];
+    int numSmall = 0;
+    int numLarge = 0;
+
+    for (int i = 0; i < n; ++i) {
+        scaled[i] = probabilities[i] * n;
+        if (scaled[i] < 1) {
+            small[numSmall++] = i;
+        } else {
+            large[numLarge++] = i;
+        }
+    }
+
+    while (numSmall > 0 && numLarge > 0) {
+        const int s = small[--numSmall];
+        const int l = large[--numLarge];
+        rule.threshold[s] = scaled[s];
+        rule.alias[s] = uint8_t(l);
+
+        scaled[l] = (scaled[l] + scaled[s]) - 1;
+        if (scaled[l] < 1) {
+            small[numSmall++] = l;
+        } else {
+            large[numLarge++] = l;
+        }
+    }
+
+    // whatever is left over is (within rounding) a sure thing
+    while (numLarge > 0) {
+        const int l = large[--numLarge];
+        rule.threshold[l] = 1;
+        rule.alias[l] = uint8_t(l);
+    }
+    while (numSmall > 0) {
+        const int s = small[--numSmall];
+        rule.threshold[s] = 1;
+        rule.alias[s] = uint8_t(s);
+    }
+}
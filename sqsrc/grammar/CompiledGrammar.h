@@ -0,0 +1,140 @@
+#pragma once
+
+#include "StochasticGrammar.h"
+
+#include <assert.h>
+#include <memory>
+#include <stdint.h>
+
+/* class CompiledGrammar
+ *
+ * A grammar (table of ProductionRules) compiled for fast evaluation.
+ *
+ * Each rule becomes an alias table, so picking a production is one random
+ * number and one compare, no matter how many entries the rule has.
+ * Each production is stored already broken down into its keys, so
+ * evaluation doesn't need ProductionRuleKeys::breakDown.
+ *
+ * Evaluation is iterative, with a fixed size stack, so it never allocates
+ * and doesn't recurse. Output goes into a caller supplied buffer.
+ *
+ * Produces the same language as ProductionRule::evaluate, with the same probabilities.
+ */
+class CompiledGrammar
+{
+public:
+    static const int maxProductions = ProductionRule::numEntries;
+    static const int maxKeysPerProduction = ProductionRuleKeys::bufferSize;
+    static const int maxStackDepth = 64;
+
+    CompiledGrammar();
+
+    /**
+     * Compile all the rules reachable from firstRule.
+     * Can be called as often as needed, doesn't allocate.
+     */
+    void compile(const ProductionRule * rules, int numRules, GKEY firstRule);
+
+    /**
+     * Expand the grammar once.
+     * @param random is called as float random(), and must return uniform 0..1.
+     * @param output gets the terminal keys, in time order.
+     * @returns the number of keys written to output.
+     */
+    template <typename R>
+    int generate(R& random, GKEY * output, int maxOutput) const;
+
+    bool isCompiled() const
+    {
+        return firstRule != sg_invalid;
+    }
+
+    /**
+     * Duration in clocks of a key, same as ProductionRuleKeys::getDuration.
+     * But it's just a table lookup.
+     */
+    int getDuration(GKEY key) const
+    {
+        assert(key < fullRuleTableSize);
+        return durations[key];
+    }
+
+private:
+    class CompiledRule
+    {
+    public:
+        int numProductions = 0;
+
+        // the alias table
+        float threshold[maxProductions];
+        uint8_t alias[maxProductions];
+
+        // zero terminated keys for each production. An empty
+        // list means the rule terminates on its own key.
+        GKEY keys[maxProductions][maxKeysPerProduction];
+    };
+
+    CompiledRule compiledRules[fullRuleTableSize];
+    int durations[fullRuleTableSize];
+    GKEY firstRule = sg_invalid;
+
+    void compileRule(const ProductionRule * rules, GKEY key);
+    static void makeAliasTable(CompiledRule& rule, const float * probabilities);
+
+    template <typename R>
+    static int pickProduction(const CompiledRule& rule, R& random);
+};
+
+using CompiledGrammarPtr = std::shared_ptr<const CompiledGrammar>;
+
+template <typename R>
+inline int CompiledGrammar::pickProduction(const CompiledRule& rule, R& random)
+{
+    const int n = rule.numProductions;
+    if (n == 1) {
+        return 0;
+    }
+    const float x = random() * n;
+    int i = int(x);
+    if (i >= n) {
+        i = n - 1;
+    }
+    return ((x - i) < rule.threshold[i]) ? i : rule.alias[i];
+}
+
+template <typename R>
+inline int CompiledGrammar::generate(R& random, GKEY * output, int maxOutput) const
+{
+    assert(isCompiled());
+
+    GKEY stack[maxStackDepth];
+    int stackSize = 0;
+    int outputSize = 0;
+
+    stack[stackSize++] = firstRule;
+    while (stackSize > 0) {
+        const GKEY key = stack[--stackSize];
+        const CompiledRule& rule = compiledRules[key];
+        assert(rule.numProductions > 0);
+
+        const GKEY * keys = rule.keys[pickProduction(rule, random)];
+        if (*keys == sg_invalid) {
+            // terminal
+            assert(outputSize < maxOutput);
+            if (outputSize < maxOutput) {
+                output[outputSize++] = key;
+            }
+        } else {
+            // push in reverse, so the first one is evaluated first
+            int numKeys = 0;
+            while (keys[numKeys] != sg_invalid) {
+                ++numKeys;
+            }
+            assert(stackSize + numKeys <= maxStackDepth);
+            for (int i = numKeys - 1; i >= 0; --i) {
+                stack[stackSize++] = keys[i];
+            }
+        }
+    }
+    return outputSize;
+}
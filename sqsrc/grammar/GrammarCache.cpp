@@ -0,0 +1,120 @@
+
+#include "GrammarCache.h"
+
+#include <sstream>
+
+uint64_t GrammarCache::hash(const std::string& text)
+{
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for (char c : text) {
+        h ^= uint8_t(c);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+CompiledGrammarPtr GrammarCache::find(uint64_t h) const
+{
+    auto it = grammars.find(h);
+    return (it == grammars.end()) ? nullptr : it->second.grammar;
+}
+
+CompiledGrammarPtr GrammarCache::get(const std::string& text, const Parser& parser, std::string& error)
+{
+    error.clear();
+    const uint64_t h = hash(text);
+    auto it = grammars.find(h);
+    if (it != grammars.end() && it->second.text == text) {
+        return it->second.grammar;
+    }
+
+    ProductionRule rules[fullRuleTableSize];
+    GKEY firstRule = sg_invalid;
+    error = parser(text, rules, firstRule);
+    if (error.empty()) {
+        error = validate(rules, fullRuleTableSize, firstRule);
+    }
+    if (!error.empty()) {
+        return nullptr;
+    }
+
+    auto grammar = std::make_shared<CompiledGrammar>();
+    grammar->compile(rules, fullRuleTableSize, firstRule);
+
+    Entry& entry = grammars[h];
+    entry.text = text;
+    entry.grammar = grammar;
+    return grammar;
+}
+
+std::string GrammarCache::validate(const ProductionRule * rules, int numRules, GKEY firstRule)
+{
+    std::stringstream s;
+    if (numRules != fullRuleTableSize) {
+        s << "bad number of rules: " << numRules;
+        return s.str();
+    }
+    if (firstRule < sg_first || firstRule > sg_last) {
+        s << "bad first rule: " << firstRule;
+        return s.str();
+    }
+
+    bool visited[fullRuleTableSize] = {false};
+    GKEY toVisit[fullRuleTableSize];
+    int numToVisit = 0;
+    toVisit[numToVisit++] = firstRule;
+    visited[firstRule] = true;
+
+    while (numToVisit > 0) {
+        const GKEY key = toVisit[--numToVisit];
+        const ProductionRule& rule = rules[key];
+        if (rule.entries[0] == ProductionRuleEntry()) {
+            s << "rule " << ProductionRuleKeys::toString(key) << " is used, but has no productions";
+            return s.str();
+        }
+
+        float last = 0;
+        bool foundTerminator = false;
+        for (int i = 0; !foundTerminator; ++i) {
+            if (i >= ProductionRule::numEntries) {
+                s << "probabilities for rule " << ProductionRuleKeys::toString(key) << " don't add up to 1";
+                return s.str();
+            }
+            const ProductionRuleEntry& e = rule.entries[i];
+            if (e.probability <= last || e.probability > 1) {
+                s << "bad probability in rule " << ProductionRuleKeys::toString(key);
+                return s.str();
+            }
+            last = e.probability;
+            foundTerminator = (e.probability == 1);
+
+            if (e.code == sg_invalid) {
+                continue;           // terminates on itself
+            }
+            if (e.code > sg_last) {
+                s << "rule " << ProductionRuleKeys::toString(key) << " has bad code " << e.code;
+                return s.str();
+            }
+            if (ProductionRuleKeys::getDuration(e.code) != ProductionRuleKeys::getDuration(key)) {
+                s << "rule " << ProductionRuleKeys::toString(key) << " -> " <<
+                    ProductionRuleKeys::toString(e.code) << " does not conserve time";
+                return s.str();
+            }
+
+            GKEY keys[ProductionRuleKeys::bufferSize];
+            ProductionRuleKeys::breakDown(e.code, keys);
+            for (GKEY * p = keys; *p != sg_invalid; ++p) {
+                if (*p == key) {
+                    s << "rule " << ProductionRuleKeys::toString(key) << " produces itself";
+                    return s.str();
+                }
+                if (!visited[*p]) {
+                    visited[*p] = true;
+                    toVisit[numToVisit++] = *p;
+                }
+            }
+        }
+    }
+    return "";
+}
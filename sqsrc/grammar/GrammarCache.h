@@ -0,0 +1,75 @@
+#pragma once
+
+#include "CompiledGrammar.h"
+#include "StochasticGrammar.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+/* class GrammarCache
+ *
+ * Holds grammars that were loaded from text (for example a user's JSON file),
+ * already validated and compiled, keyed by a hash of the text.
+ *
+ * Loading the same text again just returns the cached grammar, so flipping
+ * between grammars doesn't re-parse or re-compile.
+ *
+ * The cache keeps a reference to every grammar it hands out, so the audio
+ * thread will never be the one to free a grammar. All of the calls
+ * here may allocate, so they belong on the UI thread.
+ */
+class GrammarCache
+{
+public:
+    /**
+     * A parser fills in the rules and first rule from the text.
+     * The rules come in cleared.
+     * @returns an empty string on success, otherwise an error message.
+     */
+    using Parser = std::function<std::string(const std::string& text, ProductionRule * rules, GKEY& firstRule)>;
+
+    /**
+     * Get the compiled grammar for text, parsing, validating and compiling it
+     * if it isn't in the cache.
+     * @param error gets the error message if the text can't be parsed or isn't
+     *      a valid grammar. Then the return value is null.
+     */
+    CompiledGrammarPtr get(const std::string& text, const Parser& parser, std::string& error);
+
+    /**
+     * Find a grammar that is already in the cache.
+     * @returns null if not found.
+     */
+    CompiledGrammarPtr find(uint64_t hash) const;
+
+    size_t size() const
+    {
+        return grammars.size();
+    }
+
+    void clear()
+    {
+        grammars.clear();
+    }
+
+    static uint64_t hash(const std::string& text);
+
+    /**
+     * Makes sure every rule reachable from firstRule is complete, and conserves time.
+     * Unlike ProductionRule::isGrammarValid, this is always available (not just in debug).
+     * @returns an empty string if OK, otherwise an error message.
+     */
+    static std::string validate(const ProductionRule * rules, int numRules, GKEY firstRule);
+
+private:
+    class Entry
+    {
+    public:
+        std::string text;
+        CompiledGrammarPtr grammar;
+    };
+    std::map<uint64_t, Entry> grammars;
+};
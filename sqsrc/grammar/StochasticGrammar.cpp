@@ -1,6 +1,7 @@
 
 #include "StochasticGrammar.h"
 #include <random>
+#include <string.h>
 
 #if 0
 // eventually get rid of this global random generator
@@ -160,6 +161,16 @@ const char * ProductionRuleKeys::toString(GKEY key)
     return ret;
 }
 
+GKEY ProductionRuleKeys::fromString(const char * str)
+{
+    for (GKEY key = sg_first; key <= sg_last; ++key) {
+        if (strcmp(str, toString(key)) == 0) {
+            return key;
+        }
+    }
+    return sg_invalid;
+}
+
 int ProductionRuleKeys::getDuration(GKEY key)
 {
     int ret;
@@ -100,6 +100,12 @@ public:
      * Get a human readable string representation
      */
     static const char * toString(GKEY key);
+
+    /**
+     * Inverse of toString.
+     * @returns sg_invalid if str is not the name of a key.
+     */
+    static GKEY fromString(const char * str);
 };
 
 
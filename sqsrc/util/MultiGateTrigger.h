@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Constants.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <xmmintrin.h>
+
+/**
+ * A bank of N GateTriggers, four per SSE vector.
+ * Same behavior as GateTrigger (SchmidtTrigger on the input,
+ * optional reset logic), but all the lanes are processed at once.
+ *
+ * Gates and triggers come back as bitmasks, bit n for lane n.
+ *
+ * Intended use is one lane per polyphonic channel.
+ */
+template <int N>
+class MultiGateTrigger
+{
+public:
+    /**
+     * param wantResetLogic if true we will ignore gates right
+     * after reset until we see a low gate.
+     */
+    MultiGateTrigger(bool wantResetLogic = true);
+
+    /**
+     * Clock in one input sample for numLanes (rounded up to a multiple of four).
+     * Afterwards may query gates() and triggers().
+     * @returns the trigger bitmask.
+     */
+    uint32_t go(const float* input, int numLanes);
+
+    void reset();
+
+    /**
+     * bit n set if lane n is high
+     */
+    uint32_t gates() const
+    {
+        return _gates;
+    }
+
+    /**
+     * bit n set if lane n just went high
+     */
+    uint32_t triggers() const
+    {
+        return _triggers;
+    }
+
+    bool gate(int lane) const
+    {
+        assert(lane < N);
+        return _gates & (1u << lane);
+    }
+
+    bool trigger(int lane) const
+    {
+        assert(lane < N);
+        return _triggers & (1u << lane);
+    }
+
+private:
+    static_assert((N % 4) == 0, "lanes must be multiple of 4");
+    static_assert(N <= 32, "lanes must fit in the bitmasks");
+
+    /**
+     * The SchmidtTrigger state. All ones where high.
+     */
+    __m128 schmidt[N / 4];
+
+    uint32_t _gates = 0;
+    uint32_t _triggers = 0;
+
+    // just reset - gate must go low before high to trigger
+    uint32_t _reset = 0;
+    const bool _wantResetLogic;
+};
+
+template <int N>
+inline MultiGateTrigger<N>::MultiGateTrigger(bool wantResetLogic) :
+    _wantResetLogic(wantResetLogic)
+{
+    for (int i = 0; i < N / 4; ++i) {
+        schmidt[i] = _mm_setzero_ps();
+    }
+    reset();
+}
+
+template <int N>
+inline void MultiGateTrigger<N>::reset()
+{
+    _gates = 0;
+    _triggers = 0;
+    if (_wantResetLogic) {
+        _reset = ~0u;
+    }
+}
+
+template <int N>
+inline uint32_t MultiGateTrigger<N>::go(const float* input, int numLanes)
+{
+    assert(numLanes <= N);
+    const __m128 thHi = _mm_set_ps1(cGateHi);
+    const __m128 thLo = _mm_set_ps1(cGateLow);
+
+    uint32_t newGates = 0;
+    uint32_t laneMask = 0;
+    for (int lane = 0; lane < numLanes; lane += 4) {
+        const __m128 x = _mm_loadu_ps(input + lane);
+        __m128& last = schmidt[lane / 4];
+
+        // if we were high, stay high until below thLo.
+        // if we were low, stay low until above thHi.
+        const __m128 goHigh = _mm_cmpgt_ps(x, thHi);
+        const __m128 stayHigh = _mm_andnot_ps(_mm_cmplt_ps(x, thLo), last);
+        last = _mm_or_ps(goHigh, stayHigh);
+
+        newGates |= uint32_t(_mm_movemask_ps(last)) << lane;
+        laneMask |= 0xfu << lane;
+    }
+
+    // in reset, lanes that are high are ignored. Lanes that are low come out of reset.
+    const uint32_t blocked = _reset & newGates & laneMask;
+    _reset &= ~(laneMask & ~newGates);
+
+    const uint32_t active = laneMask & ~blocked;
+    _triggers = (_triggers & ~active) | (newGates & ~_gates & active);
+    _gates = (_gates & ~active) | (newGates & active);
+    return _triggers & laneMask;
+}
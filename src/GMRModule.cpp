@@ -5,6 +5,10 @@
 
 #ifdef _GMR
 #include "GMR.h"
+#include "GrammarCache.h"
+#include "GrammarJson.h"
+#include "ctrl/SqHelper.h"
+#include "osdialog.h"
 
 
 /**
@@ -20,16 +24,50 @@ public:
     void step() override;
     void onSampleRateChange() override;
 
+    /**
+     * Load a grammar from a JSON file. Call from the UI thread.
+     * @returns empty string on success, otherwise an error message.
+     */
+    std::string loadGrammar(const std::string& path);
+
     GMR<WidgetComposite> gmr;
 private:
+    /**
+     * Shared by all the instances, so they all share the compiled grammars.
+     */
+    static GrammarCache grammarCache;
 };
 
+GrammarCache GMRModule::grammarCache;
+
+std::string GMRModule::loadGrammar(const std::string& path)
+{
+    std::string text;
+    std::string error = GrammarJson::readFile(path, text);
+    if (!error.empty()) {
+        return error;
+    }
+    CompiledGrammarPtr grammar = grammarCache.get(text, GrammarJson::parse, error);
+    if (grammar && !gmr.setGrammar(grammar)) {
+        error = "busy, try again";
+    }
+    return error;
+}
+
 void GMRModule::onSampleRateChange()
 {
-    float rate = engineGetSampleRate();
+    float rate = SqHelper::engineGetSampleRate();
     gmr.setSampleRate(rate);
 }
 
+#ifdef __V1x
+GMRModule::GMRModule() : gmr(this)
+{
+    config(gmr.NUM_PARAMS, gmr.NUM_INPUTS, gmr.NUM_OUTPUTS, gmr.NUM_LIGHTS);
+    onSampleRateChange();
+    gmr.init();
+}
+#else
 GMRModule::GMRModule()
     : Module(gmr.NUM_PARAMS,
     gmr.NUM_INPUTS,
@@ -40,6 +78,7 @@ GMRModule::GMRModule()
     onSampleRateChange();
     gmr.init();
 }
+#endif
 
 void GMRModule::step()
 {
@@ -53,8 +92,28 @@ void GMRModule::step()
 struct GMRWidget : ModuleWidget
 {
     GMRWidget(GMRModule *);
+#ifdef __V1x
+    void appendContextMenu(Menu *menu) override;
+#else
+    Menu* createContextMenu() override;
+#endif
+
+    /**
+     * The audio thread leaves old grammars for us to free.
+     */
+    void step() override
+    {
+        if (gmrModule) {
+            gmrModule->gmr.releaseRetiredGrammar();
+        }
+        ModuleWidget::step();
+    }
+
+    void loadGrammar();
+
+    GMRModule* const gmrModule;
 
-    void addLabel(const Vec& v, const char* str, const NVGcolor& color = COLOR_BLACK)
+    void addLabel(const Vec& v, const char* str, const NVGcolor& color = SqHelper::COLOR_BLACK)
     {
         Label* label = new Label();
         label->box.pos = v;
@@ -70,33 +129,92 @@ struct GMRWidget : ModuleWidget
  * provide meta-data.
  * This is not shared by all modules in the DLL, just one
  */
-GMRWidget::GMRWidget(GMRModule *module) : ModuleWidget(module)
+#ifdef __V1x
+GMRWidget::GMRWidget(GMRModule *module) : gmrModule(module)
 {
+    setModule(module);
+#else
+GMRWidget::GMRWidget(GMRModule *module) : ModuleWidget(module), gmrModule(module)
+{
+#endif
     box.size = Vec(6 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT);
+    SqHelper::setPanel(this, "res/blank_panel.svg");
+
+    // module is null in the module browser
+    addInput(createInput<PJ301MPort>(
+        Vec(40, 200), module, GMR<WidgetComposite>::CLOCK_INPUT));
+    addOutput(createOutput<PJ301MPort>(
+        Vec(40, 300), module, GMR<WidgetComposite>::TRIGGER_OUTPUT));
+
+    // screws
+    addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+}
+
+struct LoadGrammarItem : MenuItem
+{
+    LoadGrammarItem(GMRWidget* w) : widget(w)
     {
-        SVGPanel *panel = new SVGPanel();
-        panel->box.size = box.size;
-        panel->setBackground(SVG::load(assetPlugin(pluginInstance, "res/blank_panel.svg")));
-        addChild(panel);
+        text = "Load grammar";
     }
+#ifdef __V1x
+    void onAction(const event::Action &e) override
+#else
+    void onAction(EventAction &e) override
+#endif
+    {
+        widget->loadGrammar();
+    }
+    GMRWidget* const widget;
+};
 
-    addInput(Port::create<PJ301MPort>(
-        Vec(40, 200), Port::INPUT, module, module->gmr.CLOCK_INPUT));
-    addOutput(Port::create<PJ301MPort>(
-        Vec(40, 300), Port::OUTPUT, module, module->gmr.TRIGGER_OUTPUT));
-
+#ifdef __V1x
+void GMRWidget::appendContextMenu(Menu* theMenu)
+{
+    MenuLabel *spacerLabel = new MenuLabel();
+    theMenu->addChild(spacerLabel);
+    theMenu->addChild(new LoadGrammarItem(this));
+}
+#else
+Menu* GMRWidget::createContextMenu()
+{
+    Menu* theMenu = ModuleWidget::createContextMenu();
+    MenuLabel *spacerLabel = new MenuLabel();
+    theMenu->addChild(spacerLabel);
+    theMenu->addChild(new LoadGrammarItem(this));
+    return theMenu;
+}
+#endif
 
-    // screws
-    addChild(Widget::create<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
-    addChild(Widget::create<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
-    addChild(Widget::create<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-    addChild(Widget::create<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+void GMRWidget::loadGrammar()
+{
+    if (!gmrModule) {
+        return;
+    }
+    osdialog_filters* filters = osdialog_filters_parse("Grammar (.json):json");
+    char* pathC = osdialog_file(OSDIALOG_OPEN, nullptr, nullptr, filters);
+    osdialog_filters_free(filters);
+    if (!pathC) {
+        return;
+    }
+    std::string error = gmrModule->loadGrammar(pathC);
+    if (!error.empty()) {
+        osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, error.c_str());
+    }
+    free(pathC);
 }
 
+#ifdef __V1x
+Model *modelGMRModule = createModel<GMRModule,
+    GMRWidget>("squinkylabs-GMR");
+#else
 Model *modelGMRModule = Model::create<GMRModule,
     GMRWidget>("Squinky Labs",
     "squinkylabs-GMR",
     "GMR", EFFECT_TAG, LFO_TAG);
+#endif
 
 #endif
 
@@ -0,0 +1,143 @@
+
+#include "GrammarJson.h"
+#include "jansson.h"
+
+#include <sstream>
+#include <stdio.h>
+
+/**
+ * json_decref on the way out, no matter how we leave.
+ */
+class JSONref
+{
+public:
+    JSONref(json_t* j) : json(j)
+    {
+    }
+    ~JSONref()
+    {
+        json_decref(json);
+    }
+private:
+    json_t * const json;
+};
+
+static GKEY parseKey(json_t* keyJ, std::string& error)
+{
+    if (!keyJ || !json_is_string(keyJ)) {
+        error = "key is missing, or not a string";
+        return sg_invalid;
+    }
+    const char* name = json_string_value(keyJ);
+    const GKEY key = ProductionRuleKeys::fromString(name);
+    if (key == sg_invalid) {
+        error = std::string("unknown key: ") + name;
+    }
+    return key;
+}
+
+static std::string parseRule(json_t* ruleJ, ProductionRule * rules)
+{
+    std::string error;
+    if (!json_is_object(ruleJ)) {
+        return "rule is not an object";
+    }
+    const GKEY key = parseKey(json_object_get(ruleJ, "key"), error);
+    if (key == sg_invalid) {
+        return error;
+    }
+    ProductionRule& rule = rules[key];
+    if (!(rule.entries[0] == ProductionRuleEntry())) {
+        return std::string("duplicate rule for ") + ProductionRuleKeys::toString(key);
+    }
+
+    json_t* productionsJ = json_object_get(ruleJ, "productions");
+    if (!productionsJ || !json_is_array(productionsJ)) {
+        return std::string("rule ") + ProductionRuleKeys::toString(key) + " has no productions array";
+    }
+    if (json_array_size(productionsJ) > ProductionRule::numEntries) {
+        return std::string("rule ") + ProductionRuleKeys::toString(key) + " has too many productions";
+    }
+
+    // json has the probability of each production, rule entries are cumulative.
+    double cumulative = 0;
+    const size_t numProductions = json_array_size(productionsJ);
+    size_t index;
+    json_t* productionJ;
+    json_array_foreach(productionsJ, index, productionJ) {
+        json_t* probabilityJ = json_object_get(productionJ, "p");
+        if (!probabilityJ || !json_is_number(probabilityJ)) {
+            return std::string("production in rule ") + ProductionRuleKeys::toString(key) + " has no probability";
+        }
+        cumulative += json_number_value(probabilityJ);
+
+        // last one must come out to exactly one, to terminate the rule.
+        const bool isLast = (index == numProductions - 1);
+        if (isLast && cumulative > .999 && cumulative < 1.001) {
+            cumulative = 1;
+        }
+        rule.entries[index].probability = float(cumulative);
+
+        json_t* toJ = json_object_get(productionJ, "to");
+        if (toJ) {
+            const GKEY to = parseKey(toJ, error);
+            if (to == sg_invalid) {
+                return error;
+            }
+            rule.entries[index].code = to;
+        } else {
+            rule.entries[index].code = sg_invalid;
+        }
+    }
+    return "";
+}
+
+std::string GrammarJson::parse(const std::string& text, ProductionRule * rules, GKEY& firstRule)
+{
+    json_error_t jsonError;
+    json_t* root = json_loads(text.c_str(), 0, &jsonError);
+    if (!root) {
+        std::stringstream s;
+        s << "JSON parsing error at ";
+        s << jsonError.line << ":" << jsonError.column;
+        s << " " << jsonError.text;
+        return s.str();
+    }
+    JSONref closer(root);
+
+    std::string error;
+    firstRule = parseKey(json_object_get(root, "first"), error);
+    if (firstRule == sg_invalid) {
+        return std::string("bad first: ") + error;
+    }
+
+    json_t* rulesJ = json_object_get(root, "rules");
+    if (!rulesJ || !json_is_array(rulesJ)) {
+        return "rules not found at root, or not an array";
+    }
+    size_t index;
+    json_t* ruleJ;
+    json_array_foreach(rulesJ, index, ruleJ) {
+        error = parseRule(ruleJ, rules);
+        if (!error.empty()) {
+            return error;
+        }
+    }
+    return "";
+}
+
+std::string GrammarJson::readFile(const std::string& path, std::string& text)
+{
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) {
+        return std::string("could not open ") + path;
+    }
+    text.clear();
+    char buffer[1024];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, count);
+    }
+    fclose(file);
+    return "";
+}
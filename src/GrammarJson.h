@@ -0,0 +1,58 @@
+#pragma once
+
+#include "StochasticGrammar.h"
+
+#include <string>
+
+/**
+ * Reads a StochasticGrammar from JSON, so users can write their own for GMR.
+ * GrammarJson::parse can be used as a GrammarCache::Parser.
+ *
+ * schema:
+ *  root:
+ *  {
+ *      "first": <key>,
+ *      "rules": [ <rule>, ... ]
+ *  }
+ *
+ *  rule:
+ *  {
+ *      "key": <key>,
+ *      "productions": [ <production>, ... ]    // at most 3
+ *  }
+ *
+ *  production:
+ *  {
+ *      "p": <probability>,     // probabilities in a rule must add up to 1
+ *      "to": <key>             // optional. If missing, the rule terminates
+ *  }
+ *
+ *  key: one of the names from ProductionRuleKeys::toString, like "2xw", "h,h", "q".
+ *
+ * example, quarter notes or two eighths:
+ *  {
+ *      "first": "2xw",
+ *      "rules": [
+ *          { "key": "2xw", "productions": [ { "p": 1, "to": "w,w" } ] },
+ *          { "key": "w", "productions": [ { "p": 1, "to": "h,h" } ] },
+ *          { "key": "h", "productions": [ { "p": 1, "to": "q,q" } ] },
+ *          { "key": "q", "productions": [ { "p": .7 }, { "p": .3, "to": "e,e" } ] },
+ *          { "key": "e", "productions": [ { "p": 1 } ] }
+ *      ]
+ *  }
+ */
+class GrammarJson
+{
+public:
+    /**
+     * @param rules must have fullRuleTableSize entries, all empty.
+     * @returns empty string on success, otherwise an error message.
+     */
+    static std::string parse(const std::string& text, ProductionRule * rules, GKEY& firstRule);
+
+    /**
+     * Read the whole file into text.
+     * @returns empty string on success, otherwise an error message.
+     */
+    static std::string readFile(const std::string& path, std::string& text);
+};
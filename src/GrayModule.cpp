@@ -149,6 +149,12 @@ GrayWidget::GrayWidget(GrayModule *module) :
         Gray<WidgetComposite>::OUTPUT_MIXED));
     addLabel(Vec(82, 310), "Mix", SqHelper::COLOR_WHITE);
 
+    addOutput(createOutputCentered<PJ301MPort>(
+        Vec(61, 339),
+        module,
+        Gray<WidgetComposite>::OUTPUT_POLY));
+    addLabel(Vec(45, 310), "Poly", SqHelper::COLOR_WHITE);
+
     // screws
     addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
     addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
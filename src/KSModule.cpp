@@ -26,6 +26,7 @@ private:
 
 void KSModule::onSampleRateChange()
 {
+    composite.setSampleRate(engineGetSampleRate());
 }
 
 KSModule::KSModule()
@@ -79,74 +80,68 @@ void KCCompositeWidget::addJacks(KSModule*)
     const float verticalShift = 0;
     const float col1 = 12;
     const float col2 = 46;
-    const float col3 = 81;
     const float col4 = 115;
     const float outputLabelY = 300;
 
     using CCOMP = KSComposite<WidgetComposite>;
 
     addInput(Port::create<PJ301MPort>(
-        Vec(col1, 273 + verticalShift),
+        Vec(col1, 317 + verticalShift),
         Port::INPUT,
         module,
         CCOMP::PITCH_INPUT));
-    addLabel(Vec(9, 255 + verticalShift), "cv");
-
-    addInput(Port::create<PJ301MPort>(
-        Vec(col2, 273 + verticalShift),
-        Port::INPUT,
-        module,
-        CCOMP::FM_INPUT));
-
-    addLabel(Vec(43, 255 + verticalShift), "fm");
-
-    addInput(Port::create<PJ301MPort>(
-        Vec(col3, 273 + verticalShift),
-        Port::INPUT,
-        module,
-        CCOMP::SYNC_INPUT));
-    addLabel(Vec(72, 255 + verticalShift), "sync");
+    addLabel(Vec(9, outputLabelY + verticalShift), "cv");
 
     addInput(Port::create<PJ301MPort>(
-        Vec(col4, 273 + verticalShift),
-        Port::INPUT,
-        module,
-        CCOMP::PW_INPUT));
-    addLabel(Vec(107, 255 + verticalShift), "pwm");
-
-    addOutput(Port::create<PJ301MPort>(
-        Vec(col1, 317 + verticalShift),
-        Port::OUTPUT,
-        module,
-        CCOMP::SIN_OUTPUT));
-    addLabel(Vec(8, outputLabelY + verticalShift), "sin");
-
-    addOutput(Port::create<PJ301MPort>(
         Vec(col2, 317 + verticalShift),
-        Port::OUTPUT,
-        module,
-        CCOMP::TRI_OUTPUT));
-    addLabel(Vec(44, outputLabelY + verticalShift), "tri");
-
-    addOutput(Port::create<PJ301MPort>(
-        Vec(col3, 317 + verticalShift),
-        Port::OUTPUT,
+        Port::INPUT,
         module,
-        CCOMP::SAW_OUTPUT));
-    addLabel(Vec(75, outputLabelY + verticalShift), "saw");
+        CCOMP::GATE_INPUT));
+    addLabel(Vec(40, outputLabelY + verticalShift), "gate");
 
     addOutput(Port::create<PJ301MPort>(
         Vec(col4, 317 + verticalShift),
         Port::OUTPUT,
         module,
-        CCOMP::SQR_OUTPUT));
-    addLabel(Vec(111, outputLabelY + verticalShift), "sqr");
+        CCOMP::AUDIO_OUTPUT));
+    addLabel(Vec(111, outputLabelY + verticalShift), "out");
 }
 
-
 void KCCompositeWidget::addKnobs(KSModule*)
 {
+    const float col1 = 40;
+    const float col2 = 110;
+    const float row1 = 80;
+    const float row2 = 140;
+    const float row3 = 200;
+    const float labelDeltaY = 18;
+
+    using CCOMP = KSComposite<WidgetComposite>;
 
+    addParam(createParamCentered<Rogan1PSBlue>(
+        Vec(col1, row1),
+        module, CCOMP::OCTAVE_PARAM, -5, 5, 0));
+    addLabel(Vec(col1 - 20, row1 + labelDeltaY), "octave");
+
+    addParam(createParamCentered<Rogan1PSBlue>(
+        Vec(col2, row1),
+        module, CCOMP::SEMI_PARAM, -11, 11, 0));
+    addLabel(Vec(col2 - 16, row1 + labelDeltaY), "semi");
+
+    addParam(createParamCentered<Rogan1PSBlue>(
+        Vec(col1, row2),
+        module, CCOMP::FINE_PARAM, -1, 1, 0));
+    addLabel(Vec(col1 - 14, row2 + labelDeltaY), "fine");
+
+    addParam(createParamCentered<Rogan1PSBlue>(
+        Vec(col2, row2),
+        module, CCOMP::DECAY_PARAM, 0, 1, .5));
+    addLabel(Vec(col2 - 18, row2 + labelDeltaY), "decay");
+
+    addParam(createParamCentered<Rogan1PSBlue>(
+        Vec(col1, row3),
+        module, CCOMP::BRIGHTNESS_PARAM, 0, 1, .7));
+    addLabel(Vec(col1 - 16, row3 + labelDeltaY), "bright");
 }
 /**
  * Widget constructor will describe my implementation structure and
@@ -20,7 +20,10 @@
 #include "seq/SequencerSerializer.h"
 #include "seq/S4ButtonGrid.h"
 
+#include "ImportTracksCommand4.h"
+#include "MidiFileProxy.h"
 #include "MidiSequencer4.h"
+#include <osdialog.h>
 
 using Comp = Seq4<WidgetComposite>;
 
@@ -119,9 +122,49 @@ void Sequencer4Widget::appendContextMenu(Menu* theMenu) {
     });
     item->text = "Hookup Clock";
     theMenu->addChild(item);
+
+    item = new SqMenuItem( []() { return false; }, [this](){
+        loadMidiFile();
+    });
+    item->text = "Load MIDI file";
+    theMenu->addChild(item);
     //ClockFinder::updateMenu(theMenu);
 }
 
+/**
+ * Each track of the file goes in its own row, in the first section,
+ * so they play together. Loading can be undone.
+ */
+void Sequencer4Widget::loadMidiFile() {
+    Sequencer4Module* seqModule = dynamic_cast<Sequencer4Module*>(module);
+    if (!seqModule) {
+        return;
+    }
+    static const char SMF_FILTERS[] = "Standard MIDI file (.mid):mid";
+    osdialog_filters* filters = osdialog_filters_parse(SMF_FILTERS);
+    DEFER({
+        osdialog_filters_free(filters);
+    });
+
+    char* pathC = osdialog_file(OSDIALOG_OPEN, "", "", filters);
+    if (!pathC) {
+        // Fail silently
+        return;
+    }
+    DEFER({
+        std::free(pathC);
+    });
+
+    MidiSequencer4Ptr seq = seqModule->getSequencer();
+    auto tracks = MidiFileProxy::loadTracks(pathC, seq->song->lock);
+    if (!tracks.empty()) {
+        Command4Ptr cmd = ImportTracksCommand4::create(seq, tracks);
+        seq->undo->execute4(seq, this, cmd);
+    } else {
+        WARN("unable to load midi file %s", pathC);
+    }
+}
+
 void Sequencer4Widget::setNewSeq(MidiSequencer4Ptr newSeq) {
     buttonGrid->setNewSeq(newSeq);
 }
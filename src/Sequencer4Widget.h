@@ -50,5 +50,6 @@ struct Sequencer4Widget : ModuleWidget {
     void addBigButtons(Sequencer4Module* module);
     void addJacks(Sequencer4Module* module);
     void toggleRunStop(Sequencer4Module* module);
+    void loadMidiFile();
     std::shared_ptr<S4ButtonGrid> buttonGrid;
 };
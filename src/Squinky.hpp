@@ -22,6 +22,7 @@
 #define _FILT
 //#define _CH10
 //#define _LFNB
+//#define _GMR
 #define _MIX_STEREO
 #define _USERKB
 
@@ -91,6 +91,7 @@ void NoteDisplay::initEditContext()
         UIPrefs::topMarginNoteEdit);
     sequencer->context->setScaler(scaler);
     assert(scaler);
+    noteGeometry.invalidate();
 }
 
 // TODO: get rid of this (dont remember why this is here)
@@ -104,25 +105,16 @@ void NoteDisplay::step()
 
 void NoteDisplay::drawNotes(NVGcontext *vg)
 {
-    // Get all the events on the screen, and go back two bar so we get tied notes.
-    MidiEditorContext::iterator_pair it = sequencer->context->getEvents(8.f);
-    auto scaler = sequencer->context->getScaler();
-    assert(scaler);
-    const int noteHeight = scaler->noteHeight();
-    for (; it.first != it.second; ++it.first) {
-        auto temp = *(it.first);
-        MidiEventPtr evn = temp.second;
-        MidiNoteEventPtr ev = safe_cast<MidiNoteEvent>(evn);
-
-        const float x = scaler->midiTimeToX(*ev);
-        const float y = scaler->midiPitchToY(*ev);
-        const float width = scaler->midiTimeTodX(ev->duration);
-        const bool selected = sequencer->selection->isSelected(ev);
-        if (!selected || !mouseManager->willDrawSelection()) {
+    // Only re-calculates the notes if the song, selection, or viewport changed.
+    noteGeometry.update(sequencer->context, sequencer->selection);
+    const int noteHeight = int(noteGeometry.getNoteHeight());
+    const bool drawSelected = !mouseManager->willDrawSelection();
+    for (const NoteGeometryCache::NoteGeometry& note : noteGeometry.getNotes()) {
+        if (!note.selected || drawSelected) {
             SqGfx::filledRect(
                 vg,
-                selected ? UIPrefs::SELECTED_NOTE_COLOR : UIPrefs::NOTE_COLOR,
-                x, y, width, noteHeight);
+                note.selected ? UIPrefs::SELECTED_NOTE_COLOR : UIPrefs::NOTE_COLOR,
+                note.x, note.y, note.width, noteHeight);
         }
     }
 }
@@ -3,6 +3,7 @@
 
 #include "InputScreenManager.h"
 #include "MidiSequencer.h"
+#include "NoteGeometryCache.h"
 #include "NoteScreenScale.h"
 #include "Seq.h"
 
@@ -55,6 +56,8 @@ private:
 
     std::shared_ptr<class MouseManager> mouseManager;
 
+    NoteGeometryCache noteGeometry;
+
     void step() override;
 
 
@@ -3,6 +3,7 @@
 #include "MidiSequencer.h"
 #include "MidiSequencer4.h"
 #include "MidiTrack4Options.h"
+#include "MidiTrackCodec.h"
 #include "MidiSong4.h"
 #include "../SequencerModule.h"
 #include "../Sequencer4Module.h"
@@ -20,6 +21,7 @@ schema for seq++
 
   song:
   {
+      "trackFormat": 2,
       "tk0": <track>,
       "loop": <loop>
   }
@@ -28,6 +30,7 @@ schema for seq++
 
   song4:
   {
+      "trackFormat": 2,
       "tk0_0": <track>,     // format is row_col
       "tk0_1": <track>,
       "tkx0_0": <track extra>
@@ -40,6 +43,11 @@ schema for seq++
       "song4": <song4>,
       "globals4": <globals4>
   }
+
+  track, trackFormat 2:
+      "<base64>"            // MidiTrackCodec binary
+  or, in older patches with no trackFormat:
+      [ <event>, <event>, ... ]
  */
 
 json_t *SequencerSerializer::toJson(MidiSequencerPtr inSeq)
@@ -65,6 +73,7 @@ json_t *SequencerSerializer::toJson(std::shared_ptr<MidiSong> sng)
     json_t* song = json_object();
 
     auto tk = sng->getTrack(0);
+    json_object_set_new(song, "trackFormat", json_integer(trackFormatCodec));
     json_object_set_new(song, "tk0", toJson(tk));
     json_object_set_new(song, "loop", toJson(sng->getSubrangeLoop()));
 
@@ -81,6 +90,7 @@ json_t *SequencerSerializer::toJson(std::shared_ptr<MidiSong> sng)
 json_t *SequencerSerializer::toJson(std::shared_ptr<MidiSong4> sng)
 {
     json_t* song = json_object();
+    json_object_set_new(song, "trackFormat", json_integer(trackFormatCodec));
     for (int row=0; row < MidiSong4::numTracks; ++row) {
         for (int col=0; col < MidiSong4::numSectionsPerTrack; ++col) {
             {
@@ -120,15 +130,14 @@ std::string SequencerSerializer::optionTagForSong4(int row, int col)
     return str.str(); 
 }
 
+/**
+ * Tracks are saved as a base64 string of the MidiTrackCodec binary format.
+ * Older patches have an array of event objects, which fromJsonTrack still reads.
+ * The song's trackFormat says which.
+ */
 json_t *SequencerSerializer::toJson(std::shared_ptr<MidiTrack> tk)
 {
-    json_t* track = json_array();
-
-    for (auto ev_iter : *tk) {
-        MidiEventPtr ev = ev_iter.second;
-        json_array_append_new(track, toJson(ev));
-    }
-    return track;
+    return json_string(MidiTrackCodec::encode(*tk).c_str());
 }
 
 json_t *SequencerSerializer::toJson(std::shared_ptr<MidiEvent> evt)
@@ -324,8 +333,9 @@ MidiSongPtr SequencerSerializer::fromJsonSong(json_t *data)
         MidiLocker _(lock);
 
         if (data) {
+            const int format = getTrackFormat(data);
             json_t* trackJson = json_object_get(data, "tk0");
-            MidiTrackPtr track = fromJsonTrack(trackJson, 0, lock);
+            MidiTrackPtr track = fromJsonTrack(trackJson, 0, lock, format);
             song->addTrack(0, track);
 
             json_t* loopJson = json_object_get(data, "loop");
@@ -349,6 +359,7 @@ MidiSong4Ptr SequencerSerializer::fromJsonSong4(json_t *data)
 
 
         if (data) {
+            const int format = getTrackFormat(data);
             for (int row=0; row < MidiSong4::numTracks; ++row) {
                 for (int col=0; col < MidiSong4::numSectionsPerTrack; ++col) {
                     {
@@ -356,7 +367,7 @@ MidiSong4Ptr SequencerSerializer::fromJsonSong4(json_t *data)
                         json_t* trackJson = json_object_get(data, key.c_str());
                         MidiTrackPtr track;
                         if (trackJson) {
-                            track = fromJsonTrack(trackJson, 0, lock);
+                            track = fromJsonTrack(trackJson, 0, lock, format);
                         }
                         song->addTrack(row, col, track);
                     }
@@ -390,11 +401,40 @@ MidiSong4Ptr SequencerSerializer::fromJsonSong4(json_t *data)
     return song;
 }
 
-MidiTrackPtr SequencerSerializer::fromJsonTrack(json_t *data, int index, MidiLockPtr lock)
+int SequencerSerializer::getTrackFormat(json_t* song)
+{
+    json_t* formatJson = json_object_get(song, "trackFormat");
+    return formatJson ? int(json_integer_value(formatJson)) : trackFormatEvents;
+}
+
+MidiTrackPtr SequencerSerializer::makeBlankTrack(MidiLockPtr lock)
 {
-    // data here is the track array
     MidiTrackPtr track = std::make_shared<MidiTrack>(lock);
+    track->insertEnd(4);
+    return track;
+}
+
+MidiTrackPtr SequencerSerializer::fromJsonTrack(json_t *data, int index, MidiLockPtr lock, int format)
+{
+    if (format == trackFormatCodec) {
+        MidiTrackPtr track = std::make_shared<MidiTrack>(lock);
+        const std::string err = json_is_string(data) ?
+            MidiTrackCodec::decode(json_string_value(data), track) :
+            "track is not a string";
+        if (!err.empty()) {
+            WARN("bad track data: %s", err.c_str());
+            return makeBlankTrack(lock);
+        }
+        return track;
+    }
+
+    if (format != trackFormatEvents) {
+        WARN("track format %d is from a newer version of the plugin, can't read it", format);
+        return makeBlankTrack(lock);
+    }
 
+    // old patches: data here is the track array
+    MidiTrackPtr track = std::make_shared<MidiTrack>(lock);
     size_t eventCount = json_array_size(data);
 
     for (int i = 0; i< int(eventCount); ++i) {
@@ -41,7 +41,7 @@ private:
 
     static std::shared_ptr<MidiSong> fromJsonSong(json_t *data);
     static std::shared_ptr<MidiSong4> fromJsonSong4(json_t *data);
-    static MidiTrackPtr fromJsonTrack(json_t *data, int index, std::shared_ptr<MidiLock>);
+    static MidiTrackPtr fromJsonTrack(json_t *data, int index, std::shared_ptr<MidiLock>, int format);
     static MidiTrack4OptionsPtr fromJsonOptions(json_t* data );
     static MidiEventPtr fromJsonEvent(json_t *data);
     static MidiNoteEventPtr fromJsonNoteEvent(json_t *data);
@@ -52,6 +52,15 @@ private:
     static const int typeNote = 1;
     static const int typeEnd = 2;
 
+    /**
+     * Each song saves how its tracks are stored, under "trackFormat".
+     * Patches from before there was a format key have event arrays.
+     */
+    static const int trackFormatEvents = 1;     // array of event objects
+    static const int trackFormatCodec = 2;      // MidiTrackCodec base64 string
+    static int getTrackFormat(json_t* song);
+    static MidiTrackPtr makeBlankTrack(std::shared_ptr<MidiLock>);
+
     static std::string trackTagForSong4(int row, int col);
     static std::string optionTagForSong4(int row, int col);
 };
\ No newline at end of file
@@ -38,6 +38,14 @@ public:
         }
     }
 
+    /**
+     * Try to fold a command that was just executed into ours.
+     */
+    bool mergeWith(int id, const Command& next)
+    {
+        return (id == this->moduleId) && wrappedCommand->mergeWith(next);
+    }
+
 private:
     std::shared_ptr<Command> wrappedCommand;
     SequencerPtr getSeq()
@@ -71,6 +79,20 @@ private:
 };
 
 using SeqAction1 = SeqAction<MidiSequencerPtr, SqCommand, SequencerModule, SequencerWidget>;
+
+/**
+ * If the last thing on VCV's undo history is ours, and
+ * nothing has been undone, merge cmd into it.
+ */
+static bool mergeWithLastAction(int moduleId, const SqCommand& cmd)
+{
+    auto history = ::rack::appGet()->history;
+    if (history->actions.empty() || (history->actionIndex != int(history->actions.size()))) {
+        return false;
+    }
+    SeqAction1* last = dynamic_cast<SeqAction1*>(history->actions.back());
+    return last && last->mergeWith(moduleId, cmd);
+}
 #ifdef _SEQ4
 using SeqAction4 = SeqAction<MidiSequencer4Ptr, Sq4Command, Sequencer4Module, Sequencer4Widget>;
 #endif
@@ -105,6 +127,9 @@ void UndoRedoStack::execute(MidiSequencerPtr seq, SequencerWidget* widget, std::
 {
     assert(seq);
     cmd->execute(seq, widget);
+    if (mergeWithLastAction(moduleId, *cmd)) {
+        return;
+    }
     auto action = new SeqAction1("unknown", cmd, moduleId, "Seq++");
 
     ::rack::appGet()->history->push(action);
@@ -113,6 +138,9 @@ void UndoRedoStack::execute(MidiSequencerPtr seq, std::shared_ptr<SqCommand> cmd
 {
     assert(seq);
     cmd->execute(seq, nullptr);
+    if (mergeWithLastAction(moduleId, *cmd)) {
+        return;
+    }
     auto action = new SeqAction1("unknown", cmd, moduleId, "Seq++");
 
     ::rack::appGet()->history->push(action);
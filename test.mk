@@ -11,6 +11,9 @@ TEST_SOURCES += $(wildcard sqsrc/**/*.cpp)
 TEST_SOURCES += dsp/third-party/kiss_fft130/tools/kiss_fftr.c
 TEST_SOURCES += dsp/third-party/kiss_fft130/kiss_fft.c
 
+# GMR's JSON grammar reader lives in src, because it uses jansson
+TEST_SOURCES += src/GrammarJson.cpp
+
 ## This is a list of full paths to the .o files we want to build
 TEST_OBJECTS = $(patsubst %, build_test/%.o, $(TEST_SOURCES))
 
@@ -32,6 +35,8 @@ FLAGS += $(PERFFLAG)
 
 test.exe : FLAGS += -D _TESTEX
 
+test.exe perf.exe : FLAGS += -I./src
+
 ifeq ($(ARCH), win)
 	# don't need these yet
 	#  -lcomdlg32 -lole32 -ldsound -lwinmm
@@ -51,6 +56,9 @@ test.exe perf.exe : LDFLAGS = -stdlib=libc++ -lpthread -ldl \
 		-framework Cocoa -framework OpenGL -framework IOKit -framework CoreVideo
 endif
 
+# for GrammarJson
+test.exe perf.exe : LDFLAGS += $(RACK_DIR)/dep/lib/libjansson.a
+
 test : test.exe
 
 ## Note that perf and test targets both used build_test for object files,
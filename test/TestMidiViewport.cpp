@@ -131,6 +131,46 @@ static void testDemoSong()
     assertEQ(std::distance(it.first, it.second), numNotes /2);
 }
 
+// a note held for many bars should still be visible
+static void testVisibleNotesLong()
+{
+    MidiSongPtr song(std::make_shared<MidiSong>());
+    MidiLocker l(song->lock);
+    song->createTrack(0);
+    auto track = song->getTrack(0);
+
+    MidiNoteEventPtr longNote = std::make_shared<MidiNoteEvent>();
+    longNote->startTime = 0;
+    longNote->duration = 100;
+    longNote->pitchCV = 4;
+    track->insertEvent(longNote);
+
+    MidiNoteEventPtr wrongPitch = std::make_shared<MidiNoteEvent>();
+    wrongPitch->startTime = 95;
+    wrongPitch->pitchCV = 6;
+    track->insertEvent(wrongPitch);
+
+    MidiNoteEventPtr later = std::make_shared<MidiNoteEvent>();
+    later->startTime = 96;
+    later->pitchCV = 4.5;
+    track->insertEvent(later);
+    track->insertEnd(200);
+
+    MidiEditorContext vp(song, nullptr);
+    vp.setTimeRange(90, 98);
+    vp.setPitchRange(3, 5);
+
+    // the old way, going back two bars, misses the long note
+    auto its = vp.getEvents(8);
+    assertEQ(std::distance(its.first, its.second), 1);
+
+    std::vector<MidiNoteEventPtr> notes;
+    vp.getVisibleNotes(notes);
+    assertEQ(notes.size(), 2);
+    assert(notes[0] == longNote);
+    assert(notes[1] == later);
+}
+
 void testMidiViewport()
 {
     assertEvCount(0);
@@ -138,6 +178,7 @@ void testMidiViewport()
     testEventAccess();
     testEventFilter();
     testDemoSong();
+    testVisibleNotesLong();
 
     assertEvCount(0);
 }
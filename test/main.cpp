@@ -36,6 +36,7 @@ extern void testAnalyzer();
 extern void testFilter();
 extern void testStochasticGrammar();
 extern void testGMR();
+extern void testGrammarJson();
 extern void testLowpassFilter();
 extern void testPoly();
 extern void testVCO();
@@ -44,9 +45,12 @@ extern void testVCOAlias();
 extern void testSin();
 extern void testRateConversion();
 extern void testDelay();
+extern void testKS();
+extern void testGray();
 extern void testSpline(bool emit);
 extern void testButterLookup();
 extern void testMidiDataModel();
+extern void testMidiTrackCodec();
 extern void testMidiSong();
 extern void testReplaceCommand();
 extern void testUndoRedo();
@@ -60,6 +64,7 @@ extern void testIComposite();
 extern void testMidiEditor();
 extern void testMidiEditorNextPrev();
 extern void testNoteScreenScale();
+extern void testNoteGeometryCache();
 extern void testMidiEditorCCP();
 extern void testMidiEditorSelection();
 extern void testSeqComposite();
@@ -86,6 +91,7 @@ extern void testMidiSelectionModel();
 extern void testMidiTrackPlayer();
 extern void testSuper();
 extern void testEditCommands4();
+extern void testMultiMinBLEPVCO();
 
 #if 0
 #include <sstream>
@@ -172,6 +178,7 @@ int main(int argc, char ** argv)
     testMidiEvents();
     testFilteredIterator();
     testMidiDataModel();
+    testMidiTrackCodec();
     testMidiSelectionModel();
     testMidiSong();
     testSeqClock();
@@ -192,6 +199,7 @@ int main(int argc, char ** argv)
     testMidiEditor();
     testMidiEditorCCP();
     testNoteScreenScale();
+    testNoteGeometryCache();
     testSeqComposite();
     testSeqComposite4();
     testAudition();
@@ -217,6 +225,8 @@ int main(int argc, char ** argv)
     testSaw();
     testClockMult();
     testDelay();
+    testKS();
+    testGray();
     testPoly();
 
     testSinOscillator();
@@ -224,6 +234,7 @@ int main(int argc, char ** argv)
     testButterLookup();
    
     testVCO();
+    testMultiMinBLEPVCO();
    
    // testSin();
 
@@ -233,7 +244,7 @@ int main(int argc, char ** argv)
     testAnalyzer();
     testRateConversion();
     testUtils();
-    //testLowpassFilter();
+    testLowpassFilter();
     testLadder();
     testHighpassFilter();
     testSuper();
@@ -253,6 +264,7 @@ int main(int argc, char ** argv)
 
     testStochasticGrammar();
     testGMR();
+    testGrammarJson();
 
     // after testing all the components, test composites.
     testTremolo();
@@ -166,6 +166,25 @@ static void testShifter()
         }, 1);
 }
 
+static void testShifterPoly()
+{
+    Shifter fs;
+
+    fs.setSampleRate(44100);
+    fs.init();
+
+    fs.inputs[Shifter::AUDIO_INPUT].channels = 16;
+    fs.outputs[Shifter::SIN_OUTPUT].channels = 1;
+    fs.outputs[Shifter::COS_OUTPUT].channels = 1;
+
+    assert(overheadInOut >= 0);
+    MeasureTime<float>::run(overheadInOut, "shifter 16 channel", [&fs]() {
+        fs.inputs[Shifter::AUDIO_INPUT].setVoltage(TestBuffers<float>::get(), 0);
+        fs.step();
+        return fs.outputs[Shifter::SIN_OUTPUT].getVoltage(0);
+        }, 1);
+}
+
 static void testAnimator()
 {
     Animator an;
@@ -183,6 +202,24 @@ static void testAnimator()
 }
 
 
+static void testAnimatorPoly()
+{
+    Animator an;
+
+    an.setSampleRate(44100);
+    an.init();
+
+    an.inputs[Animator::AUDIO_INPUT].channels = 16;
+    an.outputs[Animator::AUDIO_OUTPUT].channels = 1;
+
+    MeasureTime<float>::run(overheadInOut, "animator 16 channel", [&an]() {
+        an.inputs[Animator::AUDIO_INPUT].setVoltage(TestBuffers<float>::get(), 0);
+        an.step();
+        return an.outputs[Animator::AUDIO_OUTPUT].getVoltage(0);
+        }, 1);
+}
+
+
 static void testVocalFilter()
 {
     VocFilter an;
@@ -199,6 +236,23 @@ static void testVocalFilter()
         }, 1);
 }
 
+static void testVocalFilterPoly()
+{
+    VocFilter an;
+
+    an.setSampleRate(44100);
+    an.init();
+
+    an.inputs[VocFilter::AUDIO_INPUT].channels = 16;
+    an.outputs[VocFilter::AUDIO_OUTPUT].channels = 1;
+
+    MeasureTime<float>::run(overheadInOut, "vocal filter 16 channel", [&an]() {
+        an.inputs[VocFilter::AUDIO_INPUT].setVoltage(TestBuffers<float>::get(), 0);
+        an.step();
+        return an.outputs[VocFilter::AUDIO_OUTPUT].getVoltage(0);
+        }, 1);
+}
+
 static void testColors()
 {
     Colors co;
@@ -228,6 +282,27 @@ static void testTremolo()
         }, 1);
 }
 
+static void testTremoloPoly()
+{
+    Trem tr;
+
+    tr.setSampleRate(44100);
+    tr.init();
+    tr.params[Trem::LFO_PHASE_TRIM_PARAM].value = 1;
+    tr.inputs[Trem::AUDIO_INPUT].channels = 16;
+    tr.inputs[Trem::LFO_PHASE_INPUT].channels = 16;
+    tr.outputs[Trem::AUDIO_OUTPUT].channels = 1;
+    for (int i = 0; i < 16; ++i) {
+        tr.inputs[Trem::LFO_PHASE_INPUT].setVoltage(i * .3f, i);
+    }
+
+    MeasureTime<float>::run(overheadInOut, "trem 16 channel poly phase", [&tr]() {
+        tr.inputs[Trem::AUDIO_INPUT].setVoltage(TestBuffers<float>::get(), 0);
+        tr.step();
+        return tr.outputs[Trem::AUDIO_OUTPUT].getVoltage(0);
+        }, 1);
+}
+
 static void testLFN()
 {
     LFN<TestComposite> lfn;
@@ -241,6 +316,21 @@ static void testLFN()
         }, 1);
 }
 
+static void testLFNPoly()
+{
+    LFN<TestComposite> lfn;
+
+    lfn.setSampleTime(1.0f / 96000.f);
+    lfn.init();
+    lfn.inputs[LFN<TestComposite>::EQ0_INPUT].channels = 16;
+    lfn.outputs[LFN<TestComposite>::OUTPUT].channels = 1;
+
+    MeasureTime<float>::run(overheadOutOnly, "lfn 16 channel 96k", [&lfn]() {
+        lfn.step();
+        return lfn.outputs[LFN<TestComposite>::OUTPUT].getVoltage(0);
+        }, 1);
+}
+
 static void testLFNB()
 {
     LFNB<TestComposite> lfn;
@@ -652,14 +742,21 @@ static void testSuper2()
 }
 #endif
 
-static void testKS()
+static void testKS(int channels)
 {
-    KSComposite<TestComposite> gmr;
+    using KS = KSComposite<TestComposite>;
+    KS gmr;
+    gmr.inputs[KS::GATE_INPUT].channels = channels;
+    gmr.outputs[KS::AUDIO_OUTPUT].channels = 1;
+    gmr.step();
+    for (int i = 0; i < channels; ++i) {
+        gmr.inputs[KS::GATE_INPUT].setVoltage(10, i);
+    }
 
-    MeasureTime<float>::run(overheadOutOnly, "ks", [&gmr]() {
-       // gmr.inputs[KSComposite<TestComposite>::INPUT_AUDIO].value = TestBuffers<float>::get();
+    std::string name = "ks " + std::to_string(channels);
+    MeasureTime<float>::run(overheadOutOnly, name.c_str(), [&gmr]() {
         gmr.step();
-        return gmr.outputs[KSComposite<TestComposite>::SQR_OUTPUT].getVoltage(0);
+        return gmr.outputs[KS::AUDIO_OUTPUT].getVoltage(0);
         }, 1);
 }
 
@@ -861,13 +958,18 @@ void perfTest()
 #if 0
     testColors();
     testVocalFilter();
+    testVocalFilterPoly();
     testAnimator();
+    testAnimatorPoly();
     testTremolo();
+    testTremoloPoly();
   
     testShifter();
+    testShifterPoly();
     testGMR();
 #endif
     testLFN();
+    testLFNPoly();
     testLFNB();
 
 
@@ -877,7 +979,8 @@ void perfTest()
     testSuper2();
     testSuper2Stereo();
     testSuper3();
-  //  testKS();
+    testKS(1);
+    testKS(16);
   //  testShaper1a();
 #if 0
     testShaper1b();
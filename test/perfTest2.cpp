@@ -8,6 +8,7 @@
 #include "MixM.h"
 #include "MixStereo.h"
 #include "MultiLag.h"
+#include "MultiMinBLEPVCO.h"
 #include "ObjectCache.h"
 #include "Slew4.h"
 #include "TestComposite.h"
@@ -263,6 +264,55 @@ static void testMixM()
         }, 1);
 }
 
+static void testMinBLEPx4()
+{
+    MinBLEPVCO vcos[4];
+    for (int i = 0; i < 4; ++i) {
+        vcos[i].setNormalizedFreq((200.f + 20 * i) / 44100.f, 1.f / 44100.f);
+    }
+
+    MeasureTime<float>::run(overheadOutOnly, "minblep saw x4", [&vcos]() {
+        float ret = 0;
+        for (int i = 0; i < 4; ++i) {
+            vcos[i].step();
+            ret += vcos[i].getOutput();
+        }
+        return ret;
+        }, 1);
+}
+
+static void testSlew4Poly()
+{
+    Slewer fs;
+
+    fs.init();
+    for (int i = 0; i < Slewer::numRows; ++i) {
+        fs.inputs[Slewer::INPUT_TRIGGER0 + i].channels = 16;
+        fs.outputs[Slewer::OUTPUT0 + i].channels = 1;
+    }
+
+    MeasureTime<float>::run(overheadInOut, "Slade 8 x 16 channels", [&fs]() {
+        for (int i = 0; i < 16; ++i) {
+            fs.inputs[Slewer::INPUT_TRIGGER0].setVoltage(TestBuffers<float>::get(), i);
+        }
+        fs.step();
+        return fs.outputs[Slewer::OUTPUT0].getVoltage(0);
+        }, 1);
+}
+
+static void testMultiMinBLEP()
+{
+    MultiMinBLEPVCO<4> vco;
+    for (int i = 0; i < 4; ++i) {
+        vco.setNormalizedFreq(i, (200.f + 20 * i) / 44100.f, 1.f / 44100.f);
+    }
+
+    MeasureTime<float>::run(overheadOutOnly, "multi minblep saw x4", [&vco]() {
+        vco.step();
+        return vco.getOutput(0) + vco.getOutput(3);
+        }, 1);
+}
+
 void perfTest2()
 {
     assert(overheadInOut > 0);
@@ -272,6 +322,7 @@ void perfTest2()
     testFilt();
     testFilt2();
     testSlew4();
+    testSlew4Poly();
     testMixStereo();
     testMix8();
     testMix4();
@@ -283,4 +334,6 @@ void perfTest2()
     testMultiLPFMod();
     testMultiLag();
     testMultiLagMod();
+    testMinBLEPx4();
+    testMultiMinBLEP();
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "BiquadFilter.h"
 #include "BiquadParams.h"
 #include "BiquadParams.h"
+#include "asserts.h"
 #include "BiquadState.h"
 #include "BiquadState.h"
 
@@ -158,28 +159,48 @@ static void testBasicFilter3()
     BiquadState<T, 2> state;
     ButterworthFilterDesigner<T>::designThreePoleLowpass(params, T(.1));
 
-    T lastValue = 1;
+    T lastValue = -1;
 
-    //the first five values of the step decrease (to -1)
+    // the first five values of the step increase
     for (int i = 0; i < 100; ++i) {
         T temp = BiquadFilter<T>::run(1, state, params);
 
         if (i < 6) {
             // the first 5 are strictly increasing and below 1
-            assert(temp > -1);
-            assert(temp < lastValue);
+            assert(temp < 1);
+            assert(temp > lastValue);
         } else if (i < 10) {
             // the next are all overshoot
-            assert(temp < -1);
-            assert(temp > -1.1);
+            assert(temp > 1);
+            assert(temp < 1.1);
         } else if (i > 400) {
             //settled
-            assert(temp < -.999 && temp > -1.001);
+            assert(temp > .999 && temp < 1.001);
         }
         lastValue = temp;
     }
 }
 
+// the odd order designs used to come out with a DC gain of -1
+template<typename T>
+static void testOddOrderDC()
+{
+    BiquadParams<T, 2> params3;
+    BiquadState<T, 2> state3;
+    ButterworthFilterDesigner<T>::designThreePoleLowpass(params3, T(.01));
+    BiquadParams<T, 3> params5;
+    BiquadState<T, 3> state5;
+    ButterworthFilterDesigner<T>::designFivePoleLowpass(params5, T(.01));
+
+    T out3 = 0;
+    T out5 = 0;
+    for (int i = 0; i < 10000; ++i) {
+        out3 = BiquadFilter<T>::run(1, state3, params3);
+        out5 = BiquadFilter<T>::run(1, state5, params5);
+    }
+    assertClose(out3, 1, .001);
+    assertClose(out5, 1, .001);
+}
 
 void testBiquad()
 {
@@ -201,6 +222,8 @@ void testBiquad()
     testBasicFilter2<float>();
     testBasicFilter3<double>();
     testBasicFilter3<float>();
+    testOddOrderDC<double>();
+    testOddOrderDC<float>();
 
     // TODO: actually measure the freq resp
 }
\ No newline at end of file
@@ -1,8 +1,15 @@
 
 
+#include "AudioMath.h"
 #include "FractionalDelay.h"
 #include "asserts.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using Interp = FractionalDelay::Interpolation;
+
 
 // test that we can set up and get zero output
 static void test0()
@@ -151,6 +158,102 @@ static void test13()
     testRecirc(20, .9f, 100, true);
 }
 
+// integer delays should come out exact with all the kernels
+static void testKernelDelay(Interp interp)
+{
+    FractionalDelay f(100);
+    f.setInterpolation(interp);
+    f.setDelay(10);
+    for (int i = 0; i < 10; ++i) {
+        assertEQ(f.run(1), 0);
+    }
+    assertClose(f.run(1), 1, .000001);
+}
+
+// gain for a sine at fs / 4, delayed by 10.5
+static float gainAtQuarter(Interp interp)
+{
+    FractionalDelay f(100);
+    f.setInterpolation(interp);
+    f.setDelay(10.5f);
+    double inputPower = 0;
+    double outputPower = 0;
+    for (int i = 0; i < 1000; ++i) {
+        const float x = std::sin(float(AudioMath::Pi) * i / 2.f);
+        const float y = f.run(x);
+        if (i >= 500) {
+            inputPower += x * x;
+            outputPower += y * y;
+        }
+    }
+    return float(std::sqrt(outputPower / inputPower));
+}
+
+static void testKernelResponse()
+{
+    assertClose(gainAtQuarter(Interp::Linear), .707, .01);
+    assertClose(gainAtQuarter(Interp::Lagrange3), .884, .01);
+    assertClose(gainAtQuarter(Interp::Allpass), 1, .01);
+}
+
+// block processing should give the same output as sample at a time
+template <class T>
+static void testBlock(Interp interp, float delay, float feedback, int blockSize)
+{
+    T a(1000);
+    T b(1000);
+    for (T* d : { &a, &b}) {
+        d->setInterpolation(interp);
+        d->setDelay(delay);
+        d->setFeedback(feedback);
+    }
+
+    const int total = 1000;
+    std::vector<float> input(total);
+    for (int i = 0; i < total; ++i) {
+        input[i] = float(rand()) / RAND_MAX - .5f;
+    }
+    std::vector<float> output(total);
+    for (int i = 0; i < total; i += blockSize) {
+        b.run(input.data() + i, output.data() + i, std::min(blockSize, total - i));
+    }
+    for (int i = 0; i < total; ++i) {
+        assertClose(output[i], a.run(input[i]), .00001);
+    }
+}
+
+// just so testBlock can treat both delays the same
+class PlainDelay : public FractionalDelay
+{
+public:
+    PlainDelay(int numSamples) : FractionalDelay(numSamples)
+    {
+    }
+    void setFeedback(float)
+    {
+    }
+    using FractionalDelay::run;
+};
+
+static void testBlock(Interp interp)
+{
+    for (int blockSize : { 1, 7, 64, 100}) {
+        testBlock<PlainDelay>(interp, 10.3f, 0, blockSize);
+        testBlock<PlainDelay>(interp, 900.7f, 0, blockSize);
+        testBlock<RecirculatingFractionalDelay>(interp, 3.6f, .9f, blockSize);
+        testBlock<RecirculatingFractionalDelay>(interp, 100.25f, -.5f, blockSize);
+    }
+}
+
+static void testKernels()
+{
+    for (Interp interp : { Interp::Linear, Interp::Lagrange3, Interp::Allpass}) {
+        testKernelDelay(interp);
+        testBlock(interp);
+    }
+    testKernelResponse();
+}
+
 void testDelay()
 {
     test0();
@@ -166,4 +269,6 @@ void testDelay()
     test12();
 
     test13();
+
+    testKernels();
 }
\ No newline at end of file
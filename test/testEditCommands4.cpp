@@ -1,5 +1,6 @@
 
 
+#include "ImportTracksCommand4.h"
 #include "MakeEmptyTrackCommand4.h"
 #include "MidiSequencer4.h"
 #include "MidiSong4.h"
@@ -92,10 +93,47 @@ static void test3()
 
 }
 
+// importing replaces every section, and undo brings them back
+static void testImportTracks()
+{
+    MidiSequencer4Ptr seq = make();
+    Command4Ptr cmd = MakeEmptyTrackCommand4::createAddTrack(seq, 1, 2, TimeUtils::bar2time(2));
+    seq->undo->execute4(seq, cmd);
+    MidiTrackPtr oldTrack = seq->song->getTrack(1, 2);
+    assert(oldTrack);
+
+    std::vector<MidiTrackPtr> tracks;
+    {
+        MidiLocker l(seq->song->lock);
+        for (int i = 0; i < 5; ++i) {
+            tracks.push_back(MidiTrack::makeTest(MidiTrack::TestContent::eightQNotes, seq->song->lock));
+        }
+    }
+    cmd = ImportTracksCommand4::create(seq, tracks);
+    assertEQ(cmd->name, "Load MIDI file");
+    seq->undo->execute4(seq, cmd);
+    for (int row = 0; row < MidiSong4::numTracks; ++row) {
+        assert(seq->song->getTrack(row, 0) == tracks[row]);
+    }
+    assert(!seq->song->getTrack(1, 2));
+    assert(!seq->song->getOptions(1, 2));
+
+    seq->undo->undo4(seq);
+    assert(seq->song->getTrack(1, 2) == oldTrack);
+    assert(seq->song->getOptions(1, 2));
+    for (int row = 0; row < MidiSong4::numTracks; ++row) {
+        assert(!seq->song->getTrack(row, 0));
+    }
+
+    seq->undo->redo4(seq);
+    assert(seq->song->getTrack(0, 0) == tracks[0]);
+    assert(!seq->song->getTrack(1, 2));
+}
 
 void testEditCommands4()
 {
     test1();
     test2();
     test3();
+    testImportTracks();
 }
\ No newline at end of file
@@ -92,9 +92,88 @@ static void test2()
     testPeak(filter, sampleRate, 1600, 10);
 }
 
+/**
+ * The SSE bank should match the scalar TwoStageBandpass, lane by lane.
+ */
+static void testMultiTwoStage()
+{
+    const int n = 8;
+    MultiTwoStageBandpass<n> multi;
+    TwoStageBandpass ref[n];
+    for (int i = 0; i < n; ++i) {
+        const float f = .001f * (i + 1);
+        multi.setFreq(i, f);
+        ref[i].setFreq(f);
+    }
+
+    float input[n];
+    float output[n];
+    for (int sample = 0; sample < 1000; ++sample) {
+        for (int i = 0; i < n; ++i) {
+            input[i] = (sample == 0) ? 1.f : ((sample % (i + 7)) ? 0.f : .5f);
+        }
+        multi.run(input, output, n);
+        for (int i = 0; i < n; ++i) {
+            assertClose(output[i], ref[i].run(input[i]), .0001);
+        }
+    }
+}
+
+/**
+ * GraphicEq2 should be the gain weighted sum of TwoStageBandpass.
+ */
+static void testGeqReference()
+{
+    const int stages = 5;
+    GraphicEq2<stages> geq;
+    TwoStageBandpass ref[stages];
+    float gain[stages] = {.1f, 2, 0, .5f, 1};
+
+    float freq = 100.0f / 44100.0f;
+    for (int i = 0; i < stages; ++i) {
+        ref[i].setFreq(freq);
+        geq.setGain(i, gain[i]);
+        freq *= 2;
+    }
+
+    for (int sample = 0; sample < 1000; ++sample) {
+        const float x = (sample % 13) ? -.1f : 1.f;
+        float expected = 0;
+        for (int i = 0; i < stages; ++i) {
+            expected += ref[i].run(x) * gain[i];
+        }
+        assertClose(geq.run(x), expected, .0001);
+    }
+}
+
+static void testGeqBlock()
+{
+    GraphicEq2<5> geq;
+    GraphicEq2<5> geqBlock;
+    for (int i = 0; i < 5; ++i) {
+        geq.setGain(i, float(i));
+        geqBlock.setGain(i, float(i));
+    }
+
+    const int blockSize = 32;
+    float input[blockSize];
+    float output[blockSize];
+    for (int block = 0; block < 10; ++block) {
+        for (int i = 0; i < blockSize; ++i) {
+            input[i] = float((block * blockSize + i) % 5) - 2;
+        }
+        geqBlock.run(input, output, blockSize);
+        for (int i = 0; i < blockSize; ++i) {
+            assertEQ(output[i], geq.run(input[i]));
+        }
+    }
+}
 
 void testFilter()
 {
     test1<float>();
     test2();
+    testMultiTwoStage();
+    testGeqReference();
+    testGeqBlock();
 }
\ No newline at end of file
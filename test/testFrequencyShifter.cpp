@@ -4,6 +4,9 @@
 #include "FrequencyShifter.h"
 #include "TestComposite.h"
 #include "ExtremeTester.h"
+#include "MultiSinOscillator.h"
+#include "SinOscillator.h"
+#include "asserts.h"
 
 using Shifter = FrequencyShifter<TestComposite>;
 
@@ -57,9 +60,76 @@ static void testExtreme()
     ExtremeTester<Shifter>::test(va, paramLimits, true, "shifter");
 }
 
+// the polynomial sin should be as good as the lookup table
+static void testMultiSin()
+{
+    MultiSinOscillator<8> multi;
+    SinOscillatorParams<float> params[8];
+    SinOscillatorState<float> state[8];
+    for (int c = 0; c < 8; ++c) {
+        const float freq = (c - 3.5f) * .013f;
+        multi.setFrequency(c, freq);
+        SinOscillator<float, true>::setFrequency(params[c], freq);
+    }
+
+    float sinOut[8];
+    float cosOut[8];
+    for (int i = 0; i < 2000; ++i) {
+        multi.runQuadrature(sinOut, cosOut, 8);
+        for (int c = 0; c < 8; ++c) {
+            float s, q;
+            SinOscillator<float, true>::runQuadrature(s, q, state[c], params[c]);
+            assertClose(sinOut[c], s, .001);
+            assertClose(cosOut[c], q, .001);
+        }
+    }
+}
+
+// each channel of a poly shifter should sound like a mono one
+static void testPoly()
+{
+    const int numChannels = 5;
+    Shifter poly;
+    Shifter mono[numChannels];
+    poly.setSampleRate(44100);
+    poly.init();
+    poly.params[Shifter::PITCH_PARAM].value = 1.5f;
+    poly.inputs[Shifter::AUDIO_INPUT].channels = numChannels;
+    poly.inputs[Shifter::CV_INPUT].channels = numChannels;
+    poly.outputs[Shifter::SIN_OUTPUT].channels = 1;
+    poly.outputs[Shifter::COS_OUTPUT].channels = 1;
+    for (int c = 0; c < numChannels; ++c) {
+        mono[c].setSampleRate(44100);
+        mono[c].init();
+        mono[c].params[Shifter::PITCH_PARAM].value = 1.5f;
+        mono[c].inputs[Shifter::AUDIO_INPUT].channels = 1;
+        mono[c].inputs[Shifter::CV_INPUT].channels = 1;
+        mono[c].inputs[Shifter::CV_INPUT].setVoltage(c * .5f, 0);
+        poly.inputs[Shifter::CV_INPUT].setVoltage(c * .5f, c);
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        for (int c = 0; c < numChannels; ++c) {
+            const float x = std::sin(.03f * (c + 1) * i);
+            poly.inputs[Shifter::AUDIO_INPUT].setVoltage(x, c);
+            mono[c].inputs[Shifter::AUDIO_INPUT].setVoltage(x, 0);
+            mono[c].step();
+        }
+        poly.step();
+        assertEQ(int(poly.outputs[Shifter::SIN_OUTPUT].channels), numChannels);
+        assertEQ(int(poly.outputs[Shifter::COS_OUTPUT].channels), numChannels);
+        for (int c = 0; c < numChannels; ++c) {
+            assertClose(poly.outputs[Shifter::SIN_OUTPUT].getVoltage(c), mono[c].outputs[Shifter::SIN_OUTPUT].getVoltage(0), .001);
+            assertClose(poly.outputs[Shifter::COS_OUTPUT].getVoltage(c), mono[c].outputs[Shifter::COS_OUTPUT].getVoltage(0), .001);
+        }
+    }
+}
+
 void testFrequencyShifter()
 {
     test0();
     test1();
     testExtreme();
+    testMultiSin();
+    testPoly();
 }
\ No newline at end of file
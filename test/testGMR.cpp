@@ -37,7 +37,60 @@ static void test0()
     assertEQ(data.size(), 2);
 }
 
+// a grammar handed over from the UI thread gets picked up on the next step
+static void testSetGrammar()
+{
+    G gmr;
+    gmr.setSampleRate(44100);
+    gmr.init();
+
+    auto g = StochasticGrammarDictionary::getGrammar(2);
+    auto grammar = std::make_shared<CompiledGrammar>();
+    grammar->compile(g.rules, g.numRules, g.firstRule);
+
+    assert(gmr.setGrammar(grammar));
+    assert(!gmr.setGrammar(grammar));      // still pending
+
+    gmr.step();
+    assert(gmr.setGrammar(grammar));
+}
+
+static CompiledGrammarPtr makeGrammar(int index)
+{
+    auto g = StochasticGrammarDictionary::getGrammar(index);
+    auto grammar = std::make_shared<CompiledGrammar>();
+    grammar->compile(g.rules, g.numRules, g.firstRule);
+    return grammar;
+}
+
+// the grammar we switch away from is freed on the UI thread, not in step
+static void testRetiredGrammar()
+{
+    G gmr;
+    gmr.setSampleRate(44100);
+    gmr.init();
+
+    std::weak_ptr<const CompiledGrammar> weak;
+    {
+        auto grammar = makeGrammar(1);
+        weak = grammar;
+        assert(gmr.setGrammar(grammar));
+    }
+    gmr.step();
+    assert(!weak.expired());
+
+    assert(gmr.setGrammar(makeGrammar(2)));
+    gmr.step();
+
+    // step let go of grammar 1, but didn't free it
+    assert(!weak.expired());
+    gmr.releaseRetiredGrammar();
+    assert(weak.expired());
+}
+
 void testGMR()
 {
     test0();
+    testSetGrammar();
+    testRetiredGrammar();
 }
\ No newline at end of file
@@ -1,10 +1,12 @@
 
 #include "asserts.h"
 #include "GateTrigger.h"
+#include "MultiGateTrigger.h"
 #include "SchmidtTrigger.h"
 #include "TriggerOutput.h"
 
 #include <stdio.h>
+#include <vector>
 
 static void sc0()
 {
@@ -202,6 +204,54 @@ static void testGateTriggerResetNoResetLogic()
 
 }
 
+/**
+ * Each lane of MultiGateTrigger should behave just like a GateTrigger.
+ */
+static void testMultiMatchesScalar(bool wantResetLogic)
+{
+    const int n = 16;
+    MultiGateTrigger<n> multi(wantResetLogic);
+    std::vector<GateTrigger> ref(n, GateTrigger(wantResetLogic));
+
+    const float levels[] = {0, 10, 1.f, 2.f, .5f, -3, 1.7f, .9f};
+    float input[n];
+    for (int sample = 0; sample < 400; ++sample) {
+        if (sample == 200) {
+            multi.reset();
+            for (int i = 0; i < n; ++i) {
+                ref[i].reset();
+            }
+        }
+        for (int i = 0; i < n; ++i) {
+            input[i] = levels[(sample / (i + 1) + i) % 8];
+        }
+        const uint32_t triggers = multi.go(input, n);
+        assertEQ(triggers, multi.triggers());
+        for (int i = 0; i < n; ++i) {
+            ref[i].go(input[i]);
+            assertEQ(multi.gate(i), ref[i].gate());
+            assertEQ(multi.trigger(i), ref[i].trigger());
+        }
+    }
+}
+
+// only the lanes asked for should be processed
+static void testMultiPartial()
+{
+    MultiGateTrigger<8> multi(false);
+    float input[8] = {10, 10, 10, 10, 10, 10, 10, 10};
+    const uint32_t triggers = multi.go(input, 4);
+    assertEQ(triggers, 0xfu);
+    assertEQ(multi.gates(), 0xfu);
+
+    assertEQ(multi.go(input, 8), 0xf0u);
+    assertEQ(multi.gates(), 0xffu);
+
+    input[5] = 0;
+    assertEQ(multi.go(input, 8), 0u);
+    assertEQ(multi.gates(), 0xdfu);
+}
+
 void testGateTrigger()
 {
     sc0();
@@ -215,5 +265,7 @@ void testGateTrigger()
 
     testGateTriggerResetWithResetLogic();
     testGateTriggerResetNoResetLogic();
-
+    testMultiMatchesScalar(true);
+    testMultiMatchesScalar(false);
+    testMultiPartial();
 }
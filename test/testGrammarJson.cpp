@@ -0,0 +1,107 @@
+
+#include "asserts.h"
+#include "GrammarCache.h"
+#include "GrammarJson.h"
+
+// the example from GrammarJson.h
+static const char* example = R"({
+    "first": "2xw",
+    "rules": [
+        { "key": "2xw", "productions": [ { "p": 1, "to": "w,w" } ] },
+        { "key": "w", "productions": [ { "p": 1, "to": "h,h" } ] },
+        { "key": "h", "productions": [ { "p": 1, "to": "q,q" } ] },
+        { "key": "q", "productions": [ { "p": 0.7 }, { "p": 0.3, "to": "e,e" } ] },
+        { "key": "e", "productions": [ { "p": 1 } ] }
+    ]
+})";
+
+static std::string parse(const std::string& text)
+{
+    ProductionRule rules[fullRuleTableSize];
+    GKEY first = sg_invalid;
+    return GrammarJson::parse(text, rules, first);
+}
+
+static void testParseExample()
+{
+    ProductionRule rules[fullRuleTableSize];
+    GKEY first = sg_invalid;
+    assertEQ(GrammarJson::parse(example, rules, first), "");
+    assertEQ(first, sg_w2);
+
+    assertEQ(rules[sg_w2].entries[0].probability, 1);
+    assertEQ(rules[sg_w2].entries[0].code, sg_ww);
+
+    // probabilities come out cumulative
+    assertClose(rules[sg_q].entries[0].probability, .7f, .0001f);
+    assertEQ(rules[sg_q].entries[0].code, sg_invalid);
+    assertEQ(rules[sg_q].entries[1].probability, 1);
+    assertEQ(rules[sg_q].entries[1].code, sg_ee);
+
+    assertEQ(rules[sg_e].entries[0].probability, 1);
+    assertEQ(rules[sg_e].entries[0].code, sg_invalid);
+
+    // no rule given
+    assert(rules[sg_sx].entries[0] == ProductionRuleEntry());
+    assertEQ(GrammarCache::validate(rules, fullRuleTableSize, first), "");
+}
+
+static void testParseErrors()
+{
+    assertNE(parse(""), "");
+    assertNE(parse("{ \"first\": \"2xw\", "), "");
+    assertNE(parse("[]"), "");
+
+    // first
+    assertNE(parse(R"({ "rules": [] })"), "");
+    assertNE(parse(R"({ "first": "zz", "rules": [] })"), "");
+    assertNE(parse(R"({ "first": 3, "rules": [] })"), "");
+
+    // rules
+    assertNE(parse(R"({ "first": "q" })"), "");
+    assertNE(parse(R"({ "first": "q", "rules": {} })"), "");
+    assertNE(parse(R"({ "first": "q", "rules": [ 7 ] })"), "");
+    assertNE(parse(R"({ "first": "q", "rules": [ { "key": "zz", "productions": [ { "p": 1 } ] } ] })"), "");
+    assertNE(parse(R"({ "first": "q", "rules": [ { "key": "q" } ] })"), "");
+    assertNE(parse(R"({ "first": "q", "rules": [
+        { "key": "q", "productions": [ { "p": 1 } ] },
+        { "key": "q", "productions": [ { "p": 1 } ] } ] })"), "");
+
+    // productions
+    assertNE(parse(R"({ "first": "q", "rules": [ { "key": "q", "productions": [ { "to": "e,e" } ] } ] })"), "");
+    assertNE(parse(R"({ "first": "q", "rules": [ { "key": "q", "productions": [ { "p": 1, "to": "zz" } ] } ] })"), "");
+    assertNE(parse(R"({ "first": "q", "rules": [ { "key": "q", "productions": [
+        { "p": 0.25 }, { "p": 0.25 }, { "p": 0.25 }, { "p": 0.25 } ] } ] })"), "");
+
+    assertEQ(parse(R"({ "first": "q", "rules": [ { "key": "q", "productions": [ { "p": 1 } ] } ] })"), "");
+}
+
+// parses, but the cache won't take it
+static void testCacheValidates()
+{
+    GrammarCache cache;
+    std::string error;
+    CompiledGrammarPtr grammar = cache.get(example, GrammarJson::parse, error);
+    assert(grammar);
+    assertEQ(error, "");
+
+    // doesn't add up to one
+    grammar = cache.get(R"({ "first": "q", "rules": [ { "key": "q", "productions": [ { "p": 0.5 } ] } ] })",
+        GrammarJson::parse, error);
+    assert(!grammar);
+    assertNE(error, "");
+
+    // e has no rule
+    grammar = cache.get(R"({ "first": "q", "rules": [ { "key": "q", "productions": [ { "p": 1, "to": "e,e" } ] } ] })",
+        GrammarJson::parse, error);
+    assert(!grammar);
+    assertNE(error, "");
+    assertEQ(cache.size(), 1);
+}
+
+void testGrammarJson()
+{
+    testParseExample();
+    testParseErrors();
+    testCacheValidates();
+}
@@ -0,0 +1,77 @@
+
+#include "asserts.h"
+#include "Gray.h"
+#include "TestComposite.h"
+
+using G = Gray<TestComposite>;
+
+static void clock(G& gray)
+{
+    gray.inputs[G::INPUT_CLOCK].setVoltage(0, 0);
+    gray.step();
+    gray.inputs[G::INPUT_CLOCK].setVoltage(10, 0);
+    gray.step();
+}
+
+static void checkOutputs(G& gray, uint8_t code)
+{
+    for (int i = 0; i < G::numBits; ++i) {
+        const float expected = (code & (1 << i)) ? 10.f : 0.f;
+        assertEQ(gray.outputs[G::OUTPUT_0 + i].getVoltage(0), expected);
+        assertEQ(gray.outputs[G::OUTPUT_POLY].getVoltage(i), expected);
+        assertEQ(gray.lights[G::LIGHT_0 + i].value, expected);
+    }
+    assertClose(gray.outputs[G::OUTPUT_MIXED].getVoltage(0), code / 25.f, .0001);
+}
+
+static void testCount(bool balanced)
+{
+    G gray;
+    gray.params[G::PARAM_CODE].value = balanced ? 0.f : 1.f;
+    gray.outputs[G::OUTPUT_POLY].channels = 1;
+    const uint8_t* table = balanced ? bgtable : gtable;
+
+    checkOutputs(gray, 0);
+
+    // go all the way around, and a bit more
+    for (int i = 1; i < 300; ++i) {
+        clock(gray);
+        checkOutputs(gray, table[i & 0xff]);
+    }
+    assertEQ(int(gray.outputs[G::OUTPUT_POLY].channels), G::numBits);
+}
+
+// outputs should hold between clocks
+static void testHold()
+{
+    G gray;
+    gray.params[G::PARAM_CODE].value = 1;
+    clock(gray);
+    clock(gray);
+    for (int i = 0; i < 100; ++i) {
+        gray.step();
+        checkOutputs(gray, gtable[2]);
+    }
+}
+
+// switching the code type takes effect on the next clock, and all the bits follow it.
+static void testSwitchCode()
+{
+    G gray;
+    gray.params[G::PARAM_CODE].value = 1;
+    for (int i = 0; i < 20; ++i) {
+        clock(gray);
+    }
+    checkOutputs(gray, gtable[20]);
+    gray.params[G::PARAM_CODE].value = 0;
+    clock(gray);
+    checkOutputs(gray, bgtable[21]);
+}
+
+void testGray()
+{
+    testCount(false);
+    testCount(true);
+    testHold();
+    testSwitchCode();
+}
@@ -4,6 +4,8 @@
 #include "BiquadParams.h"
 #include "BiquadFilter.h"
 #include "BiquadState.h"
+#include "MultiBiquad.h"
+#include "asserts.h"
 
 #include <cmath>
 #include <algorithm>
@@ -72,8 +74,37 @@ static void test()
 
 }
 
+/**
+ * Each channel of a MultiBiquad should match a scalar BiquadFilter.
+ */
+static void testMulti()
+{
+    BiquadParams<float, 3> paramsSin;
+    BiquadParams<float, 3> paramsCos;
+    HilbertFilterDesigner<float>::design(44100, paramsSin, paramsCos);
+
+    const int numChannels = 7;
+    MultiBiquad<8, 3> multi;
+    multi.setParams(paramsSin);
+    BiquadState<float, 3> state[numChannels];
+
+    float input[8] = {0};
+    float output[8];
+    for (int i = 0; i < 1000; ++i) {
+        for (int c = 0; c < numChannels; ++c) {
+            input[c] = std::sin(.01f * (c + 1) * i);
+        }
+        multi.run(input, output, numChannels);
+        for (int c = 0; c < numChannels; ++c) {
+            const float expected = BiquadFilter<float>::run(input[c], state[c], paramsSin);
+            assertClose(output[c], expected, .001);
+        }
+    }
+}
+
 void testHilbert()
 {
     test<double>();
     test<float>();
+    testMulti();
 }
\ No newline at end of file
@@ -0,0 +1,186 @@
+
+#include "asserts.h"
+#include "KSComposite.h"
+#include "MultiKarplusStrong.h"
+#include "TestComposite.h"
+
+#include <vector>
+
+using Strings = MultiKarplusStrong<8>;
+using KS = KSComposite<TestComposite>;
+
+static std::vector<float> pluckAndRun(Strings& s, int lane, int numSamples)
+{
+    s.pluck(1u << lane);
+    std::vector<float> ret;
+    for (int i = 0; i < numSamples; ++i) {
+        s.step(8);
+        ret.push_back(s.get(lane));
+    }
+    return ret;
+}
+
+// find the period with autocorrelation, refine with a parabola
+static float measurePeriod(const std::vector<float>& data, int minLag, int maxLag)
+{
+    const int start = maxLag * 2;
+    auto correlate = [&](int lag) {
+        double sum = 0;
+        for (int i = start; i < int(data.size()); ++i) {
+            sum += data[i] * data[i - lag];
+        }
+        return sum;
+    };
+    int best = minLag;
+    double bestValue = correlate(minLag);
+    for (int lag = minLag + 1; lag <= maxLag; ++lag) {
+        const double value = correlate(lag);
+        if (value > bestValue) {
+            best = lag;
+            bestValue = value;
+        }
+    }
+    const double a = correlate(best - 1);
+    const double c = correlate(best + 1);
+    return float(best + .5 * (a - c) / (a - 2 * bestValue + c));
+}
+
+static void testStringSilent()
+{
+    Strings s;
+    s.setMaxDelay(1000);
+    for (int i = 0; i < 8; ++i) {
+        s.setDelay(i, 100);
+        s.setFeedback(i, .99f);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        s.step(8);
+        for (int j = 0; j < 8; ++j) {
+            assertEQ(s.get(j), 0);
+        }
+    }
+}
+
+static void testStringPitch(float delay)
+{
+    Strings s;
+    s.setMaxDelay(1000);
+    s.setDelay(3, delay);
+    s.setFeedback(3, .999f);
+    auto data = pluckAndRun(s, 3, 4000);
+    assertClose(measurePeriod(data, int(delay) - 5, int(delay) + 5), delay, .15);
+}
+
+// each voice has its own pitch, and plucking one doesn't bother the others
+static void testStringsIndependent()
+{
+    Strings s;
+    s.setMaxDelay(1000);
+    for (int i = 0; i < 8; ++i) {
+        s.setDelay(i, 50.f + 10 * i);
+        s.setFeedback(i, .99f);
+    }
+    s.pluck(1u << 5);
+    float maxOther = 0;
+    float max5 = 0;
+    for (int i = 0; i < 2000; ++i) {
+        s.step(8);
+        for (int j = 0; j < 8; ++j) {
+            const float x = std::abs(s.get(j));
+            if (j == 5) {
+                max5 = std::max(max5, x);
+            } else {
+                maxOther = std::max(maxOther, x);
+            }
+        }
+    }
+    assertGT(max5, .1);
+    assertEQ(maxOther, 0);
+}
+
+static float energy(const std::vector<float>& data, int first, int last)
+{
+    float ret = 0;
+    for (int i = first; i < last; ++i) {
+        ret += data[i] * data[i];
+    }
+    return ret;
+}
+
+static void testStringDecay()
+{
+    Strings fast;
+    Strings slow;
+    for (Strings* s : { &fast, &slow}) {
+        s->setMaxDelay(1000);
+        s->setDelay(0, 100);
+    }
+    fast.setFeedback(0, .9f);
+    slow.setFeedback(0, .999f);
+    auto fastData = pluckAndRun(fast, 0, 5000);
+    auto slowData = pluckAndRun(slow, 0, 5000);
+    assertLT(energy(fastData, 4000, 5000), energy(slowData, 4000, 5000) * .01f);
+    assertLT(energy(slowData, 4000, 5000), energy(slowData, 0, 1000));
+}
+
+static void testCompositePoly()
+{
+    KS ks;
+    ks.params[KS::DECAY_PARAM].value = .5f;
+    ks.params[KS::BRIGHTNESS_PARAM].value = 1;
+    ks.inputs[KS::GATE_INPUT].channels = 5;
+    ks.outputs[KS::AUDIO_OUTPUT].channels = 1;
+
+    // gate has to be low first, so it's not ignored after reset
+    ks.step();
+    ks.inputs[KS::GATE_INPUT].setVoltage(10, 3);
+
+    float max3 = 0;
+    float maxOther = 0;
+    for (int i = 0; i < 1000; ++i) {
+        ks.step();
+        for (int j = 0; j < 5; ++j) {
+            const float x = std::abs(ks.outputs[KS::AUDIO_OUTPUT].getVoltage(j));
+            if (j == 3) {
+                max3 = std::max(max3, x);
+            } else {
+                maxOther = std::max(maxOther, x);
+            }
+        }
+    }
+    assertEQ(int(ks.outputs[KS::AUDIO_OUTPUT].channels), 5);
+    assertGT(max3, 1);
+    assertEQ(maxOther, 0);
+}
+
+// 0v should be middle C
+static void testCompositePitch()
+{
+    KS ks;
+    ks.params[KS::DECAY_PARAM].value = 1;
+    ks.inputs[KS::GATE_INPUT].channels = 1;
+    ks.outputs[KS::AUDIO_OUTPUT].channels = 1;
+    ks.step();
+    ks.inputs[KS::GATE_INPUT].setVoltage(10, 0);
+
+    std::vector<float> data;
+    for (int i = 0; i < 4000; ++i) {
+        ks.step();
+        data.push_back(ks.outputs[KS::AUDIO_OUTPUT].getVoltage(0));
+    }
+    const float expectedPeriod = 44100.f / 261.626f;
+    assertClose(measurePeriod(data, 160, 180), expectedPeriod, .5);
+}
+
+void testKS()
+{
+    testStringSilent();
+    testStringPitch(100);
+    testStringPitch(100.3f);
+    testStringPitch(100.5f);
+    testStringPitch(20.7f);
+    testStringsIndependent();
+    testStringDecay();
+    testCompositePoly();
+    testCompositePitch();
+}
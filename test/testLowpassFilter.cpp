@@ -6,6 +6,8 @@
 #include "Analyzer.h"
 #include "asserts.h"
 #include "LFN.h"
+#include "LFNB.h"
+#include "MultirateStage.h"
 #include "TestComposite.h"
 #include "TrapezoidalLowpass.h"
 
@@ -409,6 +411,103 @@ static void decimate1()
     assertEQ(x, 5);
 }
 
+static void multirate0()
+{
+    MultirateStage<4> stage;
+    stage.setDecimationRate(10);
+    stage.designImagingFilter(.001f);
+
+    int calls[4] = {0};
+    float out[4];
+    for (int i = 0; i < 10000; ++i) {
+        stage.step(3, out, [&calls](int channel) {
+            ++calls[channel];
+            return float(channel + 1);
+        });
+    }
+    // one call per channel every 10 samples
+    assertEQ(calls[0], 1000);
+    assertEQ(calls[1], 1000);
+    assertEQ(calls[2], 1000);
+    assertEQ(calls[3], 0);
+
+    // DC should come through
+    assertClose(out[0], 1, .001);
+    assertClose(out[1], 2, .001);
+    assertClose(out[2], 3, .001);
+}
+
+static void multirateFractional()
+{
+    MultirateStage<4> stage;
+    stage.setDecimationRate(12.5f);
+    int calls = 0;
+    float out[4];
+    for (int i = 0; i < 10000; ++i) {
+        stage.step(1, out, [&calls](int) {
+            ++calls;
+            return 0.f;
+        });
+    }
+    assertEQ(calls, 800);
+}
+
+/**
+ * LFN should run its EQ at the same rate no matter the sample rate.
+ */
+static void lfnSampleRate()
+{
+    LFN<TestComposite> lfn44;
+    lfn44.setSampleTime(1.f / 44100.f);
+    lfn44.init();
+
+    LFN<TestComposite> lfn96;
+    lfn96.setSampleTime(1.f / 96000.f);
+    lfn96.init();
+
+    assertClose(lfn44.getDecimationRate(), 100, .001);
+    assertClose(lfn96.getDecimationRate() / lfn44.getDecimationRate(), 96000.f / 44100.f, .001);
+}
+
+static void lfnPoly()
+{
+    using Comp = LFN<TestComposite>;
+    Comp lfn;
+    lfn.setSampleTime(1.f / 44100.f);
+    lfn.init();
+    lfn.inputs[Comp::EQ0_INPUT].channels = 4;
+    lfn.outputs[Comp::OUTPUT].channels = 1;
+    for (int i = 0; i < 10000; ++i) {
+        lfn.step();
+    }
+    assertEQ(int(lfn.outputs[Comp::OUTPUT].channels), 4);
+    for (int i = 0; i < 4; ++i) {
+        assertNE(lfn.outputs[Comp::OUTPUT].getVoltage(i), 0);
+    }
+    // each channel is its own noise source
+    assertNE(lfn.outputs[Comp::OUTPUT].getVoltage(0), lfn.outputs[Comp::OUTPUT].getVoltage(1));
+}
+
+static void lfnbPoly()
+{
+    using Comp = LFNB<TestComposite>;
+    Comp lfnb;
+    lfnb.init();
+    lfnb.onSampleRateChange();
+    lfnb.inputs[Comp::FC0_INPUT].channels = 3;
+    lfnb.outputs[Comp::AUDIO0_OUTPUT].channels = 1;
+    lfnb.outputs[Comp::AUDIO1_OUTPUT].channels = 1;
+    for (int i = 0; i < 10000; ++i) {
+        lfnb.step();
+    }
+    for (int side = 0; side < 2; ++side) {
+        assertEQ(int(lfnb.outputs[Comp::AUDIO0_OUTPUT + side].channels), 3);
+        for (int i = 0; i < 3; ++i) {
+            assertNE(lfnb.outputs[Comp::AUDIO0_OUTPUT + side].getVoltage(i), 0);
+        }
+    }
+}
+
 static void testCVFeedthrough()
 {
     testCVFeedthroughSimple();
@@ -425,6 +524,11 @@ void testLowpassFilter()
     testTrapDCd();
     decimate0();
     decimate1();
+    multirate0();
+    multirateFractional();
+    lfnSampleRate();
+    lfnPoly();
+    lfnbPoly();
 }
 
 /*********************************************************************************
@@ -535,6 +639,77 @@ static void testMultiLagDisable()
 
 }
 
+/**
+ * With the same L in every lane, should match MultiLag.
+ * Each lane should use its own L.
+ */
+static void testMultiLagPerLane()
+{
+    MultiLag<8> ref;
+    ref.setAttackL(.9f);
+    ref.setReleaseL(.99f);
+
+    MultiLagPerLane<8> dut;
+    for (int i = 0; i < 8; ++i) {
+        dut.setAttackL(i, .9f);
+        dut.setReleaseL(i, .99f);
+    }
+
+    for (int n = 0; n < 100; ++n) {
+        float input[8];
+        for (int i = 0; i < 8; ++i) {
+            input[i] = (n < 50) ? float(i) : 0.f;
+        }
+        ref.step(input);
+        dut.step(input, 8);
+        for (int i = 0; i < 8; ++i) {
+            assertEQ(dut.get(i), ref.get(i));
+        }
+    }
+
+    MultiLagPerLane<8> lanes;
+    for (int i = 0; i < 8; ++i) {
+        lanes.setAttackL(i, .9f);
+    }
+    lanes.setAttackL(1, .5f);
+    const float input[8] = {10, 10, 10, 10, 10, 10, 10, 10};
+    lanes.step(input, 8);
+    assertGT(lanes.get(1), lanes.get(0));
+    assertEQ(lanes.get(2), lanes.get(0));
+
+    // lanes past numLanes are not touched
+    MultiLagPerLane<8> partial;
+    partial.setAttackL(4, .5f);
+    partial.step(input, 4);
+    assertEQ(partial.get(4), 0);
+}
+
+static void testMultiLagPerLaneBlock()
+{
+    MultiLagPerLane<8> dut;
+    MultiLagPerLane<8> blockDut;
+    for (int i = 0; i < 8; ++i) {
+        dut.setAttackL(i, .9f - .1f * i);
+        dut.setReleaseL(i, .99f);
+        blockDut.setAttackL(i, .9f - .1f * i);
+        blockDut.setReleaseL(i, .99f);
+    }
+
+    const int numSamples = 16;
+    float input[numSamples * 8];
+    float output[numSamples * 8];
+    for (int i = 0; i < numSamples * 8; ++i) {
+        input[i] = float(i % 11);
+    }
+    blockDut.step(input, output, 8, numSamples);
+    for (int n = 0; n < numSamples; ++n) {
+        dut.step(input + n * 8, 8);
+        for (int i = 0; i < 8; ++i) {
+            assertEQ(output[n * 8 + i], dut.get(i));
+        }
+    }
+}
+
 
 template <typename T>
 static void tlp()
@@ -594,4 +769,6 @@ void testMultiLag()
     testMultiLag1();
     testMultiLag2();
     testMultiLagDisable();
+    testMultiLagPerLane();
+    testMultiLagPerLaneBlock();
 }
\ No newline at end of file
@@ -273,6 +273,86 @@ static void testNoteTimeRange1()
     assertEQ(count, 2);
 }
 
+static MidiNoteEventPtr insertNote(MidiTrack& mt, float start, float duration)
+{
+    MidiNoteEventPtr ev = std::make_shared<MidiNoteEvent>();
+    ev->startTime = start;
+    ev->duration = duration;
+    mt.insertEvent(ev);
+    return ev;
+}
+
+static void testNotesOverlapping()
+{
+    auto lock = MidiLock::make();
+    MidiTrack mt(lock);
+    MidiLocker l(lock);
+
+    auto longNote = insertNote(mt, 0, 100);     // held through everything
+    insertNote(mt, 10, 1);                      // over before the range
+    auto tied = insertNote(mt, 19, 2);          // tied into the range
+    auto inside = insertNote(mt, 22, 1);
+    insertNote(mt, 30, 1);                      // starts at the end, so not included
+    MidiTestEventPtr evt = std::make_shared<MidiTestEvent>();
+    evt->startTime = 25;
+    mt.insertEvent(evt);
+    mt.insertEnd(200);
+
+    std::vector<MidiNoteEventPtr> notes;
+    mt.getNotesOverlapping(20, 30, notes);
+    assertEQ(notes.size(), 3);
+    assert(notes[0] == longNote);
+    assert(notes[1] == tied);
+    assert(notes[2] == inside);
+
+    // editing the track has to update the index
+    mt.deleteEvent(*longNote);
+    mt.getNotesOverlapping(20, 30, notes);
+    assertEQ(notes.size(), 2);
+    auto added = insertNote(mt, 5, 20);
+    mt.getNotesOverlapping(20, 30, notes);
+    assertEQ(notes.size(), 3);
+    assert(notes[0] == added);
+}
+
+// compare against checking every note
+static void testNotesOverlappingRandom()
+{
+    auto lock = MidiLock::make();
+    MidiTrack mt(lock);
+    MidiLocker l(lock);
+
+    uint32_t seed = 12345;
+    auto random = [&seed](float range) {
+        seed = seed * 1664525u + 1013904223u;
+        return range * float(seed >> 8) / float(1 << 24);
+    };
+    std::vector<MidiNoteEventPtr> all;
+    for (int i = 0; i < 500; ++i) {
+        // mostly short notes, some very long ones
+        const float duration = (i % 50) ? .1f + random(2) : random(100);
+        all.push_back(insertNote(mt, random(400), duration));
+    }
+
+    std::vector<MidiNoteEventPtr> notes;
+    for (int i = 0; i < 100; ++i) {
+        const float start = random(400);
+        const float end = start + random(20);
+        mt.getNotesOverlapping(start, end, notes);
+
+        int expected = 0;
+        for (auto note : all) {
+            if (note->startTime < end && note->startTime + note->duration > start) {
+                ++expected;
+            }
+        }
+        assertEQ(int(notes.size()), expected);
+        for (int j = 1; j < int(notes.size()); ++j) {
+            assertLE(notes[j - 1]->startTime, notes[j]->startTime);
+        }
+    }
+}
+
 static void testSeekTime1()
 {
     auto lock = MidiLock::make();
@@ -380,6 +460,8 @@ void testMidiDataModel()
     testNoteTimeRange0Mixed();
     testTimeRange1();
     testNoteTimeRange1();
+    testNotesOverlapping();
+    testNotesOverlappingRandom();
     testSameTime();
     testSeekTime1();
     testSeekTime2();
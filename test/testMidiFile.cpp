@@ -1,11 +1,15 @@
 
 #define __STDC_WANT_LIB_EXT1__ 1        // to get tempnam_s
+#include "MidiFile.h"
+#include "MidiLock.h"
 #include "MidiSong.h"
+#include "MidiSong4.h"
 #include "MidiTrack.h"
 #include "MidiFileProxy.h"
 #include "asserts.h"
 //#include <filesystem>
 
+#include <sstream>
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -84,9 +88,185 @@ static void test2()
 }
 #endif
 
+static void testLoadSong4()
+{
+#if defined(_MSC_VER)
+    const char* path = "..\\..\\test\\test1.mid";
+#else
+    const char* path = "./test/test1.mid";
+#endif
+    MidiSong4Ptr song = MidiFileProxy::loadSong4(path);
+    assert(song);
+    assertEQ(song->getTrack(0, 0)->size(), 3);
+    assert(!song->getTrack(1, 0));
+}
+
+static std::vector<uint8_t> toBytes(smf::MidiFile& midiFile)
+{
+    std::stringstream stream;
+    bool b = midiFile.write(stream);
+    assert(b);
+    const std::string str = stream.str();
+    return std::vector<uint8_t>(str.begin(), str.end());
+}
+
+/**
+ * A conductor track with no notes, then numTracks tracks of notes,
+ * each on its own channel.
+ */
+static smf::MidiFile makeMultiTrackFile(int numTracks, int notesPerTrack)
+{
+    smf::MidiFile midiFile;
+    midiFile.setTPQ(480);
+    midiFile.addTracks(numTracks);
+    midiFile.addTempo(0, 0, 100);
+    for (int tk = 1; tk <= numTracks; ++tk) {
+        midiFile.addTrackName(tk, 0, "track");
+        int tick = 0;
+        for (int i = 0; i < notesPerTrack; ++i) {
+            const int key = 30 + ((i * 7 + tk) % 60);
+            const int duration = 60 + 60 * (i % 4);
+            midiFile.addNoteOn(tk, tick, tk % 16, key, 64);
+            midiFile.addNoteOff(tk, tick + duration, tk % 16, key);
+            // chords every so often
+            if (i % 5 == 0) {
+                midiFile.addNoteOn(tk, tick, tk % 16, key + 4, 64);
+                midiFile.addNoteOff(tk, tick + 240, tk % 16, key + 4);
+            }
+            tick += 120 * (1 + (i % 3));
+        }
+    }
+    midiFile.sortTracks();
+    return midiFile;
+}
+
+static void assertSameNotes(MidiTrackPtr t1, MidiTrackPtr t2)
+{
+    assertEQ(t1->size(), t2->size());
+    auto it2 = t2->begin();
+    for (auto it1 : *t1) {
+        MidiEventPtr ev1 = it1.second;
+        MidiEventPtr ev2 = it2->second;
+        assert(*ev1 == *ev2);
+        ++it2;
+    }
+}
+
+// parse should get the same result as the old smf::MidiFile path
+static void testParseSameAsSmf()
+{
+    smf::MidiFile midiFile = makeMultiTrackFile(3, 100);
+    auto data = toBytes(midiFile);
+
+    std::vector<MidiTrackPtr> tracks;
+    auto lock = MidiLock::make();
+    std::string err = MidiFileProxy::parse(data, lock, tracks);
+    assert(err.empty());
+    assertEQ(tracks.size(), 3);
+
+    smf::MidiFile smfFile;
+    std::stringstream stream(std::string(data.begin(), data.end()));
+    bool b = smfFile.read(stream);
+    assert(b);
+    smfFile.makeAbsoluteTicks();
+    smfFile.linkNotePairs();
+    MidiSongPtr song = std::make_shared<MidiSong>();
+    MidiTrackPtr oldTrack = MidiFileProxy::getFirst(song, smfFile);
+    assert(oldTrack);
+    assertSameNotes(oldTrack, tracks[0]);
+
+    MidiLocker l(lock);
+    for (auto track : tracks) {
+        track->assertValid();
+    }
+}
+
+// hand made track using running status, and note on velocity zero for note off
+static void testParseRunningStatus()
+{
+    std::vector<uint8_t> data = {
+        'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0, 96,
+        'M', 'T', 'r', 'k', 0, 0, 0, 17,
+        0, 0x90, 60, 100,       // note on at 0
+        0, 64, 100,             // running status note on at 0
+        96, 60, 0,              // off at 96 (one quarter)
+        48, 64, 0,              // off at 144
+        0, 0xff, 0x2f, 0        // end of track
+    };
+    std::vector<MidiTrackPtr> tracks;
+    auto lock = MidiLock::make();
+    std::string err = MidiFileProxy::parse(data, lock, tracks);
+    assert(err.empty());
+    assertEQ(tracks.size(), 1);
+
+    MidiLocker l(lock);
+    MidiTrackPtr track = tracks[0];
+    track->assertValid();
+    assertEQ(track->size(), 3);
+    auto notes = track->_testGetVector();
+    MidiNoteEventPtr n0 = safe_cast<MidiNoteEvent>(notes[0]);
+    MidiNoteEventPtr n1 = safe_cast<MidiNoteEvent>(notes[1]);
+    assertEQ(n0->startTime, 0);
+    assertEQ(n0->duration, 1);
+    assertEQ(n0->pitchCV, PitchUtils::midiToCV(60));
+    assertEQ(n1->duration, 1.5);
+    assertEQ(n1->pitchCV, PitchUtils::midiToCV(64));
+    assertEQ(track->getLength(), 1.5);
+}
+
+static void testParseBadData()
+{
+    smf::MidiFile midiFile = makeMultiTrackFile(2, 10);
+    auto data = toBytes(midiFile);
+    auto lock = MidiLock::make();
+    std::vector<MidiTrackPtr> tracks;
+
+    // anything cut off in the header or the track data should fail, not crash
+    for (size_t i = 0; i < data.size(); ++i) {
+        auto bad = data;
+        bad.resize(i);
+        std::string err = MidiFileProxy::parse(bad, lock, tracks);
+        assert(!err.empty() || tracks.size() < 2);
+    }
+
+    auto bad = data;
+    bad[0] = 'X';
+    assert(!MidiFileProxy::parse(bad, lock, tracks).empty());
+}
+
+// each track of the file should go in its own row, so they all play at once
+static void testLoadSong4MultiTrack()
+{
+#if defined(_MSC_VER)
+    const char* path = "..\\..\\test\\_song4.mid";
+#else
+    const char* path = "./test/_song4.mid";
+#endif
+    smf::MidiFile midiFile = makeMultiTrackFile(6, 10);
+    bool b = midiFile.write(path);
+    assert(b);
+
+    MidiSong4Ptr song = MidiFileProxy::loadSong4(path);
+    remove(path);
+    assert(song);
+    for (int row = 0; row < MidiSong4::numTracks; ++row) {
+        MidiTrackPtr track = song->getTrack(row, 0);
+        assert(track);
+        assertGT(track->size(), 10);
+        for (int section = 1; section < MidiSong4::numSectionsPerTrack; ++section) {
+            assert(!song->getTrack(row, section));
+        }
+    }
+}
+
 void testMidiFile()
 {
     test1();
+    testLoadSong4();
+    testParseSameAsSmf();
+    testParseRunningStatus();
+    testParseBadData();
+    testLoadSong4MultiTrack();
 #ifdef _TMPNAM
     test2();
 #endif
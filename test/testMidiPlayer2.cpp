@@ -530,6 +530,127 @@ static void testVoiceAssignBug()
     assert(p->_getIndex() != 0);
 }
 
+static void testVoiceAssignBusyMask()
+{
+    MidiVoice vx[4];
+    MidiVoiceAssigner va(vx, 4);
+    TestHost2 th;
+    initVoices(vx, 4, &th);
+    assertEQ(va.getBusyVoices(), 0);
+
+    vx[2].playNote(1, 0, 1);
+    assertEQ(va.getBusyVoices(), 4);
+    vx[0].playNote(1, 0, 2);
+    assertEQ(va.getBusyVoices(), 5);
+
+    vx[2].updateToMetricTime(1);
+    assertEQ(va.getBusyVoices(), 1);
+
+    // re-triggering counts as busy
+    vx[2].playNote(1, 1, 2);
+    assert(vx[2].state() == MidiVoice::State::ReTriggering);
+    assertEQ(va.getBusyVoices(), 5);
+
+    vx[0].reset(true);
+    vx[2].reset(true);
+    assertEQ(va.getBusyVoices(), 0);
+}
+
+// plays a four note chord into four voices, and leaves them all playing
+static void playChord(MidiVoiceAssigner& va, const float* pitches)
+{
+    for (int i = 0; i < 4; ++i) {
+        MidiVoice* p = va.getNext(pitches[i]);
+        p->playNote(pitches[i], 0, 10);
+    }
+}
+
+static void testVoiceAssignModeRotate()
+{
+    MidiVoice vx[2];
+    MidiVoiceAssigner va(vx, 2);
+    TestHost2 th;
+    initVoices(vx, 2, &th);
+    va.setMode(MidiVoiceAssigner::Mode::Rotate);
+
+    MidiVoice* p = va.getNext(0);
+    assert(p == vx);
+    p->playNote(0, 0, 1);
+    p->updateToMetricTime(1);
+
+    // ReUse would go back to voice 0 for the same pitch
+    p = va.getNext(0);
+    assert(p == vx + 1);
+    p->playNote(0, 1, 2);
+    p->updateToMetricTime(2);
+
+    p = va.getNext(0);
+    assert(p == vx);
+}
+
+static void testVoiceAssignModeStealOldest()
+{
+    MidiVoice vx[4];
+    MidiVoiceAssigner va(vx, 4);
+    TestHost2 th;
+    initVoices(vx, 4, &th);
+    va.setMode(MidiVoiceAssigner::Mode::StealOldest);
+
+    const float pitches[] = {3, 2, 1, 0};
+    playChord(va, pitches);
+    assertEQ(va.getBusyVoices(), 15);
+
+    // voice 0 got the oldest note. Re-use it, and then voice 1 is the oldest.
+    MidiVoice* p = va.getNext(4);
+    assert(p == vx);
+    p->playNote(4, 1, 10);
+    p = va.getNext(5);
+    assert(p == vx + 1);
+    p->playNote(5, 1, 10);
+
+    // voice 2 ends, so the idle voice wins
+    vx[2].updateToMetricTime(20);
+    p = va.getNext(6);
+    assert(p == vx + 2);
+}
+
+static void testVoiceAssignModeStealLowest()
+{
+    MidiVoice vx[4];
+    MidiVoiceAssigner va(vx, 4);
+    TestHost2 th;
+    initVoices(vx, 4, &th);
+    va.setMode(MidiVoiceAssigner::Mode::StealLowest);
+
+    const float pitches[] = {1, 3, -2, 0};
+    playChord(va, pitches);
+    assertEQ(va.getBusyVoices(), 15);
+
+    MidiVoice* p = va.getNext(4);
+    assert(p == vx + 2);
+    p->playNote(4, 1, 10);
+
+    p = va.getNext(5);
+    assert(p == vx + 3);
+}
+
+// the voice count limits which voices are free
+static void testVoiceAssignNumVoicesMask()
+{
+    MidiVoice vx[4];
+    MidiVoiceAssigner va(vx, 4);
+    TestHost2 th;
+    initVoices(vx, 4, &th);
+    va.setNumVoices(2);
+
+    for (int i = 0; i < 4; ++i) {
+        MidiVoice* p = va.getNext(float(i));
+        assert(p == vx + (i % 2));
+        p->playNote(float(i), 0, 10);
+    }
+    assertEQ(va.getBusyVoices(), 3);
+}
+
 //********************* test helper functions ************************************************
 
 // song has an eight note starting at time 0
@@ -1160,6 +1281,11 @@ void testMidiPlayer2()
     testVoiceAssignRotate();
     testVoiceAssignRetrigger();
     testVoiceAssignBug();
+    testVoiceAssignBusyMask();
+    testVoiceAssignModeRotate();
+    testVoiceAssignModeStealOldest();
+    testVoiceAssignModeStealLowest();
+    testVoiceAssignNumVoicesMask();
 
     playerTests<MidiPlayer2, TestHost2, MidiSong, true>(false);
     playerTests<MidiPlayer4, TestHost4, MidiSong4, false>(true);
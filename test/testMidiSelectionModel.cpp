@@ -175,6 +175,60 @@ static void testSelectionSelectAll2()
 
 }
 
+// a clone has the same value, but isn't the same object
+static void testSelectionIdentity()
+{
+    auto a = std::make_shared<TestAuditionHost>();
+    MidiSelectionModel sel(a);
+    MidiNoteEventPtr note1 = std::make_shared<MidiNoteEvent>();
+    note1->startTime = 1;
+    note1->pitchCV = 1.1f;
+    MidiEventPtr cloneNote1 = note1->clone();
+
+    sel.select(note1);
+    assert(sel.isSelected(note1));
+    assert(!sel.isSelected(cloneNote1));
+    assert(sel.isSelectedDeep(cloneNote1));
+
+    // -0 and 0 are ==, so should be the same
+    MidiNoteEventPtr zero = std::make_shared<MidiNoteEvent>();
+    zero->pitchCV = 0;
+    MidiNoteEventPtr minusZero = std::make_shared<MidiNoteEvent>();
+    minusZero->pitchCV = -0.f;
+    sel.select(zero);
+    assert(sel.isSelectedDeep(minusZero));
+}
+
+// iteration is in time order, however things were added
+static void testSelectionOrder()
+{
+    auto a = std::make_shared<TestAuditionHost>();
+    MidiSelectionModel sel(a);
+    sel.setAuditionSuppressed(true);
+    for (int i = 0; i < 100; ++i) {
+        MidiNoteEventPtr note = std::make_shared<MidiNoteEvent>();
+        note->startTime = float((i * 37) % 100);
+        sel.extendSelection(note);
+    }
+    assertEQ(sel.size(), 100);
+
+    float expected = 0;
+    for (auto ev : sel) {
+        assertEQ(ev->startTime, expected);
+        expected += 1;
+    }
+
+    // removing one keeps the rest in order
+    auto v = sel.asVector();
+    sel.removeFromSelection(v[50]);
+    auto it = sel.begin();
+    for (int i = 0; i < 50; ++i) {
+        ++it;
+    }
+    assertEQ((*it)->startTime, 51);
+    assertEQ((*sel.rbegin())->startTime, 99);
+}
+
 void testMidiSelectionModel()
 {
     testExtendSelection();
@@ -184,4 +238,6 @@ void testMidiSelectionModel()
     testSelectionAddTwice();
     testSelectionSelectAll();
     testSelectionSelectAll2();
+    testSelectionIdentity();
+    testSelectionOrder();
 }
\ No newline at end of file
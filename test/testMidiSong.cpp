@@ -3,6 +3,7 @@
 #include "MidiSong.h"
 #include "MidiSong4.h"
 #include "MidiTrack.h"
+#include "MidiTrackSchedule.h"
 #include "SqClipboard.h"
 #include "TimeUtils.h"
 
@@ -86,6 +87,64 @@ static void testSong4_2()
     assertEQ(song->getTrackLength(2), TimeUtils::quarterNote() * 8);
 }
 
+// schedules get made when the editor unlocks, and only for sections that changed
+static void testSong4Schedules()
+{
+    MidiSong4Ptr song = MidiSong4::makeTest(MidiTrack::TestContent::eightQNotes, 1, 2);
+    MidiTrackPtr track = song->getTrack(1, 2);
+    const MidiTrackSchedule* schedule = song->getSchedule(1, 2);
+    assert(schedule);
+    assert(schedule->isPlayable());
+    assert(schedule->track == track.get());
+    assertEQ(schedule->events.size(), track->size());
+    assert(!song->getSchedule(1, 1));
+    const uint32_t serial = schedule->serial;
+
+    // locking without an edit keeps the old one
+    {
+        MidiLocker l(song->lock);
+    }
+    assertEQ(song->getSchedule(1, 2)->serial, serial);
+
+    // the edit isn't seen until the editor unlocks
+    {
+        MidiLocker l(song->lock);
+        MidiNoteEventPtr note = std::make_shared<MidiNoteEvent>();
+        note->startTime = 1.5;
+        note->pitchCV = 3;
+        track->insertEvent(note);
+        {
+            MidiLocker l2(song->lock);
+        }
+        assertEQ(song->getSchedule(1, 2)->serial, serial);
+    }
+    schedule = song->getSchedule(1, 2);
+    assertNE(schedule->serial, serial);
+    assertEQ(schedule->events.size(), track->size());
+    bool found = false;
+    for (auto ev : schedule->events) {
+        if (ev.startTime == 1.5f && ev.pitchCV == 3) {
+            found = true;
+        }
+    }
+    assert(found);
+
+    // replacing or removing a section's track
+    {
+        MidiLocker l(song->lock);
+        song->addTrack(1, 2, MidiTrack::makeTest(MidiTrack::TestContent::empty, song->lock));
+        song->addTrack(3, 0, MidiTrack::makeTest(MidiTrack::TestContent::oneNote123, song->lock));
+    }
+    assert(song->getSchedule(1, 2)->track == song->getTrack(1, 2).get());
+    assertEQ(song->getSchedule(1, 2)->events.size(), 1);
+    assert(song->getSchedule(3, 0)->track == song->getTrack(3, 0).get());
+    {
+        MidiLocker l(song->lock);
+        song->addTrack(3, 0, nullptr);
+    }
+    assert(!song->getSchedule(3, 0));
+}
+
 void testMidiSong()
 {
     test0();
@@ -96,6 +155,7 @@ void testMidiSong()
 
     testSong4_1();
     testSong4_2();
+    testSong4Schedules();
     InteropClipboard::_clear();
     assertNoMidi();     // check for leaks
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+
+#include "MidiLock.h"
+#include "MidiTrack.h"
+#include "MidiTrackCodec.h"
+
+#include "asserts.h"
+
+#include <stdlib.h>
+
+static void assertTracksEqual(MidiTrackPtr a, MidiTrackPtr b)
+{
+    assertEQ(a->size(), b->size());
+    auto itb = b->begin();
+    for (auto ita : *a) {
+        MidiEventPtr eva = ita.second;
+        MidiEventPtr evb = itb->second;
+        assert(*eva == *evb);
+        assertEQ(ita.first, itb->first);
+        ++itb;
+    }
+}
+
+static MidiTrackPtr roundTrip(MidiTrackPtr track)
+{
+    auto lock = MidiLock::make();
+    MidiLocker l(lock);
+    MidiTrackPtr ret = std::make_shared<MidiTrack>(lock);
+    std::string err = MidiTrackCodec::decode(MidiTrackCodec::encode(*track), ret);
+    assert(err.empty());
+    ret->assertValid();
+    return ret;
+}
+
+static void testRoundTrip(MidiTrack::TestContent content)
+{
+    auto lock = MidiLock::make();
+    MidiLocker l(lock);
+    MidiTrackPtr track = MidiTrack::makeTest(content, lock);
+    assertTracksEqual(track, roundTrip(track));
+}
+
+// off grid times and pitches are saved exactly, too
+static void testRoundTripRandom()
+{
+    auto lock = MidiLock::make();
+    MidiLocker l(lock);
+    MidiTrackPtr track = std::make_shared<MidiTrack>(lock);
+    float t = 0;
+    for (int i = 0; i < 1000; ++i) {
+        auto note = std::make_shared<MidiNoteEvent>();
+        t += float(rand() % 5) * .25f + ((i % 3) ? 0 : float(rand()) / RAND_MAX);
+        note->startTime = t;
+        note->pitchCV = (i % 2) ? PitchUtils::semitoneToCV(rand() % 100) : float(rand()) / RAND_MAX * 4 - 2;
+        note->duration = (i % 5) ? .5f : .01f + float(rand()) / RAND_MAX;
+        track->insertEvent(note);
+    }
+    track->insertEnd(t + 4);
+    assertTracksEqual(track, roundTrip(track));
+}
+
+// notes on the grid should be a few bytes each
+static void testCompact()
+{
+    auto lock = MidiLock::make();
+    MidiLocker l(lock);
+    MidiTrackPtr track = std::make_shared<MidiTrack>(lock);
+    for (int i = 0; i < 1000; ++i) {
+        auto note = std::make_shared<MidiNoteEvent>();
+        note->startTime = i * .25f;
+        note->pitchCV = PitchUtils::semitoneToCV(48 + (i % 24));
+        note->duration = .25f;
+        track->insertEvent(note);
+    }
+    track->insertEnd(250);
+    auto data = MidiTrackCodec::encodeBinary(*track);
+    assertLE(data.size(), 1001 * 6);
+}
+
+static void testBadData()
+{
+    auto lock = MidiLock::make();
+    MidiLocker l(lock);
+    MidiTrackPtr track = MidiTrack::makeTest(MidiTrack::TestContent::eightQNotes, lock);
+    auto data = MidiTrackCodec::encodeBinary(*track);
+
+    auto decode = [lock](const std::vector<uint8_t>& d) {
+        MidiTrackPtr ret = std::make_shared<MidiTrack>(lock);
+        return MidiTrackCodec::decodeBinary(d.data(), d.size(), ret);
+    };
+    assert(decode(data).empty());
+
+    // every truncation fails, and doesn't crash
+    for (size_t i = 0; i < data.size(); ++i) {
+        auto bad = data;
+        bad.resize(i);
+        assert(!decode(bad).empty());
+    }
+
+    auto bad = data;
+    bad.push_back(0);
+    assert(!decode(bad).empty());
+
+    bad = data;
+    bad[0] = MidiTrackCodec::version + 1;
+    assert(!decode(bad).empty());
+
+    MidiTrackPtr ret = std::make_shared<MidiTrack>(lock);
+    assert(!MidiTrackCodec::decode("not base64!", ret).empty());
+}
+
+static void testBase64()
+{
+    for (int size = 0; size < 10; ++size) {
+        std::vector<uint8_t> data;
+        for (int i = 0; i < size; ++i) {
+            data.push_back(uint8_t(i * 97 + 200));
+        }
+        std::string str = MidiTrackCodec::toBase64(data);
+        assertEQ(str.size() % 4, 0);
+        std::vector<uint8_t> out;
+        assert(MidiTrackCodec::fromBase64(str, out));
+        assert(out == data);
+    }
+
+    std::vector<uint8_t> abc = {'a', 'b', 'c', 'd'};
+    assertEQ(MidiTrackCodec::toBase64(abc), "YWJjZA==");
+
+    std::vector<uint8_t> out;
+    assert(!MidiTrackCodec::fromBase64("YWJ", out));
+    assert(!MidiTrackCodec::fromBase64("Y=Jj", out));
+    assert(!MidiTrackCodec::fromBase64("YW*j", out));
+}
+
+void testMidiTrackCodec()
+{
+    testRoundTrip(MidiTrack::TestContent::empty);
+    testRoundTrip(MidiTrack::TestContent::eightQNotes);
+    testRoundTrip(MidiTrack::TestContent::oneNote123);
+    testRoundTrip(MidiTrack::TestContent::FourAlmostTouchingQuarters_12);
+    testRoundTrip(MidiTrack::TestContent::eightQNotesCMaj);
+    testRoundTripRandom();
+    testCompact();
+    testBadData();
+    testBase64();
+}
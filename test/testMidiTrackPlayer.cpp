@@ -772,6 +772,134 @@ static void testLockGates()
     assert(host->onlyOneGate(0));
 }
 
+// the player plays from a copy of the track, so make sure it sees edits.
+static void testEditWhilePlaying()
+{
+    std::shared_ptr<TestHost2> host = std::make_shared<TestHost2>();
+    MidiSong4Ptr song = makeSong(0);
+    MidiTrackPlayer pl(host, 0, song);
+
+    auto options0 = song->getOptions(0, 0);
+    options0->repeatCount = 0;              // play forever
+    const float quantizationInterval = .01f;
+    pl.setRunningStatus(true);
+    pl.step();
+
+    play(pl, 3.9, quantizationInterval);
+    assertEQ(host->gateChangeCount, 2);
+
+    {
+        MidiLocker l(song->lock);
+        MidiNoteEventPtr note = std::make_shared<MidiNoteEvent>();
+        note->startTime = 3;
+        note->duration = .5;
+        note->pitchCV = 2;
+        song->getTrack(0, 0)->insertEvent(note);
+    }
+
+    // second time through has the old note, then the new one
+    play(pl, 5.5, quantizationInterval);
+    assertEQ(host->gateChangeCount, 3);
+    assertEQ(host->cvValue[0], 7.5);
+    play(pl, 7.2, quantizationInterval);
+    assertEQ(host->gateChangeCount, 5);
+    assertEQ(host->cvValue[0], 2);
+    play(pl, 7.6, quantizationInterval);
+    assertEQ(host->gateChangeCount, 6);
+}
+
+// the player only ever reads the schedule the UI built, so an edit
+// isn't heard until the editor lets go of the lock.
+static void testEditSeenAfterUnlock()
+{
+    std::shared_ptr<TestHost2> host = std::make_shared<TestHost2>();
+    MidiSong4Ptr song = makeSong(0);
+    MidiTrackPlayer pl(host, 0, song);
+
+    auto options0 = song->getOptions(0, 0);
+    options0->repeatCount = 0;              // play forever
+    const float quantizationInterval = .01f;
+    pl.setRunningStatus(true);
+    pl.step();
+
+    play(pl, 3.9, quantizationInterval);
+    assertEQ(host->gateChangeCount, 2);
+
+    MidiNoteEventPtr note = std::make_shared<MidiNoteEvent>();
+    note->startTime = 3;
+    note->duration = .5;
+    note->pitchCV = 2;
+    {
+        MidiLocker l(song->lock);
+        song->getTrack(0, 0)->insertEvent(note);
+
+        // still the old schedule: only the note at 1
+        play(pl, 7.6, quantizationInterval);
+        assertEQ(host->gateChangeCount, 4);
+        assertEQ(host->cvValue[0], 7.5);
+    }
+
+    // third time through has the new note at 3
+    play(pl, 11.2, quantizationInterval);
+    assertEQ(host->gateChangeCount, 7);
+    assertEQ(host->cvValue[0], 2);
+}
+
+// paste, cut and edit clip all replace the section's track while it plays
+static void testReplaceTrackWhilePlaying()
+{
+    std::shared_ptr<TestHost2> host = std::make_shared<TestHost2>();
+    MidiSong4Ptr song = makeSong(0);
+    MidiTrackPlayer pl(host, 0, song);
+
+    auto options0 = song->getOptions(0, 0);
+    options0->repeatCount = 0;              // play forever
+    const float quantizationInterval = .01f;
+    pl.setRunningStatus(true);
+    pl.step();
+
+    play(pl, .5, quantizationInterval);
+    assertEQ(host->gateChangeCount, 0);
+
+    {
+        MidiLocker l(song->lock);
+        song->addTrack(0, 0, MidiTrack::makeTest(MidiTrack::TestContent::oneQ1, song->lock));
+        song->addOptions(0, 0, options0);
+    }
+
+    // the new note at 1 plays, in the same section
+    play(pl, 1.5, quantizationInterval);
+    assertEQ(host->gateChangeCount, 1);
+    assertEQ(host->cvValue[0], 3);
+
+    // and it keeps looping: a note at 1, 5, 9... 37
+    play(pl, 40, quantizationInterval);
+    assertEQ(host->gateChangeCount, 20);
+    assertEQ(host->cvValue[0], 3);
+}
+
+// note offs still come at the right time when the player skips polling the voices
+static void testNoteOffTime()
+{
+    std::shared_ptr<TestHost2> host = std::make_shared<TestHost2>();
+    MidiSong4Ptr song = makeSong(0);
+    MidiTrackPlayer pl(host, 0, song);
+    pl.setNumVoices(4);
+    const float quantizationInterval = .01f;
+    pl.setRunningStatus(true);
+    pl.step();
+
+    // the quarter note is at 1..2
+    play(pl, 1, quantizationInterval);
+    assertEQ(host->gateChangeCount, 1);
+    play(pl, 1.99, quantizationInterval);
+    assertEQ(host->gateChangeCount, 1);
+    play(pl, 2, quantizationInterval);
+    assertEQ(host->gateChangeCount, 2);
+    play(pl, 3.9, quantizationInterval);
+    assertEQ(host->gateChangeCount, 2);
+}
+
 void testMidiTrackPlayer()
 {
     testCanCall();
@@ -790,4 +918,8 @@ void testMidiTrackPlayer()
     testPlayThenResetSeek();
     testPlayPauseSeek();
     testLockGates();
+    testEditWhilePlaying();
+    testEditSeenAfterUnlock();
+    testReplaceTrackWhilePlaying();
+    testNoteOffTime();
 }
\ No newline at end of file
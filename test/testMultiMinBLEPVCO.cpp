@@ -0,0 +1,168 @@
+
+#include "EV3.h"
+#include "MultiMinBLEPVCO.h"
+#include "TestComposite.h"
+#include "asserts.h"
+
+static const float sampleTime = 1.0f / 44100.0f;
+
+using Waveform = MinBLEPVCO::Waveform;
+
+template <int N>
+static void test0()
+{
+    MultiMinBLEPVCO<N> vco;
+    for (int i = 0; i < N; ++i) {
+        assertEQ(vco.getOutput(i), 0);
+        vco.setNormalizedFreq(i, 1000 * sampleTime, sampleTime);
+    }
+    for (int i = 0; i < 10; ++i) {
+        vco.step();
+    }
+    for (int i = 0; i < N; ++i) {
+        assertNE(vco.getOutput(i), 0);
+    }
+}
+
+/**
+ * Every voice in the bank should sound just like a
+ * stand-alone MinBLEPVCO set the same way.
+ */
+template <int N>
+static void testMatchesScalar(Waveform wf)
+{
+    MultiMinBLEPVCO<N> multi;
+    MinBLEPVCO mono[N];
+
+    multi.setWaveform(wf);
+    for (int i = 0; i < N; ++i) {
+        const float freq = (110.f + 97.f * i) * sampleTime;
+        const float pw = .3f + .05f * i;
+        multi.setNormalizedFreq(i, freq, sampleTime);
+        multi.setPulseWidth(i, pw);
+        mono[i].setWaveform(wf);
+        mono[i].setNormalizedFreq(freq, sampleTime);
+        mono[i].setPulseWidth(pw);
+    }
+
+    for (int frame = 0; frame < 4000; ++frame) {
+        multi.step();
+        for (int i = 0; i < N; ++i) {
+            mono[i].step();
+            assertClose(multi.getOutput(i), mono[i].getOutput(), .001);
+        }
+    }
+}
+
+template <int N>
+static void testBlock()
+{
+    MultiMinBLEPVCO<N> vco;
+    MultiMinBLEPVCO<N> vcoBlock;
+    for (int i = 0; i < N; ++i) {
+        vco.setNormalizedFreq(i, (200.f + 50 * i) * sampleTime, sampleTime);
+        vcoBlock.setNormalizedFreq(i, (200.f + 50 * i) * sampleTime, sampleTime);
+    }
+
+    const int frames = 64;
+    float buffer[frames * N];
+    vcoBlock.process(buffer, frames);
+    for (int frame = 0; frame < frames; ++frame) {
+        vco.step();
+        for (int i = 0; i < N; ++i) {
+            assertEQ(buffer[frame * N + i], vco.getOutput(i));
+        }
+    }
+}
+
+// running fewer voices doesn't change the ones that do run
+template <int N>
+static void testNumVoices()
+{
+    MultiMinBLEPVCO<N> all;
+    MultiMinBLEPVCO<N> some;
+    some.setNumVoices(3);
+    for (int i = 0; i < N; ++i) {
+        all.setNormalizedFreq(i, (300.f + 70 * i) * sampleTime, sampleTime);
+        some.setNormalizedFreq(i, (300.f + 70 * i) * sampleTime, sampleTime);
+    }
+    for (int frame = 0; frame < 1000; ++frame) {
+        all.step();
+        some.step();
+        for (int i = 0; i < 3; ++i) {
+            assertEQ(some.getOutput(i), all.getOutput(i));
+        }
+    }
+    if (N > 4) {
+        assertEQ(some.getOutput(N - 1), 0);
+    }
+}
+
+template <int N>
+static void testAll()
+{
+    test0<N>();
+    testMatchesScalar<N>(Waveform::Saw);
+    testMatchesScalar<N>(Waveform::Square);
+    testMatchesScalar<N>(Waveform::Sin);
+    testMatchesScalar<N>(Waveform::Tri);
+    testMatchesScalar<N>(Waveform::Even);
+    testBlock<N>();
+    testNumVoices<N>();
+}
+
+/**
+ * Poly CV makes EV3 run the banks. Each channel should sound
+ * like a mono EV3 at the same pitch.
+ */
+static void testEV3Poly()
+{
+    using EV = EV3<TestComposite>;
+    EV poly;
+    EV mono;
+    for (EV* ev3 : {&poly, &mono}) {
+        ev3->params[EV::WAVE1_PARAM].value = float(EV::Waves::SAW);
+        ev3->params[EV::WAVE2_PARAM].value = float(EV::Waves::SQUARE);
+        ev3->params[EV::WAVE3_PARAM].value = float(EV::Waves::EVEN);
+        ev3->params[EV::SEMI2_PARAM].value = 7;
+        ev3->params[EV::MIX1_PARAM].value = 1;
+        for (int i = 0; i < EV::NUM_OUTPUTS; ++i) {
+            ev3->outputs[i].channels = 1;
+        }
+    }
+    poly.inputs[EV::CV1_INPUT].channels = 3;
+    poly.inputs[EV::CV1_INPUT].setVoltage(0, 0);
+    poly.inputs[EV::CV1_INPUT].setVoltage(1, 1);
+    poly.inputs[EV::CV1_INPUT].setVoltage(-1, 2);
+    mono.inputs[EV::CV1_INPUT].channels = 1;
+    mono.inputs[EV::CV1_INPUT].setVoltage(1, 0);
+
+    // the channel count is picked up on the first step
+    poly.step();
+    mono.step();
+    assertEQ(poly.getNumChannels(), 3);
+    assertEQ(mono.getNumChannels(), 1);
+
+    float sum[3] = {0};
+    for (int i = 0; i < 2000; ++i) {
+        poly.step();
+        mono.step();
+        for (int out = 0; out < EV::NUM_OUTPUTS; ++out) {
+            assertEQ(int(poly.outputs[out].channels), 3);
+            assertClose(poly.outputs[out].getVoltage(1), mono.outputs[out].getVoltage(0), .001);
+        }
+        for (int c = 0; c < 3; ++c) {
+            sum[c] += std::abs(poly.outputs[EV::VCO1_OUTPUT].getVoltage(c));
+        }
+    }
+    assertGT(sum[0], 100);
+    assertGT(sum[2], 100);
+    assertNE(sum[0], sum[2]);
+}
+
+void testMultiMinBLEPVCO()
+{
+    testAll<4>();
+    testAll<8>();
+    testEV3Poly();
+}
@@ -0,0 +1,101 @@
+
+#include "asserts.h"
+#include "MidiEditorContext.h"
+#include "MidiLock.h"
+#include "MidiSelectionModel.h"
+#include "MidiSong.h"
+#include "NoteGeometryCache.h"
+#include "NoteScreenScale.h"
+#include "TestAuditionHost.h"
+#include "TestSettings.h"
+
+class GeometryFixture
+{
+public:
+    GeometryFixture()
+    {
+        song = MidiSong::makeTest(MidiTrack::TestContent::eightQNotes, 0);
+        context = std::make_shared<MidiEditorContext>(song, std::make_shared<TestSettings>());
+        context->setTimeRange(0, 8);
+        context->setPitchRange(-5, 5);
+        scaler = std::make_shared<NoteScreenScale>(100, 100, 0, 0);
+        scaler->setContext(context);
+        context->setScaler(scaler);
+        selection = std::make_shared<MidiSelectionModel>(std::make_shared<TestAuditionHost>());
+    }
+    MidiSongPtr song;
+    MidiEditorContextPtr context;
+    std::shared_ptr<NoteScreenScale> scaler;
+    MidiSelectionModelPtr selection;
+    NoteGeometryCache cache;
+};
+
+static void testGeometry()
+{
+    GeometryFixture f;
+    assert(f.cache.update(f.context, f.selection));
+    auto& notes = f.cache.getNotes();
+    assertEQ(notes.size(), 8);
+
+    auto first = f.song->getTrack(0)->getFirstNote();
+    assertEQ(notes[0].x, f.scaler->midiTimeToX(*first));
+    assertEQ(notes[0].y, f.scaler->midiPitchToY(*first));
+    assertEQ(notes[0].width, f.scaler->midiTimeTodX(first->duration));
+    assertEQ(f.cache.getNoteHeight(), f.scaler->noteHeight());
+    assert(!notes[0].selected);
+}
+
+static void testNothingChanged()
+{
+    GeometryFixture f;
+    assert(f.cache.update(f.context, f.selection));
+    assert(!f.cache.update(f.context, f.selection));
+    assert(!f.cache.update(f.context, f.selection));
+
+    f.cache.invalidate();
+    assert(f.cache.update(f.context, f.selection));
+}
+
+static void testSelectionChanged()
+{
+    GeometryFixture f;
+    f.cache.update(f.context, f.selection);
+
+    f.selection->select(f.song->getTrack(0)->getFirstNote());
+    assert(f.cache.update(f.context, f.selection));
+    assert(f.cache.getNotes()[0].selected);
+    assert(!f.cache.getNotes()[1].selected);
+}
+
+static void testViewportChanged()
+{
+    GeometryFixture f;
+    f.cache.update(f.context, f.selection);
+
+    f.context->setTimeRange(0, 2);
+    assert(f.cache.update(f.context, f.selection));
+    assertEQ(f.cache.getNotes().size(), 2);
+}
+
+static void testEdited()
+{
+    GeometryFixture f;
+    f.cache.update(f.context, f.selection);
+
+    auto track = f.song->getTrack(0);
+    {
+        MidiLocker l(track->lock);
+        track->deleteEvent(*track->getFirstNote());
+    }
+    assert(f.cache.update(f.context, f.selection));
+    assertEQ(f.cache.getNotes().size(), 7);
+}
+
+void testNoteGeometryCache()
+{
+    testGeometry();
+    testNothingChanged();
+    testSelectionChanged();
+    testViewportChanged();
+    testEdited();
+}
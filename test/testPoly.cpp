@@ -1,6 +1,7 @@
 #include "TestComposite.h"
 #include "asserts.h"
 #include "poly.h"
+#include "MultiPoly.h"
 #include "Analyzer.h"
 #include "Shaper.h"
 #include "SinOscillator.h"
@@ -99,6 +100,65 @@ static void testDC()
     }
 }
 
+/**
+ * MultiPoly should give the same answer as Poly
+ */
+static void testMultiPoly(float inputGain)
+{
+    Poly<double, 10> poly[8];
+    MultiPoly<8> multi;
+    for (int channel = 0; channel < 8; ++channel) {
+        for (int i = 0; i < 10; ++i) {
+            const float gain = float((channel + 1) * (i + 3) % 7) / 7.f;
+            poly[channel].setGain(i, gain);
+            multi.setGain(channel, i, gain);
+        }
+        multi.setInputGain(channel, inputGain);
+    }
+
+    float input[8];
+    float output[8];
+    for (int step = 0; step <= 100; ++step) {
+        for (int channel = 0; channel < 8; ++channel) {
+            input[channel] = -1.f + 2.f * float((step + 13 * channel) % 101) / 100.f;
+        }
+        multi.run(input, output, 8);
+        for (int channel = 0; channel < 8; ++channel) {
+            const float expected = poly[channel].run(input[channel], inputGain);
+            assertClose(output[channel], expected, .0001);
+        }
+    }
+}
+
+static void testMultiPolyTerm(int term)
+{
+    Poly<double, 10> poly;
+    MultiPoly<4> multi;
+    poly.setGain(term, 1);
+    multi.setGain(2, term, 1);
+    multi.setInputGain(2, .5f);
+
+    float input[4] = {0};
+    float output[4];
+    for (int i = 0; i <= 20; ++i) {
+        input[2] = -1.f + .1f * i;
+        multi.run(input, output, 4);
+        assertClose(output[2], poly.run(input[2], .5f), .00001);
+
+        // other channels have zero gain
+        assertEQ(output[0], 0);
+        assertEQ(output[3], 0);
+    }
+}
+
+static void testMultiPoly()
+{
+    testMultiPoly(1);
+    testMultiPoly(.3f);
+    for (int i = 0; i < 10; ++i) {
+        testMultiPolyTerm(i);
+    }
+}
 
 void testPoly()
 {
@@ -106,4 +166,5 @@ void testPoly()
     test1();
     testDC();
     testTerms();
+    testMultiPoly();
 }
\ No newline at end of file
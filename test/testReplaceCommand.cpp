@@ -6,7 +6,9 @@
 #include "MidiTrack.h"
 #include "MidiSequencer.h"
 #include "MidiSong.h"
+#include "NoteXformPipeline.h"
 #include "ReplaceDataCommand.h"
+#include "Scale.h"
 #include "TestAuditionHost.h"
 #include "TestSettings.h"
 
@@ -675,6 +677,191 @@ static void testAutoTriads2()
 #endif
 }
 
+// nudging the pitch many times should only make one undo record
+static void testMergeRepeatedPitch()
+{
+    MidiSongPtr ms = MidiSong::makeTest(MidiTrack::TestContent::eightQNotes, 0);
+    MidiSequencerPtr seq = MidiSequencer::make(ms, std::make_shared<TestSettings>(), std::make_shared<TestAuditionHost>());
+    seq->selection->selectAll(seq->context->getTrack());
+    const float firstPitch = seq->context->getTrack()->getFirstNote()->pitchCV;
+
+    for (int i = 0; i < 20; ++i) {
+        seq->undo->execute(seq, ReplaceDataCommand::makeChangePitchCommand(seq, 1));
+    }
+    assertClose(seq->context->getTrack()->getFirstNote()->pitchCV, firstPitch + 20 * PitchUtils::semitone, .0001);
+    assertEQ(seq->selection->size(), 8);
+
+    seq->undo->undo(seq);
+    assert(!seq->undo->canUndo());
+    assertEQ(seq->context->getTrack()->getFirstNote()->pitchCV, firstPitch);
+    assertEQ(seq->selection->size(), 8);
+    seq->assertValid();
+
+    seq->undo->redo(seq);
+    assertClose(seq->context->getTrack()->getFirstNote()->pitchCV, firstPitch + 20 * PitchUtils::semitone, .0001);
+    seq->assertValid();
+}
+
+// different kinds of edits are undone one at a time
+static void testNoMergeDifferent()
+{
+    MidiSongPtr ms = MidiSong::makeTest(MidiTrack::TestContent::eightQNotes, 0);
+    MidiSequencerPtr seq = MidiSequencer::make(ms, std::make_shared<TestSettings>(), std::make_shared<TestAuditionHost>());
+    seq->selection->select(seq->context->getTrack()->getFirstNote());
+    const float firstPitch = seq->context->getTrack()->getFirstNote()->pitchCV;
+    const float firstDuration = seq->context->getTrack()->getFirstNote()->duration;
+
+    seq->undo->execute(seq, ReplaceDataCommand::makeChangePitchCommand(seq, 1));
+    seq->undo->execute(seq, ReplaceDataCommand::makeChangeDurationCommand(seq, .1f, false));
+    seq->undo->execute(seq, ReplaceDataCommand::makeChangePitchCommand(seq, 1));
+
+    seq->undo->undo(seq);
+    seq->undo->undo(seq);
+    assert(seq->undo->canUndo());
+    auto note = seq->context->getTrack()->getFirstNote();
+    assertEQ(note->duration, firstDuration);
+    assertClose(note->pitchCV, firstPitch + PitchUtils::semitone, .0001);
+
+    seq->undo->undo(seq);
+    assert(!seq->undo->canUndo());
+    assertEQ(seq->context->getTrack()->getFirstNote()->pitchCV, firstPitch);
+}
+
+static void testUndoMemoryBudget()
+{
+    MidiSongPtr ms = MidiSong::makeTest(MidiTrack::TestContent::eightQNotes, 0);
+    MidiSequencerPtr seq = MidiSequencer::make(ms, std::make_shared<TestSettings>(), std::make_shared<TestAuditionHost>());
+    seq->selection->selectAll(seq->context->getTrack());
+
+    // alternate two kinds of edits, so they don't merge
+    seq->undo->execute(seq, ReplaceDataCommand::makeChangePitchCommand(seq, 1));
+    const size_t oneCommand = seq->undo->getMemoryUsed();
+    assertGT(oneCommand, 8 * 2 * 3 * sizeof(float));
+    seq->undo->setMemoryBudget(oneCommand * 5);
+    for (int i = 0; i < 10; ++i) {
+        seq->undo->execute(seq, ReplaceDataCommand::makeChangeDurationCommand(seq, .1f, false));
+        seq->undo->execute(seq, ReplaceDataCommand::makeChangePitchCommand(seq, 1));
+    }
+    assertLE(seq->undo->getMemoryUsed(), oneCommand * 5);
+
+    int numUndo = 0;
+    while (seq->undo->canUndo()) {
+        seq->undo->undo(seq);
+        ++numUndo;
+    }
+    // the two kinds aren't exactly the same size, so about five
+    assertGE(numUndo, 4);
+    assertLE(numUndo, 5);
+    seq->assertValid();
+}
+
+// a chain of transforms is one command, and gives the same
+// result as running them one at a time.
+static void testPipeline()
+{
+    auto makeSeq = []() {
+        MidiSongPtr ms = MidiSong::makeTest(MidiTrack::TestContent::eightQNotes, 0);
+        MidiSequencerPtr seq = MidiSequencer::make(ms, std::make_shared<TestSettings>(), std::make_shared<TestAuditionHost>());
+        seq->editor->selectAll();
+        return seq;
+    };
+    auto transpose = Scale::makeTransposeLambdaChromatic(2);
+
+    MidiSequencerPtr seqChain = makeSeq();
+    NoteXformPipeline pipeline("chain");
+    pipeline.add(NoteXformPipeline::makeFilter(transpose));
+    pipeline.add(NoteXformPipeline::makeReversePitch());
+    pipeline.add(NoteXformPipeline::makeChop(2, ReplaceDataCommand::Ornament::None, nullptr, 0));
+    seqChain->undo->execute(seqChain, pipeline.makeCommand(seqChain));
+    seqChain->assertValid();
+    assertEQ(seqChain->context->getTrack()->size(), 16 + 1);
+    assertEQ(seqChain->selection->size(), 16);
+
+    MidiSequencerPtr seqOne = makeSeq();
+    seqOne->undo->execute(seqOne, ReplaceDataCommand::makeFilterNoteCommand("transpose", seqOne, transpose));
+    seqOne->undo->execute(seqOne, ReplaceDataCommand::makeReversePitchCommand(seqOne));
+    seqOne->undo->execute(seqOne, ReplaceDataCommand::makeChopNoteCommand(seqOne, 2, ReplaceDataCommand::Ornament::None, nullptr, 0));
+
+    auto chain = seqChain->context->getTrack()->_testGetVector();
+    auto one = seqOne->context->getTrack()->_testGetVector();
+    assertEQ(chain.size(), one.size());
+    for (size_t i = 0; i < chain.size(); ++i) {
+        assert(*chain[i] == *one[i]);
+    }
+
+    // and one undo gets back to the start
+    MidiSequencerPtr seqOrig = makeSeq();
+    seqChain->undo->undo(seqChain);
+    assert(!seqChain->undo->canUndo());
+    auto undone = seqChain->context->getTrack()->_testGetVector();
+    auto orig = seqOrig->context->getTrack()->_testGetVector();
+    assertEQ(undone.size(), orig.size());
+    for (size_t i = 0; i < orig.size(); ++i) {
+        assert(*undone[i] == *orig[i]);
+    }
+}
+
+// triads pass notes that aren't in the scale through
+static void testPipelineTriadsPassThrough()
+{
+    ScalePtr scale = Scale::getScale(Scale::Scales::Major, PitchUtils::c);
+    NoteXformPipeline pipeline("triads");
+    pipeline.add(NoteXformPipeline::makeTriads(ReplaceDataCommand::TriadType::RootPosition, scale));
+
+    NoteXformPipeline::Notes notes(2);
+    notes[0].pitchCV = PitchUtils::semitoneToCV(PitchUtils::cvToSemitone(0));       // C
+    notes[1].pitchCV = PitchUtils::semitoneToCV(PitchUtils::cvToSemitone(0) + 1);   // C#
+    notes[1].startTime = 1;
+    pipeline.run(notes);
+    assertEQ(notes.size(), 4);
+    assertEQ(notes[3].startTime, 1);
+}
+
+// auto triads hand the next stage the notes in time order
+static void testPipelineAutoTriadsOrder()
+{
+    ScalePtr scale = Scale::getScale(Scale::Scales::Major, PitchUtils::c);
+    const int c = PitchUtils::cvToSemitone(0);
+
+    auto makeNotes = [c]() {
+        NoteXformPipeline::Notes notes(3);
+        notes[0].pitchCV = PitchUtils::semitoneToCV(c);         // C
+        notes[1].pitchCV = PitchUtils::semitoneToCV(c + 1);     // C#, not in scale
+        notes[1].startTime = 1;
+        notes[2].pitchCV = PitchUtils::semitoneToCV(c + 7);     // G
+        notes[2].startTime = 2;
+        return notes;
+    };
+
+    NoteXformPipeline triads("triads");
+    triads.add(NoteXformPipeline::makeTriads(ReplaceDataCommand::TriadType::Auto, scale));
+    NoteXformPipeline::Notes expected = makeNotes();
+    triads.run(expected);
+    assertEQ(expected.size(), 7);
+    for (size_t i = 1; i < expected.size(); ++i) {
+        assertLE(expected[i - 1].startTime, expected[i].startTime);
+    }
+    assertEQ(expected[3].startTime, 1);
+    assertEQ(expected[3].pitchCV, PitchUtils::semitoneToCV(c + 1));
+
+    // reversing pitches depends on the order
+    const size_t size = expected.size();
+    NoteXformPipeline::Notes reversed = expected;
+    for (size_t i = 0; i < size; ++i) {
+        reversed[i].pitchCV = expected[size - 1 - i].pitchCV;
+    }
+
+    NoteXformPipeline chain("chain");
+    chain.add(NoteXformPipeline::makeTriads(ReplaceDataCommand::TriadType::Auto, scale));
+    chain.add(NoteXformPipeline::makeReversePitch());
+    NoteXformPipeline::Notes notes = makeNotes();
+    chain.run(notes);
+    assertEQ(notes.size(), reversed.size());
+    for (size_t i = 0; i < notes.size(); ++i) {
+        assert(notes[i] == reversed[i]);
+    }
+}
+
 void testReplaceCommand()
 {
     test0();
@@ -697,4 +884,10 @@ void testReplaceCommand()
     testTriads();
     testAutoTriads();
     testAutoTriads2();
+    testMergeRepeatedPitch();
+    testNoMergeDifferent();
+    testUndoMemoryBudget();
+    testPipeline();
+    testPipelineTriadsPassThrough();
+    testPipelineAutoTriadsOrder();
 }
\ No newline at end of file
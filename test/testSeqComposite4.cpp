@@ -205,9 +205,34 @@ static void testPauseSwitchSectionStart()
     assertEQ(pl->getSection(), 4);       // should be playing requested section still
 }
 
+// The gate should go high on the same sample as the clock that plays the note,
+// whatever phase the clock has relative to the internal divider.
+static void testGateOnClockSample()
+{
+    for (int phase = 0; phase < 8; ++phase) {
+        const int tkNum = 0;
+        const auto rate = SeqClock::ClockRate::Div4;
+        Sq4Ptr comp = make(rate, 1, true, tkNum);
+        stepN(comp, 16);
+
+        // first note is at 1.0, the fifth sixteenth note clock.
+        for (int i = 0; i < 4; ++i) {
+            genOneClock(comp);
+        }
+        stepN(comp, phase);
+        assertLT(comp->outputs[comp->GATE0_OUTPUT].getVoltage(0), 5);
+
+        comp->inputs[Sq4::CLOCK_INPUT].setVoltage(10, 0);
+        comp->step();
+        assertGT(comp->outputs[comp->GATE0_OUTPUT].getVoltage(0), 5);
+        assertEQ(comp->outputs[comp->CV0_OUTPUT].getVoltage(0), 7.5f);
+    }
+}
+
 void testSeqComposite4()
 {
     test0();
     testPause();
     testPauseSwitchSectionStart();
+    testGateOnClockSample();
 }
\ No newline at end of file
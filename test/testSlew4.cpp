@@ -157,6 +157,138 @@ static void testGateInputs()
     }
 }
 
+// poly trigger on row 0 normals down to all the rows
+static void testPolyTrigger()
+{
+    Slew slew;
+    init(slew);
+    slew.inputs[Slew::INPUT_TRIGGER0].channels = 4;
+    for (int c = 0; c < 4; ++c) {
+        slew.inputs[Slew::INPUT_TRIGGER0].setVoltage(float(c + 1), c);
+    }
+    for (int i = 0; i < 8; ++i) {
+        slew.outputs[Slew::OUTPUT0 + i].channels = 1;
+    }
+
+    for (int n = 0; n < 1000; ++n) {
+        slew.step();
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        assertEQ(int(slew.outputs[Slew::OUTPUT0 + i].channels), 4);
+        for (int c = 0; c < 4; ++c) {
+            assertClose(slew.outputs[Slew::OUTPUT0 + i].getVoltage(c), float(c + 1), .01);
+        }
+    }
+}
+
+// poly audio on a row makes that row poly, with a mono trigger
+static void testPolyAudio()
+{
+    Slew slew;
+    init(slew);
+    slew.inputs[Slew::INPUT_TRIGGER0].channels = 1;
+    slew.inputs[Slew::INPUT_TRIGGER0].setVoltage(10, 0);
+    slew.inputs[Slew::INPUT_AUDIO2].channels = 3;
+    for (int c = 0; c < 3; ++c) {
+        slew.inputs[Slew::INPUT_AUDIO2].setVoltage(float(c), c);
+    }
+    slew.outputs[Slew::OUTPUT2].channels = 1;
+
+    for (int n = 0; n < 1000; ++n) {
+        slew.step();
+    }
+
+    assertEQ(int(slew.outputs[Slew::OUTPUT2].channels), 3);
+    for (int c = 0; c < 3; ++c) {
+        assertClose(slew.outputs[Slew::OUTPUT2].getVoltage(c), float(c), .01);
+    }
+}
+
+// channel n of the rise CV sets the rise time of channel n
+static void testPolyRise()
+{
+    Slew slew;
+    init(slew);
+    slew.params[Slew::PARAM_RISE].value = 0;
+    slew.inputs[Slew::INPUT_RISE].channels = 2;
+    slew.inputs[Slew::INPUT_RISE].setVoltage(-5, 0);
+    slew.inputs[Slew::INPUT_RISE].setVoltage(5, 1);
+
+    slew.inputs[Slew::INPUT_TRIGGER0].channels = 2;
+    slew.inputs[Slew::INPUT_TRIGGER0].setVoltage(10, 0);
+    slew.inputs[Slew::INPUT_TRIGGER0].setVoltage(10, 1);
+    slew.outputs[Slew::OUTPUT0].channels = 1;
+    slew.outputs[Slew::OUTPUT5].channels = 1;
+
+    for (int n = 0; n < 10; ++n) {
+        slew.step();
+    }
+    for (int row = 0; row < 8; row += 5) {
+        const float fast = slew.outputs[Slew::OUTPUT0 + row].getVoltage(0);
+        const float slow = slew.outputs[Slew::OUTPUT0 + row].getVoltage(1);
+        assertGT(fast, 5);
+        assertLT(slow, 1);
+    }
+}
+
+static void testPolyMix()
+{
+    Slew slew;
+    init(slew);
+    slew.inputs[Slew::INPUT_TRIGGER0].channels = 2;
+    slew.inputs[Slew::INPUT_TRIGGER0].setVoltage(10, 0);
+    slew.inputs[Slew::INPUT_TRIGGER0].setVoltage(5, 1);
+    slew.outputs[Slew::OUTPUT_MIX1].channels = 1;
+    slew.outputs[Slew::OUTPUT_MIX7].channels = 1;
+
+    for (int n = 0; n < 1000; ++n) {
+        slew.step();
+    }
+
+    // two rows summed into mix 1, the other six into mix 7
+    auto& mix1 = slew.outputs[Slew::OUTPUT_MIX1];
+    auto& mix7 = slew.outputs[Slew::OUTPUT_MIX7];
+    assertEQ(int(mix1.channels), 2);
+    assertEQ(int(mix7.channels), 2);
+    assertClose(mix1.getVoltage(0), 2 * 10, .1);
+    assertClose(mix1.getVoltage(1), 2 * 5, .1);
+    assertClose(mix7.getVoltage(0), 6 * 10, .1);
+    assertClose(mix7.getVoltage(1), 6 * 5, .1);
+}
+
+// widening a row moves the rows below it to other lanes. They should keep their own state.
+static void testPolyLayoutChange()
+{
+    Slew slew;
+    init(slew);
+    slew.inputs[Slew::INPUT_TRIGGER0].channels = 1;
+    slew.inputs[Slew::INPUT_TRIGGER0].setVoltage(0, 0);
+    slew.inputs[Slew::INPUT_TRIGGER1].channels = 1;
+    slew.inputs[Slew::INPUT_TRIGGER1].setVoltage(10, 0);
+    slew.inputs[Slew::INPUT_TRIGGER2].channels = 1;
+    slew.inputs[Slew::INPUT_TRIGGER2].setVoltage(0, 0);
+    slew.outputs[Slew::OUTPUT0].channels = 1;
+    slew.outputs[Slew::OUTPUT1].channels = 1;
+
+    for (int n = 0; n < 1000; ++n) {
+        slew.step();
+    }
+    assertClose(slew.outputs[Slew::OUTPUT1].getVoltage(0), 10, .01);
+
+    slew.inputs[Slew::INPUT_AUDIO0].channels = 2;
+    slew.inputs[Slew::INPUT_AUDIO0].setVoltage(10, 0);
+    slew.inputs[Slew::INPUT_AUDIO0].setVoltage(10, 1);
+    for (int n = 0; n < 4; ++n) {
+        slew.step();
+        assertClose(slew.outputs[Slew::OUTPUT1].getVoltage(0), 10, .01);
+    }
+    assertEQ(int(slew.outputs[Slew::OUTPUT0].channels), 2);
+
+    // the new channel starts from zero
+    assertClose(slew.outputs[Slew::OUTPUT0].getVoltage(1), 0, .01);
+}
+
 
 #include "LFNB.h"
 static void testLFNB()
@@ -172,5 +304,10 @@ void testSlew4()
     testTriggers();
     testMixedOutNormals();
     testGateInputs();
+    testPolyTrigger();
+    testPolyAudio();
+    testPolyRise();
+    testPolyMix();
+    testPolyLayoutChange();
     testLFNB();
 }
\ No newline at end of file
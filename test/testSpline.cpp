@@ -1,4 +1,5 @@
 #include "TestComposite.h"
+#include <functional>
 #include <map>
 #include <vector>
 #include "asserts.h"
@@ -495,6 +496,115 @@ static void testShaperOutputsLeftDisconnect()
 #endif
 
 
+/**
+ * Each channel of a poly input should come out just like
+ * a mono instance fed the same signal
+ */
+static void testShaperPolySub(Shaper<TestComposite>::Shapes shape)
+{
+    using S = Shaper<TestComposite>;
+    const int channels = 5;
+    S poly;
+    S mono[channels];
+
+    poly.inputs[S::INPUT_AUDIO0].channels = channels;
+    poly.outputs[S::OUTPUT_AUDIO0].channels = 1;
+    for (int i = 0; i < channels; ++i) {
+        mono[i].inputs[S::INPUT_AUDIO0].channels = 1;
+        mono[i].outputs[S::OUTPUT_AUDIO0].channels = 1;
+    }
+    S* all[channels + 1] = {&poly};
+    for (int i = 0; i < channels; ++i) {
+        all[i + 1] = mono + i;
+    }
+    for (S* s : all) {
+        s->params[S::PARAM_SHAPE].value = (float) shape;
+        s->params[S::PARAM_GAIN].value = 2;
+        s->params[S::PARAM_OFFSET].value = 1;
+    }
+
+    for (int t = 0; t < 200; ++t) {
+        for (int i = 0; i < channels; ++i) {
+            const float x = 4 * std::sin(.01f * t * (i + 1));
+            poly.inputs[S::INPUT_AUDIO0].setVoltage(x, i);
+            mono[i].inputs[S::INPUT_AUDIO0].setVoltage(x, 0);
+        }
+        poly.step();
+        for (int i = 0; i < channels; ++i) {
+            mono[i].step();
+            assertEQ(poly.outputs[S::OUTPUT_AUDIO0].getVoltage(i),
+                mono[i].outputs[S::OUTPUT_AUDIO0].getVoltage(0));
+        }
+    }
+    assertEQ(poly.outputs[S::OUTPUT_AUDIO0].getChannels(), channels);
+
+    // right output is unpatched, so should get a copy of left
+    assertEQ(poly.outputs[S::OUTPUT_AUDIO1].getVoltage(channels - 1),
+        poly.outputs[S::OUTPUT_AUDIO0].getVoltage(channels - 1));
+}
+
+static void testShaperPoly()
+{
+    for (int i = 0; i < shapeMax; ++i) {
+        testShaperPolySub(Shaper<TestComposite>::Shapes(i));
+    }
+}
+
+/**
+ * With no oversampling and no DC block we can compare the SSE shapes
+ * with the plain version of the same math.
+ */
+static void testShaperKernelSub(Shaper<TestComposite>::Shapes shape, std::function<float(float x, float gainInput)> reference)
+{
+    using S = Shaper<TestComposite>;
+    const int channels = 7;
+    S sh;
+    sh.inputs[S::INPUT_AUDIO0].channels = channels;
+    sh.outputs[S::OUTPUT_AUDIO0].channels = 1;
+    sh.params[S::PARAM_OVERSAMPLE].value = 2;
+    sh.params[S::PARAM_ACDC].value = 1;
+    sh.params[S::PARAM_SHAPE].value = (float) shape;
+    sh.params[S::PARAM_GAIN].value = 3;
+    sh.params[S::PARAM_OFFSET].value = .7f;
+
+    for (int t = 0; t < 100; ++t) {
+        for (int i = 0; i < channels; ++i) {
+            sh.inputs[S::INPUT_AUDIO0].setVoltage(-10.f + .1f * t + 2.f * i, i);
+        }
+        sh.step();
+        for (int i = 0; i < channels; ++i) {
+            float x = sh.inputs[S::INPUT_AUDIO0].getVoltage(i) + sh._offset;
+            if (shape != S::Shapes::Crush) {
+                x *= sh._gain;
+            }
+            const float expected = reference(x, sh._gainInput);
+            assertClose(sh.outputs[S::OUTPUT_AUDIO0].getVoltage(i), expected, .0001);
+        }
+    }
+}
+
+static void testShaperKernels()
+{
+    using S = Shaper<TestComposite>;
+    testShaperKernelSub(S::Shapes::FullWave, [](float x, float) {
+        return std::min(std::abs(x) * 1.94f, 10.f);
+    });
+    testShaperKernelSub(S::Shapes::HalfWave, [](float x, float) {
+        return std::min(std::max(0.f, x) * 1.4f * 1.26f, 10.f);
+    });
+    testShaperKernelSub(S::Shapes::Clip, [](float x, float) {
+        return 1.2f * std::max(-3.f, std::min(3.f, 3 * x));
+    });
+    testShaperKernelSub(S::Shapes::Fold, [](float x, float) {
+        return 5.6f * AudioMath::fold(x);
+    });
+    testShaperKernelSub(S::Shapes::Crush, [](float x, float gainInput) {
+        float invGain = std::max(.01f * (1 + (1 - gainInput) * 100), .09f);
+        x *= invGain;
+        x = std::round(x + .5f) - .5f;
+        return x / invGain;
+    });
+}
 
 void testSpline(bool doEmit)
 {
@@ -521,6 +631,8 @@ void testSpline(bool doEmit)
     testSplineExtremes();
 
     testShaperOutputsDisconnect();
+    testShaperPoly();
+    testShaperKernels();
    // testShaperOutputsRightDisconnect();
   //  testShaperOutputsLeftDisconnect();
 }
@@ -1,6 +1,7 @@
 #include <assert.h>
 
 #include "asserts.h"
+#include "MultiStateVariableFilter.h"
 #include "StateVariableFilter.h"
 #include "TestSignal.h"
 
@@ -117,9 +118,60 @@ static void test()
     testSetBandwidth<T>();
 }
 
+/**
+ * Each lane of the bank should match a scalar filter set the same way.
+ */
+static void testMulti(StateVariableFilterParams<float>::Mode mode)
+{
+    const int numLanes = 6;
+    MultiStateVariableFilter<8> multi;
+    StateVariableFilterParams<float> params[numLanes];
+    StateVariableFilterState<float> state[numLanes];
+
+    multi.setMode(mode);
+    for (int i = 0; i < numLanes; ++i) {
+        const float fc = .01f * (i + 1);
+        const float bw = .05f + .1f * i;
+        multi.setFreq(i, fc);
+        multi.setNormalizedBandwidth(i, bw);
+        params[i].setMode(mode);
+        params[i].setFreq(fc);
+        params[i].setNormalizedBandwidth(bw);
+    }
+
+    float input[8] = {0};
+    float output[8];
+    float mix[8] = {0};
+    const float gain[8] = {.5f, .5f, .5f, .5f, .5f, .5f, .5f, .5f};
+    for (int n = 0; n < 1000; ++n) {
+        for (int i = 0; i < numLanes; ++i) {
+            input[i] = (n % (i + 10)) < 5 ? 1.f : -1.f;
+        }
+        if (n & 1) {
+            multi.run(input, output, numLanes);
+        } else {
+            for (int i = 0; i < numLanes; ++i) {
+                output[i] = mix[i] = 1;
+            }
+            multi.runAndMix(input, mix, gain, numLanes);
+            for (int i = 0; i < numLanes; ++i) {
+                output[i] = (mix[i] - 1) * 2;
+            }
+        }
+        for (int i = 0; i < numLanes; ++i) {
+            const float expected = StateVariableFilter<float>::run(input[i], state[i], params[i]);
+            assertClose(output[i], expected, .0001);
+        }
+    }
+}
+
 void testStateVariable()
 {
     test<float>();
     test<double>();
     testBandpass();
+    testMulti(StateVariableFilterParams<float>::Mode::BandPass);
+    testMulti(StateVariableFilterParams<float>::Mode::LowPass);
+    testMulti(StateVariableFilterParams<float>::Mode::HiPass);
+    testMulti(StateVariableFilterParams<float>::Mode::Notch);
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 
+#include "asserts.h"
+#include "CompiledGrammar.h"
 #include "GenerativeTriggerGenerator.h"
+#include "GrammarCache.h"
 #include "StochasticGrammar.h"
 #include "TriggerSequencer.h"
 
@@ -466,11 +469,233 @@ static void gtg1()
     }
 }
 
+/********************************************************************************************
+* CompiledGrammar
+**********************************************************************************************/
 
+// every grammar in the dictionary should fill exactly two bars with terminals
+static void cg0()
+{
+    for (int i = 0; i < StochasticGrammarDictionary::getNumGrammars(); ++i) {
+        StochasticGrammarDictionary::Grammar g = StochasticGrammarDictionary::getGrammar(i);
+        CompiledGrammar cg;
+        cg.compile(g.rules, g.numRules, g.firstRule);
+        assert(cg.isCompiled());
+
+        auto r = AudioMath::random();
+        GKEY keys[GenerativeTriggerGenerator::maxEvents];
+        for (int j = 0; j < 100; ++j) {
+            const int n = cg.generate(r, keys, GenerativeTriggerGenerator::maxEvents);
+            assertGT(n, 0);
+            int duration = 0;
+            for (int k = 0; k < n; ++k) {
+                duration += ProductionRuleKeys::getDuration(keys[k]);
+                assertEQ(cg.getDuration(keys[k]), ProductionRuleKeys::getDuration(keys[k]));
+            }
+            assertEQ(duration, ProductionRuleKeys::getDuration(g.firstRule));
+        }
+    }
+}
 
+// a three way rule should come out with the right probabilities
+static void cg1()
+{
+    static ProductionRule rules[numRules];
+    {
+        ProductionRule& r = rules[sg_q];
+        r.entries[0].probability = .3f;
+        r.entries[0].code = sg_ee;
+        r.entries[1].probability = .7f;
+        r.entries[1].code = sg_e3e3e3;
+        r.entries[2].probability = 1.0f;
+        r.entries[2].code = sg_invalid;
+    }
+    rules[sg_e].makeTerminal();
+    rules[sg_e3].makeTerminal();
+
+    CompiledGrammar cg;
+    cg.compile(rules, numRules, sg_q);
+
+    // number of keys tells us which production fired
+    int counts[4] = {0};
+    auto r = AudioMath::random();
+    GKEY keys[4];
+    const int iterations = 20000;
+    for (int i = 0; i < iterations; ++i) {
+        const int n = cg.generate(r, keys, 4);
+        assert(n >= 1 && n <= 3);
+        counts[n]++;
+    }
+    assertClose(float(counts[1]) / iterations, .3f, .02);
+    assertClose(float(counts[2]) / iterations, .3f, .02);
+    assertClose(float(counts[3]) / iterations, .4f, .02);
+}
+
+static std::vector<bool> getClocks(GenerativeTriggerGenerator& gtg)
+{
+    std::vector<bool> ret;
+    for (int i = 0; i < 5000; ++i) {
+        ret.push_back(gtg.clock());
+    }
+    return ret;
+}
+
+// same seed, same rhythm
+static void cgSeed()
+{
+    StochasticGrammarDictionary::Grammar g = StochasticGrammarDictionary::getGrammar(3);
+    GenerativeTriggerGenerator gtg1(AudioMath::random(), g.rules, g.numRules, g.firstRule);
+    GenerativeTriggerGenerator gtg2(AudioMath::random(), g.rules, g.numRules, g.firstRule);
+    GenerativeTriggerGenerator gtg3(AudioMath::random(), g.rules, g.numRules, g.firstRule);
+    gtg1.seed(1234);
+    gtg2.seed(1234);
+    gtg3.seed(5678);
+
+    auto c1 = getClocks(gtg1);
+    auto c2 = getClocks(gtg2);
+    auto c3 = getClocks(gtg3);
+    assert(c1 == c2);
+    assert(c1 != c3);
+}
 
 
 
+
+
+/********************************************************************************************
+* GrammarCache
+**********************************************************************************************/
+
+static void testFromString()
+{
+    for (GKEY key = sg_first; key <= sg_last; ++key) {
+        assertEQ(ProductionRuleKeys::fromString(ProductionRuleKeys::toString(key)), key);
+    }
+    assertEQ(ProductionRuleKeys::fromString("not a key"), sg_invalid);
+}
+
+/**
+ * test parser: text is the index of a dictionary grammar.
+ */
+static std::string dictionaryParser(const std::string& text, ProductionRule * rules, GKEY& firstRule, int& calls)
+{
+    ++calls;
+    const int index = text[0] - '0';
+    if (index < 0 || index >= StochasticGrammarDictionary::getNumGrammars()) {
+        return "bad index";
+    }
+    auto g = StochasticGrammarDictionary::getGrammar(index);
+    for (int i = 0; i < g.numRules; ++i) {
+        rules[i] = g.rules[i];
+    }
+    firstRule = g.firstRule;
+    return "";
+}
+
+static void testCache()
+{
+    int calls = 0;
+    GrammarCache::Parser parser = [&calls](const std::string& text, ProductionRule * rules, GKEY& firstRule) {
+        return dictionaryParser(text, rules, firstRule, calls);
+    };
+
+    GrammarCache cache;
+    std::string error;
+    auto g0 = cache.get("0", parser, error);
+    assert(g0);
+    assert(error.empty());
+    assertEQ(calls, 1);
+
+    auto g1 = cache.get("1", parser, error);
+    assert(g1);
+    assertEQ(calls, 2);
+    assert(g0 != g1);
+
+    // second time comes from the cache
+    auto g0b = cache.get("0", parser, error);
+    assertEQ(calls, 2);
+    assert(g0 == g0b);
+    assert(cache.find(GrammarCache::hash("0")) == g0);
+    assert(!cache.find(GrammarCache::hash("2")));
+    assertEQ(cache.size(), 2);
+
+    auto bad = cache.get("9", parser, error);
+    assert(!bad);
+    assertEQ(error, "bad index");
+    assertEQ(cache.size(), 2);
+}
+
+static void testCachedGrammarInGtg()
+{
+    int calls = 0;
+    GrammarCache::Parser parser = [&calls](const std::string& text, ProductionRule * rules, GKEY& firstRule) {
+        return dictionaryParser(text, rules, firstRule, calls);
+    };
+    GrammarCache cache;
+    std::string error;
+
+    // grammar 0 is all quarter notes
+    GKEY key = init1();
+    GenerativeTriggerGenerator gtg(AudioMath::random(), rules, numRules, key);
+    gtg.setGrammar(cache.get("0", parser, error));
+    int ct = 0;
+    for (int i = 0; i < 10000; ++i) {
+        if (gtg.clock()) {
+            if (i > PPQ * 8) {
+                assertEQ(ct, PPQ);
+            }
+            ct = 0;
+        }
+        ct++;
+    }
+}
+
+static void testValidate()
+{
+    {
+        static ProductionRule rules[numRules];
+        rules[sg_w].makeTerminal();
+        assertEQ(GrammarCache::validate(rules, numRules, sg_w), "");
+        assertNE(GrammarCache::validate(rules, numRules, sg_invalid), "");
+    }
+    {
+        // time not conserved
+        static ProductionRule rules[numRules];
+        rules[sg_w].entries[0].probability = 1;
+        rules[sg_w].entries[0].code = sg_qq;
+        rules[sg_q].makeTerminal();
+        assertNE(GrammarCache::validate(rules, numRules, sg_w), "");
+    }
+    {
+        // h is used, but has no rule
+        static ProductionRule rules[numRules];
+        rules[sg_w].entries[0].probability = 1;
+        rules[sg_w].entries[0].code = sg_hh;
+        assertNE(GrammarCache::validate(rules, numRules, sg_w), "");
+        rules[sg_h].makeTerminal();
+        assertEQ(GrammarCache::validate(rules, numRules, sg_w), "");
+    }
+    {
+        // doesn't add up to one
+        static ProductionRule rules[numRules];
+        rules[sg_w].entries[0].probability = .5;
+        assertNE(GrammarCache::validate(rules, numRules, sg_w), "");
+    }
+    {
+        // produces itself
+        static ProductionRule rules[numRules];
+        rules[sg_q].entries[0].probability = 1;
+        rules[sg_q].entries[0].code = sg_q;
+        assertNE(GrammarCache::validate(rules, numRules, sg_q), "");
+    }
+
+    for (int i = 0; i < StochasticGrammarDictionary::getNumGrammars(); ++i) {
+        StochasticGrammarDictionary::Grammar g = StochasticGrammarDictionary::getGrammar(i);
+        assertEQ(GrammarCache::validate(g.rules, g.numRules, g.firstRule), "");
+    }
+}
+
+
 void testStochasticGrammar()
 {
     test0();
@@ -495,4 +720,13 @@ void testStochasticGrammar()
     gtg0();
     gtg1();
 
+    cg0();
+    cg1();
+    cgSeed();
+
+    testFromString();
+    testValidate();
+    testCache();
+    testCachedGrammarInGtg();
+
 }
\ No newline at end of file
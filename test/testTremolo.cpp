@@ -3,6 +3,9 @@
 #include "Tremolo.h"
 #include "TestComposite.h"
 
+#include <cmath>
+#include <vector>
+
 using Trem = Tremolo<TestComposite>;
 
 static void test0()
@@ -43,8 +46,106 @@ static void test1()
     test1Sub(-5);
 }
 
+static Trem makePoly(int channels)
+{
+    Trem t;
+    t.setSampleRate(44100);
+    t.init();
+    t.params[Trem::CLOCK_MULT_PARAM].value = 4;        // free run
+    t.params[Trem::LFO_RATE_PARAM].value = 5;
+    t.params[Trem::MOD_DEPTH_PARAM].value = 5;
+    t.params[Trem::LFO_PHASE_TRIM_PARAM].value = 1;
+    t.inputs[Trem::AUDIO_INPUT].channels = channels;
+    t.outputs[Trem::AUDIO_OUTPUT].channels = 1;
+    for (int i = 0; i < channels; ++i) {
+        t.inputs[Trem::AUDIO_INPUT].setVoltage(1, i);
+    }
+    return t;
+}
+
+// mono phase CV - all the channels get the same modulation
+static void testPolyMonoPhase()
+{
+    Trem t = makePoly(5);
+    t.inputs[Trem::AUDIO_INPUT].setVoltage(2, 4);
+    for (int i = 0; i < 1000; ++i) {
+        t.step();
+        const float x = t.outputs[Trem::AUDIO_OUTPUT].getVoltage(0);
+        for (int ch = 1; ch < 4; ++ch) {
+            assertEQ(t.outputs[Trem::AUDIO_OUTPUT].getVoltage(ch), x);
+        }
+        assertEQ(t.outputs[Trem::AUDIO_OUTPUT].getVoltage(4), 2 * x);
+    }
+    assertEQ(int(t.outputs[Trem::AUDIO_OUTPUT].channels), 5);
+}
+
+// channel 0 with poly phase CV should match the mono one
+static void testPolyPhaseMatchesMono()
+{
+    Trem mono = makePoly(1);
+    Trem poly = makePoly(6);
+    poly.inputs[Trem::LFO_PHASE_INPUT].channels = 6;
+    for (int i = 0; i < 6; ++i) {
+        poly.inputs[Trem::LFO_PHASE_INPUT].setVoltage(i, i);
+    }
+    for (int i = 0; i < 2000; ++i) {
+        mono.step();
+        poly.step();
+        assertClose(poly.outputs[Trem::AUDIO_OUTPUT].getVoltage(0),
+            mono.outputs[Trem::AUDIO_OUTPUT].getVoltage(0), .001);
+    }
+}
+
+// each channel should be a phase shifted version of channel 0
+static void testPolyPhaseShift()
+{
+    const int channels = 5;
+    Trem t = makePoly(channels);
+    t.inputs[Trem::LFO_PHASE_INPUT].channels = channels;
+
+    // phase range is +-5 volts for +-1 cycle, so .5V is 1/10 cycle
+    for (int i = 0; i < channels; ++i) {
+        t.inputs[Trem::LFO_PHASE_INPUT].setVoltage(.5f * i, i);
+    }
+
+    std::vector<float> data[channels];
+    for (int i = 0; i < 20000; ++i) {
+        t.step();
+        for (int ch = 0; ch < channels; ++ch) {
+            data[ch].push_back(t.outputs[Trem::AUDIO_OUTPUT].getVoltage(ch));
+        }
+    }
+
+    // find the period from channel 0's minimums
+    std::vector<int> minimums;
+    for (int i = 1; i < int(data[0].size()) - 1; ++i) {
+        if (data[0][i] < data[0][i - 1] && data[0][i] <= data[0][i + 1]) {
+            minimums.push_back(i);
+        }
+    }
+    assertGT(minimums.size(), 3);
+    const int period = minimums[2] - minimums[1];
+
+    // channel n should be the same as channel 0, n/10 cycle later
+    for (int ch = 1; ch < channels; ++ch) {
+        const int shift = int(std::round(period * ch / 10.f));
+        int matches = 0;
+        for (int delta = shift - 2; delta <= shift + 2; ++delta) {
+            const int i = minimums[2];
+            if (std::abs(data[ch][i - delta] - data[0][i]) < .01) {
+                ++matches;
+            }
+        }
+        assertGT(matches, 0);
+        assertNE(data[ch][minimums[2]], data[0][minimums[2]]);
+    }
+}
+
 void testTremolo()
 {
     test0();
     test1();
+    testPolyMonoPhase();
+    testPolyPhaseMatchesMono();
+    testPolyPhaseShift();
 }
\ No newline at end of file
@@ -229,6 +229,40 @@ static void testClamp()
     assertEQ(std::clamp(12, 13, 15), 13);
 }
 
+static void testPolyCh()
+{
+    CH vco;
+    vco.params[CH::PARAM_EXTGAIN].value = .63108f;
+    vco.params[CH::PARAM_H0].value = 1;
+    vco.params[CH::PARAM_H2].value = 1;
+    vco.params[CH::PARAM_SLOPE].value = 5;
+    vco.params[CH::PARAM_MAG_EVEN].value = 5;
+    vco.params[CH::PARAM_MAG_ODD].value = 5;
+    vco.outputs[CH::MIX_OUTPUT].channels = 1;
+    vco.inputs[CH::CV_INPUT].channels = 3;
+    vco.inputs[CH::CV_INPUT].setVoltage(0, 0);
+    vco.inputs[CH::CV_INPUT].setVoltage(1, 1);
+    vco.inputs[CH::CV_INPUT].setVoltage(0, 2);
+
+    float sum[3] = {0};
+    for (int i = 0; i < 1000; ++i) {
+        vco.step();
+        for (int channel = 0; channel < 3; ++channel) {
+            const float x = vco.outputs[CH::MIX_OUTPUT].getVoltage(channel);
+            sum[channel] += std::abs(x);
+        }
+    }
+    assertEQ(vco.outputs[CH::MIX_OUTPUT].getChannels(), 3);
+    assertGT(sum[0], 10);
+    assertGT(sum[1], 10);
+
+    // channels 0 and 2 have the same pitch, so should be the same
+    assertEQ(sum[0], sum[2]);
+
+    // channel 1 is an octave higher
+    assertNE(sum[0], sum[1]);
+}
+
 #if 1
 void testVCO()
 {
@@ -243,6 +277,7 @@ void testVCO()
     testClamp();
   //  testTuneEv();
     testTuneCh();
+    testPolyCh();
 }
 #else
 void testVCO()
@@ -294,6 +294,133 @@ static void testVocalFilter()
     }
 }
 
+/**
+ * Each channel of a poly vocal filter should sound like a mono one.
+ */
+static void testVocalFilterPoly()
+{
+    using VF = VocalFilter<TestComposite>;
+    const int numChannels = 6;
+    VF poly;
+    VF mono[numChannels];
+
+    poly.setSampleRate(44100);
+    poly.init();
+    poly.inputs[VF::AUDIO_INPUT].channels = numChannels;
+    poly.inputs[VF::FILTER_VOWEL_CV_INPUT].channels = numChannels;
+    poly.outputs[VF::AUDIO_OUTPUT].channels = 1;
+    for (int c = 0; c < numChannels; ++c) {
+        mono[c].setSampleRate(44100);
+        mono[c].init();
+        mono[c].inputs[VF::AUDIO_INPUT].channels = 1;
+        mono[c].outputs[VF::AUDIO_OUTPUT].channels = 1;
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        for (int c = 0; c < numChannels; ++c) {
+            const float vowel = -5.f + c * 1.5f + i * .001f;
+            const float x = (i % (20 + c)) < 10 ? 1.f : -1.f;
+            poly.inputs[VF::AUDIO_INPUT].setVoltage(x, c);
+            poly.inputs[VF::FILTER_VOWEL_CV_INPUT].setVoltage(vowel, c);
+            mono[c].inputs[VF::AUDIO_INPUT].setVoltage(x, 0);
+            mono[c].inputs[VF::FILTER_VOWEL_CV_INPUT].setVoltage(vowel, 0);
+            mono[c].step();
+        }
+        poly.step();
+        assertEQ(int(poly.outputs[VF::AUDIO_OUTPUT].channels), numChannels);
+        for (int c = 0; c < numChannels; ++c) {
+            assertClose(poly.outputs[VF::AUDIO_OUTPUT].getVoltage(c),
+                mono[c].outputs[VF::AUDIO_OUTPUT].getVoltage(0), .001);
+        }
+    }
+}
+
+/**
+ * Formant tables should only be used when the vowel moves.
+ */
+static void testFormantCache()
+{
+    using VF = VocalFilter<TestComposite>;
+    VF vf;
+    vf.setSampleRate(44100);
+    vf.init();
+    vf.inputs[VF::AUDIO_INPUT].channels = 4;
+
+    // with mono CV, only one channel needs the tables
+    for (int i = 0; i < 100; ++i) {
+        vf.step();
+    }
+    assertEQ(vf.formantCacheMisses, 1);
+
+    // less than one quantization step - no change
+    vf.params[VF::FILTER_VOWEL_PARAM].value = .1f / VF::vowelSteps;
+    for (int i = 0; i < 100; ++i) {
+        vf.step();
+    }
+    assertEQ(vf.formantCacheMisses, 1);
+
+    vf.params[VF::FILTER_VOWEL_PARAM].value = 1;
+    for (int i = 0; i < 100; ++i) {
+        vf.step();
+    }
+    assertEQ(vf.formantCacheMisses, 2);
+
+    vf.params[VF::FILTER_MODEL_SELECT_PARAM].value = 3;
+    for (int i = 0; i < 100; ++i) {
+        vf.step();
+    }
+    assertEQ(vf.formantCacheMisses, 3);
+
+    // poly vowel CV - each channel has its own
+    vf.inputs[VF::FILTER_VOWEL_CV_INPUT].channels = 4;
+    for (int i = 0; i < 100; ++i) {
+        vf.step();
+    }
+    assertEQ(vf.formantCacheMisses, 6);
+}
+
+/**
+ * Each channel of a poly animator should sound like a mono one.
+ */
+static void testAnimatorPoly()
+{
+    const int numChannels = 5;
+    Animator poly;
+    Animator mono[numChannels];
+
+    poly.setSampleRate(44100);
+    poly.init();
+    poly.inputs[Animator::AUDIO_INPUT].channels = numChannels;
+    poly.inputs[Animator::FILTER_FC_CV_INPUT].channels = numChannels;
+    poly.inputs[Animator::FILTER_Q_CV_INPUT].channels = numChannels;
+    poly.outputs[Animator::AUDIO_OUTPUT].channels = 1;
+    for (int c = 0; c < numChannels; ++c) {
+        mono[c].setSampleRate(44100);
+        mono[c].init();
+        mono[c].inputs[Animator::AUDIO_INPUT].channels = 1;
+        mono[c].outputs[Animator::AUDIO_OUTPUT].channels = 1;
+        mono[c].inputs[Animator::FILTER_FC_CV_INPUT].setVoltage(c - 2.f, 0);
+        mono[c].inputs[Animator::FILTER_Q_CV_INPUT].setVoltage(c * .7f, 0);
+        poly.inputs[Animator::FILTER_FC_CV_INPUT].setVoltage(c - 2.f, c);
+        poly.inputs[Animator::FILTER_Q_CV_INPUT].setVoltage(c * .7f, c);
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        for (int c = 0; c < numChannels; ++c) {
+            const float x = (i % (20 + c)) < 10 ? 1.f : -1.f;
+            poly.inputs[Animator::AUDIO_INPUT].setVoltage(x, c);
+            mono[c].inputs[Animator::AUDIO_INPUT].setVoltage(x, 0);
+            mono[c].step();
+        }
+        poly.step();
+        assertEQ(int(poly.outputs[Animator::AUDIO_OUTPUT].channels), numChannels);
+        for (int c = 0; c < numChannels; ++c) {
+            assertClose(poly.outputs[Animator::AUDIO_OUTPUT].getVoltage(c),
+                mono[c].outputs[Animator::AUDIO_OUTPUT].getVoltage(0), .001);
+        }
+    }
+}
+
 static void testInputExtremes()
 {
     VocalAnimator<TestComposite> va;
@@ -363,6 +490,9 @@ void testVocalAnimator()
     testFormantTables2();
 
     testVocalFilter();
+    testVocalFilterPoly();
+    testFormantCache();
+    testAnimatorPoly();
 #if defined(_DEBUG) && true
     printf("skipping extremes\n");
 #else